@@ -131,12 +131,31 @@ namespace mulex
 		}
 	}
 
-	void MxBackend::registerEvent(const std::string& name)
+	EvtHandle MxBackend::registerEvent(const std::string& name)
 	{
 		if(_init_ok && _experiment)
 		{
-			_experiment->_evt_client->regist(name);
+			return _experiment->_evt_client->regist(name);
 		}
+		return {};
+	}
+
+	EvtHandle MxBackend::findEvent(const std::string& name)
+	{
+		if(_init_ok && _experiment)
+		{
+			return _experiment->_evt_client->findEvent(name);
+		}
+		return {};
+	}
+
+	EvtFrame MxBackend::reserveEvent(const EvtHandle& evt, std::uint64_t size)
+	{
+		if(_init_ok && _experiment)
+		{
+			return _experiment->_evt_client->reserve(evt, size);
+		}
+		return {};
 	}
 
 	void MxBackend::dispatchEvent(const std::string& evt, const std::uint8_t* data, std::uint64_t size)
@@ -153,11 +172,40 @@ namespace mulex
 		dispatchEvent(evt, data.data(), data.size());
 	}
 
-	void MxBackend::subscribeEvent(const std::string& evt, EvtClientThread::EvtCallbackFunc func)
+	void MxBackend::dispatchEvent(const EvtHandle& evt, const std::uint8_t* data, std::uint64_t size)
+	{
+		if(_init_ok && _experiment)
+		{
+			_experiment->_evt_client->emit(evt, data, size);
+		}
+	}
+
+	void MxBackend::dispatchEvent(const EvtHandle& evt, const std::vector<std::uint8_t>& data)
+	{
+		dispatchEvent(evt, data.data(), data.size());
+	}
+
+	void MxBackend::subscribeEvent(const std::string& evt, EvtClientThread::EvtCallbackFunc func, EvtSubscriptionPolicy policy, const std::string& filter)
+	{
+		if(_init_ok && _experiment)
+		{
+			_experiment->_evt_client->subscribe(evt, func, policy, filter);
+		}
+	}
+
+	void MxBackend::subscribeEventChunked(const std::string& evt, EvtClientThread::EvtChunkCallbackFunc func, EvtSubscriptionPolicy policy, const std::string& filter)
 	{
 		if(_init_ok && _experiment)
 		{
-			_experiment->_evt_client->subscribe(evt, func);
+			_experiment->_evt_client->subscribeChunked(evt, func, policy, filter);
+		}
+	}
+
+	void MxBackend::subscribeEventGroup(const std::string& evt, const EvtConsumerGroup& group, EvtClientThread::EvtCallbackFunc func, EvtSubscriptionPolicy policy)
+	{
+		if(_init_ok && _experiment)
+		{
+			_experiment->_evt_client->subscribeGroup(evt, group, func, policy);
 		}
 	}
 
@@ -169,12 +217,46 @@ namespace mulex
 		}
 	}
 
+	bool MxBackend::retainEvent(const std::string& evt, std::uint32_t count)
+	{
+		if(_init_ok && _experiment)
+		{
+			return _experiment->_rpc_client->call<bool>(RPC_CALL_MULEX_EVTSETRETENTION, string32(evt), count);
+		}
+		return false;
+	}
+
+	std::vector<std::vector<std::uint8_t>> MxBackend::fetchRetainedEvent(const std::string& evt)
+	{
+		std::vector<std::vector<std::uint8_t>> events;
+		if(!_init_ok || !_experiment)
+		{
+			return events;
+		}
+
+		std::vector<std::uint8_t> data = _experiment->_rpc_client->call<RPCGenericType>(RPC_CALL_MULEX_EVTFETCHRETAINED, string32(evt));
+		std::uint64_t offset = 0;
+		while(offset + sizeof(std::uint64_t) <= data.size())
+		{
+			std::uint64_t size;
+			std::memcpy(&size, data.data() + offset, sizeof(std::uint64_t));
+			offset += sizeof(std::uint64_t);
+			if(offset + size > data.size())
+			{
+				break;
+			}
+			events.emplace_back(data.begin() + offset, data.begin() + offset + size);
+			offset += size;
+		}
+		return events;
+	}
+
 	void MxBackend::registerUserRpcEvent()
 	{
 		std::string rpc_event = std::string(SysGetBinaryName()) + "::rpc";
 		std::string rpc_response = std::string(SysGetBinaryName()) + "::rpc_res";
 		registerEvent(rpc_event);
-		registerEvent(rpc_response);
+		_user_rpc_response = registerEvent(rpc_response);
 		subscribeEvent(rpc_event, [this](auto* data, auto len, auto*){
 			this->userRpcInternal(data, len, nullptr);
 		});
@@ -182,8 +264,7 @@ namespace mulex
 
 	void MxBackend::emitRpcResponse(const RPCGenericType& data)
 	{
-		static std::string rpc_response = std::string(SysGetBinaryName()) + "::rpc_res";
-		dispatchEvent(rpc_response, data._data);
+		dispatchEvent(_user_rpc_response, data._data);
 	}
 
 	void MxBackend::userRpcInternal(const std::uint8_t* data, std::uint64_t len, const std::uint8_t* udata)
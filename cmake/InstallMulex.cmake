@@ -8,6 +8,9 @@ macro(install_mulex)
 	# Install rex remote executioner
 	install(TARGETS mxrexs DESTINATION bin)
 
+	# Install event journal replay tool
+	install(TARGETS mxreplay DESTINATION bin)
+
 	# Common includes
 	install(FILES network/socket.h DESTINATION include/network)
 	install(FILES network/rpc.h DESTINATION include/network)
@@ -29,10 +32,12 @@ macro(install_mulex)
 		set_property(TARGET mxmain PROPERTY INSTALL_RPATH_USE_LINK_PATH TRUE)
 		set_property(TARGET mxplug PROPERTY INSTALL_RPATH_USE_LINK_PATH TRUE)
 		set_property(TARGET mxrexs PROPERTY INSTALL_RPATH_USE_LINK_PATH TRUE)
+		set_property(TARGET mxreplay PROPERTY INSTALL_RPATH_USE_LINK_PATH TRUE)
 
 		install(FILES $<TARGET_RUNTIME_DLLS:mxmain> DESTINATION bin)
 		install(FILES $<TARGET_RUNTIME_DLLS:mxplug> DESTINATION bin)
 		install(FILES $<TARGET_RUNTIME_DLLS:mxrexs> DESTINATION bin)
+		install(FILES $<TARGET_RUNTIME_DLLS:mxreplay> DESTINATION bin)
 
 		install(DIRECTORY ${CMAKE_BINARY_DIR}/$<$<CONFIG:Debug>:Debug>$<$<CONFIG:Release>:Release>/ DESTINATION bin FILES_MATCHING PATTERN "*.dll")
 	endif()
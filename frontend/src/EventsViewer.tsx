@@ -25,6 +25,14 @@ interface EventIO {
 
 	lread?: Array<number>;
 	lwrite?: Array<number>;
+
+	// Subscriber queue (clients only)
+	depth?: number;
+	dropped?: number;
+
+	// Messages per second (clients only)
+	mread?: number;
+	mwrite?: number;
 };
 
 interface ClientsIO {
@@ -88,12 +96,12 @@ export const EventsViewer : Component = () => {
 		return name.startsWith('mx') || name.endsWith('::rpc') || name.endsWith('::rpc_res');
 	}
 
-	function computeClientsIO(clients: Uint8Array, frames: Uint8Array) : ClientsIO | undefined {
+	function computeClientsIO(clients: Uint8Array, frames: Uint8Array, depth: Uint8Array, dropped: Uint8Array, messages: Uint8Array) : ClientsIO | undefined {
 		if(clients.length === 0 || frames.length === 0) {
 			return undefined;
 		}
 
-		if(clients.length !== frames.length) {
+		if(clients.length !== frames.length || clients.length !== depth.length || clients.length !== dropped.length || clients.length !== messages.length) {
 			console.error('Failed to compute clients IO from metadata.');
 			return undefined;
 		}
@@ -101,13 +109,24 @@ export const EventsViewer : Component = () => {
 		const cio: ClientsIO = {};
 		const cview = new DataView(clients.buffer, clients.byteOffset, clients.byteLength);
 		const fview = new DataView(frames.buffer, frames.byteOffset, frames.byteLength);
+		const dview = new DataView(depth.buffer, depth.byteOffset, depth.byteLength);
+		const xview = new DataView(dropped.buffer, dropped.byteOffset, dropped.byteLength);
+		const mview = new DataView(messages.buffer, messages.byteOffset, messages.byteLength);
 
 		for(let i = 0; i < clients.byteLength; i += 8) {
 			const coffset = i;// + clients.byteOffset;
 			const foffset = i;// + frames.byteOffset;
 			const { r, w } = event_io_extract(fview.getBigUint64(foffset, true));
+			const m = event_io_extract(mview.getBigUint64(i, true));
 			const key = cview.getBigUint64(coffset, true).toString(16);
-			cio[key] = { read: r, write: w };
+			cio[key] = {
+				read: r,
+				write: w,
+				depth: Number(dview.getBigUint64(i, true)),
+				dropped: Number(xview.getBigUint64(i, true)),
+				mread: m.r,
+				mwrite: m.w
+			};
 		}
 
 		return cio;
@@ -140,13 +159,13 @@ export const EventsViewer : Component = () => {
 
 	async function readEventStatistics() {
 		const data = await MxWebsocket.instance.rpc_call('mulex::EvtGetAllMetadata', [], 'generic');
-		const events = data.unpack(['int16', 'str32', 'uint64', 'bytearray', 'bytearray']);
+		const events = data.unpack(['int16', 'str32', 'uint64', 'bytearray', 'bytearray', 'bytearray', 'bytearray', 'bytearray']);
 
 		for(const event of events) {
-			const [ eid, name, io, clients, frames ] = event;
+			const [ eid, name, io, clients, frames, depth, dropped, messages ] = event;
 
 			const { r, w } = event_io_extract(io);
-			const clientFrames = computeClientsIO(clients, frames);
+			const clientFrames = computeClientsIO(clients, frames, depth, dropped, messages);
 
 			if(!(eid in eventsMeta)) {
 				setEventsMeta(eid, {
@@ -314,6 +333,9 @@ export const EventsViewer : Component = () => {
 											<TableRow>
 												<TableHead>Client ID</TableHead>
 												<TableHead>Client I/O</TableHead>
+												<TableHead>Messages/s</TableHead>
+												<TableHead>Queued</TableHead>
+												<TableHead>Dropped</TableHead>
 											</TableRow>
 										</TableHeader>
 										<TableBody>
@@ -326,6 +348,9 @@ export const EventsViewer : Component = () => {
 															<BadgeDelta class="w-28" deltaType="decrease">{bps_to_string(client[1].read, false)}</BadgeDelta>
 														</span>
 													</TableCell>
+													<TableCell class="py-1">{client[1].mwrite ?? 0} / {client[1].mread ?? 0}</TableCell>
+													<TableCell class="py-1">{client[1].depth ?? 0}</TableCell>
+													<TableCell class="py-1">{client[1].dropped ?? 0}</TableCell>
 												</TableRow>
 											}</For>
 										</TableBody>
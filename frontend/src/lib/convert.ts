@@ -77,19 +77,13 @@ export class MxGenericType
 	static fromValue(value: any, type: string, intype: string = 'native') : MxGenericType {
 		let data: Uint8Array;
 		if(type === 'string32') {
-			const encoder = new TextEncoder();
-			data = new Uint8Array(32);
-			data.set(encoder.encode(value + '\0'), 0);
+			data = MxGenericType.encodeString(value, 32, intype);
 		}
 		else if(type === 'string128') {
-			const encoder = new TextEncoder();
-			data = new Uint8Array(128);
-			data.set(encoder.encode(value + '\0'), 0);
+			data = MxGenericType.encodeString(value, 128, intype);
 		}
 		else if(type === 'string512') {
-			const encoder = new TextEncoder();
-			data = new Uint8Array(512);
-			data.set(encoder.encode(value + '\0'), 0);
+			data = MxGenericType.encodeString(value, 512, intype);
 		}
 		else if(type === 'int8') {
 			data = new Uint8Array((new Int8Array([value])).buffer);
@@ -142,6 +136,22 @@ export class MxGenericType
 		return new MxGenericType(data, intype);
 	}
 
+	// NOTE: (Cesar) As an rpc argument ('native') a string goes as [u16 length][bytes]
+	//				 Values stored in the rdb ('generic') keep the fixed size layout
+	private static encodeString(value: string, size: number, intype: string) : Uint8Array {
+		const encoded = new TextEncoder().encode(value).subarray(0, size - 1);
+		if(intype === 'native') {
+			const data = new Uint8Array(2 + encoded.length);
+			new DataView(data.buffer).setUint16(0, encoded.length, true);
+			data.set(encoded, 2);
+			return data;
+		}
+
+		const data = new Uint8Array(size);
+		data.set(encoded, 0);
+		return data;
+	}
+
 	static concatData(args: Array<MxGenericType>) : Uint8Array {
 		// Skip if we only have one argument (this won't be that uncommon)
 		if(args.length === 1) {
@@ -2,16 +2,27 @@ import { MxWebsocket } from './websocket';
 
 type MxEventCallback = (data: Uint8Array) => void;
 
+// Server side rate limit for the subscription (see docs/events.md)
+// envelope delivers the minimums followed by the maximums of every sample over the window
+export type MxEventRateLimit = {
+	rate: number; // Hz
+	decimation?: 'latest' | 'nth' | 'envelope';
+	sample?: 'u8' | 'i8' | 'u16' | 'i16' | 'u32' | 'i32' | 'u64' | 'i64' | 'f32' | 'f64';
+	nth?: number;
+};
+
 export class MxEvent {
 	private ename: string;
+	private limit: MxEventRateLimit | undefined;
 	private onCloseCb: (() => void) | undefined;
 
 	private static finalizer = new FinalizationRegistry((onClose : () => void) => {
 		onClose();
 	});
 
-	public constructor(name: string) {
+	public constructor(name: string, limit?: MxEventRateLimit) {
 		this.ename = name;
+		this.limit = limit;
 	}
 
 	public get name() {
@@ -19,7 +30,7 @@ export class MxEvent {
 	}
 
 	public set onMessage(func: MxEventCallback) {
-		MxWebsocket.instance.subscribe(this.ename, func);
+		MxWebsocket.instance.subscribe(this.ename, func, this.limit);
 
 		this.onCloseCb = () => {
 			MxWebsocket.instance.unsubscribe(this.ename);
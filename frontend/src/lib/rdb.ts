@@ -71,12 +71,20 @@ export class MxRdb {
 		MxWebsocket.instance.rpc_call('mulex::RdbDeleteValueDirect', [MxGenericType.str512(tkey)], 'none');
 	}
 
+	// Splits the payload of a watch event (mxevt::rdbw-*) into key and value
+	public static decodeWatchEvent(data: Uint8Array) : [string, MxGenericType] {
+		// [u16 keysize][key][u64 datasize][data]
+		const keysize = new DataView(data.buffer, data.byteOffset, data.byteLength).getUint16(0, true);
+		const key = new TextDecoder().decode(data.subarray(2, 2 + keysize));
+		const value = MxGenericType.fromData(data.subarray(2 + keysize), 'generic');
+		return [key, value];
+	}
+
 	public watch(key: string, callback: Function) {
 		const tkey = this.root + key;
 		MxWebsocket.instance.rpc_call('mulex::RdbWatch', [MxGenericType.str512(tkey)]).then((response) => {
 			MxWebsocket.instance.subscribe(response.astype('string'), (data: Uint8Array) => {
-				const skey = MxGenericType.fromData(data).astype('string');
-				const svalue = MxGenericType.fromData(data.subarray(512), 'generic');
+				const [skey, svalue] = MxRdb.decodeWatchEvent(data);
 				callback(skey, svalue);
 			});
 		});
@@ -1,4 +1,5 @@
 import { MxGenericType } from './convert';
+import type { MxEventRateLimit } from './event';
 
 export class MxWebsocket {
 	private socket: WebSocket;
@@ -10,6 +11,7 @@ export class MxWebsocket {
 	private address: string;
 	private on_change: Array<Function>;
 	private event_subscriptions: Map<string, Function | undefined>;
+	private queued_calls: Array<object>;
 
 	private setupOnClose(reconnect: boolean) {
 		this.socket.onclose = async () => {
@@ -19,6 +21,7 @@ export class MxWebsocket {
 			this.deferred_p = new Map<number, [Function, Function, string]>();
 			this.isready = false;
 			this.waiting_p = new Array<Function>();
+			this.queued_calls = new Array<object>();
 
 			if(reconnect) {
 				// Attempt reconnect
@@ -40,33 +43,12 @@ export class MxWebsocket {
 
 		this.socket.onmessage = async (message: MessageEvent) => {
 			const data = JSON.parse(await message.data.text());
-			let fail = false;
 
 			if(data.type === "rpc")	{
-				if(data.status != "OK") {
-					console.log(`MxWebsocket did not execute call.`);
-					console.log('Reason: ', data.status);
-					fail = true;
-				}
-
-				// Push to rpc return value queue
-				if(!this.deferred_p.has(data.messageid)) {
-					// Error
-					console.log(`MxWebsocket did not expect server message with id: ${data.messageid}`);
-					console.log('Data: ', data);
-				}
-				else {
-					const resolve = this.deferred_p.get(data.messageid);
-					if(resolve) {
-						if(!fail) {
-							resolve[0](this.make_rpc_response(data, resolve[2]));
-						}
-						else {
-							resolve[1]("No permissions to execute.");
-						}
-					}
-					this.deferred_p.delete(data.messageid);
-				}
+				this.resolve_rpc(data);
+			}
+			else if(data.type === "rpc_batch") {
+				data.results.forEach((result: any) => this.resolve_rpc(result));
 			}
 			else if(data.type === "evt") {
 				// Push to subscribed events queue
@@ -97,6 +79,7 @@ export class MxWebsocket {
 		this.waiting_p = new Array<Function>();
 		this.on_change = new Array<Function>();
 		this.event_subscriptions = new Map<string, Function>();
+		this.queued_calls = new Array<object>();
 
 		this.setupCallbacks();
 	}
@@ -134,23 +117,19 @@ export class MxWebsocket {
 			await this.when_ready();
 		}
 		return new Promise<MxGenericType>((resolve, reject) => {
-			// Send the data via websocket
-			this.socket.send(data);
-
 			// Defer the response
 			this.deferred_p.set(id, [resolve, reject, response]);
-			// if(response !== 'none') {
-			// 	// Defer the response
-			// }
-			// else {
-			// 	// Resolve now with no response
-			// 	resolve(MxGenericType.fromData(new Uint8Array([]), response));
-			// }
+
+			// Calls made in the same tick are sent together as a single batch
+			this.queued_calls.push(data);
+			if(this.queued_calls.length === 1) {
+				queueMicrotask(() => this.flush_calls());
+			}
 		});
 	}
 
-	public async subscribe(event: string, callback: Function | undefined) {
-		const data: string = this.make_evt_message(event, 0);
+	public async subscribe(event: string, callback: Function | undefined, limit?: MxEventRateLimit) {
+		const data: string = this.make_evt_message(event, 0, limit);
 		if(!this.isready) {
 			await this.when_ready();
 		}
@@ -188,7 +167,46 @@ export class MxWebsocket {
 		}
 	}
 
-	private make_rpc_message(method: string, args: Array<MxGenericType>, response: boolean): [string, number] {
+	private flush_calls() {
+		const calls = this.queued_calls;
+		this.queued_calls = new Array<object>();
+		if(calls.length === 1) {
+			this.socket.send(JSON.stringify(calls[0]));
+		}
+		else if(calls.length > 1) {
+			this.socket.send(JSON.stringify({'type': 2, 'calls': calls}));
+		}
+	}
+
+	private resolve_rpc(data: any) {
+		let fail = false;
+		if(data.status != "OK") {
+			console.log(`MxWebsocket did not execute call.`);
+			console.log('Reason: ', data.status);
+			fail = true;
+		}
+
+		// Push to rpc return value queue
+		if(!this.deferred_p.has(data.messageid)) {
+			// Error
+			console.log(`MxWebsocket did not expect server message with id: ${data.messageid}`);
+			console.log('Data: ', data);
+		}
+		else {
+			const resolve = this.deferred_p.get(data.messageid);
+			if(resolve) {
+				if(!fail) {
+					resolve[0](this.make_rpc_response(data, resolve[2]));
+				}
+				else {
+					resolve[1]("No permissions to execute.");
+				}
+			}
+			this.deferred_p.delete(data.messageid);
+		}
+	}
+
+	private make_rpc_message(method: string, args: Array<MxGenericType>, response: boolean): [object, number] {
 		const id = this.messageid++;
 		// const tdec = new TextDecoder('iso8859-2');
 		// const tdec = new TextDecoder();
@@ -205,10 +223,10 @@ export class MxWebsocket {
 
 		if(args.length > 0) {
 			// console.log(MxGenericType.concatData(args));
-			return [JSON.stringify({'type': 0, 'method': method, 'args': rawData, 'messageid': id, 'response': response}), id];
+			return [{'type': 0, 'method': method, 'args': rawData, 'messageid': id, 'response': response}, id];
 		}
 		else {
-			return [JSON.stringify({'type': 0, 'method': method, 'messageid': id, 'response': response}), id];
+			return [{'type': 0, 'method': method, 'messageid': id, 'response': response}, id];
 		}
 	}
 
@@ -216,7 +234,15 @@ export class MxWebsocket {
 		return MxGenericType.fromData(new Uint8Array(data.response), response);
 	}
 
-	private make_evt_message(event: string, opcode: number) {
+	private make_evt_message(event: string, opcode: number, limit?: MxEventRateLimit) {
+		if(limit) {
+			const decimation = ['latest', 'nth', 'envelope'].indexOf(limit.decimation ?? 'latest');
+			const sample = ['u8', 'i8', 'u16', 'i16', 'u32', 'i32', 'u64', 'i64', 'f32', 'f64'].indexOf(limit.sample ?? 'f32');
+			return JSON.stringify({
+				'type': 1, 'opcode': opcode, 'event': event,
+				'rate': limit.rate, 'decimation': decimation, 'sample': sample, 'nth': limit.nth ?? 0
+			});
+		}
 		return JSON.stringify({'type': 1, 'opcode': opcode, 'event': event});
 	}
 };
@@ -43,9 +43,17 @@ namespace mulex
 		// Events
 		void dispatchEvent(const std::string& evt, const std::uint8_t* data, std::uint64_t size);
 		void dispatchEvent(const std::string& evt, const std::vector<std::uint8_t>& data);
-		void registerEvent(const std::string& evt);
-		void subscribeEvent(const std::string& evt, EvtClientThread::EvtCallbackFunc func);
+		void dispatchEvent(const EvtHandle& evt, const std::uint8_t* data, std::uint64_t size);
+		void dispatchEvent(const EvtHandle& evt, const std::vector<std::uint8_t>& data);
+		EvtHandle registerEvent(const std::string& evt);
+		EvtHandle findEvent(const std::string& evt);
+		EvtFrame reserveEvent(const EvtHandle& evt, std::uint64_t size);
+		void subscribeEvent(const std::string& evt, EvtClientThread::EvtCallbackFunc func, EvtSubscriptionPolicy policy = {}, const std::string& filter = "");
+		void subscribeEventChunked(const std::string& evt, EvtClientThread::EvtChunkCallbackFunc func, EvtSubscriptionPolicy policy = {}, const std::string& filter = "");
+		void subscribeEventGroup(const std::string& evt, const EvtConsumerGroup& group, EvtClientThread::EvtCallbackFunc func, EvtSubscriptionPolicy policy = {});
 		void unsubscribeEvent(const std::string& evt);
+		bool retainEvent(const std::string& evt, std::uint32_t count);
+		std::vector<std::vector<std::uint8_t>> fetchRetainedEvent(const std::string& evt);
 
 		// User RPC
 		template<std::derived_from<MxBackend> D, typename... Args>
@@ -150,6 +158,7 @@ namespace mulex
 
 		// User rpc function
 		std::function<RPCGenericType(const std::vector<std::uint8_t>&)> _user_rpc;
+		EvtHandle _user_rpc_response;
 		// RPCGenericType (MxBackend::*_user_rpc)(const std::vector<std::uint8_t>&) = nullptr;
 
 		// User start/stop
@@ -194,7 +203,9 @@ namespace mulex
 		template<TriviallyCopyable T>
 		inline MxEventBuilder& add(const std::vector<T>& t)
 		{
-			std::for_each(t.begin(), t.end(), [this](const auto& tt){ add(tt); });
+			// Contiguous so a single bulk copy does it
+			const std::uint8_t* ptr = reinterpret_cast<const std::uint8_t*>(t.data());
+			_buffer.insert(_buffer.end(), ptr, ptr + t.size() * sizeof(T));
 			return *this;
 		}
 
@@ -4,18 +4,21 @@
 #include <thread>
 #include <map>
 #include <set>
+#include <array>
 #include <condition_variable>
 #include <mutex>
 
 #include "mxtypes.h"
 // #include "network/socket.h"
 #include "network/rpc.h"
+#include "network/shm.h"
 #include "mxsystem.h"
 
 namespace mulex
 {
 	static constexpr std::uint16_t EVT_PORT = 5702;
 	static constexpr std::uint16_t EVT_RECV_TIMEOUT = 10000; // 10 sec
+	static constexpr std::int64_t  EVT_SHM_ACCEPT_TIMEOUT = 500; // ms
 
 	enum class EvtResult
 	{
@@ -24,33 +27,299 @@ namespace mulex
 		TIMEOUT
 	};
 	
+	// NOTE: (Cesar) flags/totalsize/fragoffset live in what used to be padding
+	// 				 so the header is still 32 bytes and the layout of the old fields is unchanged
 	struct EvtHeader
 	{
-		std::uint64_t client;
-		std::uint16_t eventid;
-		std::uint64_t msgid;
-		std::uint32_t payloadsize;
-		// std::uint8_t  padding[10];
+		std::uint64_t client = 0;
+		std::uint16_t eventid = 0;
+		std::uint8_t  flags = 0;
+		std::uint8_t  reserved = 0;
+		std::uint32_t totalsize = 0;  // Full event size (fragments only)
+		std::uint64_t msgid = 0;
+		std::uint32_t payloadsize = 0;
+		std::uint32_t fragoffset = 0; // Offset of this fragment into the event (fragments only)
 	};
 
 	constexpr std::uint64_t EVT_HEADER_SIZE = sizeof(EvtHeader);
+	static_assert(EVT_HEADER_SIZE == 32, "EvtHeader wire size changed.");
+
+	// NOTE: (Cesar) Events larger than EVT_FRAGMENT_SIZE are split into fragments sharing the same msgid
+	// 				 The server relays fragments as they come and the receivers put them back together
+	// 				 so no connection ever needs a buffer the size of the whole event
+	constexpr std::uint8_t  EVT_FLAG_FRAGMENT = 0x01;
+	constexpr std::uint8_t  EVT_FLAG_LAST_FRAGMENT = 0x02;
+	constexpr std::uint64_t EVT_FRAGMENT_SIZE = 0x40000; // 256KB
+	constexpr std::uint64_t EVT_MAX_EVENT_SIZE = 0xFFFFFFFF;
+
+	// NOTE: (Cesar) Traced events carry EvtTraceStamps behind the payload (counted in payloadsize)
+	// 				 Producer, server and subscriber stamp them with SysGetMonotonicNs() so the
+	// 				 latencies are only meaningful when everyone runs on the same host
+	// 				 Only events that fit in a single frame are traced
+	constexpr std::uint8_t  EVT_FLAG_TRACE = 0x04;
+	constexpr std::int64_t  EVT_TRACE_REPORT_INTERVAL = 1000; // ms
+
+	struct EvtTraceStamps
+	{
+		std::uint64_t _emit = 0;
+		std::uint64_t _server_recv = 0;
+		std::uint64_t _server_send = 0;
+	};
+
+	// NOTE: (Cesar) PRODUCE - emit to server receive
+	// 				 QUEUE   - server receive to server send (subscriber queue)
+	// 				 DELIVER - server send to subscriber receive
+	// 				 TOTAL   - emit to subscriber receive
+	enum class EvtTraceStage : std::uint8_t
+	{
+		PRODUCE,
+		QUEUE,
+		DELIVER,
+		TOTAL,
+		COUNT
+	};
+
+	using EvtTraceHistograms = std::array<SysLatencyHistogram, static_cast<std::size_t>(EvtTraceStage::COUNT)>;
+
+	// Entry returned by EvtGetLatencyStats(), _producer = _consumer = 0 for the event wide histograms
+	struct EvtLatencyEntry
+	{
+		std::uint64_t _producer;
+		std::uint64_t _consumer;
+		std::uint64_t _count;
+		std::uint64_t _p50;
+		std::uint64_t _p90;
+		std::uint64_t _p99;
+		std::uint64_t _p999;
+		std::uint64_t _max;
+		std::uint16_t _eventid;
+		EvtTraceStage _stage;
+	};
 	constexpr std::uint64_t EVT_MAX_SUB = 64;
+	constexpr std::uint64_t EVT_EMIT_QUEUE_SIZE = 4096;
+	constexpr std::uint64_t EVT_EMIT_BATCH_SIZE = 64;
+	constexpr std::uint64_t EVT_EMIT_BATCH_BYTES = 256 * 1024;
+	constexpr std::uint64_t EVT_SUB_QUEUE_DEPTH = 256;
+	constexpr std::int64_t  EVT_DECIMATION_TICK = 5; // ms
+	constexpr std::uint64_t EVT_FRAME_POOL_SIZE = 256;
+	constexpr std::uint64_t EVT_REACTOR_SEND_WINDOW = 64;
+	constexpr std::uint64_t EVT_STATS_SLOT_BLOCK = 128; // Client slots are allocated in blocks as clients attach
+	constexpr std::uint64_t EVT_STATS_MAX_BLOCKS = 256;
+	constexpr std::uint64_t EVT_GROUP_MAX_FRAGMENTED = 1024;
+	constexpr std::uint32_t EVT_RETAIN_MAX_COUNT = 64;
+	constexpr std::uint64_t EVT_RETAIN_MAX_BYTES = 0x4000000; // 64MB per event
+
+	// NOTE: (Cesar) What the server does with frames for a subscriber that is not keeping up
+	// 				 RELIABLE    - Queue up to _param frames (EVT_EMIT_QUEUE_SIZE if 0) then block the producer
+	// 				 			   Opt-in only, a stalled subscriber stalls every producer of the event
+	// 				 			   The reactor server never blocks, it keeps queueing instead
+	// 				 DROP_OLDEST - Queue up to _param frames (EVT_SUB_QUEUE_DEPTH if 0) then drop the oldest (default)
+	// 				 CONFLATE    - Keep only the latest undelivered frame
+	// 				 SAMPLE      - Deliver 1 in _param frames and drop the oldest when behind
+	enum class EvtDeliveryPolicy : std::uint8_t
+	{
+		RELIABLE,
+		DROP_OLDEST,
+		CONFLATE,
+		SAMPLE
+	};
+
+	// NOTE: (Cesar) How frames are thinned out before being queued when a subscription sets a _max_rate (e.g. plots on the frontend)
+	// 				 LATEST    - Deliver the latest frame of every 1 / _max_rate window
+	// 				 EVERY_NTH - Only consider 1 in _decimation_param frames (and then the latest per window if _max_rate is set)
+	// 				 ENVELOPE  - Deliver the min and max of every sample over the window
+	// 				 			 The payload is taken as an array of _sample_type and the delivered
+	// 				 			 payload is the array of minimums followed by the array of maximums
+	// 				 The first frame after a quiet window is delivered right away
+	enum class EvtDecimation : std::uint8_t
+	{
+		LATEST,
+		EVERY_NTH,
+		ENVELOPE
+	};
+
+	enum class EvtSampleType : std::uint8_t
+	{
+		U8,
+		I8,
+		U16,
+		I16,
+		U32,
+		I32,
+		U64,
+		I64,
+		F32,
+		F64
+	};
+
+	struct EvtSubscriptionPolicy
+	{
+		EvtDeliveryPolicy _policy = EvtDeliveryPolicy::DROP_OLDEST;
+		std::uint32_t 	  _param = 0;
+		float 			  _max_rate = 0.0f; // Hz (0 = no limit)
+		EvtDecimation 	  _decimation = EvtDecimation::LATEST;
+		EvtSampleType 	  _sample_type = EvtSampleType::F32;
+		std::uint32_t 	  _decimation_param = 0;
+	};
+
+	// NOTE: (Cesar) How a consumer group picks the member that gets a frame
+	// 				 ROUND_ROBIN - Members take turns
+	// 				 LEAST_DEPTH - The member with the fewest frames queued on the server
+	// 				 KEY_HASH    - Frames with the same _key_size bytes at _key_offset of the payload always go to the
+	// 				 			   same member (rendezvous hashing so only the keys of a member that left/joined move)
+	enum class EvtGroupBalance : std::uint8_t
+	{
+		ROUND_ROBIN,
+		LEAST_DEPTH,
+		KEY_HASH
+	};
+
+	// NOTE: (Cesar) Subscribers of an event that join with the same _name share its stream
+	// 				 Every frame is delivered to a single member of the group
+	// 				 The first member decides the balancing, later members must use the same
+	struct EvtConsumerGroup
+	{
+		mulex::string32 _name;
+		EvtGroupBalance _balance = EvtGroupBalance::ROUND_ROBIN;
+		std::uint32_t 	_key_offset = 0;
+		std::uint32_t 	_key_size = 0;
+	};
+
+	// NOTE: (Cesar) THREADED spawns a listen and emit thread per connection
+	// 				 REACTOR multiplexes every connection on a fixed number of epoll loops
+	enum class EvtServerMode
+	{
+		THREADED,
+		REACTOR
+	};
+
+	// NOTE: (Cesar) Traffic of a single (event, client) edge over the last second
+	// 				 in - emitted by the client, out - delivered to the client
+	struct EvtEdgeStatistics
+	{
+		std::uint64_t _client = 0;
+		std::uint64_t _msgs_in = 0;
+		std::uint64_t _bytes_in = 0;
+		std::uint64_t _msgs_out = 0;
+		std::uint64_t _bytes_out = 0;
+		std::uint64_t _depth = 0;
+		std::uint64_t _dropped = 0; // Since the client subscribed
+	};
 
+	struct EvtEventStatistics
+	{
+		std::uint16_t 				   _id = 0;
+		string32 					   _name;
+		std::uint64_t 				   _msgs_in = 0;
+		std::uint64_t 				   _bytes_in = 0;
+		std::uint64_t 				   _msgs_out = 0;
+		std::uint64_t 				   _bytes_out = 0;
+		std::vector<EvtEdgeStatistics> _edges;
+	};
+
+	// NOTE: (Cesar) Immutable snapshot published by the server stats thread once per second
+	// 				 _metadata is the EvtGetAllMetadata() reply already built from _events
 	struct EvtStatistics
 	{
-		std::uint64_t							_len = 0;
-		std::vector<string32> 	 				_name;
-		std::vector<std::uint64_t> 				_total_frames;
-		std::vector<std::vector<std::uint64_t>>	_clients;
-		std::vector<std::vector<std::uint64_t>> _frames;
+		std::vector<EvtEventStatistics> _events;
+		std::vector<std::uint8_t> 		_metadata;
+	};
+
+	// NOTE: (Cesar) Emit threads drain up to _max_frames / _max_bytes into a single vectored send
+	// 				 If _max_delay_us > 0 they wait up to that long for more frames to fill the batch
+	struct EvtEmitBatchConfig
+	{
+		std::uint64_t _max_frames = EVT_EMIT_BATCH_SIZE;
+		std::uint64_t _max_bytes = EVT_EMIT_BATCH_BYTES;
+		std::int64_t  _max_delay_us = 0;
+	};
+
+	struct EvtEmitCounters
+	{
+		std::uint64_t _frames;
+		std::uint64_t _syscalls;
 	};
 
 	std::uint64_t GetNextEventMessageId();
+	void EvtSetEmitBatchConfig(const EvtEmitBatchConfig& config);
+	EvtEmitBatchConfig EvtGetEmitBatchConfig();
+	EvtEmitCounters EvtGetEmitCounters();
+	void EvtSetSharedMemoryEnabled(bool enabled);
+	void EvtSetTracingEnabled(bool enabled);
+	bool EvtGetTracingEnabled();
+
+	// NOTE: (Cesar) Pre-resolved event for the emit hot path
+	// 				 Holds a header template with the event and client ids filled in
+	// 				 so emitting by handle skips the name lookup entirely
+	struct EvtHandle
+	{
+		EvtHeader _header;
+
+		inline std::uint16_t id() const { return _header.eventid; }
+		inline bool valid() const { return _header.eventid != 0; }
+	};
+
+	// NOTE: (Cesar) Puts fragmented events back together
+	// 				 One partial event is kept per (client, event) pair, a fragment out of
+	// 				 order (e.g. dropped by a delivery policy) discards the partial event
+	class EvtReassembler
+	{
+	public:
+		using CompleteFunc = std::function<void(const EvtHeader& header, const std::uint8_t* data, std::uint64_t len)>;
+
+		bool feed(const EvtHeader& header, const std::uint8_t* payload, CompleteFunc func);
+		void discard(std::uint64_t clientid);
+		std::uint64_t discarded() const;
+
+	private:
+		struct Partial
+		{
+			std::uint64_t 			  _msgid;
+			std::uint64_t 			  _received;
+			std::vector<std::uint8_t> _data;
+		};
+
+		mutable std::mutex 										  _mutex;
+		std::map<std::pair<std::uint64_t, std::uint16_t>, Partial> _partial;
+		std::uint64_t 											  _discarded = 0;
+	};
+
+	class EvtClientThread;
+
+	// NOTE: (Cesar) Outgoing event frame reserved from the client frame pool
+	// 				 The payload is written in place behind the header and commit()
+	// 				 hands the buffer over to the emit thread without copying it
+	// 				 A frame that is never committed goes back to the pool
+	class EvtFrame
+	{
+	public:
+		EvtFrame() = default;
+		EvtFrame(EvtFrame&& other) noexcept;
+		EvtFrame& operator=(EvtFrame&& other) noexcept;
+		EvtFrame(const EvtFrame&) = delete;
+		EvtFrame& operator=(const EvtFrame&) = delete;
+		~EvtFrame();
+
+		std::uint8_t* data();
+		std::uint64_t size() const;
+		bool valid() const;
+		void commit();
+		void commit(std::uint64_t size); // Only send the first size bytes
+
+	private:
+		friend class EvtClientThread;
+		void reset();
+
+	private:
+		EvtClientThread* 		  _owner = nullptr;
+		std::vector<std::uint8_t> _buffer;
+	};
 
 	class EvtClientThread
 	{
 	public:
 		using EvtCallbackFunc = std::function<void(const std::uint8_t* data, std::uint64_t len, const std::uint8_t* userdata)>;
+		using EvtChunkCallbackFunc = std::function<void(const std::uint8_t* data, std::uint64_t len, std::uint64_t offset, std::uint64_t total, const std::uint8_t* userdata)>;
 		EvtClientThread(
 			const std::string& hostname,
 			const Experiment* exp = nullptr,
@@ -61,15 +330,31 @@ namespace mulex
 		~EvtClientThread();
 
 		void emit(const std::string& event, const std::uint8_t* data, std::uint64_t len);
-		void regist(const std::string& event);
-		void subscribe(const std::string& event, EvtCallbackFunc callback);
+		void emit(const EvtHandle& handle, const std::uint8_t* data, std::uint64_t len);
+		EvtFrame reserve(const EvtHandle& handle, std::uint64_t size);
+		EvtHandle regist(const std::string& event);
+		void subscribe(const std::string& event, EvtCallbackFunc callback, EvtSubscriptionPolicy policy = {}, const std::string& filter = "");
+		void subscribeChunked(const std::string& event, EvtChunkCallbackFunc callback, EvtSubscriptionPolicy policy = {}, const std::string& filter = "");
+		void subscribeGroup(const std::string& event, const EvtConsumerGroup& group, EvtCallbackFunc callback, EvtSubscriptionPolicy policy = {});
 		void unsubscribe(const std::string& event);
 		void unsubscribeAll();
-		std::uint16_t findEvent(const std::string& event);
+		EvtHandle findEvent(const std::string& event);
 
 	private:
 		void clientListenThread(const Socket& socket);
 		void clientEmitThread(const Socket& socket);
+		void clientShmListenThread();
+		void clientTraceThread();
+		void dispatchFrame(const std::uint8_t* frame);
+		void emitFrame(const SocketBuffer* parts, std::uint64_t count, bool* shm);
+		void recordTrace(const EvtHeader& header, const EvtTraceStamps& stamps, std::uint64_t now);
+		void reportTrace();
+		std::uint16_t subscribeRemote(const std::string& event, EvtSubscriptionPolicy policy, const std::string& filter, const EvtConsumerGroup* group, const std::function<void(std::uint16_t)>& install);
+		EvtHandle makeHandle(std::uint16_t eventid) const;
+		void commit(std::vector<std::uint8_t>&& frame, std::uint64_t size);
+		std::vector<std::uint8_t> acquireFrame(std::uint64_t size);
+		void recycleFrame(std::vector<std::uint8_t>&& frame);
+		friend class EvtFrame;
 
 	private:
 		const Experiment* _exp;
@@ -77,69 +362,119 @@ namespace mulex
 		std::unique_ptr<std::thread> _evt_listen_thread;
 		std::unique_ptr<std::thread> _evt_emit_thread;
 		SysByteStream* _evt_stream;
-		SysBufferStack _evt_emit_stack;
+		SysRingQueue<std::vector<std::uint8_t>> _evt_emit_queue{EVT_EMIT_QUEUE_SIZE};
+		std::vector<std::vector<std::uint8_t>> _evt_frame_pool;
+		std::mutex _evt_frame_pool_lock;
 		std::atomic<bool> _evt_thread_running = false;
 		std::atomic<bool> _evt_thread_ready = false;
 		std::map<std::string, std::uint16_t> _evt_registry;
+		std::mutex _evt_registry_lock;
 		std::set<std::string> _evt_subscriptions;
 		std::map<std::uint16_t, EvtCallbackFunc> _evt_callbacks;
+		std::map<std::uint16_t, EvtChunkCallbackFunc> _evt_chunk_callbacks;
+		std::mutex _evt_callbacks_lock;
+		EvtReassembler _evt_reassembler;
 		std::map<std::uint16_t, std::uint8_t*> _evt_userdata;
 		bool _evt_has_custom_id = false;
 		std::uint64_t _evt_custom_id;
+		std::unique_ptr<ShmChannel> _evt_shm;
+		std::unique_ptr<std::thread> _evt_shm_listen_thread;
+		std::map<std::pair<std::uint64_t, std::uint16_t>, EvtTraceHistograms> _evt_trace;
+		std::int64_t _evt_trace_last_report = 0;
+		EvtHandle _evt_trace_handle;
+		std::mutex _evt_trace_lock;
+		std::condition_variable _evt_trace_notifier;
+		std::unique_ptr<std::thread> _evt_trace_thread;
 	};
 
+	struct EvtShmPeer;
+	class EvtSubscriberQueue;
+	class EvtFilter;
+
 	class EvtServerThread
 	{
 	public:
-		EvtServerThread();
+		EvtServerThread(EvtServerMode mode = EvtServerMode::THREADED, std::uint32_t nloops = 1, std::uint16_t port = EVT_PORT);
 		~EvtServerThread();
 		bool ready() const;
 
 		bool emit(const std::string& event, const std::uint8_t* data, std::uint64_t len);
-		void relay(const std::uint64_t clientid, const std::uint8_t* data, std::uint64_t len);
+		void relay(const std::shared_ptr<EvtSubscriberQueue>& queue, const SysRefBuffer& frame, const EvtSubscriptionPolicy& policy);
 		void unsub(const std::uint64_t cid);
 
 	private:
+		void reject(const std::shared_ptr<EvtSubscriberQueue>& queue, const EvtHeader& header);
 		void serverConnAcceptThread();
-		void serverListenThread(const Socket& socket);
-		void serverEmitThread(const Socket& socket);
+		void serverListenThread(const Socket& socket, std::shared_ptr<EvtSubscriberQueue> queue);
+		void serverEmitThread(const Socket& socket, std::shared_ptr<EvtSubscriberQueue> queue);
 		void clientStatisticsThread();
+		void decimationThread();
+		void processFrame(const Socket& socket, const std::uint8_t* frame, std::uint64_t size);
+		void attachShm(const Socket& socket, std::uint64_t cid, const std::string& name);
+		void detachShm(std::uint64_t cid);
+		std::shared_ptr<EvtShmPeer> findShmPeer(std::uint64_t cid);
+		std::shared_ptr<EvtSubscriberQueue> findQueue(const Socket& socket);
+		void pumpReactorQueue(const std::shared_ptr<EvtSubscriberQueue>& queue);
 
 	private:
+		EvtServerMode _evt_mode;
+		std::uint16_t _evt_port;
+		std::unique_ptr<SysIoReactor> _evt_reactor;
 		Socket _server_socket;
+		SocketNotifier _accept_wakeup;
 		std::map<Socket, std::unique_ptr<std::thread>> _evt_listen_thread;
 		std::map<Socket, std::unique_ptr<std::thread>> _evt_emit_thread;
 		std::map<Socket, SysByteStream*> _evt_stream;
 		std::map<Socket, std::atomic<bool>> _evt_thread_sig;
-		std::map<Socket, SysBufferStack> _evt_emit_stack;
-		// SysRefBufferStack _evt_emit_stack;
+		std::map<Socket, std::shared_ptr<EvtSubscriberQueue>> _evt_emit_queue;
+		std::mutex _evt_emit_queue_mutex;
 		std::unique_ptr<std::thread> _evt_accept_thread;
 		std::unique_ptr<std::thread> _evt_stats_thread;
+		std::unique_ptr<std::thread> _evt_decimation_thread;
 		std::atomic<bool> _evt_thread_running = false;
 		std::atomic<bool> _evt_thread_ready = false;
 		std::mutex _connections_mutex;
-		std::condition_variable _evt_notifier;
+		std::map<std::uint64_t, std::shared_ptr<EvtShmPeer>> _evt_shm_peers;
+		std::atomic<std::uint64_t> _evt_shm_peer_count = 0;
+		std::mutex _evt_shm_mutex;
+		EvtReassembler _evt_reassembler;
 	};
 
 	MX_RPC_METHOD bool EvtRegister(mulex::string32 name);
 	MX_RPC_METHOD std::uint16_t EvtGetId(mulex::string32 name);
 	MX_RPC_METHOD bool EvtSubscribe(mulex::string32 name);
+	MX_RPC_METHOD bool EvtSubscribeWithPolicy(mulex::string32 name, mulex::EvtSubscriptionPolicy policy, mulex::string256 filter);
+	bool EvtSubscribe(std::uint64_t clientid, std::uint16_t eventid, EvtSubscriptionPolicy policy = {}, std::shared_ptr<const EvtFilter> filter = nullptr);
+	MX_RPC_METHOD bool EvtSubscribeGroup(mulex::string32 name, mulex::EvtConsumerGroup group, mulex::EvtSubscriptionPolicy policy);
+	bool EvtSubscribeGroup(std::uint64_t clientid, std::uint16_t eventid, const EvtConsumerGroup& group, EvtSubscriptionPolicy policy = {});
 	MX_RPC_METHOD bool EvtUnsubscribe(mulex::string32 name);
 	bool EvtUnsubscribe(std::uint64_t clientid, std::uint16_t eventid);
 	void EvtServerRegisterCallback(mulex::string32 name, std::function<void(const Socket&, std::uint64_t, std::uint16_t, const std::uint8_t*, std::uint64_t)> callback);
+	bool EvtHasServerCallback(std::uint16_t eventid);
 	void EvtTryRunServerCallback(std::uint64_t clientid, std::uint16_t eventid, const std::uint8_t* data, std::uint64_t len, const Socket& socket);
 	bool EvtEmit(const std::string& event, const std::uint8_t* data, std::uint64_t len);
-	void EvtAccumulateClientStatistics(std::uint64_t clientid, std::uint64_t framebytes);
-	void EvtAccumulateEventStatistics(std::uint16_t eventid, std::uint64_t clientid, std::uint64_t framebytes, bool create = false);
-	void EvtResetStatistics(std::uint16_t eventid);
-	void EvtMakeStats(const mulex::string32& name, std::uint16_t eventid);
-	void EvtMakeStatsEntry(std::uint16_t eventid, std::uint64_t clientid);
-	void EvtDeleteStatsEntry(std::uint16_t eventid, std::uint64_t clientid);
-	void EvtPurgeStatsEntryClient(std::uint64_t clientid);
-	std::uint64_t EvtCalculateStatisticsBufferSize();
+	void EvtRelay(const std::shared_ptr<EvtSubscriberQueue>& queue, const SysRefBuffer& frame, const EvtSubscriptionPolicy& policy);
+	bool EvtStatsAttachClient(std::uint64_t clientid, bool publish);
+	void EvtStatsDetachClient(std::uint64_t clientid);
+	void EvtAccumulateUpload(std::uint16_t eventid, std::uint64_t clientid, std::uint64_t framebytes);
+	void EvtAccumulateDownload(std::uint16_t eventid, std::uint64_t clientid, std::uint64_t framebytes);
+	std::shared_ptr<const EvtStatistics> EvtGetStatistics();
 
 	MX_RPC_METHOD mulex::RPCGenericType EvtGetAllRegisteredEvents();
 	MX_RPC_METHOD mulex::RPCGenericType EvtGetAllMetadata();
+	MX_RPC_METHOD mulex::RPCGenericType EvtGetLatencyStats();
+
+	// Keep the last count events of name on the server (0 stops retaining them)
+	// Subscribers get the retained events right after subscribing
+	MX_RPC_METHOD bool EvtSetRetention(mulex::string32 name, std::uint32_t count);
+	// The retained events of name oldest first as [u64 size][payload] pairs
+	MX_RPC_METHOD mulex::RPCGenericType EvtFetchRetained(mulex::string32 name);
+
+	// Record frames arriving at the server into a journal (see network/journal.h)
+	// events holds the event names to record, empty records every event
+	bool EvtRecordStartAt(const std::string& dir, const std::vector<std::string>& events);
+	MX_RPC_METHOD MX_PERMISSION("record_events") bool EvtRecordStart(mulex::string128 name, mulex::RPCGenericType events);
+	MX_RPC_METHOD MX_PERMISSION("record_events") void EvtRecordStop();
 
 	template <typename T>
 	inline std::uint64_t EvtDataAppend(std::uint64_t offset, std::vector<std::uint8_t>* buffer, const T& value)
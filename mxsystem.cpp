@@ -1,5 +1,7 @@
 #include "mxsystem.h"
+#include <bit>
 #include <chrono>
+#include <cmath>
 #include <cstdlib>
 #include <memory>
 #include <mutex>
@@ -31,6 +33,9 @@
 #include <sys/file.h>
 #include <unistd.h>
 #include <limits.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
 #endif
 
 #include <tracy/Tracy.hpp>
@@ -296,6 +301,13 @@ namespace mulex
 #endif
 	}
 
+	static void SysSetEventBatchDelay(const std::string& delaystr)
+	{
+		EvtEmitBatchConfig config = EvtGetEmitBatchConfig();
+		config._max_delay_us = ::atoll(delaystr.c_str());
+		EvtSetEmitBatchConfig(config);
+	}
+
 	bool SysInitializeExperiment(int argc, char* argv[])
 	{
 		// Set the current time as the server starting time for the given experiment
@@ -312,10 +324,17 @@ namespace mulex
 
 		bool loopback = false;
 		std::uint16_t port = 8080;
+		std::uint32_t evt_reactor_loops = 0;
+		std::uint32_t rpc_workers = 0;
+		std::string evt_record_dir;
 
 		SysAddArgument("name", 'n', true, [](const std::string& expname){ _sys_expname = expname; }, "Set the current experiment name.");
 		SysAddArgument("loopback", 'l', false, [&](const std::string&){ loopback = true; }, "Set the http server on loopback mode only.");
 		SysAddArgument("port", 'p', true, [&](const std::string& portstr){ port = static_cast<std::uint16_t>(::atoi(portstr.c_str())); }, "Set the http server listen port.");
+		SysAddArgument("evt-reactor", 0, true, [&](const std::string& loopstr){ evt_reactor_loops = static_cast<std::uint32_t>(::atoi(loopstr.c_str())); }, "Run the event server on reactor mode with the given number of loops.");
+		SysAddArgument("rpc-workers", 0, true, [&](const std::string& workerstr){ rpc_workers = static_cast<std::uint32_t>(::atoi(workerstr.c_str())); }, "Run the rpc server on reactor mode with the given number of workers.");
+		SysAddArgument("evt-batch-delay", 0, true, SysSetEventBatchDelay, "Maximum time in microseconds to wait for more events before sending a batch.");
+		SysAddArgument("evt-record", 0, true, [&](const std::string& dir){ evt_record_dir = dir; }, "Record all of the events to a journal on the given directory.");
 
 		if(!SysParseArguments(argc, argv))
 		{
@@ -348,8 +367,23 @@ namespace mulex
 
 		RunInitVariables();
 
-		_sys_rpc_thread = std::make_unique<RPCServerThread>();
-		_sys_evt_thread = std::make_unique<EvtServerThread>();
+		if(rpc_workers > 0)
+		{
+			_sys_rpc_thread = std::make_unique<RPCServerThread>(RPCServerMode::REACTOR, rpc_workers);
+		}
+		else
+		{
+			_sys_rpc_thread = std::make_unique<RPCServerThread>();
+		}
+
+		if(evt_reactor_loops > 0)
+		{
+			_sys_evt_thread = std::make_unique<EvtServerThread>(EvtServerMode::REACTOR, evt_reactor_loops);
+		}
+		else
+		{
+			_sys_evt_thread = std::make_unique<EvtServerThread>();
+		}
 
 		while(!_sys_rpc_thread->ready())
 		{
@@ -361,6 +395,11 @@ namespace mulex
 			std::this_thread::yield();
 		}
 
+		if(!evt_record_dir.empty())
+		{
+			EvtRecordStartAt(evt_record_dir, {});
+		}
+
 		// After evt thread init
 		MsgInit();
 
@@ -430,6 +469,9 @@ namespace mulex
 		std::string server_name = "localhost";
 
 		SysAddArgument("server", 's', true, [&](const std::string& server){ server_name = server; }, "Set the server to connect to.");
+		SysAddArgument("evt-batch-delay", 0, true, SysSetEventBatchDelay, "Maximum time in microseconds to wait for more events before sending a batch.");
+		SysAddArgument("evt-no-shm", 0, false, [](const std::string&){ EvtSetSharedMemoryEnabled(false); }, "Disable the shared memory event transport when the server is on the same host.");
+		SysAddArgument("evt-trace", 0, false, [](const std::string&){ EvtSetTracingEnabled(true); }, "Timestamp emitted events to measure their end to end latency.");
 
 		if(!SysParseArguments(argc, argv))
 		{
@@ -525,15 +567,25 @@ namespace mulex
 	}
 
 	SysRecvThread::SysRecvThread(const Socket& socket, std::uint64_t ssize, std::uint64_t sheadersize, std::uint64_t sheaderoffset)
-		: _handle(), _stream(ssize, sheadersize, sheaderoffset)
+		: _stream(std::min(SYS_RECV_THREAD_INITIAL_BUFFER_SIZE, ssize), sheadersize, sheaderoffset, ssize), _handle()
 	{
+		// Unblocking the stream also wakes up the receiver
+		_wakeup = std::make_unique<SocketNotifier>(SocketNotifierInit());
+		_stream.setUnblockNotifier(_wakeup.get());
+
 		_handle = std::thread([&](){
-			static constexpr std::uint64_t SOCKET_RECV_BUFSIZE = 32768;
-			std::vector<std::uint8_t> rbuffer(SOCKET_RECV_BUFSIZE);
+			// Receive straight into the stream ring
 			std::uint64_t read;
+			std::uint64_t avail;
 			while(true)
 			{
-				SocketResult r = SocketRecvBytes(socket, rbuffer.data(), SOCKET_RECV_BUFSIZE, &read);
+				std::uint8_t* region = _stream.acquireWrite(&avail);
+				if(!region)
+				{
+					break;
+				}
+
+				SocketResult r = SocketRecvBytes(socket, region, avail, &read);
 				if((r == SocketResult::DISCONNECT) || (r == SocketResult::ERROR))
 				{
 					break;
@@ -544,19 +596,34 @@ namespace mulex
 					{
 						break;
 					}
-					std::this_thread::sleep_for(std::chrono::microseconds(10));
+
+					// Sleep until there is data or someone unblocks the stream
+					// A stream that grew gives the memory back once the connection goes quiet
+					const bool grown = _stream.capacity() > SYS_RECV_THREAD_INITIAL_BUFFER_SIZE;
+					SocketResult w = SocketWaitReadable(socket, grown ? SYS_RECV_THREAD_TRIM_DELAY : -1, _wakeup.get());
+					if(w == SocketResult::ERROR)
+					{
+						break;
+					}
+					else if(w == SocketResult::TIMEOUT && grown)
+					{
+						_stream.trim();
+					}
 					continue;
 				}
 
-				if(!_stream.push(rbuffer.data(), read))
-				{
-					break;
-				}
+				_stream.commitWrite(read);
 			}
 			LogTrace("SysRecvThread: Stopped.");
 			_stream.requestUnblock();
 		});
 	}
+
+	SysRecvThread::~SysRecvThread()
+	{
+		_stream.setUnblockNotifier(nullptr);
+		SocketNotifierClose(*_wakeup);
+	}
 	
 	[[nodiscard]] std::unique_ptr<SysRecvThread> SysStartRecvThread(const Socket& socket, std::uint64_t headersize, std::uint64_t headeroffset)
 	{
@@ -575,176 +642,1061 @@ namespace mulex
 		return true;
 	}
 
-	void SysBufferStack::push(std::vector<std::uint8_t>&& data)
+	struct SysIoReactor::Connection
 	{
-		ZoneScoped;
+		Socket 								  _socket;
+		std::vector<std::uint8_t> 			  _rbuffer;
+		std::uint64_t 						  _roffset = 0;
+		std::deque<SysRefBuffer> 			  _outbound;
+		std::uint64_t 						  _woffset = 0;
+		bool 								  _wait_writable = false;
+		bool 								  _dirty = false;
+	};
+
+	struct SysIoReactor::Loop
+	{
+		int 												 _epfd = -1;
+		int 												 _wakefd = -1;
+		std::thread 										 _handle;
+		std::mutex 											 _mutex;
+		std::map<int, std::unique_ptr<Connection>> 			 _connections;
+		std::vector<int> 									 _dirty;
+		std::atomic<bool> 									 _wake_pending = false;
+	};
+
+	static constexpr std::uint64_t SYS_IO_REACTOR_INITIAL_BUFFER_SIZE = 65536;
+	static constexpr std::uint32_t SYS_IO_REACTOR_MAX_EVENTS = 64;
+	static constexpr std::uint64_t SYS_IO_REACTOR_MAX_IOV = 64;
+
+	SysIoReactor::SysIoReactor(std::uint32_t nloops, std::uint64_t headersize, std::uint64_t headeroffset, FrameFunc onframe, CloseFunc onclose, DrainFunc ondrain, SendFunc onsend)
+		: _next_loop(0), _header_size(headersize), _header_size_offset(headeroffset), _onframe(onframe), _onclose(onclose), _ondrain(ondrain), _onsend(onsend)
+	{
+#ifdef __linux__
+		_running.store(true);
+		nloops = std::max(nloops, 1U);
+		for(std::uint32_t i = 0; i < nloops; i++)
 		{
-			std::unique_lock<std::mutex> lock(_mutex);
-			_stack.push(std::move(data));
+			std::unique_ptr<Loop> loop = std::make_unique<Loop>();
+			loop->_epfd = ::epoll_create1(EPOLL_CLOEXEC);
+			loop->_wakefd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			if(loop->_epfd < 0 || loop->_wakefd < 0)
+			{
+				LogError("SysIoReactor: Failed to create epoll loop.");
+				if(loop->_epfd >= 0) ::close(loop->_epfd);
+				if(loop->_wakefd >= 0) ::close(loop->_wakefd);
+				continue;
+			}
+
+			epoll_event ev;
+			ev.events = EPOLLIN;
+			ev.data.fd = loop->_wakefd;
+			::epoll_ctl(loop->_epfd, EPOLL_CTL_ADD, loop->_wakefd, &ev);
+
+			Loop* ptr = loop.get();
+			loop->_handle = std::thread([this, ptr](){ loopThread(ptr); });
+			_loops.push_back(std::move(loop));
 		}
-		_notifier.notify_one();	
+		LogDebug("SysIoReactor: Started with %u loops.", static_cast<std::uint32_t>(_loops.size()));
+#else
+		_running.store(false);
+		LogError("SysIoReactor: Not supported on this platform.");
+#endif
 	}
 
-	void SysBufferStack::push(const std::vector<std::uint8_t>& data)
+	SysIoReactor::~SysIoReactor()
 	{
-		ZoneScoped;
+#ifdef __linux__
+		_running.store(false);
+		for(auto& loop : _loops)
 		{
-			std::unique_lock<std::mutex> lock(_mutex);
-			_stack.push(data);
+			std::uint64_t one = 1;
+			[[maybe_unused]] auto w = ::write(loop->_wakefd, &one, sizeof(one));
+		}
+
+		for(auto& loop : _loops)
+		{
+			loop->_handle.join();
+			for(auto& [fd, conn] : loop->_connections)
+			{
+				SocketClose(conn->_socket);
+			}
+			loop->_connections.clear();
+			::close(loop->_wakefd);
+			::close(loop->_epfd);
 		}
-		_notifier.notify_one();	
+#endif
 	}
 
-	std::vector<std::uint8_t> SysBufferStack::pop()
+	bool SysIoReactor::Supported()
 	{
-		ZoneScoped;
-		std::unique_lock<std::mutex> lock(_mutex);
-		_notifier.wait(lock, [this](){ return !_stack.empty() || _sig_unblock.load(); }); // Don't wait if the stack if not empty
-		if(_sig_unblock.load())
+#ifdef __linux__
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	std::uint32_t SysIoReactor::loops() const
+	{
+		return static_cast<std::uint32_t>(_loops.size());
+	}
+
+	bool SysIoReactor::attach(const Socket& socket)
+	{
+#ifdef __linux__
+		if(_loops.empty())
 		{
-			return std::vector<std::uint8_t>();
+			return false;
+		}
+
+		if(!SocketSetNonBlocking(socket))
+		{
+			LogError("SysIoReactor: Failed to set socket to non blocking mode.");
+			return false;
+		}
+
+		// Round robin the sockets over the loops
+		Loop* loop = _loops[_next_loop++ % _loops.size()].get();
+
+		std::unique_ptr<Connection> conn = std::make_unique<Connection>();
+		conn->_socket = socket;
+		conn->_rbuffer.resize(std::max(SYS_IO_REACTOR_INITIAL_BUFFER_SIZE, _header_size));
+
+		{
+			std::unique_lock<std::mutex> lock(_sockets_mutex);
+			_sockets[socket._handle] = loop;
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(loop->_mutex);
+			loop->_connections.emplace(socket._handle, std::move(conn));
+		}
+
+		epoll_event ev;
+		ev.events = EPOLLIN | EPOLLRDHUP;
+		ev.data.fd = socket._handle;
+		if(::epoll_ctl(loop->_epfd, EPOLL_CTL_ADD, socket._handle, &ev) < 0)
+		{
+			LogError("SysIoReactor: Failed to add socket to epoll loop.");
+			std::unique_lock<std::mutex> lock(loop->_mutex);
+			loop->_connections.erase(socket._handle);
+			return false;
 		}
-		std::vector<std::uint8_t> val = std::move(_stack.top());
-		_stack.pop();
-		return val;
+		return true;
+#else
+		return false;
+#endif
 	}
 
-	void SysBufferStack::requestUnblock()
+	bool SysIoReactor::send(const Socket& socket, const SysRefBuffer& data)
 	{
-		_sig_unblock.store(true);
-		_notifier.notify_all();
+#ifdef __linux__
+		Loop* loop;
+		{
+			std::unique_lock<std::mutex> lock(_sockets_mutex);
+			auto it = _sockets.find(socket._handle);
+			if(it == _sockets.end())
+			{
+				return false;
+			}
+			loop = it->second;
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(loop->_mutex);
+			auto it = loop->_connections.find(socket._handle);
+			if(it == loop->_connections.end())
+			{
+				return false;
+			}
+
+			Connection* conn = it->second.get();
+			conn->_outbound.push_back(data);
+			if(!conn->_dirty)
+			{
+				conn->_dirty = true;
+				loop->_dirty.push_back(socket._handle);
+			}
+		}
+
+		// Only wake the loop once per batch of sends
+		if(!loop->_wake_pending.exchange(true))
+		{
+			std::uint64_t one = 1;
+			[[maybe_unused]] auto w = ::write(loop->_wakefd, &one, sizeof(one));
+		}
+		return true;
+#else
+		return false;
+#endif
 	}
 
-	std::uint64_t SysBufferStack::size() const
+	std::uint64_t SysIoReactor::pending(const Socket& socket)
 	{
-		// NOTE: (Cesar) This could be a shared lock
-		std::unique_lock<std::mutex> lock(_mutex);
-		return _stack.size();
+#ifdef __linux__
+		Loop* loop;
+		{
+			std::unique_lock<std::mutex> lock(_sockets_mutex);
+			auto it = _sockets.find(socket._handle);
+			if(it == _sockets.end())
+			{
+				return 0;
+			}
+			loop = it->second;
+		}
+
+		std::unique_lock<std::mutex> lock(loop->_mutex);
+		auto it = loop->_connections.find(socket._handle);
+		return (it != loop->_connections.end()) ? it->second->_outbound.size() : 0;
+#else
+		return 0;
+#endif
+	}
+
+	void SysIoReactor::loopThread(Loop* loop)
+	{
+#ifdef __linux__
+		epoll_event events[SYS_IO_REACTOR_MAX_EVENTS];
+		while(_running.load())
+		{
+			int n = ::epoll_wait(loop->_epfd, events, SYS_IO_REACTOR_MAX_EVENTS, -1);
+			if(n < 0)
+			{
+				if(errno == EINTR) continue;
+				LogError("SysIoReactor: epoll_wait failed.");
+				break;
+			}
+
+			for(int i = 0; i < n; i++)
+			{
+				int fd = events[i].data.fd;
+				if(fd == loop->_wakefd)
+				{
+					std::uint64_t value;
+					[[maybe_unused]] auto r = ::read(loop->_wakefd, &value, sizeof(value));
+					loop->_wake_pending.store(false);
+
+					std::vector<int> dirty;
+					{
+						std::unique_lock<std::mutex> lock(loop->_mutex);
+						dirty.swap(loop->_dirty);
+					}
+
+					for(int dfd : dirty)
+					{
+						Connection* conn = nullptr;
+						{
+							std::unique_lock<std::mutex> lock(loop->_mutex);
+							auto it = loop->_connections.find(dfd);
+							if(it == loop->_connections.end()) continue;
+							conn = it->second.get();
+							conn->_dirty = false;
+						}
+						if(!flushConnection(loop, conn))
+						{
+							closeConnection(loop, dfd);
+						}
+					}
+					continue;
+				}
+
+				Connection* conn = nullptr;
+				{
+					std::unique_lock<std::mutex> lock(loop->_mutex);
+					auto it = loop->_connections.find(fd);
+					if(it == loop->_connections.end()) continue;
+					conn = it->second.get();
+				}
+
+				if(events[i].events & EPOLLOUT)
+				{
+					if(!flushConnection(loop, conn))
+					{
+						closeConnection(loop, fd);
+						continue;
+					}
+				}
+
+				if(events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+				{
+					// readConnection closes the connection itself on error/disconnect
+					readConnection(loop, conn);
+				}
+			}
+		}
+		LogTrace("SysIoReactor: Loop stopped.");
+#endif
+	}
+
+	void SysIoReactor::readConnection(Loop* loop, Connection* conn)
+	{
+#ifdef __linux__
+		const int fd = conn->_socket._handle;
+		while(true)
+		{
+			if(conn->_roffset == conn->_rbuffer.size())
+			{
+				// Frame larger than the current buffer (parse below grows it)
+				// If we are here the frame is still incomplete and we are at capacity
+				LogError("SysIoReactor: Receive buffer overflow. Closing connection.");
+				closeConnection(loop, fd);
+				return;
+			}
+
+			std::int64_t res = ::recv(fd, conn->_rbuffer.data() + conn->_roffset, conn->_rbuffer.size() - conn->_roffset, MSG_DONTWAIT);
+			if(res == 0)
+			{
+				LogTrace("SysIoReactor: Socket disconnected.");
+				closeConnection(loop, fd);
+				return;
+			}
+			else if(res < 0)
+			{
+				if(errno == EAGAIN || errno == EWOULDBLOCK)
+				{
+					// Drop the memory a large frame needed once the connection is drained
+					if(conn->_roffset == 0 && conn->_rbuffer.size() > SYS_IO_REACTOR_INITIAL_BUFFER_SIZE)
+					{
+						std::vector<std::uint8_t>(std::max(SYS_IO_REACTOR_INITIAL_BUFFER_SIZE, _header_size)).swap(conn->_rbuffer);
+					}
+					return;
+				}
+				if(errno == EINTR)
+				{
+					continue;
+				}
+				LogError("SysIoReactor: Socket receive error.");
+				closeConnection(loop, fd);
+				return;
+			}
+
+			conn->_roffset += static_cast<std::uint64_t>(res);
+
+			// Split frames
+			std::uint64_t cursor = 0;
+			while(conn->_roffset - cursor >= _header_size)
+			{
+				std::uint32_t msg_size;
+				std::memcpy(&msg_size, conn->_rbuffer.data() + cursor + _header_size_offset, sizeof(std::uint32_t));
+				const std::uint64_t framesize = _header_size + msg_size;
+
+				if(framesize > SYS_RECV_THREAD_BUFFER_SIZE)
+				{
+					LogError("SysIoReactor: Frame exceeds maximum size. Closing connection.");
+					closeConnection(loop, fd);
+					return;
+				}
+
+				if(conn->_roffset - cursor < framesize)
+				{
+					if(framesize > conn->_rbuffer.size())
+					{
+						conn->_rbuffer.resize(framesize);
+					}
+					break;
+				}
+
+				_onframe(conn->_socket, conn->_rbuffer.data() + cursor, framesize);
+				cursor += framesize;
+			}
+
+			// Compact only the incomplete tail
+			if(cursor > 0)
+			{
+				const std::uint64_t remaining = conn->_roffset - cursor;
+				if(remaining > 0)
+				{
+					std::memmove(conn->_rbuffer.data(), conn->_rbuffer.data() + cursor, remaining);
+				}
+				conn->_roffset = remaining;
+			}
+		}
+#endif
+	}
+
+	bool SysIoReactor::flushConnection(Loop* loop, Connection* conn)
+	{
+#ifdef __linux__
+		std::unique_lock<std::mutex> lock(loop->_mutex);
+		iovec iov[SYS_IO_REACTOR_MAX_IOV];
+		const bool had_data = !conn->_outbound.empty();
+		std::uint64_t nframes = 0;
+		std::uint64_t nsyscalls = 0;
+		while(!conn->_outbound.empty())
+		{
+			// Gather as many queued frames as possible into a single syscall
+			std::uint64_t niov = 0;
+			for(auto it = conn->_outbound.begin(); it != conn->_outbound.end() && niov < SYS_IO_REACTOR_MAX_IOV; it++, niov++)
+			{
+				const std::uint64_t skip = (niov == 0) ? conn->_woffset : 0;
+				iov[niov].iov_base = const_cast<std::uint8_t*>(it->data()) + skip;
+				iov[niov].iov_len = it->size() - skip;
+			}
+
+			msghdr msg;
+			std::memset(&msg, 0, sizeof(msg));
+			msg.msg_iov = iov;
+			msg.msg_iovlen = niov;
+			std::int64_t res = ::sendmsg(conn->_socket._handle, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+			nsyscalls++;
+
+			if(res < 0)
+			{
+				if(errno == EINTR)
+				{
+					continue;
+				}
+
+				if(errno == EAGAIN || errno == EWOULDBLOCK)
+				{
+					break;
+				}
+				LogError("SysIoReactor: Failed to send data.");
+				return false;
+			}
+
+			std::uint64_t sent = static_cast<std::uint64_t>(res);
+			while(sent > 0)
+			{
+				const std::uint64_t remaining = conn->_outbound.front().size() - conn->_woffset;
+				if(sent < remaining)
+				{
+					conn->_woffset += sent;
+					break;
+				}
+				sent -= remaining;
+				conn->_outbound.pop_front();
+				conn->_woffset = 0;
+				nframes++;
+			}
+		}
+
+		if(nsyscalls > 0 && _onsend)
+		{
+			_onsend(nframes, nsyscalls);
+		}
+
+		// Only wait for writability when the kernel buffer is full
+		const bool need_writable = !conn->_outbound.empty();
+		if(need_writable != conn->_wait_writable)
+		{
+			epoll_event ev;
+			ev.events = EPOLLIN | EPOLLRDHUP | (need_writable ? static_cast<std::uint32_t>(EPOLLOUT) : 0U);
+			ev.data.fd = conn->_socket._handle;
+			::epoll_ctl(loop->_epfd, EPOLL_CTL_MOD, conn->_socket._handle, &ev);
+			conn->_wait_writable = need_writable;
+		}
+
+		// Let the owner refill the connection once everything went out
+		if(had_data && !need_writable && _ondrain)
+		{
+			const Socket socket = conn->_socket;
+			lock.unlock();
+			_ondrain(socket);
+		}
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	void SysIoReactor::closeConnection(Loop* loop, int fd)
+	{
+#ifdef __linux__
+		std::unique_ptr<Connection> conn;
+		{
+			std::unique_lock<std::mutex> lock(loop->_mutex);
+			auto it = loop->_connections.find(fd);
+			if(it == loop->_connections.end())
+			{
+				return;
+			}
+			conn = std::move(it->second);
+			loop->_connections.erase(it);
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(_sockets_mutex);
+			_sockets.erase(fd);
+		}
+
+		::epoll_ctl(loop->_epfd, EPOLL_CTL_DEL, fd, nullptr);
+		_onclose(conn->_socket);
+		SocketClose(conn->_socket);
+#endif
+	}
+
+	SysRefBuffer::SysRefBuffer(const SysRefBuffer& other) : _block(other._block)
+	{
+		if(_block)
+		{
+			_block->_refcount.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	SysRefBuffer::SysRefBuffer(SysRefBuffer&& other) noexcept : _block(other._block)
+	{
+		other._block = nullptr;
+	}
+
+	SysRefBuffer& SysRefBuffer::operator=(const SysRefBuffer& other)
+	{
+		if(this != &other)
+		{
+			if(other._block)
+			{
+				other._block->_refcount.fetch_add(1, std::memory_order_relaxed);
+			}
+			release();
+			_block = other._block;
+		}
+		return *this;
+	}
+
+	SysRefBuffer& SysRefBuffer::operator=(SysRefBuffer&& other) noexcept
+	{
+		if(this != &other)
+		{
+			release();
+			_block = other._block;
+			other._block = nullptr;
+		}
+		return *this;
+	}
+
+	SysRefBuffer::~SysRefBuffer()
+	{
+		release();
+	}
+
+	SysRefBuffer SysRefBuffer::Allocate(std::uint64_t size)
+	{
+		SysRefBuffer buffer;
+		void* memory = ::operator new(sizeof(Block) + size);
+		buffer._block = new(memory) Block();
+		buffer._block->_refcount.store(1, std::memory_order_relaxed);
+		buffer._block->_size = size;
+		return buffer;
 	}
 
-	void SysRefBufferStack::push(std::vector<std::uint8_t>&& data, std::uint16_t ref)
+	SysRefBuffer SysRefBuffer::Copy(const std::uint8_t* data, std::uint64_t size)
 	{
-		_refcount.store(ref);
+		SysRefBuffer buffer = Allocate(size);
+		if(size > 0)
+		{
+			std::memcpy(buffer.mutableData(), data, size);
+		}
+		return buffer;
+	}
+
+	const std::uint8_t* SysRefBuffer::data() const
+	{
+		return _block ? reinterpret_cast<const std::uint8_t*>(_block + 1) : nullptr;
+	}
+
+	std::uint8_t* SysRefBuffer::mutableData()
+	{
+		return _block ? reinterpret_cast<std::uint8_t*>(_block + 1) : nullptr;
+	}
+
+	std::uint64_t SysRefBuffer::size() const
+	{
+		return _block ? _block->_size : 0;
+	}
+
+	bool SysRefBuffer::empty() const
+	{
+		return size() == 0;
+	}
+
+	std::uint32_t SysRefBuffer::refcount() const
+	{
+		return _block ? _block->_refcount.load(std::memory_order_relaxed) : 0;
+	}
+
+	void SysRefBuffer::release()
+	{
+		if(_block && _block->_refcount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			_block->~Block();
+			::operator delete(_block);
+		}
+		_block = nullptr;
+	}
+
+	SysBufferPool& SysBufferPool::Get()
+	{
+		static SysBufferPool pool;
+		return pool;
+	}
+
+	SysBufferPool::~SysBufferPool()
+	{
+		for(auto& [capacity, blocks] : _free)
+		{
+			for(std::uint8_t* block : blocks)
+			{
+				::operator delete(block);
+			}
+		}
+	}
+
+	std::uint8_t* SysBufferPool::acquire(std::uint64_t size, std::uint64_t* capacity)
+	{
+		std::uint64_t cap = 1;
+		while(cap < size)
+		{
+			cap <<= 1;
+		}
+		*capacity = cap;
+
 		{
 			std::unique_lock<std::mutex> lock(_mutex);
-			_stack.push(std::move(data));
+			_used += cap;
+			auto it = _free.find(cap);
+			if(it != _free.end() && !it->second.empty())
+			{
+				std::uint8_t* block = it->second.back();
+				it->second.pop_back();
+				_cached -= cap;
+				return block;
+			}
 		}
-		_notifier.notify_all();	
+		return static_cast<std::uint8_t*>(::operator new(cap));
 	}
 
-	std::vector<std::uint8_t> SysRefBufferStack::pop()
+	void SysBufferPool::release(std::uint8_t* block, std::uint64_t capacity)
 	{
-		std::unique_lock<std::mutex> lock(_mutex);
-		_notifier.wait(lock);
-		if(_stack.empty())
+		if(!block)
 		{
-			return std::vector<std::uint8_t>();
+			return;
 		}
-		std::vector<std::uint8_t> val = _stack.top();
 
-		decref();
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_used -= capacity;
+			if(_cached + capacity <= SYS_BUFFER_POOL_CACHE_SIZE)
+			{
+				_free[capacity].push_back(block);
+				_cached += capacity;
+				return;
+			}
+		}
+		::operator delete(block);
+	}
 
-		return val;
+	std::uint64_t SysBufferPool::usedBytes() const
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		return _used;
 	}
 
-	const std::vector<std::uint8_t>* SysRefBufferStack::peek()
+	std::uint64_t SysBufferPool::cachedBytes() const
 	{
 		std::unique_lock<std::mutex> lock(_mutex);
-		_notifier.wait(lock);
-		if(_stack.empty())
+		return _cached;
+	}
+
+	std::uint32_t SysLatencyHistogram::BucketOf(std::uint64_t ns)
+	{
+		if(ns < (1ULL << SUB_BITS))
 		{
-			return nullptr;
+			return static_cast<std::uint32_t>(ns);
 		}
-		return &_stack.top();
+
+		if(ns >= (1ULL << MAX_BITS))
+		{
+			return BUCKETS - 1;
+		}
+
+		// Tier by the position of the highest bit, the next SUB_BITS bits pick the bucket in the tier
+		const std::uint32_t msb = static_cast<std::uint32_t>(std::bit_width(ns)) - 1;
+		const std::uint32_t tier = msb - SUB_BITS + 1;
+		const std::uint32_t sub = static_cast<std::uint32_t>(ns >> (msb - SUB_BITS)) & ((1U << SUB_BITS) - 1);
+		return (tier << SUB_BITS) | sub;
 	}
 
-	void SysRefBufferStack::decref()
+	std::uint64_t SysLatencyHistogram::BucketValue(std::uint32_t bucket)
 	{
-		_refcount--; // This is atomic
-		if(_refcount.load() == 0)
+		// Highest value that falls in the bucket
+		const std::uint32_t tier = bucket >> SUB_BITS;
+		const std::uint64_t sub = bucket & ((1U << SUB_BITS) - 1);
+		if(tier == 0)
 		{
-			std::lock_guard<std::mutex> lock(_mutex);
-			if(!_stack.empty()) _stack.pop();
+			return sub;
 		}
+
+		const std::uint64_t width = 1ULL << (tier - 1);
+		return ((sub + (1ULL << SUB_BITS)) << (tier - 1)) + width - 1;
 	}
 
-	void SysRefBufferStack::requestUnblock()
+	void SysLatencyHistogram::record(std::uint64_t ns)
 	{
-		_notifier.notify_all();
+		if(_counts.empty())
+		{
+			_counts.resize(BUCKETS, 0);
+		}
+
+		_counts[BucketOf(ns)]++;
+		_count++;
+		_max = std::max(_max, ns);
+	}
+
+	void SysLatencyHistogram::merge(const SysLatencyHistogram& other)
+	{
+		if(other._count == 0)
+		{
+			return;
+		}
+
+		if(_counts.empty())
+		{
+			_counts.resize(BUCKETS, 0);
+		}
+
+		for(std::uint32_t i = 0; i < BUCKETS; i++)
+		{
+			_counts[i] += other._counts[i];
+		}
+		_count += other._count;
+		_max = std::max(_max, other._max);
+	}
+
+	void SysLatencyHistogram::reset()
+	{
+		std::fill(_counts.begin(), _counts.end(), 0);
+		_count = 0;
+		_max = 0;
 	}
 
-	SysByteStream::SysByteStream(std::uint64_t size, std::uint64_t headersize, std::uint64_t headeroffset)
+	std::uint64_t SysLatencyHistogram::count() const
 	{
-		_buffer.resize(size);
-		_buffer_offset = 0;
+		return _count;
+	}
+
+	std::uint64_t SysLatencyHistogram::max() const
+	{
+		return _max;
+	}
+
+	std::uint64_t SysLatencyHistogram::percentile(double p) const
+	{
+		if(_count == 0)
+		{
+			return 0;
+		}
+
+		const double clamped = std::clamp(p, 0.0, 100.0);
+		const std::uint64_t target = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(clamped / 100.0 * _count)));
+		std::uint64_t seen = 0;
+		for(std::uint32_t i = 0; i < BUCKETS; i++)
+		{
+			seen += _counts[i];
+			if(seen >= target)
+			{
+				return std::min(BucketValue(i), _max);
+			}
+		}
+		return _max;
+	}
+
+	std::vector<std::uint8_t> SysLatencyHistogram::serialize() const
+	{
+		// [count u64][max u64][nbuckets u32] followed by nbuckets x [bucket u32][count u64]
+		std::uint32_t nbuckets = static_cast<std::uint32_t>(std::count_if(_counts.begin(), _counts.end(), [](std::uint64_t c){ return c > 0; }));
+		std::vector<std::uint8_t> buffer(2 * sizeof(std::uint64_t) + sizeof(std::uint32_t) + nbuckets * (sizeof(std::uint32_t) + sizeof(std::uint64_t)));
+
+		std::uint8_t* data = buffer.data();
+		std::memcpy(data, &_count, sizeof(std::uint64_t));
+		data += sizeof(std::uint64_t);
+		std::memcpy(data, &_max, sizeof(std::uint64_t));
+		data += sizeof(std::uint64_t);
+		std::memcpy(data, &nbuckets, sizeof(std::uint32_t));
+		data += sizeof(std::uint32_t);
+
+		for(std::uint32_t i = 0; i < _counts.size(); i++)
+		{
+			if(_counts[i] == 0)
+			{
+				continue;
+			}
+			std::memcpy(data, &i, sizeof(std::uint32_t));
+			data += sizeof(std::uint32_t);
+			std::memcpy(data, &_counts[i], sizeof(std::uint64_t));
+			data += sizeof(std::uint64_t);
+		}
+		return buffer;
+	}
+
+	bool SysLatencyHistogram::deserialize(const std::uint8_t* data, std::uint64_t size, std::uint64_t* read)
+	{
+		constexpr std::uint64_t hsize = 2 * sizeof(std::uint64_t) + sizeof(std::uint32_t);
+		constexpr std::uint64_t esize = sizeof(std::uint32_t) + sizeof(std::uint64_t);
+		if(size < hsize)
+		{
+			return false;
+		}
+
+		std::uint64_t count, max;
+		std::uint32_t nbuckets;
+		std::memcpy(&count, data, sizeof(std::uint64_t));
+		std::memcpy(&max, data + sizeof(std::uint64_t), sizeof(std::uint64_t));
+		std::memcpy(&nbuckets, data + 2 * sizeof(std::uint64_t), sizeof(std::uint32_t));
+		if(size < hsize + nbuckets * esize)
+		{
+			return false;
+		}
+
+		std::vector<std::uint64_t> counts(BUCKETS, 0);
+		const std::uint8_t* entry = data + hsize;
+		for(std::uint32_t i = 0; i < nbuckets; i++, entry += esize)
+		{
+			std::uint32_t bucket;
+			std::memcpy(&bucket, entry, sizeof(std::uint32_t));
+			if(bucket >= BUCKETS)
+			{
+				return false;
+			}
+			std::memcpy(&counts[bucket], entry + sizeof(std::uint32_t), sizeof(std::uint64_t));
+		}
+
+		_counts = std::move(counts);
+		_count = count;
+		_max = max;
+		if(read)
+		{
+			*read = hsize + nbuckets * esize;
+		}
+		return true;
+	}
+
+	SysByteStream::SysByteStream(std::uint64_t size, std::uint64_t headersize, std::uint64_t headeroffset, std::uint64_t maxsize)
+	{
+		_buffer = SysBufferPool::Get().acquire(size, &_size);
+		_min_size = _size;
+		_max_size = std::max(maxsize, _size);
+		_grow_request = 0;
+		_head = 0;
+		_tail = 0;
 		_header_size = headersize;
 		_header_size_offset = headeroffset;
 		_unblock_sig.store(false);
+		_unblock_notifier = nullptr;
 	}
 
-	bool SysByteStream::push(std::uint8_t* data, std::uint64_t size)
+	SysByteStream::~SysByteStream()
+	{
+		SysBufferPool::Get().release(_buffer, _size);
+	}
+
+	void SysByteStream::resize(std::uint64_t size)
+	{
+		// Called by the producer with the lock held while the consumer holds no view
+		// Unread bytes move to the start of the new ring
+		const std::uint64_t used = _head - _tail;
+		std::uint64_t capacity;
+		std::uint8_t* buffer = SysBufferPool::Get().acquire(std::max(size, used), &capacity);
+		copyOut(_tail, buffer, used);
+		SysBufferPool::Get().release(_buffer, _size);
+		_buffer = buffer;
+		_size = capacity;
+		_tail = 0;
+		_head = used;
+	}
+
+	bool SysByteStream::push(const std::uint8_t* data, std::uint64_t size)
 	{
 		ZoneScoped;
+		while(size > 0)
 		{
-			std::unique_lock<std::mutex> lock(_mutex);
-			
-			_notifier.wait(lock, [&](){ return (_buffer_offset + size <= _buffer.size()) || _unblock_sig.load(); });
-
-			if(_unblock_sig.load())
+			std::uint64_t avail;
+			std::uint8_t* region = acquireWrite(&avail);
+			if(!region)
 			{
 				return false;
 			}
-			
-			std::memcpy(_buffer.data() + _buffer_offset, data, size);
-			_buffer_offset += size;
+
+			const std::uint64_t count = std::min(avail, size);
+			std::memcpy(region, data, count);
+			commitWrite(count);
+			data += count;
+			size -= count;
 		}
-		_notifier.notify_one();
 		return true;
 	}
 
-	std::uint64_t SysByteStream::fetch(std::uint8_t* buffer, std::uint64_t size)
+	std::uint8_t* SysByteStream::acquireWrite(std::uint64_t* avail)
+	{
+		// Blocks until there is free space and returns the largest contiguous free region
+		std::unique_lock<std::mutex> lock(_mutex);
+		_notifier.wait(lock, [&](){ return (_head - _tail < _size) || (_grow_request > _size) || _unblock_sig.load(); });
+
+		if(_unblock_sig.load())
+		{
+			*avail = 0;
+			return nullptr;
+		}
+
+		if(_grow_request > _size)
+		{
+			LogTrace("SysByteStream: Growing stream to fit a frame of size %llu.", _grow_request);
+			resize(std::max(_grow_request, _size * 2));
+			_grow_request = 0;
+		}
+
+		const std::uint64_t position = _head % _size;
+		*avail = std::min(_size - (_head - _tail), _size - position);
+		return _buffer + position;
+	}
+
+	void SysByteStream::commitWrite(std::uint64_t size)
+	{
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_head += size;
+		}
+		_notifier.notify_all();
+	}
+
+	void SysByteStream::copyOut(std::uint64_t position, std::uint8_t* buffer, std::uint64_t size) const
+	{
+		const std::uint64_t offset = position % _size;
+		const std::uint64_t first = std::min(size, _size - offset);
+		std::memcpy(buffer, _buffer + offset, first);
+		if(first < size)
+		{
+			std::memcpy(buffer + first, _buffer, size - first);
+		}
+	}
+
+	SysByteStream::FrameView SysByteStream::fetchView()
 	{
 		ZoneScoped;
 		std::uint64_t payloadsize = 0;
+		std::uint64_t position;
 		{
 			std::unique_lock<std::mutex> lock(_mutex);
 			
-			_notifier.wait(lock, [&](){ return (_buffer_offset >= _header_size) || _unblock_sig.load(); });
+			_notifier.wait(lock, [&](){ return (_head - _tail >= _header_size) || _unblock_sig.load(); });
 			
 			if(_unblock_sig.load())
 			{
-				return 0;
+				return {};
 			}
 			
 			std::uint32_t msg_size;
-			std::memcpy(&msg_size, _buffer.data() + _header_size_offset, sizeof(std::uint32_t));
-			
+			copyOut(_tail + _header_size_offset, reinterpret_cast<std::uint8_t*>(&msg_size), sizeof(std::uint32_t));
 			payloadsize = msg_size + _header_size;
 
-			// LogTrace("Waiting for buffer with payloadsize = %llu", payloadsize);
-			// LogTrace("HS = %llu", _header_size);
-			// LogTrace("MSG = %d", msg_size);
-			// LogTrace("Current buffer offset = %llu", _buffer_offset);
-			// LogTrace("Buffer total size = %llu", _buffer.size());
+			if(payloadsize > _max_size)
+			{
+				LogError("SysByteStream: Frame of size %llu does not fit the stream buffer.", payloadsize);
+				_unblock_sig.store(true);
+				lock.unlock();
+				_notifier.notify_all();
+				return {};
+			}
+
+			if(payloadsize > _size)
+			{
+				// Ask the producer to grow the ring (we are not holding any view now)
+				_grow_request = payloadsize;
+				_notifier.notify_all();
+			}
 			
-			_notifier.wait(lock, [&](){ return payloadsize <= _buffer_offset; });
+			_notifier.wait(lock, [&](){ return (payloadsize <= _head - _tail) || _unblock_sig.load(); });
 
-			std::memcpy(buffer, _buffer.data(), payloadsize);
-			_buffer_offset -= payloadsize;
+			if(_unblock_sig.load())
+			{
+				return {};
+			}
+			position = _tail;
+		}
 
-			if(_buffer_offset > 0)
+		// The producer never touches [tail, head) so this is safe without the lock
+		FrameView view;
+		view._size = payloadsize;
+		const std::uint64_t offset = position % _size;
+		if(offset + payloadsize <= _size)
+		{
+			view._data = _buffer + offset;
+		}
+		else
+		{
+			if(_wrap_buffer.size() < payloadsize)
 			{
-				std::memmove(_buffer.data(), _buffer.data() + payloadsize, _buffer_offset);
+				_wrap_buffer.resize(payloadsize);
 			}
+			copyOut(position, _wrap_buffer.data(), payloadsize);
+			view._data = _wrap_buffer.data();
+		}
+		return view;
+	}
+
+	void SysByteStream::release(const FrameView& view)
+	{
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_tail += view._size;
 		}
-		_notifier.notify_one();
-		return payloadsize;
+		_notifier.notify_all();
+	}
+
+	std::uint64_t SysByteStream::fetch(std::uint8_t* buffer, std::uint64_t size)
+	{
+		FrameView view = fetchView();
+		if(view._size == 0)
+		{
+			return 0;
+		}
+
+		if(view._size > size)
+		{
+			LogError("SysByteStream: Frame of size %llu does not fit the fetch buffer.", view._size);
+			release(view);
+			return 0;
+		}
+
+		std::memcpy(buffer, view._data, view._size);
+		release(view);
+		return view._size;
 	}
 
 	void SysByteStream::requestUnblock()
 	{
 		_unblock_sig.store(true);
 		_notifier.notify_all();
+		if(_unblock_notifier)
+		{
+			SocketNotifierSignal(*_unblock_notifier);
+		}
+	}
+
+	void SysByteStream::setUnblockNotifier(const SocketNotifier* notifier)
+	{
+		_unblock_notifier = notifier;
+	}
+
+	bool SysByteStream::trim()
+	{
+		// Producer side only
+		// An empty ring has no views out so it can be swapped freely
+		std::unique_lock<std::mutex> lock(_mutex);
+		if(_head != _tail || _size <= _min_size || _grow_request > 0)
+		{
+			return false;
+		}
+
+		resize(_min_size);
+		std::vector<std::uint8_t>().swap(_wrap_buffer);
+		LogTrace("SysByteStream: Trimmed stream back to %llu bytes.", _size);
+		return true;
+	}
+
+	std::uint64_t SysByteStream::capacity()
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		return _size;
 	}
 
 	bool SysByteStream::unblockRequested() const
@@ -948,6 +1900,11 @@ namespace mulex
 		return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
 	}
 
+	std::uint64_t SysGetMonotonicNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
 	std::string_view SysGetCacheDir()
 	{
 		if(!_mxcachedir.empty())
@@ -1379,6 +2336,14 @@ namespace mulex
 		return _sys_evt_thread->emit(event, data, len);
 	}
 
+	void EvtRelay(const std::shared_ptr<EvtSubscriberQueue>& queue, const SysRefBuffer& frame, const EvtSubscriptionPolicy& policy)
+	{
+		if(_sys_evt_thread)
+		{
+			_sys_evt_thread->relay(queue, frame, policy);
+		}
+	}
+
 	bool SysMatchPattern(const std::string& pattern, const std::string& target)
 	{
 		// Pattern examples (only Kleene Star is available) (this is a shortcut to be fast with our rdb key cases)
@@ -1774,6 +2739,7 @@ namespace mulex
 		RdbCreateValueDirect("/system/metrics/cpu_usage", RdbValueType::FLOAT64, 0, 0.0);
 		RdbCreateValueDirect("/system/metrics/mem_total", RdbValueType::UINT64, 0, std::uint64_t(0));
 		RdbCreateValueDirect("/system/metrics/mem_used" , RdbValueType::UINT64, 0, std::uint64_t(0));
+		RdbCreateValueDirect("/system/metrics/evt_frames_per_syscall", RdbValueType::FLOAT64, 0, 0.0);
 
 		SysPerformanceMetrics metrics = SysGetPerformanceMetrics();
 		RdbWriteValueDirect("/system/metrics/mem_total", metrics._ram_total);
@@ -1781,6 +2747,7 @@ namespace mulex
 		_sys_performance_metrics_running.store(true);
 
 		_sys_performance_metrics_thread = std::make_unique<std::thread>([](){
+			EvtEmitCounters last = EvtGetEmitCounters();
 			while(_sys_performance_metrics_running.load())
 			{
 				SysPerformanceMetrics metrics = SysGetPerformanceMetrics();
@@ -1788,6 +2755,13 @@ namespace mulex
 				RdbWriteValueDirect("/system/metrics/cpu_usage", metrics._cpu_usage);
 				RdbWriteValueDirect("/system/metrics/mem_used", metrics._ram_used);
 
+				// Event frames sent per emit syscall over the last interval
+				EvtEmitCounters counters = EvtGetEmitCounters();
+				const std::uint64_t syscalls = counters._syscalls - last._syscalls;
+				const double ratio = syscalls > 0 ? static_cast<double>(counters._frames - last._frames) / syscalls : 0.0;
+				RdbWriteValueDirect("/system/metrics/evt_frames_per_syscall", ratio);
+				last = counters;
+
 				std::this_thread::sleep_for(std::chrono::milliseconds(SYS_PERF_GATHER_INTERVAL));
 			}
 		});
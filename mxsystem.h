@@ -10,6 +10,10 @@
 #include <queue>
 #include <mutex>
 #include <functional>
+#include <map>
+#include <deque>
+#include <memory>
+#include <atomic>
 #include "mxtypes.h"
 
 #ifdef _WIN32
@@ -20,6 +24,7 @@
 namespace mulex
 {
 	struct Socket;
+	struct SocketNotifier;
 	struct RPCGenericType;
 	class RPCClientThread;
 	class EvtClientThread;
@@ -97,6 +102,127 @@ namespace mulex
 		return buffer;
 	}
 
+	template<typename T>
+	struct SysIsMxString : std::false_type {};
+
+	template<std::uint64_t N>
+	struct SysIsMxString<mulex::mxstring<N>> : std::true_type {};
+
+	// NOTE: (Cesar) RPC argument wire format
+	// 				 mxstring<N> goes as [u16 length][bytes] without the terminator
+	// 				 RPCGenericType as [u64 size][bytes] and everything else as its raw bytes
+	// 				 SysPackArguments keeps the fixed layout since PDB rows and user payloads rely on it
+	template<typename T>
+	inline constexpr std::uint64_t SysPackedSize(const T& t)
+	{
+		if constexpr(std::is_same_v<T, mulex::RPCGenericType>)
+		{
+			return sizeof(std::uint64_t) + t._data.size();
+		}
+		else if constexpr(SysIsMxString<T>::value)
+		{
+			return sizeof(std::uint16_t) + t.size();
+		}
+		else if constexpr(std::is_same_v<T, std::vector<std::uint8_t>>)
+		{
+			return t.size();
+		}
+		else
+		{
+			return sizeof(T);
+		}
+	}
+
+	template<typename ...Args>
+	inline constexpr std::uint64_t SysPackedSize(const Args&... args)
+	{
+		return (std::uint64_t(0) + ... + SysPackedSize<Args>(args));
+	}
+
+	template<typename T>
+	inline std::uint8_t* SysPackArgumentTo(std::uint8_t* buffer, const T& t)
+	{
+		static_assert(
+			std::is_same_v<T, mulex::RPCGenericType> ||
+			std::is_trivially_copyable_v<T> ||
+			std::is_same_v<T, std::vector<std::uint8_t>>,
+			"SysPackArgumentTo requires trivially copyable arguments or a binary buffer."
+		);
+
+		if constexpr(std::is_same_v<T, mulex::RPCGenericType>)
+		{
+			const std::uint64_t size = t._data.size();
+			std::memcpy(buffer, &size, sizeof(std::uint64_t));
+			if(size > 0)
+			{
+				std::memcpy(buffer + sizeof(std::uint64_t), t._data.data(), size);
+			}
+			return buffer + sizeof(std::uint64_t) + size;
+		}
+		else if constexpr(SysIsMxString<T>::value)
+		{
+			const std::uint16_t size = static_cast<std::uint16_t>(t.size());
+			std::memcpy(buffer, &size, sizeof(std::uint16_t));
+			std::memcpy(buffer + sizeof(std::uint16_t), t.c_str(), size);
+			return buffer + sizeof(std::uint16_t) + size;
+		}
+		else if constexpr(std::is_same_v<T, std::vector<std::uint8_t>>)
+		{
+			if(!t.empty())
+			{
+				std::memcpy(buffer, t.data(), t.size());
+			}
+			return buffer + t.size();
+		}
+		else
+		{
+			std::memcpy(buffer, &t, sizeof(T));
+			return buffer + sizeof(T);
+		}
+	}
+
+	// NOTE: (Cesar) Packs in the RPC wire format, written in place
+	// 				 buffer must hold at least SysPackedSize(args...) bytes
+	template<typename ...Args>
+	inline void SysPackArgumentsTo([[maybe_unused]] std::uint8_t* buffer, const Args&... args)
+	{
+		((buffer = SysPackArgumentTo<Args>(buffer, args)), ...);
+	}
+
+	// Size of the packed (non generic) argument of type T at data
+	template<typename T>
+	inline std::uint64_t SysWireSize(const std::uint8_t* data)
+	{
+		if constexpr(SysIsMxString<std::remove_cv_t<T>>::value)
+		{
+			std::uint16_t size;
+			std::memcpy(&size, data, sizeof(std::uint16_t));
+			return sizeof(std::uint16_t) + size;
+		}
+		else
+		{
+			return sizeof(T);
+		}
+	}
+
+	// Strings are rebuilt, everything else is copied out (the wire has no alignment)
+	template<typename T>
+	inline std::remove_cv_t<T> SysWireRead(const std::uint8_t* data)
+	{
+		if constexpr(SysIsMxString<std::remove_cv_t<T>>::value)
+		{
+			std::uint16_t size;
+			std::memcpy(&size, data, sizeof(std::uint16_t));
+			return std::remove_cv_t<T>::FromData(reinterpret_cast<const char*>(data + sizeof(std::uint16_t)), size);
+		}
+		else
+		{
+			std::remove_cv_t<T> out;
+			std::memcpy(&out, data, sizeof(T));
+			return out;
+		}
+	}
+
 	template<typename T, typename ...Args>
 	inline std::tuple<T, Args...> SysUnpackArguments(const std::uint8_t* data, std::uint64_t size)
 	{
@@ -165,56 +291,421 @@ namespace mulex
 		return SysVargSize<T>(t) + SysVargSize<U, Args...>(u, args...);
 	}
 
-	class SysBufferStack
+	enum class SysOverflowPolicy
+	{
+		BLOCK,
+		DROP_OLDEST,
+		DROP_NEWEST
+	};
+
+	// NOTE: (Cesar) Bounded FIFO queue (Vyukov style ring with per cell sequence numbers)
+	// 				 Push and pop are lock free, waiting is done via atomic wait/notify
+	// 				 and only touches the kernel if there is someone sleeping
+	// 				 Safe for multiple producers and multiple consumers
+	template<typename T>
+	class SysRingQueue
 	{
 	public:
-		void push(std::vector<std::uint8_t>&& data);
-		void push(const std::vector<std::uint8_t>& data);
-		std::vector<std::uint8_t> pop();
-		void requestUnblock();
-		std::uint64_t size() const;
+		explicit SysRingQueue(std::uint64_t capacity = 1024, SysOverflowPolicy policy = SysOverflowPolicy::BLOCK)
+		{
+			std::uint64_t size = 2;
+			while(size < capacity) size <<= 1;
+
+			_cells = std::make_unique<Cell[]>(size);
+			_mask = size - 1;
+			_policy = policy;
+			for(std::uint64_t i = 0; i < size; i++)
+			{
+				_cells[i]._sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+
+		SysRingQueue(const SysRingQueue&) = delete;
+		SysRingQueue& operator=(const SysRingQueue&) = delete;
+
+		bool push(const T& value)
+		{
+			T copy = value;
+			return push(std::move(copy));
+		}
+
+		// Returns false if the value was not queued (DROP_NEWEST overflow or unblock requested)
+		bool push(T&& value)
+		{
+			while(!tryPush(value))
+			{
+				if(_sig_unblock.load())
+				{
+					return false;
+				}
+
+				switch(_policy)
+				{
+					case SysOverflowPolicy::DROP_NEWEST:
+					{
+						_dropped.fetch_add(1, std::memory_order_relaxed);
+						return false;
+					}
+					case SysOverflowPolicy::DROP_OLDEST:
+					{
+						T discard;
+						if(tryDequeue(discard))
+						{
+							_dropped.fetch_add(1, std::memory_order_relaxed);
+						}
+						break;
+					}
+					case SysOverflowPolicy::BLOCK:
+					{
+						waitFor(_pop_signal, _pop_waiters, [this](){ return !full(); });
+						break;
+					}
+				}
+			}
+			signal(_push_signal, _push_waiters);
+			return true;
+		}
+
+		// Blocks until there is data, returns T() if unblock was requested
+		T pop()
+		{
+			T value;
+			while(!_sig_unblock.load())
+			{
+				if(tryDequeue(value))
+				{
+					signal(_pop_signal, _pop_waiters);
+					return value;
+				}
+				waitFor(_push_signal, _push_waiters, [this](){ return !empty(); });
+			}
+			return T();
+		}
+
+		// Blocks until there is data and then drains up to max elements into out
+		std::uint64_t popBatch(std::vector<T>& out, std::uint64_t max)
+		{
+			std::uint64_t count = 0;
+			while(!_sig_unblock.load())
+			{
+				T value;
+				while(count < max && tryDequeue(value))
+				{
+					out.push_back(std::move(value));
+					count++;
+				}
+
+				if(count > 0)
+				{
+					signal(_pop_signal, _pop_waiters);
+					return count;
+				}
+				waitFor(_push_signal, _push_waiters, [this](){ return !empty(); });
+			}
+			return 0;
+		}
+
+		// Non blocking pop
+		bool tryPop(T& value)
+		{
+			if(tryDequeue(value))
+			{
+				signal(_pop_signal, _pop_waiters);
+				return true;
+			}
+			return false;
+		}
+
+		void requestUnblock()
+		{
+			_sig_unblock.store(true);
+			_push_signal.fetch_add(1);
+			_pop_signal.fetch_add(1);
+			_push_signal.notify_all();
+			_pop_signal.notify_all();
+		}
+
+		std::uint64_t size() const
+		{
+			const std::uint64_t dequeue = _dequeue_pos.load();
+			const std::uint64_t enqueue = _enqueue_pos.load();
+			return enqueue > dequeue ? enqueue - dequeue : 0;
+		}
+
+		std::uint64_t capacity() const
+		{
+			return _mask + 1;
+		}
+
+		std::uint64_t dropped() const
+		{
+			return _dropped.load(std::memory_order_relaxed);
+		}
+
+	private:
+		struct Cell
+		{
+			std::atomic<std::uint64_t> _sequence;
+			T 						   _value;
+		};
+
+		bool empty() const
+		{
+			return size() == 0;
+		}
+
+		bool full() const
+		{
+			return size() > _mask;
+		}
+
+		bool tryDequeue(T& value)
+		{
+			std::uint64_t pos = _dequeue_pos.load(std::memory_order_relaxed);
+			Cell* cell;
+			while(true)
+			{
+				cell = &_cells[pos & _mask];
+				std::uint64_t seq = cell->_sequence.load(std::memory_order_acquire);
+				std::int64_t diff = static_cast<std::int64_t>(seq) - static_cast<std::int64_t>(pos + 1);
+				if(diff == 0)
+				{
+					if(_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					{
+						break;
+					}
+				}
+				else if(diff < 0)
+				{
+					return false; // Empty
+				}
+				else
+				{
+					pos = _dequeue_pos.load(std::memory_order_relaxed);
+				}
+			}
+
+			value = std::move(cell->_value);
+			cell->_value = T();
+			cell->_sequence.store(pos + _mask + 1, std::memory_order_release);
+			return true;
+		}
+
+		bool tryPush(T& value)
+		{
+			std::uint64_t pos = _enqueue_pos.load(std::memory_order_relaxed);
+			Cell* cell;
+			while(true)
+			{
+				cell = &_cells[pos & _mask];
+				std::uint64_t seq = cell->_sequence.load(std::memory_order_acquire);
+				std::int64_t diff = static_cast<std::int64_t>(seq) - static_cast<std::int64_t>(pos);
+				if(diff == 0)
+				{
+					if(_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					{
+						break;
+					}
+				}
+				else if(diff < 0)
+				{
+					return false; // Full
+				}
+				else
+				{
+					pos = _enqueue_pos.load(std::memory_order_relaxed);
+				}
+			}
+
+			cell->_value = std::move(value);
+			cell->_sequence.store(pos + 1, std::memory_order_release);
+			return true;
+		}
+
+		// NOTE: (Cesar) The waiter count is raised before re-checking the condition
+		// 				 so a signal() after the check is never missed
+		template<typename F>
+		void waitFor(std::atomic<std::uint32_t>& sig, std::atomic<std::uint32_t>& waiters, F ready)
+		{
+			waiters.fetch_add(1);
+			const std::uint32_t value = sig.load();
+			if(!ready() && !_sig_unblock.load())
+			{
+				sig.wait(value);
+			}
+			waiters.fetch_sub(1);
+		}
+
+		void signal(std::atomic<std::uint32_t>& sig, std::atomic<std::uint32_t>& waiters)
+		{
+			sig.fetch_add(1);
+			if(waiters.load() > 0)
+			{
+				sig.notify_all();
+			}
+		}
 
 	private:
-		std::stack<std::vector<std::uint8_t>> _stack;
-		mutable std::mutex _mutex;
-		std::atomic<bool> _sig_unblock = false;
-		std::condition_variable _notifier;
+		std::unique_ptr<Cell[]> 				_cells;
+		std::uint64_t 							_mask;
+		SysOverflowPolicy 						_policy;
+		alignas(64) std::atomic<std::uint64_t> 	_enqueue_pos = 0;
+		alignas(64) std::atomic<std::uint64_t> 	_dequeue_pos = 0;
+		alignas(64) std::atomic<std::uint32_t> 	_push_signal = 0;
+		std::atomic<std::uint32_t> 				_push_waiters = 0;
+		alignas(64) std::atomic<std::uint32_t> 	_pop_signal = 0;
+		std::atomic<std::uint32_t> 				_pop_waiters = 0;
+		std::atomic<std::uint64_t> 				_dropped = 0;
+		std::atomic<bool> 						_sig_unblock = false;
 	};
 
-	class SysRefBufferStack
+	// NOTE: (Cesar) Immutable shared buffer
+	// 				 Refcount, size and data live in a single allocation
+	// 				 Copies only bump the refcount so a frame can be queued for
+	// 				 any number of sockets without copying the payload
+	class SysRefBuffer
 	{
 	public:
-		void push(std::vector<std::uint8_t>&& data, std::uint16_t ref);
-		std::vector<std::uint8_t> pop();
-		const std::vector<std::uint8_t>* peek();
-		void decref();
-		void requestUnblock();
+		SysRefBuffer() = default;
+		SysRefBuffer(const SysRefBuffer& other);
+		SysRefBuffer(SysRefBuffer&& other) noexcept;
+		SysRefBuffer& operator=(const SysRefBuffer& other);
+		SysRefBuffer& operator=(SysRefBuffer&& other) noexcept;
+		~SysRefBuffer();
+
+		static SysRefBuffer Allocate(std::uint64_t size);
+		static SysRefBuffer Copy(const std::uint8_t* data, std::uint64_t size);
+
+		const std::uint8_t* data() const;
+		std::uint8_t* mutableData(); // Only valid while the buffer is not shared yet
+		std::uint64_t size() const;
+		bool empty() const;
+		std::uint32_t refcount() const;
 
 	private:
-		std::atomic<std::uint16_t> _refcount = 0;
-		std::stack<std::vector<std::uint8_t>> _stack;
-		std::mutex _mutex;
-		std::condition_variable _notifier;
+		struct Block
+		{
+			std::atomic<std::uint32_t> _refcount;
+			std::uint64_t 			   _size;
+		};
+		void release();
+
+	private:
+		Block* _block = nullptr;
 	};
 	
+	// NOTE: (Cesar) Process wide pool of power of two byte blocks
+	// 				 Receive streams borrow their ring from here and give it back
+	// 				 when they shrink or close, at most SYS_BUFFER_POOL_CACHE_SIZE
+	// 				 bytes of free blocks are kept around for reuse
+	class SysBufferPool
+	{
+	public:
+		static SysBufferPool& Get();
+		~SysBufferPool();
+
+		std::uint8_t* acquire(std::uint64_t size, std::uint64_t* capacity);
+		void release(std::uint8_t* block, std::uint64_t capacity);
+		std::uint64_t usedBytes() const;
+		std::uint64_t cachedBytes() const;
+
+	private:
+		SysBufferPool() = default;
+
+	private:
+		mutable std::mutex 								 _mutex;
+		std::map<std::uint64_t, std::vector<std::uint8_t*>> _free;
+		std::uint64_t 									 _cached = 0;
+		std::uint64_t 									 _used = 0;
+	};
+
+	static constexpr std::uint64_t SYS_BUFFER_POOL_CACHE_SIZE = 0x4000000; // 64MB
+
+	// NOTE: (Cesar) Log-linear (HDR style) histogram of nanosecond latencies
+	// 				 Values below 2^SUB_BITS are exact, above that every power of two is split
+	// 				 into 2^SUB_BITS buckets so percentiles are within ~3% of the real value
+	// 				 Values above 2^MAX_BITS ns (~18 min) land on the last bucket
+	// 				 Not thread safe, callers hold their own lock
+	class SysLatencyHistogram
+	{
+	public:
+		static constexpr std::uint32_t SUB_BITS = 5;
+		static constexpr std::uint32_t MAX_BITS = 40;
+		static constexpr std::uint32_t BUCKETS = (MAX_BITS - SUB_BITS + 1) << SUB_BITS;
+
+		void record(std::uint64_t ns);
+		void merge(const SysLatencyHistogram& other);
+		void reset();
+		std::uint64_t count() const;
+		std::uint64_t max() const;
+		std::uint64_t percentile(double p) const; // p in [0, 100]
+
+		// Sparse encoding, only buckets with counts go out
+		std::vector<std::uint8_t> serialize() const;
+		bool deserialize(const std::uint8_t* data, std::uint64_t size, std::uint64_t* read = nullptr);
+
+	private:
+		static std::uint32_t BucketOf(std::uint64_t ns);
+		static std::uint64_t BucketValue(std::uint32_t bucket);
+
+	private:
+		std::vector<std::uint64_t> _counts; // Allocated on the first record
+		std::uint64_t 			   _count = 0;
+		std::uint64_t 			   _max = 0;
+	};
+
+	// NOTE: (Cesar) Single producer / single consumer byte ring split into frames
+	// 				 Frames have a header of headersize bytes with a u32 payload size at headeroffset
+	// 				 The consumer gets a view of the next frame straight from the ring and
+	// 				 releases it when done, only frames that wrap around the end are copied
+	// 				 The lock only guards the head/tail updates, copies are done outside of it
+	// 				 If maxsize > size the ring starts small and the producer grows it when the
+	// 				 consumer asks for a frame that does not fit, trim() gives the memory back
 	class SysByteStream
 	{
 	public:
-		SysByteStream(std::uint64_t size, std::uint64_t headersize, std::uint64_t headeroffset);
+		struct FrameView
+		{
+			const std::uint8_t* _data = nullptr;
+			std::uint64_t 		_size = 0;
+		};
+
+		SysByteStream(std::uint64_t size, std::uint64_t headersize, std::uint64_t headeroffset, std::uint64_t maxsize = 0);
+		~SysByteStream();
+		SysByteStream(const SysByteStream&) = delete;
+		SysByteStream& operator=(const SysByteStream&) = delete;
 		
-		bool push(std::uint8_t* data, std::uint64_t size);
+		bool push(const std::uint8_t* data, std::uint64_t size);
+		std::uint8_t* acquireWrite(std::uint64_t* avail);
+		void commitWrite(std::uint64_t size);
+		FrameView fetchView();
+		void release(const FrameView& view);
 		std::uint64_t fetch(std::uint8_t* buffer, std::uint64_t size);
 		void requestUnblock();
 		bool unblockRequested() const;
+		void setUnblockNotifier(const SocketNotifier* notifier);
+		bool trim();
+		std::uint64_t capacity();
+
+	private:
+		void copyOut(std::uint64_t position, std::uint8_t* buffer, std::uint64_t size) const;
+		void resize(std::uint64_t size);
 
 	private:
-		std::vector<std::uint8_t> _buffer;
-		std::uint64_t 	  		  _buffer_offset;
+		std::uint8_t* 			  _buffer;
+		std::uint64_t 			  _size;
+		std::uint64_t 			  _min_size;
+		std::uint64_t 			  _max_size;
+		std::uint64_t 			  _grow_request;
+		std::vector<std::uint8_t> _wrap_buffer;
+		std::uint64_t 	  		  _head;
+		std::uint64_t 	  		  _tail;
 		std::uint64_t			  _header_size;
 		std::uint64_t			  _header_size_offset;
 		std::atomic<bool> 		  _unblock_sig;
 		std::mutex 				  _mutex;
 		std::condition_variable   _notifier;
+		const SocketNotifier* 	  _unblock_notifier;
 	};
 
 	class SysFileWatcher
@@ -273,15 +764,63 @@ namespace mulex
 	struct SysRecvThread
 	{
 		SysRecvThread(const Socket& socket, std::uint64_t ssize, std::uint64_t sheadersize, std::uint64_t sheaderoffset);
-		SysByteStream _stream;
-		std::thread   _handle;
+		~SysRecvThread();
+		SysByteStream 					_stream;
+		std::unique_ptr<SocketNotifier> _wakeup;
+		std::thread   					_handle;
 	};
 
 	static constexpr std::uint64_t SYS_RECV_THREAD_BUFFER_SIZE = 0x640000; // 10MB Maximum return size !
+	static constexpr std::uint64_t SYS_RECV_THREAD_INITIAL_BUFFER_SIZE = 0x10000; // 64KB
+	static constexpr std::int64_t  SYS_RECV_THREAD_TRIM_DELAY = 1000; // ms
 
 	[[nodiscard]] std::unique_ptr<SysRecvThread> SysStartRecvThread(const Socket& socket, std::uint64_t headersize, std::uint64_t headeroffset);
 	bool SysRecvThreadCanStart([[maybe_unused]] const Socket& socket);
 
+	// NOTE: (Cesar) Event driven alternative to SysRecvThread
+	// 				 A fixed number of epoll loops own all of the attached sockets
+	// 				 and split the incoming bytes into frames using the same
+	// 				 headersize/headeroffset contract as SysByteStream
+	// 				 Only available under linux
+	class SysIoReactor
+	{
+	public:
+		using FrameFunc = std::function<void(const Socket& socket, const std::uint8_t* frame, std::uint64_t size)>;
+		using CloseFunc = std::function<void(const Socket& socket)>;
+		using DrainFunc = std::function<void(const Socket& socket)>;
+		using SendFunc  = std::function<void(std::uint64_t frames, std::uint64_t syscalls)>; // Called once per flush
+
+		SysIoReactor(std::uint32_t nloops, std::uint64_t headersize, std::uint64_t headeroffset, FrameFunc onframe, CloseFunc onclose, DrainFunc ondrain = nullptr, SendFunc onsend = nullptr);
+		~SysIoReactor();
+
+		bool attach(const Socket& socket);
+		bool send(const Socket& socket, const SysRefBuffer& data);
+		std::uint64_t pending(const Socket& socket);
+		std::uint32_t loops() const;
+		static bool Supported();
+
+	private:
+		struct Connection;
+		struct Loop;
+		void loopThread(Loop* loop);
+		void readConnection(Loop* loop, Connection* conn);
+		bool flushConnection(Loop* loop, Connection* conn);
+		void closeConnection(Loop* loop, int fd);
+
+	private:
+		std::vector<std::unique_ptr<Loop>> _loops;
+		std::atomic<std::uint32_t> 		   _next_loop;
+		std::uint64_t 					   _header_size;
+		std::uint64_t 					   _header_size_offset;
+		FrameFunc 						   _onframe;
+		CloseFunc 						   _onclose;
+		DrainFunc 						   _ondrain;
+		SendFunc 						   _onsend;
+		std::atomic<bool> 				   _running;
+		std::mutex 						   _sockets_mutex;
+		std::map<std::int64_t, Loop*> 	   _sockets;
+	};
+
 	struct Experiment
 	{
 		std::string _exp_name;
@@ -311,6 +850,7 @@ namespace mulex
 	void SysAddArgument(const std::string& longname, const char shortname, bool needvalue, std::function<void(const std::string&)> action, const std::string& helptxt = "");
 	bool SysParseArguments(int argc, char* argv[]);
 	std::int64_t SysGetCurrentTime();
+	std::uint64_t SysGetMonotonicNs(); // Only comparable between processes on the same host
 	std::string_view SysGetCacheDir();
 	std::string_view SysGetCacheLockDir();
 	std::string_view SysGetCachePrivateDir();
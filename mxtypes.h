@@ -42,10 +42,27 @@ namespace mulex
 		{
 			return &_data[0];
 		}
+
+		// NOTE: (Cesar) Length without the terminator (S when the string fills the buffer)
+		inline std::uint64_t size() const
+		{
+			return strnlen(_data, S);
+		}
+
+		// Builds from size bytes that are not null terminated, truncates to S - 1
+		inline static mxstring FromData(const char* data, std::uint64_t size)
+		{
+			mxstring s;
+			size = size < S ? size : S - 1;
+			std::memcpy(s._data, data, size);
+			s._data[size] = 0;
+			return s;
+		}
 	private:
 		char _data[S];
 	};
 
 	using string32 = mxstring<32>;
 	using string128 = mxstring<128>;
+	using string256 = mxstring<256>;
 }
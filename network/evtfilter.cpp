@@ -0,0 +1,362 @@
+#include "evtfilter.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+namespace mulex
+{
+	// NOTE: (Cesar) Recursive descent over
+	// 				 expr   := term ('||' term)*
+	// 				 term   := factor ('&&' factor)*
+	// 				 factor := '!' factor | '(' expr ')' | type '@' offset cmp number
+	// 				 Emits the instructions in postfix order
+	class EvtFilter::Parser
+	{
+	public:
+		Parser(const std::string& source, std::vector<Instruction>& program) : _src(source), _program(program) { }
+
+		bool parse(std::string* error)
+		{
+			const bool parsed = expr() && (skip(), _pos == _src.size() || fail("Unexpected input"));
+			if(!parsed)
+			{
+				if(error)
+				{
+					*error = _error + " at position " + std::to_string(_pos) + ".";
+				}
+				return false;
+			}
+			return true;
+		}
+
+	private:
+		bool fail(const char* msg)
+		{
+			if(_error.empty())
+			{
+				_error = msg;
+			}
+			return false;
+		}
+
+		void emit(Op op)
+		{
+			Instruction ins;
+			ins._op = op;
+			_program.push_back(ins);
+		}
+
+		void skip()
+		{
+			while(_pos < _src.size() && std::isspace(static_cast<unsigned char>(_src[_pos])))
+			{
+				_pos++;
+			}
+		}
+
+		bool accept(const char* token)
+		{
+			skip();
+			const std::size_t len = std::strlen(token);
+			if(_src.compare(_pos, len, token) == 0)
+			{
+				_pos += len;
+				return true;
+			}
+			return false;
+		}
+
+		bool expr()
+		{
+			if(!term())
+			{
+				return false;
+			}
+
+			while(accept("||"))
+			{
+				if(!term())
+				{
+					return false;
+				}
+				emit(Op::OR);
+			}
+			return true;
+		}
+
+		bool term()
+		{
+			if(!factor())
+			{
+				return false;
+			}
+
+			while(accept("&&"))
+			{
+				if(!factor())
+				{
+					return false;
+				}
+				emit(Op::AND);
+			}
+			return true;
+		}
+
+		bool factor()
+		{
+			if(accept("!"))
+			{
+				if(!factor())
+				{
+					return false;
+				}
+				emit(Op::NOT);
+				return true;
+			}
+
+			if(accept("("))
+			{
+				if(!expr())
+				{
+					return false;
+				}
+				return accept(")") || fail("Expected ')'");
+			}
+
+			return comparison();
+		}
+
+		bool comparison()
+		{
+			static constexpr struct { const char* _name; Type _type; std::uint8_t _size; } types[] = {
+				{ "u8",  Type::U8,  1 }, { "i8",  Type::I8,  1 },
+				{ "u16", Type::U16, 2 }, { "i16", Type::I16, 2 },
+				{ "u32", Type::U32, 4 }, { "i32", Type::I32, 4 },
+				{ "u64", Type::U64, 8 }, { "i64", Type::I64, 8 },
+				{ "f32", Type::F32, 4 }, { "f64", Type::F64, 8 }
+			};
+
+			// Longer cmp tokens first so "<=" is not taken as "<"
+			static constexpr struct { const char* _token; Cmp _cmp; } cmps[] = {
+				{ "==", Cmp::EQ }, { "!=", Cmp::NE }, { "<=", Cmp::LE },
+				{ ">=", Cmp::GE }, { "<",  Cmp::LT }, { ">",  Cmp::GT }
+			};
+
+			Instruction ins;
+			bool typed = false;
+			for(const auto& type : types)
+			{
+				if(accept(type._name))
+				{
+					ins._type = type._type;
+					ins._size = type._size;
+					typed = true;
+					break;
+				}
+			}
+
+			if(!typed)
+			{
+				return fail("Expected a type (u8/i8/u16/i16/u32/i32/u64/i64/f32/f64)");
+			}
+
+			if(!accept("@"))
+			{
+				return fail("Expected '@'");
+			}
+
+			skip();
+			const char* begin = _src.c_str() + _pos;
+			char* end;
+			errno = 0;
+			const unsigned long long offset = std::strtoull(begin, &end, 0);
+			if(end == begin || *begin == '-' || errno == ERANGE || offset > 0xFFFFFFFF)
+			{
+				return fail("Expected a payload offset");
+			}
+			ins._offset = static_cast<std::uint32_t>(offset);
+			_pos += end - begin;
+
+			bool compared = false;
+			for(const auto& cmp : cmps)
+			{
+				if(accept(cmp._token))
+				{
+					ins._cmp = cmp._cmp;
+					compared = true;
+					break;
+				}
+			}
+
+			if(!compared)
+			{
+				return fail("Expected a comparison (== != < <= > >=)");
+			}
+
+			skip();
+			begin = _src.c_str() + _pos;
+			errno = 0;
+			switch(ins._type)
+			{
+				case Type::F32:
+				case Type::F64:
+					ins._f = std::strtod(begin, &end);
+					break;
+				case Type::I8:
+				case Type::I16:
+				case Type::I32:
+				case Type::I64:
+					ins._i = std::strtoll(begin, &end, 0);
+					break;
+				default:
+					ins._u = std::strtoull(begin, &end, 0);
+					if(*begin == '-')
+					{
+						return fail("Negative value for an unsigned type");
+					}
+					break;
+			}
+
+			if(end == begin || errno == ERANGE)
+			{
+				return fail("Expected a number");
+			}
+			_pos += end - begin;
+
+			_program.push_back(ins);
+			return true;
+		}
+
+	private:
+		const std::string& 		  _src;
+		std::vector<Instruction>& _program;
+		std::size_t 			  _pos = 0;
+		std::string 			  _error;
+	};
+
+	std::unique_ptr<EvtFilter> EvtFilter::Compile(const std::string& source, std::string* error)
+	{
+		if(source.size() >= EVT_FILTER_MAX_SOURCE)
+		{
+			if(error)
+			{
+				*error = "Filter is too long.";
+			}
+			return nullptr;
+		}
+
+		std::unique_ptr<EvtFilter> filter(new EvtFilter());
+		filter->_source = source;
+
+		Parser parser(source, filter->_program);
+		if(!parser.parse(error))
+		{
+			return nullptr;
+		}
+
+		// The bit stack is a single u64
+		std::uint64_t depth = 0;
+		std::uint64_t maxdepth = 0;
+		for(const Instruction& ins : filter->_program)
+		{
+			if(ins._op == Op::CMP)
+			{
+				maxdepth = std::max(maxdepth, ++depth);
+			}
+			else if(ins._op != Op::NOT)
+			{
+				depth--;
+			}
+		}
+
+		if(maxdepth > EVT_FILTER_MAX_DEPTH)
+		{
+			if(error)
+			{
+				*error = "Filter is nested too deep.";
+			}
+			return nullptr;
+		}
+
+		return filter;
+	}
+
+	template<typename T>
+	static inline T EvtFilterLoad(const std::uint8_t* ptr)
+	{
+		T value;
+		std::memcpy(&value, ptr, sizeof(T));
+		return value;
+	}
+
+	template<typename T>
+	static inline bool EvtFilterCompare(T a, T b, std::uint8_t cmp)
+	{
+		switch(cmp)
+		{
+			case 0: return a == b;
+			case 1: return a != b;
+			case 2: return a < b;
+			case 3: return a <= b;
+			case 4: return a > b;
+			default: return a >= b;
+		}
+	}
+
+	bool EvtFilter::Compare(const Instruction& ins, const std::uint8_t* payload, std::uint64_t len)
+	{
+		if(static_cast<std::uint64_t>(ins._offset) + ins._size > len)
+		{
+			return false;
+		}
+
+		const std::uint8_t* ptr = payload + ins._offset;
+		const std::uint8_t cmp = static_cast<std::uint8_t>(ins._cmp);
+		switch(ins._type)
+		{
+			case Type::U8:  return EvtFilterCompare<std::uint64_t>(EvtFilterLoad<std::uint8_t>(ptr), ins._u, cmp);
+			case Type::U16: return EvtFilterCompare<std::uint64_t>(EvtFilterLoad<std::uint16_t>(ptr), ins._u, cmp);
+			case Type::U32: return EvtFilterCompare<std::uint64_t>(EvtFilterLoad<std::uint32_t>(ptr), ins._u, cmp);
+			case Type::U64: return EvtFilterCompare<std::uint64_t>(EvtFilterLoad<std::uint64_t>(ptr), ins._u, cmp);
+			case Type::I8:  return EvtFilterCompare<std::int64_t>(EvtFilterLoad<std::int8_t>(ptr), ins._i, cmp);
+			case Type::I16: return EvtFilterCompare<std::int64_t>(EvtFilterLoad<std::int16_t>(ptr), ins._i, cmp);
+			case Type::I32: return EvtFilterCompare<std::int64_t>(EvtFilterLoad<std::int32_t>(ptr), ins._i, cmp);
+			case Type::I64: return EvtFilterCompare<std::int64_t>(EvtFilterLoad<std::int64_t>(ptr), ins._i, cmp);
+			case Type::F32: return EvtFilterCompare<double>(EvtFilterLoad<float>(ptr), ins._f, cmp);
+			case Type::F64: return EvtFilterCompare<double>(EvtFilterLoad<double>(ptr), ins._f, cmp);
+		}
+		return false;
+	}
+
+	bool EvtFilter::match(const std::uint8_t* payload, std::uint64_t len) const
+	{
+		// Top of the stack is bit 0
+		std::uint64_t stack = 0;
+		for(const Instruction& ins : _program)
+		{
+			switch(ins._op)
+			{
+				case Op::CMP:
+					stack = (stack << 1) | (Compare(ins, payload, len) ? 1 : 0);
+					break;
+				case Op::AND:
+					stack = (stack >> 1) & (stack | ~1ULL);
+					break;
+				case Op::OR:
+					stack = (stack >> 1) | (stack & 1);
+					break;
+				case Op::NOT:
+					stack ^= 1;
+					break;
+			}
+		}
+		return stack & 1;
+	}
+
+	const std::string& EvtFilter::source() const
+	{
+		return _source;
+	}
+} // namespace mulex
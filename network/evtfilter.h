@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mulex
+{
+	static constexpr std::uint64_t EVT_FILTER_MAX_SOURCE = 256;
+	static constexpr std::uint64_t EVT_FILTER_MAX_DEPTH = 64;
+
+	// NOTE: (Cesar) Content filter evaluated by the event server before a frame is queued for a subscriber
+	// 				 The source is a list of typed comparisons on payload byte offsets joined by && / ||
+	// 				 e.g. "u16@8 == 3 && (f32@12 > 0.5 || !(u8@0 == 0x7f))"
+	// 				 Types are u8/i8/u16/i16/u32/i32/u64/i64/f32/f64 (little endian, unaligned)
+	// 				 The source is compiled once into a postfix program so matching is a single pass
+	// 				 over the instructions with the intermediate results kept in a bit stack
+	// 				 A comparison that reads past the end of the payload is false
+	class EvtFilter
+	{
+	public:
+		static std::unique_ptr<EvtFilter> Compile(const std::string& source, std::string* error = nullptr);
+
+		bool match(const std::uint8_t* payload, std::uint64_t len) const;
+		const std::string& source() const;
+
+	private:
+		enum class Op : std::uint8_t
+		{
+			CMP,
+			AND,
+			OR,
+			NOT
+		};
+
+		enum class Type : std::uint8_t
+		{
+			U8, I8, U16, I16, U32, I32, U64, I64, F32, F64
+		};
+
+		enum class Cmp : std::uint8_t
+		{
+			EQ, NE, LT, LE, GT, GE
+		};
+
+		struct Instruction
+		{
+			Op 			  _op = Op::CMP;
+			Type 		  _type = Type::U8;
+			Cmp 		  _cmp = Cmp::EQ;
+			std::uint8_t  _size = 0;
+			std::uint32_t _offset = 0;
+			union
+			{
+				std::uint64_t _u = 0;
+				std::int64_t  _i;
+				double 		  _f;
+			};
+		};
+
+		class Parser;
+		EvtFilter() = default;
+		static bool Compare(const Instruction& ins, const std::uint8_t* payload, std::uint64_t len);
+
+	private:
+		std::string 			 _source;
+		std::vector<Instruction> _program;
+	};
+} // namespace mulex
@@ -0,0 +1,547 @@
+// Date   : 17/10/2026
+// Brief  : Memory mapped event journal for recording and replaying events
+
+#include "journal.h"
+#include "../mxlogger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace mulex
+{
+	// NOTE: (Cesar) Records start right after the header
+	// 				 _used counts the header and is only stored after a record is fully written
+	struct JournalSegment
+	{
+		std::uint32_t 			   _magic;
+		std::uint32_t 			   _version;
+		std::uint32_t 			   _index;
+		std::uint32_t 			   _reserved;
+		std::int64_t 			   _start; // Wall time (ms) of the journal start
+		std::uint64_t 			   _size;
+		alignas(64) std::atomic<std::uint64_t> _used;
+	};
+
+	static constexpr std::uint64_t JournalAlign(std::uint64_t size)
+	{
+		return (size + 7) & ~std::uint64_t(7);
+	}
+
+	static constexpr std::uint64_t JournalDataOffset()
+	{
+		return JournalAlign(sizeof(JournalSegment));
+	}
+
+	static std::uint64_t JournalNowNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	static std::string JournalSegmentPath(const std::string& dir, std::uint32_t index)
+	{
+		char name[32];
+		std::snprintf(name, sizeof(name), "segment-%06u.mxj", index);
+		return dir + "/" + name;
+	}
+
+	JournalWriter::~JournalWriter()
+	{
+		close();
+	}
+
+	bool JournalWriter::Supported()
+	{
+#ifdef __linux__
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	std::unique_ptr<JournalWriter> JournalWriter::Create(const std::string& dir, std::uint64_t segsize)
+	{
+#ifdef __linux__
+		std::error_code ec;
+		std::filesystem::create_directories(dir, ec);
+		if(!std::filesystem::is_directory(dir) || !std::filesystem::is_empty(dir))
+		{
+			LogError("[journal] Journal directory <%s> is not an empty directory.", dir.c_str());
+			return nullptr;
+		}
+
+		std::unique_ptr<JournalWriter> writer(new JournalWriter());
+		writer->_dir = dir;
+		writer->_segment_size = segsize;
+		writer->_start = JournalNowNs();
+		writer->_index_time.resize(UINT16_MAX + 1, 0);
+		writer->_index_count.resize(UINT16_MAX + 1, 0);
+
+		writer->_index_file = std::fopen((dir + "/index.mxj").c_str(), "wb");
+		writer->_names_file = std::fopen((dir + "/names.txt").c_str(), "w");
+		if(!writer->_index_file || !writer->_names_file)
+		{
+			LogError("[journal] Failed to create the journal index at <%s>.", dir.c_str());
+			return nullptr;
+		}
+
+		writer->_current = writer->mapSegment(0);
+		if(!writer->_current)
+		{
+			return nullptr;
+		}
+
+		writer->_running = true;
+		writer->_segment_thread = std::make_unique<std::thread>(&JournalWriter::segmentThread, writer.get());
+		LogTrace("[journal] Created journal at <%s>.", dir.c_str());
+		return writer;
+#else
+		static_cast<void>(dir);
+		static_cast<void>(segsize);
+		return nullptr;
+#endif
+	}
+
+	JournalSegment* JournalWriter::mapSegment(std::uint32_t index)
+	{
+#ifdef __linux__
+		const std::string path = JournalSegmentPath(_dir, index);
+		int fd = ::open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+		if(fd < 0)
+		{
+			LogError("[journal] Failed to create segment <%s>.", path.c_str());
+			return nullptr;
+		}
+
+		// Reserve the blocks up front so a full disk fails here and not as a SIGBUS on append
+		int err = ::posix_fallocate(fd, 0, static_cast<off_t>(_segment_size));
+		if(err == EOPNOTSUPP || err == EINVAL)
+		{
+			err = ::ftruncate(fd, static_cast<off_t>(_segment_size)) < 0 ? errno : 0;
+		}
+
+		if(err != 0)
+		{
+			LogError("[journal] Failed to allocate segment <%s>.", path.c_str());
+			::close(fd);
+			::unlink(path.c_str());
+			return nullptr;
+		}
+
+		void* memory = ::mmap(nullptr, _segment_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+		::close(fd);
+		if(memory == MAP_FAILED)
+		{
+			LogError("[journal] Failed to map segment <%s>.", path.c_str());
+			::unlink(path.c_str());
+			return nullptr;
+		}
+
+		JournalSegment* segment = new(memory) JournalSegment();
+		segment->_magic = JOURNAL_MAGIC;
+		segment->_version = JOURNAL_VERSION;
+		segment->_index = index;
+		segment->_start = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::system_clock::now().time_since_epoch() - std::chrono::nanoseconds(JournalNowNs() - _start)
+		).count();
+		segment->_size = _segment_size;
+		segment->_used.store(JournalDataOffset(), std::memory_order_release);
+		return segment;
+#else
+		static_cast<void>(index);
+		return nullptr;
+#endif
+	}
+
+	void JournalWriter::unmapSegment(JournalSegment* segment, bool remove)
+	{
+#ifdef __linux__
+		const std::string path = JournalSegmentPath(_dir, segment->_index);
+		const std::uint64_t used = segment->_used.load();
+		::munmap(segment, _segment_size);
+
+		// Give back the unused tail of the segment
+		if(remove)
+		{
+			::unlink(path.c_str());
+		}
+		else if(::truncate(path.c_str(), static_cast<off_t>(used)) < 0)
+		{
+			LogWarning("[journal] Failed to truncate segment <%s>.", path.c_str());
+		}
+#else
+		static_cast<void>(segment);
+		static_cast<void>(remove);
+#endif
+	}
+
+	void JournalWriter::segmentThread()
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		while(_running)
+		{
+			_segment_notifier.wait(lock, [this]() { return !_running || !_retired.empty() || (!_next && !_next_failed); });
+
+			std::vector<JournalSegment*> retired;
+			retired.swap(_retired);
+			const bool prepare = _running && !_next && !_next_failed;
+			const std::uint32_t index = _current_index + 1;
+
+			lock.unlock();
+			for(JournalSegment* segment : retired)
+			{
+				unmapSegment(segment, false);
+			}
+
+			JournalSegment* next = prepare ? mapSegment(index) : nullptr;
+			lock.lock();
+
+			if(prepare)
+			{
+				_next = next;
+				_next_failed = (next == nullptr);
+				_segment_notifier.notify_all();
+			}
+		}
+	}
+
+	bool JournalWriter::rotate(std::unique_lock<std::mutex>& lock)
+	{
+		_segment_notifier.wait(lock, [this]() { return !_running || _next || _next_failed; });
+		if(!_next)
+		{
+			return false;
+		}
+
+		_retired.push_back(_current);
+		_current = _next;
+		_current_index = _current->_index;
+		_next = nullptr;
+		_segment_notifier.notify_all();
+		return true;
+	}
+
+	void JournalWriter::index(std::uint16_t eventid, std::uint64_t time, std::uint64_t offset)
+	{
+		for(std::uint16_t id : { std::uint16_t(0), eventid })
+		{
+			if(_index_count[id] == 0 || time - _index_time[id] >= JOURNAL_INDEX_INTERVAL)
+			{
+				JournalIndexEntry entry = { time, offset, _current_index, id, 0, _index_count[id] };
+				std::fwrite(&entry, sizeof(JournalIndexEntry), 1, _index_file);
+				_index_time[id] = time;
+			}
+			_index_count[id]++;
+		}
+	}
+
+	bool JournalWriter::append(std::uint16_t eventid, const std::uint8_t* frame, std::uint64_t size)
+	{
+		const std::uint64_t recsize = JournalAlign(sizeof(JournalRecord) + size);
+		if(recsize > _segment_size - JournalDataOffset())
+		{
+			LogError("[journal] Frame of size %llu does not fit a segment.", size);
+			return false;
+		}
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		if(!_current)
+		{
+			return false;
+		}
+
+		std::uint64_t used = _current->_used.load(std::memory_order_relaxed);
+		if(used + recsize > _segment_size)
+		{
+			if(!rotate(lock))
+			{
+				LogError("[journal] No segment available. Frame dropped.");
+				return false;
+			}
+			used = _current->_used.load(std::memory_order_relaxed);
+		}
+
+		// Timestamp under the lock so records are in time order
+		const std::uint64_t time = JournalNowNs() - _start;
+		std::uint8_t* record = reinterpret_cast<std::uint8_t*>(_current) + used;
+		const JournalRecord header = { time, static_cast<std::uint32_t>(size), eventid, 0 };
+		std::memcpy(record, &header, sizeof(JournalRecord));
+		std::memcpy(record + sizeof(JournalRecord), frame, size);
+
+		index(eventid, time, used);
+		_current->_used.store(used + recsize, std::memory_order_release);
+		_records++;
+		_bytes += size;
+		return true;
+	}
+
+	void JournalWriter::name(std::uint16_t eventid, const std::string& name)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		if(_names_file)
+		{
+			std::fprintf(_names_file, "%u %s\n", eventid, name.c_str());
+			std::fflush(_names_file);
+		}
+	}
+
+	void JournalWriter::close()
+	{
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_running = false;
+			_segment_notifier.notify_all();
+		}
+
+		if(_segment_thread)
+		{
+			_segment_thread->join();
+			_segment_thread.reset();
+		}
+
+		// The segment thread is gone, no need to lock from here
+		for(JournalSegment* segment : _retired)
+		{
+			unmapSegment(segment, false);
+		}
+		_retired.clear();
+
+		if(_current)
+		{
+			unmapSegment(_current, false);
+			_current = nullptr;
+		}
+
+		if(_next)
+		{
+			unmapSegment(_next, true);
+			_next = nullptr;
+		}
+
+		if(_index_file)
+		{
+			std::fclose(_index_file);
+			_index_file = nullptr;
+		}
+
+		if(_names_file)
+		{
+			std::fclose(_names_file);
+			_names_file = nullptr;
+		}
+	}
+
+	const std::string& JournalWriter::dir() const
+	{
+		return _dir;
+	}
+
+	std::uint64_t JournalWriter::records() const
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		return _records;
+	}
+
+	std::uint64_t JournalWriter::bytes() const
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		return _bytes;
+	}
+
+	JournalReader::~JournalReader()
+	{
+#ifdef __linux__
+		for(const Mapping& segment : _segments)
+		{
+			::munmap(const_cast<std::uint8_t*>(segment._data), segment._size);
+		}
+#endif
+	}
+
+	std::unique_ptr<JournalReader> JournalReader::Open(const std::string& dir)
+	{
+#ifdef __linux__
+		if(!std::filesystem::is_directory(dir))
+		{
+			LogError("[journal] Journal <%s> does not exist.", dir.c_str());
+			return nullptr;
+		}
+
+		std::unique_ptr<JournalReader> reader(new JournalReader());
+		for(std::uint32_t index = 0; ; index++)
+		{
+			const std::string path = JournalSegmentPath(dir, index);
+			int fd = ::open(path.c_str(), O_RDONLY);
+			if(fd < 0)
+			{
+				break;
+			}
+
+			struct stat st;
+			if(::fstat(fd, &st) < 0 || static_cast<std::uint64_t>(st.st_size) < JournalDataOffset())
+			{
+				LogWarning("[journal] Segment <%s> is too small. Ignoring.", path.c_str());
+				::close(fd);
+				break;
+			}
+
+			void* memory = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+			::close(fd);
+			if(memory == MAP_FAILED)
+			{
+				LogError("[journal] Failed to map segment <%s>.", path.c_str());
+				return nullptr;
+			}
+			::madvise(memory, st.st_size, MADV_SEQUENTIAL);
+
+			const JournalSegment* segment = static_cast<const JournalSegment*>(memory);
+			if(segment->_magic != JOURNAL_MAGIC || segment->_version != JOURNAL_VERSION || segment->_index != index)
+			{
+				LogError("[journal] Segment <%s> has an invalid layout.", path.c_str());
+				::munmap(memory, st.st_size);
+				return nullptr;
+			}
+
+			// A writer that did not close properly leaves the segment untruncated
+			const std::uint64_t used = std::min<std::uint64_t>(segment->_used.load(), st.st_size);
+			reader->_segments.push_back({ static_cast<const std::uint8_t*>(memory), static_cast<std::uint64_t>(st.st_size), used });
+			if(index == 0)
+			{
+				reader->_start = segment->_start;
+			}
+		}
+
+		if(reader->_segments.empty())
+		{
+			LogError("[journal] Journal <%s> has no segments.", dir.c_str());
+			return nullptr;
+		}
+
+		if(std::FILE* file = std::fopen((dir + "/index.mxj").c_str(), "rb"))
+		{
+			JournalIndexEntry entry;
+			while(std::fread(&entry, sizeof(JournalIndexEntry), 1, file) == 1)
+			{
+				reader->_index.push_back(entry);
+			}
+			std::fclose(file);
+		}
+
+		if(std::FILE* file = std::fopen((dir + "/names.txt").c_str(), "r"))
+		{
+			unsigned id;
+			char name[256];
+			while(std::fscanf(file, "%u %255[^\n]", &id, name) == 2)
+			{
+				reader->_names[static_cast<std::uint16_t>(id)] = name;
+			}
+			std::fclose(file);
+		}
+
+		reader->rewind();
+		LogTrace("[journal] Opened journal <%s> with %llu segments.", dir.c_str(), reader->_segments.size());
+		return reader;
+#else
+		static_cast<void>(dir);
+		return nullptr;
+#endif
+	}
+
+	bool JournalReader::peek(JournalFrame* frame)
+	{
+		while(_cursor_segment < _segments.size())
+		{
+			const Mapping& segment = _segments[_cursor_segment];
+			if(_cursor_offset + sizeof(JournalRecord) <= segment._used)
+			{
+				JournalRecord record;
+				std::memcpy(&record, segment._data + _cursor_offset, sizeof(JournalRecord));
+				if(_cursor_offset + sizeof(JournalRecord) + record._size > segment._used)
+				{
+					LogError("[journal] Truncated record on segment %u.", _cursor_segment);
+					return false;
+				}
+
+				frame->_time = record._time;
+				frame->_eventid = record._eventid;
+				frame->_data = segment._data + _cursor_offset + sizeof(JournalRecord);
+				frame->_size = record._size;
+				return true;
+			}
+
+			_cursor_segment++;
+			_cursor_offset = JournalDataOffset();
+		}
+		return false;
+	}
+
+	void JournalReader::advance()
+	{
+		JournalRecord record;
+		std::memcpy(&record, _segments[_cursor_segment]._data + _cursor_offset, sizeof(JournalRecord));
+		_cursor_offset += JournalAlign(sizeof(JournalRecord) + record._size);
+	}
+
+	bool JournalReader::next(JournalFrame* frame)
+	{
+		if(!peek(frame))
+		{
+			return false;
+		}
+		advance();
+		return true;
+	}
+
+	void JournalReader::rewind()
+	{
+		_cursor_segment = 0;
+		_cursor_offset = JournalDataOffset();
+	}
+
+	void JournalReader::seek(std::uint64_t time, std::uint16_t eventid)
+	{
+		// Start from the last index entry before time and scan from there
+		rewind();
+		for(auto it = _index.rbegin(); it != _index.rend(); it++)
+		{
+			if(it->_eventid == eventid && it->_time <= time && it->_segment < _segments.size())
+			{
+				_cursor_segment = it->_segment;
+				_cursor_offset = it->_offset;
+				break;
+			}
+		}
+
+		JournalFrame frame;
+		while(peek(&frame) && (frame._time < time || (eventid != 0 && frame._eventid != eventid)))
+		{
+			advance();
+		}
+	}
+
+	std::uint64_t JournalReader::start() const
+	{
+		return _start;
+	}
+
+	std::uint64_t JournalReader::duration() const
+	{
+		// Up to the last index entry, which is at most JOURNAL_INDEX_INTERVAL behind the last record
+		return _index.empty() ? 0 : _index.back()._time;
+	}
+
+	const std::map<std::uint16_t, std::string>& JournalReader::names() const
+	{
+		return _names;
+	}
+} // namespace mulex
@@ -0,0 +1,144 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mulex
+{
+	static constexpr std::uint64_t JOURNAL_SEGMENT_SIZE = 0x10000000; // 256MB
+	static constexpr std::uint32_t JOURNAL_MAGIC = 0x4A52584D; // 'MXRJ'
+	static constexpr std::uint32_t JOURNAL_VERSION = 1;
+	static constexpr std::uint64_t JOURNAL_INDEX_INTERVAL = 10000000; // 10ms in ns
+
+	// NOTE: (Cesar) Every record is 8 byte aligned and followed by the raw event frame
+	// 				 _time is in ns since the journal was created
+	struct JournalRecord
+	{
+		std::uint64_t _time;
+		std::uint32_t _size;
+		std::uint16_t _eventid;
+		std::uint16_t _reserved;
+	};
+
+	// NOTE: (Cesar) _eventid = 0 entries index every event
+	// 				 _count is the number of records of _eventid before this one
+	struct JournalIndexEntry
+	{
+		std::uint64_t _time;
+		std::uint64_t _offset;
+		std::uint32_t _segment;
+		std::uint16_t _eventid;
+		std::uint16_t _reserved;
+		std::uint64_t _count;
+	};
+
+	struct JournalFrame
+	{
+		std::uint64_t 		_time;
+		std::uint16_t 		_eventid;
+		const std::uint8_t* _data;
+		std::uint64_t 		_size;
+	};
+
+	struct JournalSegment;
+
+	// NOTE: (Cesar) Event journal on disk
+	// 				 A directory of fixed size memory mapped segments plus an index and a names file
+	// 				 Appending is a copy into the mapped segment, the next segment is created and
+	// 				 prefaulted ahead of time on a background thread so rotating never waits on disk
+	// 				 The used size is kept in the segment header so a crashed writer leaves a readable journal
+	// 				 (linux only)
+	class JournalWriter
+	{
+	public:
+		~JournalWriter();
+		JournalWriter(const JournalWriter&) = delete;
+		JournalWriter& operator=(const JournalWriter&) = delete;
+
+		static std::unique_ptr<JournalWriter> Create(const std::string& dir, std::uint64_t segsize = JOURNAL_SEGMENT_SIZE);
+		static bool Supported();
+
+		bool append(std::uint16_t eventid, const std::uint8_t* frame, std::uint64_t size);
+		void name(std::uint16_t eventid, const std::string& name);
+		void close();
+
+		const std::string& dir() const;
+		std::uint64_t records() const;
+		std::uint64_t bytes() const;
+
+	private:
+		JournalWriter() = default;
+		JournalSegment* mapSegment(std::uint32_t index);
+		void unmapSegment(JournalSegment* segment, bool remove);
+		void segmentThread();
+		bool rotate(std::unique_lock<std::mutex>& lock);
+		void index(std::uint16_t eventid, std::uint64_t time, std::uint64_t offset);
+
+	private:
+		std::string 				  _dir;
+		std::uint64_t 				  _segment_size = 0;
+		std::uint64_t 				  _start = 0;
+		JournalSegment* 			  _current = nullptr;
+		std::uint32_t 				  _current_index = 0;
+		std::uint64_t 				  _records = 0;
+		std::uint64_t 				  _bytes = 0;
+		mutable std::mutex 			  _mutex;
+		std::FILE* 					  _index_file = nullptr;
+		std::FILE* 					  _names_file = nullptr;
+		std::vector<std::uint64_t> 	  _index_time;
+		std::vector<std::uint64_t> 	  _index_count;
+
+		// Background segment management
+		std::unique_ptr<std::thread>  _segment_thread;
+		std::condition_variable 	  _segment_notifier;
+		JournalSegment* 			  _next = nullptr;
+		std::vector<JournalSegment*>  _retired;
+		bool 						  _next_failed = false;
+		bool 						  _running = false;
+	};
+
+	class JournalReader
+	{
+	public:
+		~JournalReader();
+		JournalReader(const JournalReader&) = delete;
+		JournalReader& operator=(const JournalReader&) = delete;
+
+		static std::unique_ptr<JournalReader> Open(const std::string& dir);
+
+		// Places the cursor on the first record at or after time
+		// that is (if eventid != 0) of the given event
+		void seek(std::uint64_t time, std::uint16_t eventid = 0);
+		bool next(JournalFrame* frame);
+		void rewind();
+
+		std::uint64_t start() const;
+		std::uint64_t duration() const;
+		const std::map<std::uint16_t, std::string>& names() const;
+
+	private:
+		struct Mapping
+		{
+			const std::uint8_t* _data;
+			std::uint64_t 		_size;
+			std::uint64_t 		_used;
+		};
+		JournalReader() = default;
+		bool peek(JournalFrame* frame);
+		void advance();
+
+	private:
+		std::vector<Mapping> 				 _segments;
+		std::vector<JournalIndexEntry> 		 _index;
+		std::map<std::uint16_t, std::string> _names;
+		std::uint64_t 						 _start = 0;
+		std::uint32_t 						 _cursor_segment = 0;
+		std::uint64_t 						 _cursor_offset = 0;
+	};
+} // namespace mulex
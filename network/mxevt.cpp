@@ -6,16 +6,21 @@
 #include <functional>
 #include <cstring>
 #include <algorithm>
+#include <deque>
 #include <iterator>
 #include <mutex>
 #include <set>
 #include <numeric>
+#include <tuple>
+#include <unordered_map>
 
 #include "../mxevt.h"
 #include "../rexs/mxrexs.h"
 
 #include "../mxlogger.h"
 #include "socket.h"
+#include "journal.h"
+#include "evtfilter.h"
 #include <rpcspec.inl>
 
 #ifdef _WIN32
@@ -35,10 +40,90 @@ static std::map<std::string, std::uint16_t> _evt_server_reg;
 static std::shared_mutex _evt_reg_lock;
 static std::atomic<std::uint16_t> _evt_server_reg_next = 0;
 
-// NOTE: (Cesar) Map for eventid -> subscribed clientid list
-static std::map<std::uint16_t, std::set<std::uint64_t>> _evt_current_subscriptions;
+// NOTE: (Cesar) Consumer group of an event
+// 				 Shared by the subscriptions of its members so it goes away with the last one
+// 				 _fragments keeps the member that got the first fragment of an event in flight
+struct EvtGroupState
+{
+	std::string 												  	  _name;
+	mulex::EvtConsumerGroup 									  	  _config;
+	std::atomic<std::uint64_t> 									  	  _next = 0;
+	std::map<std::pair<std::uint64_t, std::uint64_t>, std::uint64_t> _fragments; // (producer, msgid) -> member
+	std::mutex 													  	  _fragments_lock;
+};
+
+// NOTE: (Cesar) A client subscription as the relay path sees it
+// 				 _filter is compiled once on subscribe and is nullptr if the client takes every frame
+// 				 _group is nullptr if the client is not part of a consumer group
+// 				 _queue is nullptr until the client connection sent its metadata
+struct EvtSubscription
+{
+	mulex::EvtSubscriptionPolicy 				_policy;
+	std::shared_ptr<const mulex::EvtFilter> 	_filter;
+	std::shared_ptr<EvtGroupState> 				_group;
+	std::shared_ptr<mulex::EvtSubscriberQueue> _queue;
+};
+
+struct EvtGroupSubscribers
+{
+	std::shared_ptr<EvtGroupState> 						_state;
+	std::vector<std::pair<std::uint64_t, EvtSubscription>> _members;
+};
+
+// NOTE: (Cesar) Map for eventid -> subscribed clientid list (and their delivery policy / filter)
+// 				 Only touched by subscribe/unsubscribe/register under _evt_sub_lock
+static std::map<std::uint16_t, std::map<std::uint64_t, EvtSubscription>> _evt_current_subscriptions;
 static std::mutex _evt_sub_lock;
 
+// NOTE: (Cesar) Last value cache of an event
+// 				 Keeps the frames of the last _count whole events (a single frame unless fragmented)
+// 				 so subscribers that join late get the current state right away
+// 				 Frames are stored without trace stamps since they are delivered long after being emitted
+struct EvtRetention
+{
+	std::mutex 																			 _lock;
+	std::uint32_t 																		 _count = 0;
+	std::uint64_t 																		 _bytes = 0;
+	std::deque<std::vector<mulex::SysRefBuffer>> 										 _events;
+	std::map<std::pair<std::uint64_t, std::uint64_t>, std::vector<mulex::SysRefBuffer>> _partial; // (producer, msgid) -> fragments so far
+};
+static std::map<std::uint16_t, std::shared_ptr<EvtRetention>> _evt_retention; // Under _evt_sub_lock
+
+// NOTE: (Cesar) Send queue of every connected client
+// 				 Subscriptions keep a reference to it so the relay path never looks the client up
+static std::map<std::uint64_t, std::shared_ptr<mulex::EvtSubscriberQueue>> _evt_client_queues; // Under _evt_sub_lock
+
+// NOTE: (Cesar) Immutable copy of _evt_current_subscriptions indexed by event id for the relay path
+// 				 Writers replace the entry they changed and publish a new table (entries are shared)
+// 				 Readers keep a per thread reference and only reload it when the version changes
+// 				 so relaying takes no lock and touches no shared reference count
+struct EvtSubscriptionTable
+{
+	// Consumer groups are collapsed into a single entry each
+	struct Subscribers
+	{
+		std::vector<std::pair<std::uint64_t, EvtSubscription>> _clients;
+		std::vector<EvtGroupSubscribers> 					   _groups;
+		std::shared_ptr<EvtRetention> 						   _retention; // nullptr if the event is not retained
+
+		bool empty() const
+		{
+			return _clients.empty() && _groups.empty();
+		}
+
+		bool contains(std::uint64_t cid) const
+		{
+			auto match = [cid](const auto& sub) { return sub.first == cid; };
+			return std::any_of(_clients.begin(), _clients.end(), match) || std::any_of(_groups.begin(), _groups.end(), [&match](const auto& group) {
+				return std::any_of(group._members.begin(), group._members.end(), match);
+			});
+		}
+	};
+	std::vector<std::shared_ptr<const Subscribers>> _events;
+};
+static std::atomic<std::shared_ptr<const EvtSubscriptionTable>> _evt_sub_table = std::make_shared<const EvtSubscriptionTable>();
+static std::atomic<std::uint64_t> _evt_sub_version = 0;
+
 static std::map<std::uint16_t, std::function<void(const mulex::Socket&, std::uint64_t, std::uint16_t, const std::uint8_t*, std::uint64_t)>> _evt_server_callbacks;
 static std::mutex _evt_server_callback_lock;
 
@@ -47,795 +132,3565 @@ static std::map<int, std::uint64_t> _evt_client_socket_pair;
 #else
 static std::map<SOCKET, std::uint64_t> _evt_client_socket_pair;
 #endif
-static std::map<std::uint64_t, mulex::Socket> _evt_client_socket_pair_rev;
 static std::set<std::uint64_t> _evt_client_ghost;
 
-// TODO: (Cesar) Update this map value type as required
-static std::map<std::uint64_t, std::atomic<std::uint64_t>> _evt_client_stats;
-static std::mutex _evt_client_stats_lock;
-
-static mulex::EvtStatistics _evt_event_stats;
-static mulex::EvtStatistics _evt_event_stats_buffer;
-static std::mutex _evt_event_stats_lock;
-static std::mutex _evt_event_stats_buffer_lock;
-
-namespace mulex
+static std::atomic<std::uint64_t> _evt_batch_max_frames = mulex::EVT_EMIT_BATCH_SIZE;
+static std::atomic<std::uint64_t> _evt_batch_max_bytes = mulex::EVT_EMIT_BATCH_BYTES;
+static std::atomic<std::int64_t>  _evt_batch_max_delay_us = 0;
+static std::atomic<std::uint64_t> _evt_emit_frames = 0;
+static std::atomic<std::uint64_t> _evt_emit_syscalls = 0;
+static std::atomic<bool> _evt_shm_enabled = true;
+static std::atomic<bool> _evt_trace_enabled = false;
+
+// NOTE: (Cesar) Latency histograms merged from the subscriber trace reports
+// 				 Kept per (producer, consumer, event) and per event since the server started
+static std::map<std::tuple<std::uint64_t, std::uint64_t, std::uint16_t>, mulex::EvtTraceHistograms> _evt_trace_pairs;
+static std::map<std::uint16_t, mulex::EvtTraceHistograms> _evt_trace_events;
+static bool _evt_trace_dirty = false;
+static std::mutex _evt_trace_lock;
+
+// NOTE: (Cesar) Event statistics
+// 				 Every thread on the data path owns a shard of counters indexed by (event id, client slot)
+// 				 Counters only go up and have a single writer so they are bumped without any atomic RMW
+// 				 The stats thread sums the shards once per second and publishes the rates as a snapshot
+struct EvtStatsCounter
 {
-	std::uint64_t GetNextEventMessageId()
+	std::atomic<std::uint64_t> _msgs_in;
+	std::atomic<std::uint64_t> _bytes_in;
+	std::atomic<std::uint64_t> _msgs_out;
+	std::atomic<std::uint64_t> _bytes_out;
+};
+
+// Counters of one event in blocks of client slots
+struct EvtStatsEventCounters
+{
+	std::array<std::atomic<EvtStatsCounter*>, mulex::EVT_STATS_MAX_BLOCKS> _blocks;
+
+	~EvtStatsEventCounters()
 	{
-		return _client_msg_id++;
+		for(auto& block : _blocks) delete[] block.load();
 	}
+};
 
-	EvtClientThread::EvtClientThread(const std::string& hostname, const Experiment* exp, std::uint16_t evtport, bool ghost, std::uint64_t customid)
-	{
-		_exp = exp;
-		if(_exp)
-		{
-			LogTrace("[evtclient] Passed in custom experiment dependency.");
-		}
+struct EvtStatsShard
+{
+	// Two levels (high/low byte of the event id) so counters only exist for the events the thread touches
+	std::array<std::atomic<std::atomic<EvtStatsEventCounters*>*>, 256> _pages;
 
-		if(customid > 0)
+	~EvtStatsShard()
+	{
+		for(auto& page : _pages)
 		{
-			_evt_has_custom_id = true;
-			_evt_custom_id = customid;
-
-			LogDebug("[evtclient] Client spawned with custom id.");
-			
-			if(!ghost)
-			{
-				LogError("[evtclient] Specified custom client id without being ghost.");
-				LogError("[evtclient] This is not possible.");
-				return;
-			}
+			std::atomic<EvtStatsEventCounters*>* events = page.load();
+			if(!events) continue;
+			for(std::uint64_t i = 0; i < 256; i++) delete events[i].load();
+			delete[] events;
 		}
+	}
+};
 
-		_evt_socket = SocketInit();
-		SocketConnect(_evt_socket, hostname, evtport);
-		_evt_thread_running.store(true);
-		_evt_listen_thread = std::make_unique<std::thread>(
-			std::bind(&EvtClientThread::clientListenThread, this, _evt_socket)
-		);
-		_evt_emit_thread = std::make_unique<std::thread>(
-			std::bind(&EvtClientThread::clientEmitThread, this, _evt_socket)
-		);
+// Shards outlive their threads and are handed to the next one so the counters never go back
+static std::vector<std::unique_ptr<EvtStatsShard>> _evt_stats_shards;
+static std::vector<EvtStatsShard*> _evt_stats_free_shards;
+static std::mutex _evt_stats_shards_lock;
 
-		if(ghost)
-		{
-			emit("mxevt::getclientmeta", nullptr, 0);
-		}
-		else
-		{
-			// Tell the server who we are
-			std::string_view bname = SysGetBinaryName();
-			std::string_view hname = SysGetHostname();
-			std::string client_name_meta = std::string(bname) + "@" + std::string(hname);
+// Client id per slot (0 if free), slots of disconnected clients are freed by the stats thread
+// Blocks are added under _evt_stats_clients_lock when every slot is taken and live until exit
+struct EvtStatsSlots
+{
+	std::array<std::atomic<std::atomic<std::uint64_t>*>, mulex::EVT_STATS_MAX_BLOCKS> _blocks;
+	std::atomic<std::uint64_t> _size;
 
-			emit("mxevt::getclientmeta", reinterpret_cast<const std::uint8_t*>(client_name_meta.c_str()), client_name_meta.size() + 1);
-		}
+	~EvtStatsSlots()
+	{
+		for(auto& block : _blocks) delete[] block.load();
 	}
 
-	EvtClientThread::~EvtClientThread()
+	// Valid for slot < size()
+	std::atomic<std::uint64_t>& operator[](std::uint64_t slot)
 	{
-		_evt_thread_running.store(false);
-		_evt_stream->requestUnblock();
-		_evt_emit_stack.requestUnblock();
-		SocketClose(_evt_socket);
-		_evt_listen_thread->join();
-		_evt_emit_thread->join();
+		return _blocks[slot / mulex::EVT_STATS_SLOT_BLOCK].load(std::memory_order_acquire)[slot % mulex::EVT_STATS_SLOT_BLOCK];
 	}
 
-	void EvtClientThread::clientListenThread(const Socket& socket)
+	std::uint64_t size() const
 	{
-		std::unique_ptr<SysRecvThread> recvthread = SysStartRecvThread(socket, sizeof(EvtHeader), offsetof(EvtHeader, payloadsize));
-		SysByteStream& sbs = recvthread->_stream;
-		_evt_stream = &recvthread->_stream;
-		static constexpr std::uint64_t buffersize = SYS_RECV_THREAD_BUFFER_SIZE;
-		std::vector<std::uint8_t> fbuffer(buffersize);
+		return _size.load(std::memory_order_acquire);
+	}
 
-		while(_evt_thread_running.load())
+	bool grow()
+	{
+		const std::uint64_t block = size() / mulex::EVT_STATS_SLOT_BLOCK;
+		if(block >= _blocks.size())
 		{
-			// Read next event
-			std::uint64_t read = sbs.fetch(fbuffer.data(), buffersize);
-
-			// if(read <= 0 && !_evt_thread_running.load())
-			if(read <= 0)
-			{
-				break;
-			}
-			
-			// TODO: (Cesar): Place the new event on the event stack
-			//  			  For now we just run the event callback from this thread
-			//				  and see how it goes
-			EvtHeader header;
-			std::memcpy(&header, fbuffer.data(), sizeof(EvtHeader));
-			LogTrace("[evtclient] Got Event <%d> from <0x%llx>.", header.eventid, header.client);
-			
-			// TODO: (Cesar): Add some userdata instead of passing nullptr
-			// 				  _evt_userdata;
-			auto callback = _evt_callbacks.find(header.eventid);
-			if(callback != _evt_callbacks.end())
-			{
-				callback->second(fbuffer.data() + sizeof(EvtHeader), header.payloadsize, nullptr);
-			}
+			return false;
 		}
-		
-		recvthread->_handle.join();
+		_blocks[block].store(new std::atomic<std::uint64_t>[mulex::EVT_STATS_SLOT_BLOCK](), std::memory_order_release);
+		_size.store((block + 1) * mulex::EVT_STATS_SLOT_BLOCK, std::memory_order_release);
+		return true;
 	}
+};
+static EvtStatsSlots _evt_stats_slots;
 
-	void EvtClientThread::clientEmitThread(const Socket& socket)
-	{
-		while(_evt_thread_running.load())
-		{
-			// Read next event to emit from stack
-			std::vector<std::uint8_t> data = _evt_emit_stack.pop();
+struct EvtStatsClient
+{
+	bool 			  _publish = false;
+	bool 			  _retired = false;
+	mulex::RdbKeyName _read_key;
+	mulex::RdbKeyName _write_key;
+};
+static std::vector<EvtStatsClient> _evt_stats_clients; // Grows with _evt_stats_slots
+static std::mutex _evt_stats_clients_lock;
+
+// NOTE: (Cesar) Event recorder
+// 				 Frames are appended to the journal as they arrive on the server (before being relayed)
+// 				 _events is indexed by event id and is only written with the unique lock held
+struct EvtRecorder
+{
+	std::unique_ptr<mulex::JournalWriter> _journal;
+	std::set<std::string> 				  _names; // Empty records every event
+	std::vector<bool> 					  _events;
+};
+static std::unique_ptr<EvtRecorder> _evt_recorder;
+static std::shared_mutex _evt_recorder_lock;
+static std::atomic<bool> _evt_recording = false;
 
-			if(data.size() == 0 && !_evt_thread_running.load())
-			{
-				break;
-			}
-			
-			// TODO: (Cesar): Place the new event on the event stack
-			//  			  For now we just run the event callback from this thread
-			//				  and see how it goes
-			EvtHeader header;
-			std::memcpy(&header, data.data(), sizeof(EvtHeader));
-			LogTrace("[evtclient] Emitting Event <%d> from <0x%llx> [size=%llu].", header.eventid, header.client, data.size());
-			
-			SocketSendBytes(socket, data.data(), data.size());
-		}
+// Rate limited subscriptions currently holding a frame (see EvtSubscriberQueue::flushWindows)
+static std::atomic<std::uint64_t> _evt_held_windows = 0;
+
+static std::atomic<std::shared_ptr<const mulex::EvtStatistics>> _evt_stats_snapshot = std::make_shared<const mulex::EvtStatistics>();
+
+namespace mulex
+{
+	std::uint64_t GetNextEventMessageId()
+	{
+		return _client_msg_id++;
 	}
 
-	std::uint16_t EvtClientThread::findEvent(const std::string& event)
+	// Must be called with _evt_sub_lock held after the subscribers of eventid changed
+	static void EvtPublishSubscribers(std::uint16_t eventid)
 	{
-		auto evt = _evt_registry.find(event);
-		if(evt == _evt_registry.end())
+		std::shared_ptr<EvtSubscriptionTable> table = std::make_shared<EvtSubscriptionTable>(*_evt_sub_table.load());
+		if(table->_events.size() <= eventid)
 		{
-			LogDebug("[evtclient] Could not find event <%s> in local registry.", event.c_str());
-			LogDebug("[evtclient] Looking in server for <%s>.", event.c_str());
-			std::uint16_t eid = 0;
+			table->_events.resize(eventid + 1);
+		}
 
-			if(_exp)
-			{
-				eid = _exp->_rpc_client->call<std::uint16_t>(RPC_CALL_MULEX_EVTGETID, string32(event));
-			}
-			else
+		auto subit = _evt_current_subscriptions.find(eventid);
+		if(subit != _evt_current_subscriptions.end())
+		{
+			std::shared_ptr<EvtSubscriptionTable::Subscribers> subscribers = std::make_shared<EvtSubscriptionTable::Subscribers>();
+			for(const auto& sub : subit->second)
 			{
-				std::optional<const Experiment*> experiment = SysGetConnectedExperiment();
-				if(!experiment.has_value())
+				if(!sub.second._group)
 				{
-					LogError("[evtclient] Failed to emit event. Not connected to an experiment.");
-					return 0;
+					subscribers->_clients.push_back(sub);
+					continue;
 				}
 
-				eid = experiment.value()->_rpc_client->call<std::uint16_t>(RPC_CALL_MULEX_EVTGETID, string32(event));
+				auto group = std::find_if(subscribers->_groups.begin(), subscribers->_groups.end(), [&sub](const auto& g) { return g._state == sub.second._group; });
+				if(group == subscribers->_groups.end())
+				{
+					group = subscribers->_groups.insert(subscribers->_groups.end(), { sub.second._group, {} });
+				}
+				group->_members.push_back(sub);
 			}
-			if(eid != 0)
+
+			auto retit = _evt_retention.find(eventid);
+			if(retit != _evt_retention.end())
 			{
-				// Cache it
-				_evt_registry.emplace(event, eid);
+				subscribers->_retention = retit->second;
 			}
-			return eid;
+			table->_events[eventid] = std::move(subscribers);
+		}
+		else
+		{
+			table->_events[eventid].reset();
 		}
-		return evt->second;
+
+		// The table goes out before the version so readers never cache a stale table as current
+		_evt_sub_table.store(std::move(table));
+		_evt_sub_version.fetch_add(1, std::memory_order_release);
 	}
 
-	void EvtClientThread::emit(const std::string& event, const std::uint8_t* data, std::uint64_t len)
+	// Returns nullptr if eventid is not registered
+	// The pointer stays valid until the next call from the same thread
+	static const EvtSubscriptionTable::Subscribers* EvtGetSubscribers(std::uint16_t eventid)
 	{
-		std::uint16_t eid = findEvent(event);
-		if(eid == 0)
+		thread_local std::shared_ptr<const EvtSubscriptionTable> table;
+		thread_local std::uint64_t version = ~0ULL;
+
+		const std::uint64_t current = _evt_sub_version.load(std::memory_order_acquire);
+		if(current != version)
 		{
-			LogError("[evtclient] Failed to find event in server. Emit aborted.");
-			return;
+			table = _evt_sub_table.load();
+			version = current;
 		}
 
-		// Make header
-		EvtHeader header;
-		if(_evt_has_custom_id)
+		if(eventid >= table->_events.size())
 		{
-			header.client = _evt_custom_id;
+			return nullptr;
 		}
-		else
+		return table->_events[eventid].get();
+	}
+
+	static void EvtRecordFrame(std::uint16_t eventid, const std::uint8_t* frame, std::uint64_t size)
+	{
+		if(!_evt_recording.load(std::memory_order_relaxed))
 		{
-			header.client = SysGetClientId();
+			return;
 		}
-		header.eventid = eid;
-		header.msgid = GetNextEventMessageId();
-		header.payloadsize = static_cast<std::uint32_t>(len);
-
-		LogTrace("payloadsize on client: %d", header.payloadsize);
 
-		std::vector<std::uint8_t> vdata;
-		vdata.resize(sizeof(EvtHeader) + len);
-
-		std::memcpy(vdata.data(), &header, sizeof(EvtHeader));
-		if(len > 0)
+		std::shared_lock lock(_evt_recorder_lock);
+		if(_evt_recorder && _evt_recorder->_events[eventid])
 		{
-			std::memcpy(vdata.data() + sizeof(EvtHeader), data, len);
+			_evt_recorder->_journal->append(eventid, frame, size);
 		}
+	}
 
-		// _evt_emit_stack.push(std::move(vdata));
-		_evt_emit_stack.push(vdata);
+	void EvtSetEmitBatchConfig(const EvtEmitBatchConfig& config)
+	{
+		_evt_batch_max_frames.store(std::max<std::uint64_t>(config._max_frames, 1));
+		_evt_batch_max_bytes.store(config._max_bytes);
+		_evt_batch_max_delay_us.store(config._max_delay_us);
 	}
 
-	void EvtClientThread::regist(const std::string& event)
+	EvtEmitBatchConfig EvtGetEmitBatchConfig()
 	{
-		// Ask server to register event via RPC
-		const Experiment* exp;
-		if(_exp)
+		EvtEmitBatchConfig config;
+		config._max_frames = _evt_batch_max_frames.load();
+		config._max_bytes = _evt_batch_max_bytes.load();
+		config._max_delay_us = _evt_batch_max_delay_us.load();
+		return config;
+	}
+
+	void EvtSetSharedMemoryEnabled(bool enabled)
+	{
+		_evt_shm_enabled.store(enabled);
+	}
+
+	void EvtSetTracingEnabled(bool enabled)
+	{
+		_evt_trace_enabled.store(enabled);
+	}
+
+	bool EvtGetTracingEnabled()
+	{
+		return _evt_trace_enabled.load();
+	}
+
+	static bool EvtHostIsLocal(const std::string& hostname)
+	{
+		return hostname == "localhost" || hostname == "127.0.0.1" || hostname == SysGetHostname();
+	}
+
+	EvtEmitCounters EvtGetEmitCounters()
+	{
+		EvtEmitCounters counters;
+		counters._frames = _evt_emit_frames.load();
+		counters._syscalls = _evt_emit_syscalls.load();
+		return counters;
+	}
+
+	// Blocks for the first frame and then fills the batch up to the configured budget
+	template<typename Q, typename T>
+	static std::uint64_t EvtDrainEmitQueue(Q& queue, std::vector<T>& batch)
+	{
+		const EvtEmitBatchConfig config = EvtGetEmitBatchConfig();
+		batch.clear();
+		if(queue.popBatch(batch, config._max_frames) == 0)
 		{
-			exp = _exp;
+			return 0;
 		}
-		else
+
+		if(config._max_delay_us <= 0)
 		{
-			std::optional<const Experiment*> experiment = SysGetConnectedExperiment();
-			if(!experiment.has_value())
-			{
-				LogError("[evtclient] Failed to register event. Not connected to an experiment.");
-				return;
-			}
-			exp = experiment.value();
+			return batch.size();
 		}
-		
-		bool reg = exp->_rpc_client->call<bool>(RPC_CALL_MULEX_EVTREGISTER, string32(event));
-		if(!reg)
+
+		std::uint64_t bytes = 0;
+		for(const auto& frame : batch) bytes += frame.size();
+
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(config._max_delay_us);
+		T frame;
+		while(batch.size() < config._max_frames && bytes < config._max_bytes)
 		{
-			LogError("[evtclient] Failed to register event. EvtRegister() returned false.");
+			if(queue.tryPop(frame))
+			{
+				bytes += frame.size();
+				batch.push_back(std::move(frame));
+				continue;
+			}
+
+			if(std::chrono::steady_clock::now() >= deadline)
+			{
+				break;
+			}
+			std::this_thread::yield();
 		}
+		return batch.size();
+	}
 
-		std::uint16_t eventid = exp->_rpc_client->call<std::uint16_t>(RPC_CALL_MULEX_EVTGETID, string32(event));
-		if(eventid == 0)
+	template<typename T>
+	static SocketResult EvtSendBatch(const Socket& socket, const std::vector<T>& batch, std::vector<SocketBuffer>& iov)
+	{
+		iov.clear();
+		for(const auto& frame : batch)
 		{
-			LogError("[evtclient] Failed to register event.");
-			return;
+			iov.push_back({ frame.data(), frame.size() });
 		}
 
-		_evt_registry.emplace(event, eventid);
-		LogTrace("[evtclient] Registered event <%s> with id <%d>.", event.c_str(), eventid);
+		std::uint64_t nsyscalls = 0;
+		SocketResult result = SocketSendVec(socket, iov.data(), iov.size(), &nsyscalls);
+		_evt_emit_frames += batch.size();
+		_evt_emit_syscalls += nsyscalls;
+		return result;
 	}
 
-	void EvtClientThread::subscribe(const std::string& event, EvtCallbackFunc callback)
+	// Calls func(header, data, len) for every frame the event goes out as
+	template<typename F>
+	static void EvtForEachFrame(EvtHeader header, const std::uint8_t* data, std::uint64_t len, F func)
 	{
-		// Ask server for the event id via RPC
-		const Experiment* exp;
-		if(_exp)
+		if(len <= EVT_FRAGMENT_SIZE)
 		{
-			exp = _exp;
+			header.payloadsize = static_cast<std::uint32_t>(len);
+			func(header, data, len);
+			return;
 		}
-		else
+
+		header.flags |= EVT_FLAG_FRAGMENT;
+		header.totalsize = static_cast<std::uint32_t>(len);
+		for(std::uint64_t offset = 0; offset < len; offset += EVT_FRAGMENT_SIZE)
 		{
-			std::optional<const Experiment*> experiment = SysGetConnectedExperiment();
-			if(!experiment.has_value())
+			const std::uint64_t chunk = std::min(EVT_FRAGMENT_SIZE, len - offset);
+			header.fragoffset = static_cast<std::uint32_t>(offset);
+			header.payloadsize = static_cast<std::uint32_t>(chunk);
+			if(offset + chunk == len)
 			{
-				LogError("[evtclient] Failed to subscribe to event. Not connected to an experiment.");
-				return;
+				header.flags |= EVT_FLAG_LAST_FRAGMENT;
 			}
-			exp = experiment.value();
-		}
-		
-		std::uint16_t eventid = exp->_rpc_client->call<std::uint16_t>(RPC_CALL_MULEX_EVTGETID, string32(event));
-		if(eventid == 0)
-		{
-			LogError("[evtclient] Failed to subscribe to event. Event <%s> is not registered.");
-			return;
+			func(header, data + offset, chunk);
 		}
+	}
+
+	static bool EvtFrameIsFragment(const std::uint8_t* frame)
+	{
+		return (frame[offsetof(EvtHeader, flags)] & EVT_FLAG_FRAGMENT) != 0;
+	}
+
+	static bool EvtTraceFits(std::uint64_t len)
+	{
+		return _evt_trace_enabled.load(std::memory_order_relaxed) && len + sizeof(EvtTraceStamps) <= EVT_FRAGMENT_SIZE;
+	}
+
+	static bool EvtFrameIsTraced(const std::uint8_t* frame, std::uint64_t size)
+	{
+		return (frame[offsetof(EvtHeader, flags)] & EVT_FLAG_TRACE) != 0 && size >= sizeof(EvtHeader) + sizeof(EvtTraceStamps);
+	}
 
-		if(!exp->_rpc_client->call<bool>(RPC_CALL_MULEX_EVTSUBSCRIBE, string32(event)))
+	// NOTE: (Cesar) Only the first fragment of an event is matched against the filter
+	// 				 The subscriber queue drops the remaining fragments if it was rejected
+	static bool EvtFilterAccepts(const EvtSubscription& sub, const EvtHeader& header, const std::uint8_t* payload, std::uint64_t len)
+	{
+		if(!sub._filter || ((header.flags & EVT_FLAG_FRAGMENT) && header.fragoffset > 0))
 		{
-			LogError("[evtclient] Failed to subscribe to event.");
-			return;
+			return true;
 		}
+		return sub._filter->match(payload, len);
+	}
 
-		auto eid_callbacks = _evt_callbacks.find(eventid);
-		if(eid_callbacks != _evt_callbacks.end())
+	static std::uint64_t EvtGroupKeyHash(const EvtConsumerGroup& config, const std::uint8_t* payload, std::uint64_t len)
+	{
+		// FNV-1a (keys past the end of the payload are cut short)
+		std::uint64_t hash = 0xcbf29ce484222325ULL;
+		const std::uint64_t end = std::min<std::uint64_t>(static_cast<std::uint64_t>(config._key_offset) + config._key_size, len);
+		for(std::uint64_t i = config._key_offset; i < end; i++)
 		{
-			LogTrace("[evtclient] Subscribing to already subscribed event. Only one callback per event is allowed. Replacing...");
+			hash = (hash ^ payload[i]) * 0x100000001b3ULL;
 		}
-		_evt_callbacks[eventid] = callback;
-		_evt_subscriptions.insert(event);
+		return hash;
+	}
 
-		LogTrace("[evtclient] Subscribed to event <%s> [%d].", event.c_str(), eventid);
+	static std::uint64_t EvtGroupMix(std::uint64_t x)
+	{
+		x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+		x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+		return x ^ (x >> 31);
 	}
 
-	void EvtClientThread::unsubscribe(const std::string& event)
+	// NOTE: (Cesar) Picks the member of a consumer group that gets the frame (nullptr if none)
+	// 				 The remaining fragments of an event go to the member that got the first one
+	// 				 depth(sub) returns the number of frames queued for a member
+	template<typename F>
+	static const std::pair<std::uint64_t, EvtSubscription>* EvtPickGroupMember(const EvtGroupSubscribers& group, const EvtHeader& header, const std::uint8_t* payload, std::uint64_t len, F depth)
 	{
-		// Ask server for the event id via RPC
-		const Experiment* exp;
-		if(_exp)
+		const auto& members = group._members;
+		EvtGroupState& state = *group._state;
+		const bool fragment = (header.flags & EVT_FLAG_FRAGMENT);
+		if(members.empty())
 		{
-			exp = _exp;
+			return nullptr;
 		}
-		else
+
+		if(fragment && header.fragoffset > 0)
 		{
-			std::optional<const Experiment*> experiment = SysGetConnectedExperiment();
-			if(!experiment.has_value())
+			std::uint64_t cid;
 			{
-				LogError("[evtclient] Failed to unsubscribe to event. Not connected to an experiment.");
-				return;
+				std::unique_lock<std::mutex> lock(state._fragments_lock);
+				auto it = state._fragments.find({ header.client, header.msgid });
+				if(it == state._fragments.end())
+				{
+					return nullptr;
+				}
+				cid = it->second;
+				if(header.flags & EVT_FLAG_LAST_FRAGMENT)
+				{
+					state._fragments.erase(it);
+				}
 			}
-			exp = experiment.value();
+
+			// The member might have left midway
+			auto member = std::find_if(members.begin(), members.end(), [cid](const auto& m) { return m.first == cid; });
+			return member != members.end() ? &(*member) : nullptr;
 		}
-		
-		std::uint16_t eventid = exp->_rpc_client->call<std::uint16_t>(RPC_CALL_MULEX_EVTGETID, string32(event));
-		if(eventid == 0)
+
+		std::uint64_t index = 0;
+		switch(state._config._balance)
+		{
+			case EvtGroupBalance::ROUND_ROBIN:
+			{
+				index = state._next.fetch_add(1, std::memory_order_relaxed) % members.size();
+				break;
+			}
+			case EvtGroupBalance::LEAST_DEPTH:
+			{
+				// Ties are broken round robin so idle members share the load
+				const std::uint64_t start = state._next.fetch_add(1, std::memory_order_relaxed);
+				std::uint64_t best = ~0ULL;
+				for(std::uint64_t i = 0; i < members.size(); i++)
+				{
+					const std::uint64_t candidate = (start + i) % members.size();
+					const std::uint64_t d = depth(members[candidate].second);
+					if(d < best)
+					{
+						best = d;
+						index = candidate;
+					}
+				}
+				break;
+			}
+			case EvtGroupBalance::KEY_HASH:
+			{
+				// Rendezvous hashing, the member with the highest weight for the key wins
+				const std::uint64_t key = EvtGroupKeyHash(state._config, payload, len);
+				std::uint64_t best = 0;
+				for(std::uint64_t i = 0; i < members.size(); i++)
+				{
+					const std::uint64_t weight = EvtGroupMix(key ^ EvtGroupMix(members[i].first));
+					if(i == 0 || weight > best)
+					{
+						best = weight;
+						index = i;
+					}
+				}
+				break;
+			}
+		}
+
+		if(fragment)
+		{
+			std::unique_lock<std::mutex> lock(state._fragments_lock);
+
+			// Producers that died midway leave their entry behind
+			if(state._fragments.size() >= EVT_GROUP_MAX_FRAGMENTED)
+			{
+				state._fragments.clear();
+			}
+			state._fragments[{ header.client, header.msgid }] = members[index].first;
+		}
+		return &members[index];
+	}
+
+	// Must be called with the retention lock held
+	static void EvtTrimRetention(EvtRetention& retention)
+	{
+		while(!retention._events.empty() && (retention._events.size() > retention._count || retention._bytes > EVT_RETAIN_MAX_BYTES))
+		{
+			for(const SysRefBuffer& frame : retention._events.front())
+			{
+				retention._bytes -= frame.size();
+			}
+			retention._events.pop_front();
+		}
+	}
+
+	static void EvtRetainFrame(EvtRetention& retention, const EvtHeader& header, const SysRefBuffer& frame)
+	{
+		std::unique_lock<std::mutex> lock(retention._lock);
+		std::vector<SysRefBuffer> event;
+		if(header.flags & EVT_FLAG_FRAGMENT)
+		{
+			const std::pair<std::uint64_t, std::uint64_t> key = { header.client, header.msgid };
+			if(header.fragoffset == 0)
+			{
+				// Producers that died midway leave their fragments behind
+				if(retention._partial.size() >= EVT_GROUP_MAX_FRAGMENTED)
+				{
+					retention._partial.clear();
+				}
+				retention._partial[key].clear();
+			}
+
+			auto partial = retention._partial.find(key);
+			if(partial == retention._partial.end())
+			{
+				// Started before the event was retained
+				return;
+			}
+
+			partial->second.push_back(frame);
+			if(!(header.flags & EVT_FLAG_LAST_FRAGMENT))
+			{
+				return;
+			}
+			event = std::move(partial->second);
+			retention._partial.erase(partial);
+		}
+		else
+		{
+			event.push_back(frame);
+		}
+
+		for(const SysRefBuffer& f : event)
+		{
+			retention._bytes += f.size();
+		}
+		retention._events.push_back(std::move(event));
+		EvtTrimRetention(retention);
+	}
+
+	// Copy of a traced frame without the trace stamps
+	static SysRefBuffer EvtUntracedCopy(const std::uint8_t* frame, std::uint64_t size)
+	{
+		SysRefBuffer copy = SysRefBuffer::Copy(frame, size - sizeof(EvtTraceStamps));
+		EvtHeader header;
+		std::memcpy(&header, copy.data(), sizeof(EvtHeader));
+		header.flags &= ~EVT_FLAG_TRACE;
+		header.payloadsize -= sizeof(EvtTraceStamps);
+		std::memcpy(copy.mutableData(), &header, sizeof(EvtHeader));
+		return copy;
+	}
+
+	// Sends the retained events to a new subscriber
+	// Must be called with _evt_sub_lock held before the subscriber is published so nothing newer goes out first
+	static void EvtRelayRetained(const std::shared_ptr<EvtSubscriberQueue>& queue, EvtRetention& retention, const EvtSubscriptionPolicy& policy, const EvtFilter* filter)
+	{
+		if(!queue)
+		{
+			return;
+		}
+
+		std::vector<std::vector<SysRefBuffer>> events;
+		{
+			std::unique_lock<std::mutex> lock(retention._lock);
+			events.assign(retention._events.begin(), retention._events.end());
+		}
+
+		// Never block the subscribe call on a full reliable queue
+		EvtSubscriptionPolicy replay = policy;
+		if(replay._policy == EvtDeliveryPolicy::RELIABLE)
+		{
+			replay._policy = EvtDeliveryPolicy::DROP_OLDEST;
+		}
+
+		for(const std::vector<SysRefBuffer>& event : events)
+		{
+			EvtHeader header;
+			std::memcpy(&header, event.front().data(), sizeof(EvtHeader));
+			if(filter && !filter->match(event.front().data() + sizeof(EvtHeader), header.payloadsize))
+			{
+				continue;
+			}
+
+			for(const SysRefBuffer& frame : event)
+			{
+				EvtRelay(queue, frame, replay);
+			}
+		}
+	}
+
+	// Writes one of the EvtTraceStamps fields in the trailer of a traced frame
+	static void EvtStampTrace(std::uint8_t* frame, std::uint64_t size, std::uint64_t field, std::uint64_t ns)
+	{
+		std::memcpy(frame + size - sizeof(EvtTraceStamps) + field, &ns, sizeof(std::uint64_t));
+	}
+
+	// Traced frames are private to the subscriber queue so the send time is written in place
+	static void EvtStampSend(SysRefBuffer& frame)
+	{
+		if(EvtFrameIsTraced(frame.data(), frame.size()))
+		{
+			EvtStampTrace(frame.mutableData(), frame.size(), offsetof(EvtTraceStamps, _server_send), SysGetMonotonicNs());
+		}
+	}
+
+	bool EvtReassembler::feed(const EvtHeader& header, const std::uint8_t* payload, CompleteFunc func)
+	{
+		const auto key = std::make_pair(header.client, header.eventid);
+		std::vector<std::uint8_t> data;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			auto it = _partial.find(key);
+
+			if(header.fragoffset == 0)
+			{
+				if(it != _partial.end())
+				{
+					// The previous event never completed
+					_discarded++;
+					_partial.erase(it);
+				}
+
+				Partial partial;
+				partial._msgid = header.msgid;
+				partial._received = 0;
+				partial._data.resize(header.totalsize);
+				it = _partial.emplace(key, std::move(partial)).first;
+			}
+			else if(it == _partial.end() || it->second._msgid != header.msgid || it->second._received != header.fragoffset)
+			{
+				// Missing fragments
+				if(it != _partial.end())
+				{
+					_discarded++;
+					_partial.erase(it);
+				}
+				return false;
+			}
+
+			Partial& partial = it->second;
+			if(partial._received + header.payloadsize > partial._data.size())
+			{
+				LogError("[evtreassembler] Fragment of event <%d> overflows the event size.", header.eventid);
+				_discarded++;
+				_partial.erase(it);
+				return false;
+			}
+
+			std::memcpy(partial._data.data() + partial._received, payload, header.payloadsize);
+			partial._received += header.payloadsize;
+
+			if(!(header.flags & EVT_FLAG_LAST_FRAGMENT))
+			{
+				return true;
+			}
+
+			if(partial._received != partial._data.size())
+			{
+				_discarded++;
+				_partial.erase(it);
+				return false;
+			}
+
+			data = std::move(partial._data);
+			_partial.erase(it);
+		}
+
+		// Run the callback outside of the lock
+		func(header, data.data(), data.size());
+		return true;
+	}
+
+	void EvtReassembler::discard(std::uint64_t clientid)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		std::erase_if(_partial, [clientid](const auto& p) { return p.first.first == clientid; });
+	}
+
+	std::uint64_t EvtReassembler::discarded() const
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		return _discarded;
+	}
+
+	struct EvtShmPeer
+	{
+		std::unique_ptr<ShmChannel>  _channel;
+		std::unique_ptr<std::thread> _thread;
+	};
+
+	static std::uint64_t EvtSampleSize(EvtSampleType type)
+	{
+		switch(type)
+		{
+			case EvtSampleType::U8:
+			case EvtSampleType::I8:  return 1;
+			case EvtSampleType::U16:
+			case EvtSampleType::I16: return 2;
+			case EvtSampleType::U32:
+			case EvtSampleType::I32:
+			case EvtSampleType::F32: return 4;
+			case EvtSampleType::U64:
+			case EvtSampleType::I64:
+			case EvtSampleType::F64: return 8;
+		}
+		return 1;
+	}
+
+	// The envelope holds the array of minimums followed by the array of maximums
+	template<typename T>
+	static void EvtFoldEnvelopeAs(std::uint8_t* envelope, const std::uint8_t* payload, std::uint64_t count)
+	{
+		std::uint8_t* mins = envelope;
+		std::uint8_t* maxs = envelope + count * sizeof(T);
+		for(std::uint64_t i = 0; i < count; i++)
+		{
+			T value, lo, hi;
+			std::memcpy(&value, payload + i * sizeof(T), sizeof(T));
+			std::memcpy(&lo, mins + i * sizeof(T), sizeof(T));
+			std::memcpy(&hi, maxs + i * sizeof(T), sizeof(T));
+			lo = std::min(lo, value);
+			hi = std::max(hi, value);
+			std::memcpy(mins + i * sizeof(T), &lo, sizeof(T));
+			std::memcpy(maxs + i * sizeof(T), &hi, sizeof(T));
+		}
+	}
+
+	static void EvtFoldEnvelope(EvtSampleType type, std::uint8_t* envelope, const std::uint8_t* payload, std::uint64_t count)
+	{
+		switch(type)
+		{
+			case EvtSampleType::U8:  EvtFoldEnvelopeAs<std::uint8_t>(envelope, payload, count); break;
+			case EvtSampleType::I8:  EvtFoldEnvelopeAs<std::int8_t>(envelope, payload, count); break;
+			case EvtSampleType::U16: EvtFoldEnvelopeAs<std::uint16_t>(envelope, payload, count); break;
+			case EvtSampleType::I16: EvtFoldEnvelopeAs<std::int16_t>(envelope, payload, count); break;
+			case EvtSampleType::U32: EvtFoldEnvelopeAs<std::uint32_t>(envelope, payload, count); break;
+			case EvtSampleType::I32: EvtFoldEnvelopeAs<std::int32_t>(envelope, payload, count); break;
+			case EvtSampleType::U64: EvtFoldEnvelopeAs<std::uint64_t>(envelope, payload, count); break;
+			case EvtSampleType::I64: EvtFoldEnvelopeAs<std::int64_t>(envelope, payload, count); break;
+			case EvtSampleType::F32: EvtFoldEnvelopeAs<float>(envelope, payload, count); break;
+			case EvtSampleType::F64: EvtFoldEnvelopeAs<double>(envelope, payload, count); break;
+		}
+	}
+
+	static bool EvtIsDecimated(const EvtSubscriptionPolicy& policy)
+	{
+		return policy._max_rate > 0.0f || policy._decimation == EvtDecimation::EVERY_NTH;
+	}
+
+	static std::uint64_t EvtWindowPeriod(const EvtSubscriptionPolicy& policy)
+	{
+		return static_cast<std::uint64_t>(1e9 / policy._max_rate);
+	}
+
+	// NOTE: (Cesar) Server side outbound queue of a single client
+	// 				 Every subscription gets its own FIFO so the delivery policy only
+	// 				 affects frames of that event, a global sequence number keeps the
+	// 				 order frames were relayed in across subscriptions
+	// 				 Exposes the same popBatch/tryPop/requestUnblock as SysRingQueue
+	class EvtSubscriberQueue
+	{
+	public:
+		EvtSubscriberQueue(bool canblock, const Socket& socket) : _socket(socket), _can_block(canblock) { }
+
+		~EvtSubscriberQueue()
+		{
+			for(auto& sub : _subs)
+			{
+				if(sub.second._window_held) takeWindow(sub.second);
+			}
+		}
+
+		// Returns false if the frame was not queued due to an unblock request
+		bool push(const EvtHeader& header, const SysRefBuffer& input, const EvtSubscriptionPolicy& policy)
+		{
+			std::unique_lock<std::mutex> lock(_lock);
+			if(_unblock)
+			{
+				return false;
+			}
+
+			Subscription& sub = _subs[header.eventid];
+			sub._policy = policy;
+
+			// NOTE: (Cesar) The policy is decided on the first fragment of an event
+			// 				 The remaining fragments follow that decision
+			// 				 Fragments of different producers interleave so the decision is kept per (producer, msgid)
+			const bool fragment = (header.flags & EVT_FLAG_FRAGMENT);
+			const bool continuation = fragment && header.fragoffset > 0;
+			const bool last = (header.flags & EVT_FLAG_LAST_FRAGMENT);
+			if(continuation)
+			{
+				auto it = sub._fragments.find({ header.client, header.msgid });
+				if(it == sub._fragments.end())
+				{
+					sub._dropped++;
+					return true;
+				}
+
+				const bool accepted = it->second;
+				if(last)
+				{
+					sub._fragments.erase(it);
+				}
+
+				// Fragments of an event the filter rejected are not drops
+				if(!accepted)
+				{
+					return true;
+				}
+			}
+
+			// Rate limiting happens before the delivery policy
+			// so the policy sees the decimated stream
+			const SysRefBuffer* frame = &input;
+			SysRefBuffer released;
+			if(!continuation && EvtIsDecimated(policy))
+			{
+				if(!decimate(sub, header, input, policy, released))
+				{
+					return true;
+				}
+				frame = &released;
+			}
+
+			switch(continuation ? EvtDeliveryPolicy::RELIABLE : policy._policy)
+			{
+				case EvtDeliveryPolicy::SAMPLE:
+				{
+					if((sub._seen++ % std::max<std::uint32_t>(policy._param, 1)) != 0)
+					{
+						return true;
+					}
+					dropOldest(sub, EVT_SUB_QUEUE_DEPTH);
+					break;
+				}
+				case EvtDeliveryPolicy::DROP_OLDEST:
+				{
+					dropOldest(sub, policy._param > 0 ? policy._param : EVT_SUB_QUEUE_DEPTH);
+					break;
+				}
+				case EvtDeliveryPolicy::CONFLATE:
+				{
+					if(!sub._frames.empty())
+					{
+						if(!fragment && !EvtFrameIsFragment(sub._frames.back()._frame.data()))
+						{
+							// Replace the undelivered value in place
+							sub._frames.back()._frame = *frame;
+							sub._dropped++;
+							return true;
+						}
+
+						// Fragmented events are only conflated as a whole
+						dropOldest(sub, 1);
+					}
+					break;
+				}
+				case EvtDeliveryPolicy::RELIABLE:
+				{
+					// NOTE: (Cesar) Reactor loops cannot block, they keep the old unbounded behaviour
+					// 				 Fragments of an event a lossy policy accepted are always queued
+					const std::uint64_t depth = policy._param > 0 ? policy._param : EVT_EMIT_QUEUE_SIZE;
+					if(_can_block && policy._policy == EvtDeliveryPolicy::RELIABLE)
+					{
+						_space_cv.wait(lock, [&](){ return _unblock || sub._frames.size() < depth; });
+						if(_unblock)
+						{
+							return false;
+						}
+					}
+					break;
+				}
+			}
+
+			if(fragment && !continuation && !last)
+			{
+				markFragments(sub, header, true);
+			}
+			sub._frames.push_back({ _seq++, *frame });
+			_size++;
+			lock.unlock();
+			_data_cv.notify_one();
+			return true;
+		}
+
+		// Blocks until there is data and then drains up to max frames into out
+		std::uint64_t popBatch(std::vector<SysRefBuffer>& out, std::uint64_t max)
+		{
+			std::uint64_t count = 0;
+			{
+				std::unique_lock<std::mutex> lock(_lock);
+				_data_cv.wait(lock, [this](){ return _unblock || _size > 0; });
+				if(_unblock)
+				{
+					return 0;
+				}
+
+				SysRefBuffer frame;
+				while(count < max && popLocked(frame))
+				{
+					out.push_back(std::move(frame));
+					count++;
+				}
+			}
+			_space_cv.notify_all();
+			return count;
+		}
+
+		// Non blocking pop
+		bool tryPop(SysRefBuffer& value)
+		{
+			bool popped;
+			{
+				std::unique_lock<std::mutex> lock(_lock);
+				popped = popLocked(value);
+			}
+			if(popped)
+			{
+				_space_cv.notify_all();
+			}
+			return popped;
+		}
+
+		// Queues the held frames of the rate limited subscriptions whose window is over
+		// Returns true if anything was queued
+		bool flushWindows(std::uint64_t now)
+		{
+			bool flushed = false;
+			{
+				std::unique_lock<std::mutex> lock(_lock);
+				if(_unblock)
+				{
+					return false;
+				}
+
+				for(auto& [eventid, sub] : _subs)
+				{
+					if(sub._window_held && now >= sub._window_release)
+					{
+						dropOldest(sub, EVT_SUB_QUEUE_DEPTH);
+						sub._frames.push_back({ _seq++, takeWindow(sub) });
+						sub._window_release = now + EvtWindowPeriod(sub._policy);
+						_size++;
+						flushed = true;
+					}
+				}
+			}
+
+			if(flushed)
+			{
+				_data_cv.notify_one();
+			}
+			return flushed;
+		}
+
+		std::uint64_t depth(std::uint16_t eventid)
+		{
+			std::unique_lock<std::mutex> lock(_lock);
+			auto it = _subs.find(eventid);
+			return it != _subs.end() ? it->second._frames.size() : 0;
+		}
+
+		// The first fragment of the event was rejected by the subscriber filter
+		void rejectFragments(const EvtHeader& header)
+		{
+			std::unique_lock<std::mutex> lock(_lock);
+			markFragments(_subs[header.eventid], header, false);
+		}
+
+		void requestUnblock()
+		{
+			{
+				std::unique_lock<std::mutex> lock(_lock);
+				_unblock = true;
+				for(auto& sub : _subs)
+				{
+					if(sub.second._window_held) takeWindow(sub.second);
+				}
+			}
+			_data_cv.notify_all();
+			_space_cv.notify_all();
+		}
+
+		std::mutex& pumpMutex()
+		{
+			return _pump_lock;
+		}
+
+		const Socket& socket() const
+		{
+			return _socket;
+		}
+
+		// Set once the client metadata arrives
+		void bind(std::uint64_t cid)
+		{
+			_client.store(cid, std::memory_order_release);
+		}
+
+		std::uint64_t client() const
+		{
+			return _client.load(std::memory_order_acquire);
+		}
+
+		// Shared memory transport of the client (if any)
+		// Must be called with pumpMutex() held
+		std::shared_ptr<EvtShmPeer>& shmPeer()
+		{
+			return _shm_peer;
+		}
+
+		// Calls func(eventid, depth, dropped) for every subscription seen on this queue
+		template<typename F>
+		void statistics(F func)
+		{
+			std::unique_lock<std::mutex> lock(_lock);
+			for(const auto& sub : _subs)
+			{
+				func(sub.first, sub.second._frames.size(), sub.second._dropped);
+			}
+		}
+
+	private:
+		struct Pending
+		{
+			std::uint64_t _seq;
+			SysRefBuffer  _frame;
+		};
+
+		struct Subscription
+		{
+			EvtSubscriptionPolicy _policy;
+			std::deque<Pending>   _frames;
+			std::uint64_t 		  _seen = 0;
+			std::uint64_t 		  _dropped = 0;
+			std::map<std::pair<std::uint64_t, std::uint64_t>, bool> _fragments; // (producer, msgid) -> accepted
+
+			// Rate limiting window
+			SysRefBuffer 		  _window;
+			std::uint64_t 		  _window_release = 0; // Monotonic ns
+			std::uint64_t 		  _window_samples = 0; // Envelope size (0 if _window is a plain frame)
+			std::uint64_t 		  _nth = 0;
+			bool 				  _window_held = false;
+		};
+
+		void markFragments(Subscription& sub, const EvtHeader& header, bool accepted)
+		{
+			// Producers that died midway leave their entry behind
+			if(sub._fragments.size() >= EVT_GROUP_MAX_FRAGMENTED)
+			{
+				sub._fragments.clear();
+			}
+			sub._fragments[{ header.client, header.msgid }] = accepted;
+		}
+
+		void holdWindow(Subscription& sub, const SysRefBuffer& frame, std::uint64_t samples)
+		{
+			if(!sub._window_held)
+			{
+				sub._window_held = true;
+				_evt_held_windows.fetch_add(1, std::memory_order_relaxed);
+			}
+			sub._window = frame;
+			sub._window_samples = samples;
+		}
+
+		SysRefBuffer takeWindow(Subscription& sub)
+		{
+			sub._window_held = false;
+			_evt_held_windows.fetch_sub(1, std::memory_order_relaxed);
+			return std::move(sub._window);
+		}
+
+		void foldEnvelope(Subscription& sub, const EvtHeader& header, const SysRefBuffer& frame, EvtSampleType type)
+		{
+			const std::uint64_t len = header.payloadsize - (EvtFrameIsTraced(frame.data(), frame.size()) ? sizeof(EvtTraceStamps) : 0);
+			const std::uint64_t ssize = EvtSampleSize(type);
+			const std::uint64_t samples = len / ssize;
+			const std::uint8_t* payload = frame.data() + sizeof(EvtHeader);
+
+			// The envelope is twice the size of the event, when that does not fit a frame keep the latest instead
+			if(samples == 0 || 2 * samples * ssize > EVT_FRAGMENT_SIZE)
+			{
+				holdWindow(sub, frame, 0);
+				return;
+			}
+
+			if(sub._window_held && sub._window_samples == samples)
+			{
+				EvtFoldEnvelope(type, sub._window.mutableData() + sizeof(EvtHeader), payload, samples);
+				return;
+			}
+
+			// Start a new envelope (also when the event size changes mid window)
+			EvtHeader eheader = header;
+			eheader.flags &= ~EVT_FLAG_TRACE;
+			eheader.payloadsize = static_cast<std::uint32_t>(2 * samples * ssize);
+			SysRefBuffer envelope = SysRefBuffer::Allocate(sizeof(EvtHeader) + eheader.payloadsize);
+			std::memcpy(envelope.mutableData(), &eheader, sizeof(EvtHeader));
+			std::memcpy(envelope.mutableData() + sizeof(EvtHeader), payload, samples * ssize);
+			std::memcpy(envelope.mutableData() + sizeof(EvtHeader) + samples * ssize, payload, samples * ssize);
+			holdWindow(sub, envelope, samples);
+		}
+
+		// Returns true if there is a frame to queue now (placed in out)
+		bool decimate(Subscription& sub, const EvtHeader& header, const SysRefBuffer& frame, const EvtSubscriptionPolicy& policy, SysRefBuffer& out)
+		{
+			if(policy._decimation == EvtDecimation::EVERY_NTH && (sub._nth++ % std::max<std::uint32_t>(policy._decimation_param, 1)) != 0)
+			{
+				return false;
+			}
+
+			if(policy._max_rate <= 0.0f)
+			{
+				out = frame;
+				return true;
+			}
+
+			const std::uint64_t now = SysGetMonotonicNs();
+			if(header.flags & EVT_FLAG_FRAGMENT)
+			{
+				// Large events are never held, they go through whole if the window is over
+				if(now < sub._window_release)
+				{
+					return false;
+				}
+
+				if(sub._window_held)
+				{
+					takeWindow(sub);
+				}
+				sub._window_release = now + EvtWindowPeriod(policy);
+				out = frame;
+				return true;
+			}
+
+			if(policy._decimation == EvtDecimation::ENVELOPE)
+			{
+				foldEnvelope(sub, header, frame, policy._sample_type);
+			}
+			else
+			{
+				holdWindow(sub, frame, 0);
+			}
+
+			// Otherwise the decimation thread flushes it once the window is over
+			if(now < sub._window_release)
+			{
+				return false;
+			}
+
+			out = takeWindow(sub);
+			sub._window_release = now + EvtWindowPeriod(policy);
+			return true;
+		}
+
+		void dropOldest(Subscription& sub, std::uint64_t depth)
+		{
+			while(!sub._frames.empty() && sub._frames.size() >= depth)
+			{
+				sub._frames.pop_front();
+				sub._dropped++;
+				_size--;
+			}
+		}
+
+		bool popLocked(SysRefBuffer& value)
+		{
+			// Subscriptions per client are few (< EVT_MAX_SUB) so a linear scan is fine
+			Subscription* next = nullptr;
+			for(auto& sub : _subs)
+			{
+				if(!sub.second._frames.empty() && (!next || sub.second._frames.front()._seq < next->_frames.front()._seq))
+				{
+					next = &sub.second;
+				}
+			}
+
+			if(!next)
+			{
+				return false;
+			}
+
+			value = std::move(next->_frames.front()._frame);
+			next->_frames.pop_front();
+			_size--;
+			return true;
+		}
+
+	private:
+		std::mutex 							 _lock;
+		std::mutex 							 _pump_lock;
+		Socket 								 _socket;
+		std::atomic<std::uint64_t> 			 _client = 0;
+		std::shared_ptr<EvtShmPeer> 		 _shm_peer; // Under _pump_lock
+		std::condition_variable 			 _data_cv;
+		std::condition_variable 			 _space_cv;
+		std::map<std::uint16_t, Subscription> _subs;
+		std::uint64_t 						 _seq = 0;
+		std::uint64_t 						 _size = 0;
+		bool 								 _can_block;
+		bool 								 _unblock = false;
+	};
+
+	EvtClientThread::EvtClientThread(const std::string& hostname, const Experiment* exp, std::uint16_t evtport, bool ghost, std::uint64_t customid)
+	{
+		_exp = exp;
+		if(_exp)
+		{
+			LogTrace("[evtclient] Passed in custom experiment dependency.");
+		}
+
+		if(customid > 0)
+		{
+			_evt_has_custom_id = true;
+			_evt_custom_id = customid;
+
+			LogDebug("[evtclient] Client spawned with custom id.");
+			
+			if(!ghost)
+			{
+				LogError("[evtclient] Specified custom client id without being ghost.");
+				LogError("[evtclient] This is not possible.");
+				return;
+			}
+		}
+
+		_evt_socket = SocketInit();
+		SocketConnect(_evt_socket, hostname, evtport);
+		SocketSetNoDelay(_evt_socket);
+		_evt_thread_running.store(true);
+		_evt_listen_thread = std::make_unique<std::thread>(
+			std::bind(&EvtClientThread::clientListenThread, this, _evt_socket)
+		);
+		_evt_emit_thread = std::make_unique<std::thread>(
+			std::bind(&EvtClientThread::clientEmitThread, this, _evt_socket)
+		);
+
+		if(ghost)
+		{
+			emit("mxevt::getclientmeta", nullptr, 0);
+		}
+		else
+		{
+			// Tell the server who we are
+			std::string_view bname = SysGetBinaryName();
+			std::string_view hname = SysGetHostname();
+			std::string client_name_meta = std::string(bname) + "@" + std::string(hname);
+			std::vector<std::uint8_t> meta(client_name_meta.c_str(), client_name_meta.c_str() + client_name_meta.size() + 1);
+
+			// Offer a shared memory transport if the server is on this host
+			// The segment name goes after the null terminator so older servers just ignore it
+			std::unique_ptr<ShmChannel> shm;
+			if(_evt_shm_enabled.load() && ShmChannel::Supported() && EvtHostIsLocal(hostname))
+			{
+				shm = ShmChannel::Create(sizeof(EvtHeader), offsetof(EvtHeader, payloadsize));
+				if(shm)
+				{
+					meta.insert(meta.end(), shm->name().begin(), shm->name().end());
+					meta.push_back(0);
+				}
+			}
+
+			emit("mxevt::getclientmeta", meta.data(), meta.size());
+
+			if(shm && shm->waitAccepted(EVT_SHM_ACCEPT_TIMEOUT))
+			{
+				shm->unlink();
+				_evt_shm = std::move(shm);
+				_evt_shm_listen_thread = std::make_unique<std::thread>(
+					std::bind(&EvtClientThread::clientShmListenThread, this)
+				);
+				LogDebug("[evtclient] Using shared memory event transport.");
+			}
+			else if(shm)
+			{
+				LogDebug("[evtclient] Server did not accept the shared memory transport. Using TCP.");
+			}
+		}
+	}
+
+	EvtClientThread::~EvtClientThread()
+	{
+		_evt_thread_running.store(false);
+		if(_evt_shm)
+		{
+			_evt_shm->close();
+			_evt_shm_listen_thread->join();
+		}
+		_evt_stream->requestUnblock();
+		_evt_emit_queue.requestUnblock();
+		SocketClose(_evt_socket);
+		_evt_listen_thread->join();
+		_evt_emit_thread->join();
+
+		// Only started once a traced frame arrives (nothing records traces past this point)
+		{
+			std::unique_lock<std::mutex> lock(_evt_trace_lock);
+		}
+		_evt_trace_notifier.notify_all();
+		if(_evt_trace_thread)
+		{
+			_evt_trace_thread->join();
+		}
+	}
+
+	void EvtClientThread::clientListenThread(const Socket& socket)
+	{
+		std::unique_ptr<SysRecvThread> recvthread = SysStartRecvThread(socket, sizeof(EvtHeader), offsetof(EvtHeader, payloadsize));
+		SysByteStream& sbs = recvthread->_stream;
+		_evt_stream = &recvthread->_stream;
+
+		while(_evt_thread_running.load())
+		{
+			// Read next event (in place)
+			SysByteStream::FrameView frame = sbs.fetchView();
+
+			if(frame._size == 0)
+			{
+				break;
+			}
+			
+			dispatchFrame(frame._data);
+			sbs.release(frame);
+		}
+		
+		recvthread->_handle.join();
+	}
+
+	void EvtClientThread::clientShmListenThread()
+	{
+		// Frames are read in place from the shared ring
+		while(_evt_shm->read([this](const std::uint8_t* frame, std::uint64_t) { dispatchFrame(frame); }));
+		LogTrace("[evtclient] Shared memory transport closed.");
+	}
+
+	void EvtClientThread::dispatchFrame(const std::uint8_t* frame)
+	{
+		// TODO: (Cesar): Place the new event on the event stack
+		//  			  For now we just run the event callback from this thread
+		//				  and see how it goes
+		EvtHeader header;
+		std::memcpy(&header, frame, sizeof(EvtHeader));
+		LogTrace("[evtclient] Got Event <%d> from <0x%llx>.", header.eventid, header.client);
+
+		const std::uint8_t* payload = frame + sizeof(EvtHeader);
+		const bool fragment = (header.flags & EVT_FLAG_FRAGMENT);
+
+		if(EvtFrameIsTraced(frame, sizeof(EvtHeader) + header.payloadsize))
+		{
+			// Strip the stamps so callbacks only see the user payload
+			const std::uint64_t now = SysGetMonotonicNs();
+			EvtTraceStamps stamps;
+			header.payloadsize -= sizeof(EvtTraceStamps);
+			std::memcpy(&stamps, payload + header.payloadsize, sizeof(EvtTraceStamps));
+			recordTrace(header, stamps, now);
+		}
+		
+		// NOTE: (Cesar) The callbacks are copied out so they run without the lock
+		// 				 Callbacks are free to (un)subscribe from within
+		EvtCallbackFunc callback;
+		EvtChunkCallbackFunc chunk;
+		{
+			std::unique_lock<std::mutex> lock(_evt_callbacks_lock);
+			auto chunkit = _evt_chunk_callbacks.find(header.eventid);
+			if(chunkit != _evt_chunk_callbacks.end())
+			{
+				chunk = chunkit->second;
+			}
+			else
+			{
+				auto callbackit = _evt_callbacks.find(header.eventid);
+				if(callbackit == _evt_callbacks.end())
+				{
+					return;
+				}
+				callback = callbackit->second;
+			}
+		}
+
+		// TODO: (Cesar): Add some userdata instead of passing nullptr
+		// 				  _evt_userdata;
+		if(chunk)
+		{
+			// Chunked subscribers get every fragment as it arrives
+			if(fragment)
+			{
+				chunk(payload, header.payloadsize, header.fragoffset, header.totalsize, nullptr);
+			}
+			else
+			{
+				chunk(payload, header.payloadsize, 0, header.payloadsize, nullptr);
+			}
+			return;
+		}
+
+		if(fragment)
+		{
+			_evt_reassembler.feed(header, payload, [&callback](const EvtHeader&, const std::uint8_t* data, std::uint64_t len) {
+				callback(data, len, nullptr);
+			});
+			return;
+		}
+
+		callback(payload, header.payloadsize, nullptr);
+	}
+
+	void EvtClientThread::recordTrace(const EvtHeader& header, const EvtTraceStamps& stamps, std::uint64_t now)
+	{
+		const std::uint64_t points[] = { stamps._emit, stamps._server_recv, stamps._server_send, now };
+		{
+			std::unique_lock<std::mutex> lock(_evt_trace_lock);
+			EvtTraceHistograms& hist = _evt_trace[{ header.client, header.eventid }];
+			for(std::uint64_t i = 0; i < 3; i++)
+			{
+				// Skip stages the server did not stamp
+				if(points[i] > 0 && points[i + 1] >= points[i])
+				{
+					hist[i].record(points[i + 1] - points[i]);
+				}
+			}
+
+			if(points[0] > 0 && now >= points[0])
+			{
+				hist[static_cast<std::size_t>(EvtTraceStage::TOTAL)].record(now - points[0]);
+			}
+
+			// NOTE: (Cesar) Traffic that stops leaves its last samples behind
+			// 				 The trace thread reports them once the interval is over
+			if(!_evt_trace_thread)
+			{
+				_evt_trace_thread = std::make_unique<std::thread>(
+					std::bind(&EvtClientThread::clientTraceThread, this)
+				);
+			}
+
+			if(SysGetCurrentTime() - _evt_trace_last_report < EVT_TRACE_REPORT_INTERVAL)
+			{
+				return;
+			}
+		}
+		reportTrace();
+	}
+
+	void EvtClientThread::reportTrace()
+	{
+		std::vector<std::uint8_t> report;
+		{
+			std::unique_lock<std::mutex> lock(_evt_trace_lock);
+			_evt_trace_last_report = SysGetCurrentTime();
+
+			// Report the histogram deltas to the server
+			// [producer u64][eventid u16][stage u8][histogram] for every stage with samples
+			for(auto& [key, stages] : _evt_trace)
+			{
+				for(std::uint8_t stage = 0; stage < stages.size(); stage++)
+				{
+					if(stages[stage].count() == 0)
+					{
+						continue;
+					}
+
+					const std::uint64_t offset = report.size();
+					std::vector<std::uint8_t> data = stages[stage].serialize();
+					report.resize(offset + sizeof(std::uint64_t) + sizeof(std::uint16_t) + sizeof(std::uint8_t));
+					std::uint64_t next = EvtDataAppend(offset, &report, key.first);
+					next = EvtDataAppend(next, &report, key.second);
+					EvtDataAppend(next, &report, stage);
+					report.insert(report.end(), data.begin(), data.end());
+					stages[stage].reset();
+				}
+			}
+
+			if(report.empty())
+			{
+				return;
+			}
+
+			if(!_evt_trace_handle.valid())
+			{
+				_evt_trace_handle = findEvent("mxevt::tracereport");
+			}
+		}
+
+		if(_evt_trace_handle.valid())
+		{
+			emit(_evt_trace_handle, report.data(), report.size());
+		}
+	}
+
+	void EvtClientThread::clientTraceThread()
+	{
+		std::unique_lock<std::mutex> lock(_evt_trace_lock);
+		while(_evt_thread_running.load())
+		{
+			_evt_trace_notifier.wait_for(lock, std::chrono::milliseconds(EVT_TRACE_REPORT_INTERVAL), [this](){ return !_evt_thread_running.load(); });
+			if(!_evt_thread_running.load() || SysGetCurrentTime() - _evt_trace_last_report < EVT_TRACE_REPORT_INTERVAL)
+			{
+				continue;
+			}
+
+			lock.unlock();
+			reportTrace();
+			lock.lock();
+		}
+	}
+
+	void EvtClientThread::clientEmitThread(const Socket& socket)
+	{
+		std::vector<std::vector<std::uint8_t>> batch;
+		std::vector<SocketBuffer> iov;
+		batch.reserve(EVT_EMIT_BATCH_SIZE);
+		while(_evt_thread_running.load())
+		{
+			// Drain the next events to emit in FIFO order
+			if(EvtDrainEmitQueue(_evt_emit_queue, batch) == 0)
+			{
+				break;
+			}
+
+			LogTrace("[evtclient] Emitting %llu events.", batch.size());
+			EvtSendBatch(socket, batch, iov);
+
+			for(auto& frame : batch)
+			{
+				recycleFrame(std::move(frame));
+			}
+		}
+	}
+
+	std::vector<std::uint8_t> EvtClientThread::acquireFrame(std::uint64_t size)
+	{
+		std::vector<std::uint8_t> frame;
+		{
+			std::unique_lock<std::mutex> lock(_evt_frame_pool_lock);
+			if(!_evt_frame_pool.empty())
+			{
+				frame = std::move(_evt_frame_pool.back());
+				_evt_frame_pool.pop_back();
+			}
+		}
+
+		// Recycled frames are not cleared so this only touches memory past the old size
+		frame.resize(size);
+		return frame;
+	}
+
+	void EvtClientThread::recycleFrame(std::vector<std::uint8_t>&& frame)
+	{
+		// Fragment sized frames at most, large reservations are just freed
+		if(frame.capacity() == 0 || frame.capacity() > sizeof(EvtHeader) + EVT_FRAGMENT_SIZE)
+		{
+			return;
+		}
+
+		std::unique_lock<std::mutex> lock(_evt_frame_pool_lock);
+		if(_evt_frame_pool.size() < EVT_FRAME_POOL_SIZE)
+		{
+			_evt_frame_pool.push_back(std::move(frame));
+		}
+	}
+
+	EvtFrame EvtClientThread::reserve(const EvtHandle& handle, std::uint64_t size)
+	{
+		EvtFrame frame;
+		if(!handle.valid())
+		{
+			LogError("[evtclient] Reserve on an invalid event handle.");
+			return frame;
+		}
+
+		if(size > EVT_MAX_EVENT_SIZE)
+		{
+			LogError("[evtclient] Event <%d> is too large. Reserve aborted.", handle.id());
+			return frame;
+		}
+
+		frame._owner = this;
+		frame._buffer = acquireFrame(sizeof(EvtHeader) + size);
+		std::memcpy(frame._buffer.data(), &handle._header, sizeof(EvtHeader));
+		return frame;
+	}
+
+	void EvtClientThread::commit(std::vector<std::uint8_t>&& frame, std::uint64_t size)
+	{
+		EvtHeader header;
+		std::memcpy(&header, frame.data(), sizeof(EvtHeader));
+
+		if(size > EVT_FRAGMENT_SIZE)
+		{
+			// NOTE: (Cesar) Fragments need their own headers, large frames take the copy path
+			emit(EvtHandle{ header }, frame.data() + sizeof(EvtHeader), size);
+			recycleFrame(std::move(frame));
+			return;
+		}
+
+		header.msgid = GetNextEventMessageId();
+		if(EvtTraceFits(size))
+		{
+			EvtTraceStamps stamps;
+			stamps._emit = SysGetMonotonicNs();
+			header.flags |= EVT_FLAG_TRACE;
+			header.payloadsize = static_cast<std::uint32_t>(size + sizeof(EvtTraceStamps));
+			frame.resize(sizeof(EvtHeader) + size + sizeof(EvtTraceStamps));
+			std::memcpy(frame.data() + sizeof(EvtHeader) + size, &stamps, sizeof(EvtTraceStamps));
+		}
+		else
+		{
+			header.payloadsize = static_cast<std::uint32_t>(size);
+			frame.resize(sizeof(EvtHeader) + size);
+		}
+		std::memcpy(frame.data(), &header, sizeof(EvtHeader));
+
+		if(_evt_shm)
+		{
+			SocketBuffer part = { frame.data(), frame.size() };
+			if(_evt_shm->write(&part, 1))
+			{
+				recycleFrame(std::move(frame));
+				return;
+			}
+			LogWarning("[evtclient] Failed to emit via shared memory. Falling back to TCP.");
+		}
+
+		_evt_emit_queue.push(std::move(frame));
+	}
+
+	EvtFrame::EvtFrame(EvtFrame&& other) noexcept
+		: _owner(other._owner), _buffer(std::move(other._buffer))
+	{
+		other._owner = nullptr;
+	}
+
+	EvtFrame& EvtFrame::operator=(EvtFrame&& other) noexcept
+	{
+		if(this != &other)
+		{
+			reset();
+			_owner = other._owner;
+			_buffer = std::move(other._buffer);
+			other._owner = nullptr;
+		}
+		return *this;
+	}
+
+	EvtFrame::~EvtFrame()
+	{
+		reset();
+	}
+
+	void EvtFrame::reset()
+	{
+		if(_owner)
+		{
+			_owner->recycleFrame(std::move(_buffer));
+			_owner = nullptr;
+		}
+		_buffer.clear();
+	}
+
+	std::uint8_t* EvtFrame::data()
+	{
+		return _owner ? _buffer.data() + sizeof(EvtHeader) : nullptr;
+	}
+
+	std::uint64_t EvtFrame::size() const
+	{
+		return _owner ? _buffer.size() - sizeof(EvtHeader) : 0;
+	}
+
+	bool EvtFrame::valid() const
+	{
+		return _owner != nullptr;
+	}
+
+	void EvtFrame::commit()
+	{
+		commit(size());
+	}
+
+	void EvtFrame::commit(std::uint64_t size)
+	{
+		if(!_owner)
+		{
+			LogError("[evtclient] Commit on an invalid or already committed frame.");
+			return;
+		}
+
+		EvtClientThread* owner = _owner;
+		const std::uint64_t payload = std::min(size, this->size());
+		_owner = nullptr;
+		owner->commit(std::move(_buffer), payload);
+	}
+
+	EvtHandle EvtClientThread::makeHandle(std::uint16_t eventid) const
+	{
+		EvtHandle handle;
+		handle._header.client = _evt_has_custom_id ? _evt_custom_id : SysGetClientId();
+		handle._header.eventid = eventid;
+		return handle;
+	}
+
+	EvtHandle EvtClientThread::findEvent(const std::string& event)
+	{
+		{
+			std::unique_lock<std::mutex> lock(_evt_registry_lock);
+			auto evt = _evt_registry.find(event);
+			if(evt != _evt_registry.end())
+			{
+				return makeHandle(evt->second);
+			}
+		}
+
+		LogDebug("[evtclient] Could not find event <%s> in local registry.", event.c_str());
+		LogDebug("[evtclient] Looking in server for <%s>.", event.c_str());
+		std::uint16_t eid = 0;
+
+		if(_exp)
+		{
+			eid = _exp->_rpc_client->call<std::uint16_t>(RPC_CALL_MULEX_EVTGETID, string32(event));
+		}
+		else
+		{
+			std::optional<const Experiment*> experiment = SysGetConnectedExperiment();
+			if(!experiment.has_value())
+			{
+				LogError("[evtclient] Failed to emit event. Not connected to an experiment.");
+				return {};
+			}
+
+			eid = experiment.value()->_rpc_client->call<std::uint16_t>(RPC_CALL_MULEX_EVTGETID, string32(event));
+		}
+		if(eid != 0)
+		{
+			// Cache it
+			std::unique_lock<std::mutex> lock(_evt_registry_lock);
+			_evt_registry.emplace(event, eid);
+		}
+		return makeHandle(eid);
+	}
+
+	void EvtClientThread::emit(const std::string& event, const std::uint8_t* data, std::uint64_t len)
+	{
+		EvtHandle handle = findEvent(event);
+		if(!handle.valid())
+		{
+			LogError("[evtclient] Failed to find event in server. Emit aborted.");
+			return;
+		}
+
+		emit(handle, data, len);
+	}
+
+	void EvtClientThread::emit(const EvtHandle& handle, const std::uint8_t* data, std::uint64_t len)
+	{
+		if(!handle.valid())
+		{
+			LogError("[evtclient] Emit on an invalid event handle. Emit aborted.");
+			return;
+		}
+
+		if(len > EVT_MAX_EVENT_SIZE)
+		{
+			LogError("[evtclient] Event <%d> is too large. Emit aborted.", handle.id());
+			return;
+		}
+
+		// Header from the handle template
+		EvtHeader header = handle._header;
+		header.msgid = GetNextEventMessageId();
+
+		LogTrace("payloadsize on client: %llu", len);
+
+		bool shm = (_evt_shm != nullptr);
+		if(EvtTraceFits(len))
+		{
+			// Traced events always fit a single frame with the stamps behind the payload
+			EvtTraceStamps stamps;
+			header.flags |= EVT_FLAG_TRACE;
+			header.payloadsize = static_cast<std::uint32_t>(len + sizeof(EvtTraceStamps));
+			stamps._emit = SysGetMonotonicNs();
+
+			SocketBuffer parts[3] = {
+				{ reinterpret_cast<const std::uint8_t*>(&header), sizeof(EvtHeader) },
+				{ data, len },
+				{ reinterpret_cast<const std::uint8_t*>(&stamps), sizeof(EvtTraceStamps) }
+			};
+			emitFrame(parts, 3, &shm);
+			return;
+		}
+
+		// Large events go out as fragments (all through the same transport)
+		EvtForEachFrame(header, data, len, [this, &shm](const EvtHeader& fheader, const std::uint8_t* fdata, std::uint64_t flen) {
+			SocketBuffer parts[2] = {
+				{ reinterpret_cast<const std::uint8_t*>(&fheader), sizeof(EvtHeader) },
+				{ fdata, flen }
+			};
+			emitFrame(parts, 2, &shm);
+		});
+	}
+
+	void EvtClientThread::emitFrame(const SocketBuffer* parts, std::uint64_t count, bool* shm)
+	{
+		if(*shm)
+		{
+			// Single copy straight into the shared ring
+			if(_evt_shm->write(parts, count))
+			{
+				return;
+			}
+			LogWarning("[evtclient] Failed to emit via shared memory. Falling back to TCP.");
+			*shm = false;
+		}
+
+		std::uint64_t size = 0;
+		for(std::uint64_t i = 0; i < count; i++) size += parts[i].len;
+
+		std::vector<std::uint8_t> vdata = acquireFrame(size);
+		std::uint64_t offset = 0;
+		for(std::uint64_t i = 0; i < count; i++)
+		{
+			if(parts[i].len > 0)
+			{
+				std::memcpy(vdata.data() + offset, parts[i].data, parts[i].len);
+			}
+			offset += parts[i].len;
+		}
+
+		_evt_emit_queue.push(std::move(vdata));
+	}
+
+	EvtHandle EvtClientThread::regist(const std::string& event)
+	{
+		// Ask server to register event via RPC
+		const Experiment* exp;
+		if(_exp)
+		{
+			exp = _exp;
+		}
+		else
+		{
+			std::optional<const Experiment*> experiment = SysGetConnectedExperiment();
+			if(!experiment.has_value())
+			{
+				LogError("[evtclient] Failed to register event. Not connected to an experiment.");
+				return {};
+			}
+			exp = experiment.value();
+		}
+		
+		bool reg = exp->_rpc_client->call<bool>(RPC_CALL_MULEX_EVTREGISTER, string32(event));
+		if(!reg)
+		{
+			LogError("[evtclient] Failed to register event. EvtRegister() returned false.");
+		}
+
+		std::uint16_t eventid = exp->_rpc_client->call<std::uint16_t>(RPC_CALL_MULEX_EVTGETID, string32(event));
+		if(eventid == 0)
+		{
+			LogError("[evtclient] Failed to register event.");
+			return {};
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(_evt_registry_lock);
+			_evt_registry.emplace(event, eventid);
+		}
+		LogTrace("[evtclient] Registered event <%s> with id <%d>.", event.c_str(), eventid);
+		return makeHandle(eventid);
+	}
+
+	std::uint16_t EvtClientThread::subscribeRemote(const std::string& event, EvtSubscriptionPolicy policy, const std::string& filter, const EvtConsumerGroup* group, const std::function<void(std::uint16_t)>& install)
+	{
+		// Ask server for the event id via RPC
+		const Experiment* exp;
+		if(_exp)
+		{
+			exp = _exp;
+		}
+		else
+		{
+			std::optional<const Experiment*> experiment = SysGetConnectedExperiment();
+			if(!experiment.has_value())
+			{
+				LogError("[evtclient] Failed to subscribe to event. Not connected to an experiment.");
+				return 0;
+			}
+			exp = experiment.value();
+		}
+		
+		std::uint16_t eventid = exp->_rpc_client->call<std::uint16_t>(RPC_CALL_MULEX_EVTGETID, string32(event));
+		if(eventid == 0)
+		{
+			LogError("[evtclient] Failed to subscribe to event. Event <%s> is not registered.");
+			return 0;
+		}
+
+		if(filter.size() >= EVT_FILTER_MAX_SOURCE)
+		{
+			LogError("[evtclient] Failed to subscribe to event. Filter is longer than %llu characters.", EVT_FILTER_MAX_SOURCE - 1);
+			return 0;
+		}
+
+		// NOTE: (Cesar) The callback goes in before subscribing since the server sends
+		// 				 the retained frames of the event (if any) before the call returns
+		decltype(_evt_callbacks)::node_type callback;
+		decltype(_evt_chunk_callbacks)::node_type chunk_callback;
+		{
+			std::unique_lock<std::mutex> lock(_evt_callbacks_lock);
+			callback = _evt_callbacks.extract(eventid);
+			chunk_callback = _evt_chunk_callbacks.extract(eventid);
+			install(eventid);
+		}
+
+		const bool subscribed = group ?
+			exp->_rpc_client->call<bool>(RPC_CALL_MULEX_EVTSUBSCRIBEGROUP, string32(event), *group, policy) :
+			exp->_rpc_client->call<bool>(RPC_CALL_MULEX_EVTSUBSCRIBEWITHPOLICY, string32(event), policy, string256(filter));
+		if(!subscribed)
+		{
+			// Keep the previous subscription (if any) as it was
+			std::unique_lock<std::mutex> lock(_evt_callbacks_lock);
+			_evt_callbacks.erase(eventid);
+			_evt_chunk_callbacks.erase(eventid);
+			if(callback) _evt_callbacks.insert(std::move(callback));
+			if(chunk_callback) _evt_chunk_callbacks.insert(std::move(chunk_callback));
+			lock.unlock();
+			LogError("[evtclient] Failed to subscribe to event.");
+			return 0;
+		}
+
+		if(callback || chunk_callback)
+		{
+			LogTrace("[evtclient] Subscribing to already subscribed event. Only one callback per event is allowed. Replacing...");
+		}
+		return eventid;
+	}
+
+	void EvtClientThread::subscribe(const std::string& event, EvtCallbackFunc callback, EvtSubscriptionPolicy policy, const std::string& filter)
+	{
+		std::uint16_t eventid = subscribeRemote(event, policy, filter, nullptr, [this, &callback](std::uint16_t id) { _evt_callbacks[id] = callback; });
+		if(eventid == 0)
+		{
+			return;
+		}
+
+		_evt_subscriptions.insert(event);
+
+		LogTrace("[evtclient] Subscribed to event <%s> [%d].", event.c_str(), eventid);
+	}
+
+	void EvtClientThread::subscribeGroup(const std::string& event, const EvtConsumerGroup& group, EvtCallbackFunc callback, EvtSubscriptionPolicy policy)
+	{
+		std::uint16_t eventid = subscribeRemote(event, policy, "", &group, [this, &callback](std::uint16_t id) { _evt_callbacks[id] = callback; });
+		if(eventid == 0)
+		{
+			return;
+		}
+
+		_evt_subscriptions.insert(event);
+
+		LogTrace("[evtclient] Subscribed to event <%s> [%d] in group <%s>.", event.c_str(), eventid, group._name.c_str());
+	}
+
+	void EvtClientThread::subscribeChunked(const std::string& event, EvtChunkCallbackFunc callback, EvtSubscriptionPolicy policy, const std::string& filter)
+	{
+		std::uint16_t eventid = subscribeRemote(event, policy, filter, nullptr, [this, &callback](std::uint16_t id) { _evt_chunk_callbacks[id] = callback; });
+		if(eventid == 0)
+		{
+			return;
+		}
+
+		_evt_subscriptions.insert(event);
+
+		LogTrace("[evtclient] Subscribed to event <%s> [%d] in chunks.", event.c_str(), eventid);
+	}
+
+	void EvtClientThread::unsubscribe(const std::string& event)
+	{
+		// Ask server for the event id via RPC
+		const Experiment* exp;
+		if(_exp)
+		{
+			exp = _exp;
+		}
+		else
+		{
+			std::optional<const Experiment*> experiment = SysGetConnectedExperiment();
+			if(!experiment.has_value())
+			{
+				LogError("[evtclient] Failed to unsubscribe to event. Not connected to an experiment.");
+				return;
+			}
+			exp = experiment.value();
+		}
+		
+		std::uint16_t eventid = exp->_rpc_client->call<std::uint16_t>(RPC_CALL_MULEX_EVTGETID, string32(event));
+		if(eventid == 0)
+		{
+			LogError("[evtclient] Failed to unsubscribe to event. Event <%s> is not registered.");
+			return;
+		}
+
+		if(!exp->_rpc_client->call<bool>(RPC_CALL_MULEX_EVTUNSUBSCRIBE, string32(event)))
+		{
+			LogError("[evtclient] Failed to unsubscribe to event.");
+			return;
+		}
+
+		std::uint64_t erased;
+		{
+			std::unique_lock<std::mutex> lock(_evt_callbacks_lock);
+			erased = _evt_callbacks.erase(eventid) + _evt_chunk_callbacks.erase(eventid);
+		}
+
+		if(erased == 0)
+		{
+			LogError("[evtclient] Failed to unsubscribe to event.");
+			return;
+		}
+		_evt_subscriptions.erase(event);
+
+		LogTrace("[evtclient] Unsubscribed to event <%s> [%d].", event.c_str(), eventid);
+	}
+
+	void EvtClientThread::unsubscribeAll()
+	{
+		for(const auto& event : _evt_subscriptions)
+		{
+			unsubscribe(event);
+		}
+	}
+
+	static void SetRdbClientConnectionStatus(std::uint64_t cid, bool connected)
+	{
+		std::string root_key = "/system/backends/" + SysI64ToHexString(cid) + "/";
+		if(!RdbNewEntry(root_key + "connected", RdbValueType::BOOL, &connected))
+		{
+			RdbWriteValueDirect(root_key + "connected", connected);
+		}
+	}
+
+	static void RegisterClientRdb(const mxstring<512>& name, const mxstring<512>& host, std::uint64_t cid)
+	{
+		std::string root_key = "/system/backends/" + SysI64ToHexString(cid) + "/";
+
+		if(!RdbNewEntry(root_key + "name", RdbValueType::STRING, name.c_str()))
+		{
+			RdbWriteValueDirect(root_key + "name", name);
+		}
+
+		if(!RdbNewEntry(root_key + "host", RdbValueType::STRING, host.c_str()))
+		{
+			RdbWriteValueDirect(root_key + "host", host);
+		}
+
+		std::int64_t time = SysGetCurrentTime();
+		if(!RdbNewEntry(root_key + "last_connect_time", RdbValueType::INT64, &time))
+		{
+			RdbWriteValueDirect(root_key + "last_connect_time", time);
+		}
+
+		if(!RdbNewEntry(root_key + "user_status/text", RdbValueType::STRING, "None"))
+		{
+			RdbWriteValueDirect(root_key + "user_status/text", mxstring<512>("None"));
+		}
+
+		if(!RdbNewEntry(root_key + "user_status/color", RdbValueType::STRING, "#000000"))
+		{
+			RdbWriteValueDirect(root_key + "user_status/color", mxstring<512>("#000000"));
+		}
+
+		std::uint32_t init = 0;
+		RdbNewEntry(root_key + "statistics/event/read" , RdbValueType::UINT32, &init);
+		RdbNewEntry(root_key + "statistics/event/write", RdbValueType::UINT32, &init);
+
+		SetRdbClientConnectionStatus(cid, true);
+	}
+
+	static bool ClientIsGhost(std::uint64_t cid)
+	{
+		return (_evt_client_ghost.find(cid) != _evt_client_ghost.end());
+	}
+
+	static void OnClientConnectMetadata(const Socket& socket, std::uint64_t cid, std::uint16_t eid, const std::uint8_t* data, std::uint64_t size)
+	{
+		LogDebug("[evtserver] Registering client <0x%llx>.", cid);
+		_evt_client_socket_pair[socket._handle] = cid;
+
+		if(size == 0)
+		{
+			// This is a "ghost" client
+			// Not registered on the rdb
+			LogTrace("[evtserver] Client is ghost.");
+			_evt_client_ghost.insert(cid);
+			EvtStatsAttachClient(cid, false);
+			return;
+		}
+
+		EvtStatsAttachClient(cid, true);
+
+		LogDebug("[evtserver] New connected client <%s>.", reinterpret_cast<const char*>(data));
+		std::string name_data = reinterpret_cast<const char*>(data);
+		auto token = name_data.find_first_of("@");
+		mxstring<512> bname = name_data.substr(0, token);
+		mxstring<512> hname = name_data.substr(token + 1);
+		RegisterClientRdb(bname, hname, cid);
+		RexUpdateHostsFile(cid, socket._addr);
+	}
+
+	// Points the subscriptions of cid to its send queue
+	// Subscriptions made before the metadata of the connection arrived are bound (and get the retained events) here
+	static void EvtBindClientQueue(std::uint64_t cid, const std::shared_ptr<EvtSubscriberQueue>& queue)
+	{
+		if(!queue)
+		{
+			return;
+		}
+		queue->bind(cid);
+
+		std::unique_lock<std::mutex> lock(_evt_sub_lock);
+		_evt_client_queues[cid] = queue;
+		for(auto& [eid, subs] : _evt_current_subscriptions)
+		{
+			auto it = subs.find(cid);
+			if(it == subs.end() || it->second._queue == queue)
+			{
+				continue;
+			}
+
+			auto retit = _evt_retention.find(eid);
+			if(!it->second._group && retit != _evt_retention.end())
+			{
+				EvtRelayRetained(queue, *retit->second, it->second._policy, it->second._filter.get());
+			}
+			it->second._queue = queue;
+			EvtPublishSubscribers(eid);
+		}
+	}
+
+	static void EvtUnbindClientQueue(std::uint64_t cid, const std::shared_ptr<EvtSubscriberQueue>& queue)
+	{
+		std::unique_lock<std::mutex> lock(_evt_sub_lock);
+		auto it = _evt_client_queues.find(cid);
+
+		// A reconnect with the same id might have replaced it already
+		if(it != _evt_client_queues.end() && it->second == queue)
+		{
+			_evt_client_queues.erase(it);
+		}
+	}
+
+	// Must be called with _evt_sub_lock held
+	static std::shared_ptr<EvtSubscriberQueue> EvtFindClientQueue(std::uint64_t cid)
+	{
+		auto it = _evt_client_queues.find(cid);
+		return (it != _evt_client_queues.end()) ? it->second : nullptr;
+	}
+
+	static std::uint64_t EvtQueueDepth(const EvtSubscription& sub, std::uint16_t eventid)
+	{
+		return sub._queue ? sub._queue->depth(eventid) : ~0ULL;
+	}
+
+	static void OnClientDisconnect(std::uint64_t cid)
+	{
+		std::vector<std::uint16_t> events;
+		{
+			std::unique_lock<std::mutex> lock(_evt_sub_lock);
+			for(const auto& evt : _evt_current_subscriptions)
+			{
+				if(evt.second.contains(cid))
+				{
+					events.push_back(evt.first);
+				}
+			}
+		}
+
+		for(const std::uint16_t eid : events)
+		{
+			EvtUnsubscribe(cid, eid);
+		}
+
+		// Get rid of all the event stats for this client
+		EvtStatsDetachClient(cid);
+
+		if(ClientIsGhost(cid))
+		{
+			_evt_client_ghost.erase(cid);
+			return; // Don't set the status
+		}
+
+		// Reset custom status
+		RdbWriteValueDirect("/system/backends/" + SysI64ToHexString(cid) + "/user_status/text" , mxstring<512>("None"));
+		RdbWriteValueDirect("/system/backends/" + SysI64ToHexString(cid) + "/user_status/color", mxstring<512>("#000000"));
+
+		SetRdbClientConnectionStatus(cid, false);
+
+		RdbWriteValueDirect("/system/backends/" + SysI64ToHexString(cid) + "/statistics/event/read" , 0);
+		RdbWriteValueDirect("/system/backends/" + SysI64ToHexString(cid) + "/statistics/event/write", 0);
+	}
+
+	static void OnClientTraceReport(const Socket& socket, std::uint64_t cid, std::uint16_t eid, const std::uint8_t* data, std::uint64_t size)
+	{
+		constexpr std::uint64_t keysize = sizeof(std::uint64_t) + sizeof(std::uint16_t) + sizeof(std::uint8_t);
+		std::unique_lock<std::mutex> lock(_evt_trace_lock);
+		std::uint64_t offset = 0;
+		while(offset + keysize <= size)
+		{
+			std::uint64_t producer;
+			std::uint16_t eventid;
+			std::uint8_t stage;
+			std::memcpy(&producer, data + offset, sizeof(std::uint64_t));
+			std::memcpy(&eventid, data + offset + sizeof(std::uint64_t), sizeof(std::uint16_t));
+			std::memcpy(&stage, data + offset + sizeof(std::uint64_t) + sizeof(std::uint16_t), sizeof(std::uint8_t));
+			offset += keysize;
+
+			SysLatencyHistogram hist;
+			std::uint64_t read;
+			if(stage >= static_cast<std::uint8_t>(EvtTraceStage::COUNT) || !hist.deserialize(data + offset, size - offset, &read))
+			{
+				LogError("[evtserver] Malformed trace report from <0x%llx>.", cid);
+				return;
+			}
+			offset += read;
+
+			_evt_trace_pairs[{ producer, cid, eventid }][stage].merge(hist);
+			_evt_trace_events[eventid][stage].merge(hist);
+			_evt_trace_dirty = true;
+		}
+	}
+
+	static void EvtWriteRdbLatency(const std::string& key, std::uint64_t value)
+	{
+		if(!RdbNewEntry(key, RdbValueType::UINT64, &value))
+		{
+			RdbWriteValueDirect(key, value);
+		}
+	}
+
+	static void EvtMirrorLatencyRdb()
+	{
+		static constexpr const char* stages[] = { "produce", "queue", "deliver", "total" };
+		std::vector<EvtLatencyEntry> entries;
+		{
+			std::unique_lock<std::mutex> lock(_evt_trace_lock);
+			if(!_evt_trace_dirty)
+			{
+				return;
+			}
+			_evt_trace_dirty = false;
+
+			for(const auto& [eventid, hists] : _evt_trace_events)
+			{
+				for(std::uint8_t stage = 0; stage < hists.size(); stage++)
+				{
+					const SysLatencyHistogram& hist = hists[stage];
+					if(hist.count() > 0)
+					{
+						entries.push_back({ 0, 0, hist.count(), hist.percentile(50.0), hist.percentile(90.0), hist.percentile(99.0), hist.percentile(99.9), hist.max(), eventid, static_cast<EvtTraceStage>(stage) });
+					}
+				}
+			}
+		}
+
+		std::map<std::uint16_t, std::string> names;
+		{
+			std::shared_lock lock(_evt_reg_lock);
+			for(const auto& reg : _evt_server_reg) names.emplace(reg.second, reg.first);
+		}
+
+		for(const auto& entry : entries)
+		{
+			auto name = names.find(entry._eventid);
+			if(name == names.end())
+			{
+				continue;
+			}
+
+			std::string key = "/system/events/" + name->second + "/latency/" + stages[static_cast<std::uint8_t>(entry._stage)];
+			EvtWriteRdbLatency(key + "/count", entry._count);
+			EvtWriteRdbLatency(key + "/p50", entry._p50);
+			EvtWriteRdbLatency(key + "/p99", entry._p99);
+			EvtWriteRdbLatency(key + "/p999", entry._p999);
+			EvtWriteRdbLatency(key + "/max", entry._max);
+		}
+	}
+
+	static void RegisterServerSideEvents()
+	{
+		// Register server side event for metadata
+		EvtRegister("mxevt::getclientmeta");
+		EvtServerRegisterCallback("mxevt::getclientmeta", OnClientConnectMetadata);
+
+		// Subscribers of traced events report their latency histograms here
+		EvtRegister("mxevt::tracereport");
+		EvtServerRegisterCallback("mxevt::tracereport", OnClientTraceReport);
+	}
+
+	EvtServerThread::EvtServerThread(EvtServerMode mode, std::uint32_t nloops, std::uint16_t port)
+	{
+		_evt_mode = mode;
+		_evt_port = port;
+		_evt_thread_running.store(true);
+		_evt_thread_ready.store(false);
+		_accept_wakeup = SocketNotifierInit();
+
+		RegisterServerSideEvents();
+
+		// Same host clients append the name of their shared memory segment to the metadata
+		EvtServerRegisterCallback("mxevt::getclientmeta", [this](const Socket& socket, std::uint64_t cid, std::uint16_t eid, const std::uint8_t* data, std::uint64_t size) {
+			OnClientConnectMetadata(socket, cid, eid, data, size);
+			EvtBindClientQueue(cid, findQueue(socket));
+
+			const char* meta = reinterpret_cast<const char*>(data);
+			const std::uint64_t namelen = (size > 0) ? ::strnlen(meta, size) + 1 : 0;
+			if(namelen < size)
+			{
+				attachShm(socket, cid, std::string(meta + namelen, ::strnlen(meta + namelen, size - namelen)));
+			}
+		});
+
+		if(_evt_mode == EvtServerMode::REACTOR && !SysIoReactor::Supported())
+		{
+			LogWarning("[evtserver] Reactor mode is not supported on this platform. Falling back to threaded mode.");
+			_evt_mode = EvtServerMode::THREADED;
+		}
+
+		if(_evt_mode == EvtServerMode::REACTOR)
+		{
+			_evt_reactor = std::make_unique<SysIoReactor>(
+				nloops,
+				sizeof(EvtHeader),
+				offsetof(EvtHeader, payloadsize),
+				[this](const Socket& socket, const std::uint8_t* frame, std::uint64_t size) { processFrame(socket, frame, size); },
+				[this](const Socket& socket) {
+					auto it = _evt_client_socket_pair.find(socket._handle);
+					std::shared_ptr<EvtSubscriberQueue> queue = findQueue(socket);
+					if(queue)
+					{
+						queue->requestUnblock();
+					}
+
+					if(it != _evt_client_socket_pair.end())
+					{
+						EvtUnbindClientQueue(it->second, queue);
+						detachShm(it->second);
+						_evt_reassembler.discard(it->second);
+						OnClientDisconnect(it->second);
+					}
+
+					std::unique_lock<std::mutex> lock(_evt_emit_queue_mutex);
+					_evt_emit_queue.erase(socket);
+				},
+				[this](const Socket& socket) {
+					std::shared_ptr<EvtSubscriberQueue> queue = findQueue(socket);
+					if(queue)
+					{
+						pumpReactorQueue(queue);
+					}
+				},
+				[](std::uint64_t frames, std::uint64_t syscalls) {
+					// Same counters as the emit threads' batches
+					_evt_emit_frames += frames;
+					_evt_emit_syscalls += syscalls;
+				}
+			);
+			LogDebug("[evtserver] Running in reactor mode with %u loops.", _evt_reactor->loops());
+		}
+		
+		_evt_accept_thread = std::make_unique<std::thread>(
+			std::bind(&EvtServerThread::serverConnAcceptThread, this)
+		);
+
+		_evt_stats_thread = std::make_unique<std::thread>(
+			std::bind(&EvtServerThread::clientStatisticsThread, this)
+		);
+
+		_evt_decimation_thread = std::make_unique<std::thread>(
+			std::bind(&EvtServerThread::decimationThread, this)
+		);
+	}
+
+	EvtServerThread::~EvtServerThread()
+	{
+		_evt_thread_running.store(false);
+		SocketNotifierSignal(_accept_wakeup);
+		_evt_accept_thread->join();
+		SocketNotifierClose(_accept_wakeup);
+
+		std::vector<std::uint64_t> shm_clients;
+		{
+			std::unique_lock<std::mutex> lock(_evt_shm_mutex);
+			for(const auto& peer : _evt_shm_peers) shm_clients.push_back(peer.first);
+		}
+		std::for_each(shm_clients.begin(), shm_clients.end(), [this](std::uint64_t cid){ detachShm(cid); });
+
+		_evt_stats_thread->join();
+		_evt_decimation_thread->join();
+		EvtRecordStop();
+		_evt_reactor.reset();
+		{
+			std::unique_lock<std::mutex> lock(_evt_emit_queue_mutex);
+			std::for_each(_evt_emit_queue.begin(), _evt_emit_queue.end(), [](auto& t){ t.second->requestUnblock(); });
+		}
+#ifdef WIN32
+		std::for_each(_evt_stream.begin(), _evt_stream.end(), [](auto& t){ t.second->requestUnblock(); });
+#endif
+		std::for_each(_evt_emit_thread.begin(), _evt_emit_thread.end(), [](auto& t){ t.second->join(); });
+		std::for_each(_evt_listen_thread.begin(), _evt_listen_thread.end(), [](auto& t){ t.second->join(); });
+		_evt_thread_ready.store(false);
+	}
+
+	bool EvtServerThread::ready() const
+	{
+		return _evt_thread_ready.load();
+	}
+
+	bool EvtServerThread::emit(const std::string& event, const std::uint8_t* data, std::uint64_t len)
+	{
+		std::uint16_t eid = EvtGetId(event);
+		if(eid == 0)
+		{
+			LogError("[evtserver] Failed to find event. Emit aborted.");
+			return false;
+		}
+
+		if(len > EVT_MAX_EVENT_SIZE)
+		{
+			LogError("[evtserver] Event <%s> is too large. Emit aborted.", event.c_str());
+			return false;
+		}
+
+		const EvtSubscriptionTable::Subscribers* subscribers = EvtGetSubscribers(eid);
+		if(!subscribers)
+		{
+			// Not in registry
+			// Silently ignore
+			return false;
+		}
+
+		if(subscribers->empty() && !subscribers->_retention && !_evt_recording.load(std::memory_order_relaxed))
+		{
+			// Dangling event with no subscriptions
+			// Silently ignore
+			LogTrace("Dangling event <%s>.", event.c_str());
+			return false;
+		}
+
+		// Make header
+		EvtHeader header;
+		header.client = SysGetClientId(); // Should be 0x00
+		header.eventid = eid;
+		header.msgid = GetNextEventMessageId();
+
+		EvtForEachFrame(header, data, len, [&](const EvtHeader& fheader, const std::uint8_t* fdata, std::uint64_t flen) {
+			// Built once and shared by all of the subscribers
+			SysRefBuffer frame = SysRefBuffer::Allocate(sizeof(EvtHeader) + flen);
+
+			std::memcpy(frame.mutableData(), &fheader, sizeof(EvtHeader));
+			if(flen > 0)
+			{
+				std::memcpy(frame.mutableData() + sizeof(EvtHeader), fdata, flen);
+			}
+
+			EvtRecordFrame(eid, frame.data(), frame.size());
+			if(subscribers->_retention)
+			{
+				EvtRetainFrame(*subscribers->_retention, fheader, frame);
+			}
+
+			for(const auto& [cid, sub] : subscribers->_clients)
+			{
+				if(!EvtFilterAccepts(sub, fheader, fdata, flen))
+				{
+					reject(sub._queue, fheader);
+					continue;
+				}
+				relay(sub._queue, frame, sub._policy);
+			}
+
+			for(const EvtGroupSubscribers& group : subscribers->_groups)
+			{
+				const auto* member = EvtPickGroupMember(group, fheader, fdata, flen, [eid](const EvtSubscription& sub) { return EvtQueueDepth(sub, eid); });
+				if(member)
+				{
+					relay(member->second._queue, frame, member->second._policy);
+				}
+			}
+		});
+		return true;
+	}
+
+	static void AccumulateDownloadStatistics(std::uint64_t cid, const std::uint8_t* frame)
+	{
+		EvtHeader header;
+		std::memcpy(&header, frame, sizeof(EvtHeader));
+		EvtAccumulateDownload(header.eventid, cid, sizeof(EvtHeader) + header.payloadsize);
+	}
+
+	static bool EvtWriteShm(const std::shared_ptr<EvtShmPeer>& peer, std::uint64_t cid, const SysRefBuffer& frame)
+	{
+		SocketBuffer part = { frame.data(), frame.size() };
+		if(peer->_channel->write(&part, 1))
+		{
+			return true;
+		}
+		LogWarning("[evtserver] Failed to relay via shared memory to <0x%llx>. Falling back to TCP.", cid);
+		return false;
+	}
+
+	void EvtServerThread::relay(const std::shared_ptr<EvtSubscriberQueue>& queue, const SysRefBuffer& frame, const EvtSubscriptionPolicy& policy)
+	{
+		// NOTE: (Cesar) The queue comes from the subscription table entry
+		// 				 So relaying looks up no shared map and takes no lock other than the queue's own
+		if(!queue)
 		{
-			LogError("[evtclient] Failed to unsubscribe to event. Event <%s> is not registered.");
 			return;
 		}
 
-		if(!exp->_rpc_client->call<bool>(RPC_CALL_MULEX_EVTUNSUBSCRIBE, string32(event)))
+		EvtHeader header;
+		std::memcpy(&header, frame.data(), sizeof(EvtHeader));
+		if(!queue->push(header, frame, policy))
 		{
-			LogError("[evtclient] Failed to unsubscribe to event.");
 			return;
 		}
 
-		auto eid_callbacks = _evt_callbacks.find(eventid);
-		if(eid_callbacks == _evt_callbacks.end())
+		if(_evt_reactor)
+		{
+			// NOTE: (Cesar) There is no emit thread in reactor mode
+			// 				 The queue is moved into the connection as it drains
+			pumpReactorQueue(queue);
+		}
+	}
+
+	void EvtServerThread::reject(const std::shared_ptr<EvtSubscriberQueue>& queue, const EvtHeader& header)
+	{
+		// Only fragmented events leave state behind in the queue
+		if(!queue || !(header.flags & EVT_FLAG_FRAGMENT) || (header.flags & EVT_FLAG_LAST_FRAGMENT))
 		{
-			LogError("[evtclient] Failed to unsubscribe to event.");
 			return;
 		}
-		_evt_callbacks.erase(eid_callbacks);
-		_evt_subscriptions.erase(event);
+		queue->rejectFragments(header);
+	}
 
-		LogTrace("[evtclient] Unsubscribed to event <%s> [%d].", event.c_str(), eventid);
+	void EvtServerThread::pumpReactorQueue(const std::shared_ptr<EvtSubscriberQueue>& queue)
+	{
+		const Socket& socket = queue->socket();
+		const std::uint64_t cid = queue->client();
+
+		// Only keep a small window on the connection so the delivery policy decides what is dropped
+		std::unique_lock<std::mutex> lock(queue->pumpMutex());
+		std::shared_ptr<EvtShmPeer>& peer = queue->shmPeer();
+		SysRefBuffer frame;
+		while((peer || _evt_reactor->pending(socket) < EVT_REACTOR_SEND_WINDOW) && queue->tryPop(frame))
+		{
+			LogTrace("[evtserver] Emitting Event to <0x%llx>.", cid);
+			AccumulateDownloadStatistics(cid, frame.data());
+			EvtStampSend(frame);
+			if(peer && EvtWriteShm(peer, cid, frame))
+			{
+				continue;
+			}
+			peer.reset();
+			_evt_reactor->send(socket, frame);
+		}
 	}
 
-	void EvtClientThread::unsubscribeAll()
+	std::shared_ptr<EvtSubscriberQueue> EvtServerThread::findQueue(const Socket& socket)
 	{
-		for(const auto& event : _evt_subscriptions)
+		std::unique_lock<std::mutex> lock(_evt_emit_queue_mutex);
+		auto it = _evt_emit_queue.find(socket);
+		return (it != _evt_emit_queue.end()) ? it->second : nullptr;
+	}
+
+	void EvtServerThread::serverConnAcceptThread()
+	{
+		_server_socket = SocketInit();
+		SocketBindListen(_server_socket, _evt_port);
+		if(!SocketSetNonBlocking(_server_socket))
+		{
+			LogError("Failed to set listen socket to non blocking mode.");
+			SocketClose(_server_socket);
+			return;
+		}
+
+		bool would_block;
+		_evt_thread_ready.store(true);
+		while(_evt_thread_running.load())
+		{
+			Socket client = SocketAccept(_server_socket, &would_block);
+
+			if(would_block)
+			{
+				// Sleep until there is a connection or we are shutting down
+				SocketWaitReadable(_server_socket, -1, &_accept_wakeup);
+				continue;
+			}
+
+			if(!client._error)
+			{
+				SocketSetNoDelay(client);
+			}
+
+			if(!client._error && _evt_reactor)
+			{
+				{
+					std::unique_lock<std::mutex> lock(_evt_emit_queue_mutex);
+					_evt_emit_queue[client] = std::make_shared<EvtSubscriberQueue>(false, client);
+				}
+
+				// Reactor mode does not need any per connection threads
+				if(!_evt_reactor->attach(client))
+				{
+					std::unique_lock<std::mutex> lock(_evt_emit_queue_mutex);
+					_evt_emit_queue.erase(client);
+					SocketClose(client);
+				}
+			}
+			else if(!client._error)
+			{
+				// NOTE: (Cesar) Everything both threads share is in place before either starts
+				std::shared_ptr<EvtSubscriberQueue> queue = std::make_shared<EvtSubscriberQueue>(true, client);
+				{
+					std::unique_lock<std::mutex> lock(_evt_emit_queue_mutex);
+					_evt_emit_queue[client] = queue;
+				}
+
+				std::lock_guard<std::mutex> lock(_connections_mutex);
+				_evt_thread_sig.emplace(client, true);
+				_evt_emit_thread.emplace(
+					client,
+					std::make_unique<std::thread>(std::bind(&EvtServerThread::serverEmitThread, this, client, queue))
+				);
+				_evt_listen_thread.emplace(
+					client,
+					std::make_unique<std::thread>(std::bind(&EvtServerThread::serverListenThread, this, client, queue))
+				);
+			}
+
+			// Ignore and keep trying
+			// SocketAccept() already handles errors
+		}
+
+		SocketClose(_server_socket);
+	}
+
+	void EvtServerThread::serverListenThread(const Socket& socket, std::shared_ptr<EvtSubscriberQueue> queue)
+	{
+		std::unique_ptr<SysRecvThread> recvthread = SysStartRecvThread(socket, sizeof(EvtHeader), offsetof(EvtHeader, payloadsize));
+		SysByteStream& sbs = recvthread->_stream;
+
+		{
+			std::unique_lock<std::mutex> lock(_connections_mutex);
+			_evt_stream.emplace(socket, &recvthread->_stream);
+		}
+
+		while(_evt_thread_running.load() && _evt_thread_sig.at(socket).load())
+		{
+			// Read next event (in place)
+			SysByteStream::FrameView frame = sbs.fetchView();
+
+			if(frame._size == 0)
+			{
+				break;
+			}
+
+			processFrame(socket, frame._data, frame._size);
+			sbs.release(frame);
+		}
+
+		// Release producers blocked on this client first (also stops the emit thread)
+		queue->requestUnblock();
+
+		// On client disconnect unsubscribe from events
+		// We can run into issues if there is a crash on the client side, which we don't control
+		EvtUnbindClientQueue(_evt_client_socket_pair.at(socket._handle), queue);
+		detachShm(_evt_client_socket_pair.at(socket._handle));
+		_evt_reassembler.discard(_evt_client_socket_pair.at(socket._handle));
+		OnClientDisconnect(_evt_client_socket_pair.at(socket._handle));
+
+		{
+			std::unique_lock<std::mutex> lock(_connections_mutex);
+			_evt_stream.erase(socket);
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(_evt_emit_queue_mutex);
+			_evt_emit_queue.erase(socket);
+		}
+		recvthread->_handle.join();
+	}
+
+	void EvtServerThread::attachShm(const Socket& socket, std::uint64_t cid, const std::string& name)
+	{
+		std::unique_ptr<ShmChannel> channel = ShmChannel::Open(name, sizeof(EvtHeader), offsetof(EvtHeader, payloadsize));
+		if(!channel)
+		{
+			LogWarning("[evtserver] Could not open shared memory for <0x%llx>. Using TCP.", cid);
+			return;
+		}
+
+		std::shared_ptr<EvtShmPeer> peer = std::make_shared<EvtShmPeer>();
+		peer->_channel = std::move(channel);
+
+		ShmChannel* ch = peer->_channel.get();
+		peer->_thread = std::make_unique<std::thread>([this, socket, ch]() {
+			while(ch->read([this, &socket](const std::uint8_t* frame, std::uint64_t size) { processFrame(socket, frame, size); }));
+		});
+
+		{
+			std::unique_lock<std::mutex> lock(_evt_shm_mutex);
+			_evt_shm_peers[cid] = peer;
+			_evt_shm_peer_count.store(_evt_shm_peers.size());
+		}
+
+		std::shared_ptr<EvtSubscriberQueue> queue = findQueue(socket);
+		if(queue)
+		{
+			std::unique_lock<std::mutex> lock(queue->pumpMutex());
+			queue->shmPeer() = peer;
+		}
+
+		peer->_channel->accept();
+		LogDebug("[evtserver] Client <0x%llx> is using the shared memory transport.", cid);
+	}
+
+	void EvtServerThread::detachShm(std::uint64_t cid)
+	{
+		std::shared_ptr<EvtShmPeer> peer;
+		{
+			std::unique_lock<std::mutex> lock(_evt_shm_mutex);
+			auto it = _evt_shm_peers.find(cid);
+			if(it == _evt_shm_peers.end())
+			{
+				return;
+			}
+			peer = it->second;
+			_evt_shm_peers.erase(it);
+			_evt_shm_peer_count.store(_evt_shm_peers.size());
+		}
+
+		peer->_channel->close();
+		peer->_thread->join();
+		LogTrace("[evtserver] Detached shared memory transport from <0x%llx>.", cid);
+	}
+
+	std::shared_ptr<EvtShmPeer> EvtServerThread::findShmPeer(std::uint64_t cid)
+	{
+		if(_evt_shm_peer_count.load() == 0)
+		{
+			return nullptr;
+		}
+
+		std::unique_lock<std::mutex> lock(_evt_shm_mutex);
+		auto it = _evt_shm_peers.find(cid);
+		return (it != _evt_shm_peers.end()) ? it->second : nullptr;
+	}
+
+	void EvtServerThread::processFrame(const Socket& socket, const std::uint8_t* frame, std::uint64_t size)
+	{
+		// TODO: (Cesar): Place the new event on the event stack
+		//  			  For now we just run the event callback from this thread
+		//				  and see how it goes
+		EvtHeader header;
+		std::memcpy(&header, frame, sizeof(EvtHeader));
+		LogTrace("[evtserver] Got Event <%d> from <0x%llx>.", header.eventid, header.client);
+
+		std::uint64_t datasz = sizeof(EvtHeader) + header.payloadsize;
+		const bool traced = EvtFrameIsTraced(frame, size);
+		const std::uint8_t* payload = frame + sizeof(EvtHeader);
+		const std::uint64_t len = header.payloadsize - (traced ? sizeof(EvtTraceStamps) : 0);
+		EvtRecordFrame(header.eventid, frame, size);
+		const std::uint64_t recvtime = traced ? SysGetMonotonicNs() : 0;
+
+		// Relay event to clients that are subscribed
+		// The frame is copied once out of the receive buffer no matter the subscriber count
+		// Subscribers come from the lock free snapshot since reliable subscribers may block
+		const EvtSubscriptionTable::Subscribers* subscribers = EvtGetSubscribers(header.eventid);
+		SysRefBuffer shared;
+		if(subscribers && subscribers->_retention)
+		{
+			if(traced)
+			{
+				EvtRetainFrame(*subscribers->_retention, header, EvtUntracedCopy(frame, size));
+			}
+			else
+			{
+				shared = SysRefBuffer::Copy(frame, size);
+				EvtRetainFrame(*subscribers->_retention, header, shared);
+			}
+		}
+
+		if(subscribers && !subscribers->empty() && traced)
+		{
+			// Traced frames get a copy per subscriber since the send time is stamped in place
+			auto relayTraced = [&](const EvtSubscription& sub) {
+				SysRefBuffer copy = SysRefBuffer::Copy(frame, size);
+				EvtStampTrace(copy.mutableData(), size, offsetof(EvtTraceStamps, _server_recv), recvtime);
+				relay(sub._queue, copy, sub._policy);
+			};
+
+			for(const auto& [cid, sub] : subscribers->_clients)
+			{
+				if(!EvtFilterAccepts(sub, header, payload, len))
+				{
+					reject(sub._queue, header);
+					continue;
+				}
+				relayTraced(sub);
+			}
+
+			for(const EvtGroupSubscribers& group : subscribers->_groups)
+			{
+				const auto* member = EvtPickGroupMember(group, header, payload, len, [&header](const EvtSubscription& sub) { return EvtQueueDepth(sub, header.eventid); });
+				if(member)
+				{
+					relayTraced(member->second);
+				}
+			}
+		}
+		else if(subscribers && !subscribers->empty())
+		{
+			// The copy is made on the first accepted subscriber (if not retained already)
+			auto relayShared = [&](std::uint64_t cid, const EvtSubscription& sub) {
+				if(!shared.data())
+				{
+					shared = SysRefBuffer::Copy(frame, size);
+				}
+				LogTrace("[evtserver] Relaying event <%d> from <0x%llx> to <0x%llx>.", header.eventid, header.client, cid);
+				relay(sub._queue, shared, sub._policy);
+			};
+
+			for(const auto& [cid, sub] : subscribers->_clients)
+			{
+				if(!EvtFilterAccepts(sub, header, payload, len))
+				{
+					reject(sub._queue, header);
+					continue;
+				}
+				relayShared(cid, sub);
+			}
+
+			for(const EvtGroupSubscribers& group : subscribers->_groups)
+			{
+				const auto* member = EvtPickGroupMember(group, header, payload, len, [&header](const EvtSubscription& sub) { return EvtQueueDepth(sub, header.eventid); });
+				if(member)
+				{
+					relayShared(member->first, member->second);
+				}
+			}
+		}
+
+		// Perform server side tasks (if any)
+		// Fragments are relayed as they come but server callbacks always get the whole event
+		if(!(header.flags & EVT_FLAG_FRAGMENT))
 		{
-			unsubscribe(event);
+			EvtTryRunServerCallback(header.client, header.eventid, payload, len, socket);
+		}
+		else if(EvtHasServerCallback(header.eventid))
+		{
+			_evt_reassembler.feed(header, frame + sizeof(EvtHeader), [&socket](const EvtHeader& h, const std::uint8_t* data, std::uint64_t len) {
+				EvtTryRunServerCallback(h.client, h.eventid, data, len, socket);
+			});
 		}
+
+		EvtAccumulateUpload(header.eventid, header.client, datasz);
 	}
 
-	static void SetRdbClientConnectionStatus(std::uint64_t cid, bool connected)
+	void EvtServerThread::serverEmitThread(const Socket& socket, std::shared_ptr<EvtSubscriberQueue> queue)
 	{
-		std::string root_key = "/system/backends/" + SysI64ToHexString(cid) + "/";
-		if(!RdbNewEntry(root_key + "connected", RdbValueType::BOOL, &connected))
+		std::vector<SysRefBuffer> batch;
+		std::vector<SocketBuffer> iov;
+		batch.reserve(EVT_EMIT_BATCH_SIZE);
+		while(_evt_thread_running.load() && _evt_thread_sig.at(socket).load())
 		{
-			RdbWriteValueDirect(root_key + "connected", connected);
+			// Drain the next events to emit in FIFO order
+			if(EvtDrainEmitQueue(*queue, batch) == 0)
+			{
+				break;
+			}
+
+			// Frames are only queued once the client metadata bound the queue
+			const std::uint64_t cid = queue->client();
+			LogTrace("[evtserver] Emitting %llu events to <0x%llx>.", batch.size(), cid);
+
+			for(auto& data : batch)
+			{
+				AccumulateDownloadStatistics(cid, data.data());
+				EvtStampSend(data);
+			}
+
+			// Same host clients get the frames via shared memory
+			// Whatever could not be written there goes through TCP
+			std::shared_ptr<EvtShmPeer> peer = findShmPeer(cid);
+			std::uint64_t written = 0;
+			while(peer && written < batch.size() && EvtWriteShm(peer, cid, batch[written]))
+			{
+				written++;
+			}
+
+			if(written < batch.size())
+			{
+				batch.erase(batch.begin(), batch.begin() + written);
+				EvtSendBatch(socket, batch, iov);
+			}
 		}
 	}
 
-	static void RegisterClientRdb(const mxstring<512>& name, const mxstring<512>& host, std::uint64_t cid)
+	bool EvtRegister(string32 name)
 	{
-		std::string root_key = "/system/backends/" + SysI64ToHexString(cid) + "/";
-
-		if(!RdbNewEntry(root_key + "name", RdbValueType::STRING, name.c_str()))
+		std::unique_lock lock(_evt_reg_lock);
+		auto evtrit = _evt_server_reg.find(name.c_str());
+		if(evtrit != _evt_server_reg.end())
 		{
-			RdbWriteValueDirect(root_key + "name", name);
+			LogTrace("[evtserver] Cannot register event <%s>. Already exists.", name.c_str());
+			return false;
 		}
 
-		if(!RdbNewEntry(root_key + "host", RdbValueType::STRING, host.c_str()))
+		const std::uint16_t event_id = ++_evt_server_reg_next;
 		{
-			RdbWriteValueDirect(root_key + "host", host);
+			std::unique_lock<std::mutex> lock_sub(_evt_sub_lock);
+			_evt_current_subscriptions.emplace(event_id, std::map<std::uint64_t, EvtSubscription>());
+			EvtPublishSubscribers(event_id);
 		}
+		_evt_server_reg.emplace(name.c_str(), event_id);
 
-		std::int64_t time = SysGetCurrentTime();
-		if(!RdbNewEntry(root_key + "last_connect_time", RdbValueType::INT64, &time))
+		if(_evt_recording.load())
 		{
-			RdbWriteValueDirect(root_key + "last_connect_time", time);
+			std::unique_lock lock_rec(_evt_recorder_lock);
+			if(_evt_recorder)
+			{
+				_evt_recorder->_events[event_id] = _evt_recorder->_names.empty() || _evt_recorder->_names.contains(name.c_str());
+				_evt_recorder->_journal->name(event_id, name.c_str());
+			}
 		}
 
-		if(!RdbNewEntry(root_key + "user_status/text", RdbValueType::STRING, "None"))
-		{
-			RdbWriteValueDirect(root_key + "user_status/text", mxstring<512>("None"));
-		}
+		LogTrace("[evtserver] Registered event <%s> [id=%d].", name.c_str(), event_id);
+		return true;
+	}
 
-		if(!RdbNewEntry(root_key + "user_status/color", RdbValueType::STRING, "#000000"))
+	std::uint16_t EvtGetId(mulex::string32 name)
+	{
+		std::shared_lock lock(_evt_reg_lock);
+		auto evtrit = _evt_server_reg.find(name.c_str());
+		if(evtrit != _evt_server_reg.end())
 		{
-			RdbWriteValueDirect(root_key + "user_status/color", mxstring<512>("#000000"));
+			return evtrit->second;
 		}
 
-		std::uint32_t init = 0;
-		RdbNewEntry(root_key + "statistics/event/read" , RdbValueType::UINT32, &init);
-		RdbNewEntry(root_key + "statistics/event/write", RdbValueType::UINT32, &init);
-
-		SetRdbClientConnectionStatus(cid, true);
+		LogError("[evtserver] Cannot get event id. Event <%s> is not registered.", name.c_str());
+		return 0;
 	}
 
-	static bool ClientIsGhost(std::uint64_t cid)
+	bool EvtSubscribe(mulex::string32 name)
 	{
-		return (_evt_client_ghost.find(cid) != _evt_client_ghost.end());
+		return EvtSubscribeWithPolicy(name, {}, "");
 	}
 
-	static void OnClientConnectMetadata(const Socket& socket, std::uint64_t cid, std::uint16_t eid, const std::uint8_t* data, std::uint64_t size)
+	// Checks the remote subscribe arguments common to every kind of subscription
+	static bool EvtValidateSubscription(const mulex::string32& name, const EvtSubscriptionPolicy& policy, std::uint16_t eid, std::uint64_t cid)
 	{
-		LogDebug("[evtserver] Registering client <0x%llx>.", cid);
-		_evt_client_socket_pair[socket._handle] = cid;
-		_evt_client_socket_pair_rev[cid] = socket;
+		if(eid == 0)
+		{
+			LogError("[evtserver] Cannot subscribe to event <%s>.", name.c_str());
+			return false;
+		}
 
-		if(size == 0)
+		if(cid == 0)
 		{
-			// This is a "ghost" client
-			// Not registered on the rdb
-			LogTrace("[evtserver] Client is ghost.");
-			_evt_client_ghost.insert(cid);
-			return;
+			LogError("[evtserver] Mxserver cannot manually subscribe to events.");
+			return false;
 		}
 
+		if(policy._policy > EvtDeliveryPolicy::SAMPLE)
 		{
-			std::unique_lock<std::mutex> lock(_evt_client_stats_lock);
-			_evt_client_stats[cid] = 0;
+			LogError("[evtserver] Cannot subscribe to event <%s>. Unknown delivery policy <%d>.", name.c_str(), static_cast<int>(policy._policy));
+			return false;
 		}
 
-		LogDebug("[evtserver] New connected client <%s>.", reinterpret_cast<const char*>(data));
-		std::string name_data = reinterpret_cast<const char*>(data);
-		auto token = name_data.find_first_of("@");
-		mxstring<512> bname = name_data.substr(0, token);
-		mxstring<512> hname = name_data.substr(token + 1);
-		RegisterClientRdb(bname, hname, cid);
-		RexUpdateHostsFile(cid, socket._addr);
+		if(policy._decimation > EvtDecimation::ENVELOPE || policy._sample_type > EvtSampleType::F64 || !(policy._max_rate >= 0.0f))
+		{
+			LogError("[evtserver] Cannot subscribe to event <%s>. Invalid rate limit.", name.c_str());
+			return false;
+		}
+		return true;
 	}
 
-	static void OnClientDisconnect(std::uint64_t cid)
+	bool EvtSubscribeWithPolicy(mulex::string32 name, mulex::EvtSubscriptionPolicy policy, mulex::string256 filter)
 	{
-		for(const auto& evt : _evt_current_subscriptions)
+		std::uint16_t eid = EvtGetId(name);
+		std::uint64_t cid = GetCurrentCallerId();
+		if(!EvtValidateSubscription(name, policy, eid, cid))
 		{
-			EvtUnsubscribe(cid, evt.first);
+			return false;
 		}
 
-		// Get rid of all the event stats for this client
-		EvtPurgeStatsEntryClient(cid);
-
-		if(ClientIsGhost(cid))
+		// Compiled here once so the relay path only runs the program
+		std::shared_ptr<const EvtFilter> compiled;
+		if(filter.c_str()[0] != 0)
 		{
-			_evt_client_ghost.erase(cid);
-			return; // Don't set the status
+			std::string error;
+			compiled = EvtFilter::Compile(filter.c_str(), &error);
+			if(!compiled)
+			{
+				LogError("[evtserver] Cannot subscribe to event <%s>. Invalid filter <%s>: %s", name.c_str(), filter.c_str(), error.c_str());
+				return false;
+			}
 		}
 
-		// Reset custom status
-		RdbWriteValueDirect("/system/backends/" + SysI64ToHexString(cid) + "/user_status/text" , mxstring<512>("None"));
-		RdbWriteValueDirect("/system/backends/" + SysI64ToHexString(cid) + "/user_status/color", mxstring<512>("#000000"));
-
-		SetRdbClientConnectionStatus(cid, false);
-
-		{
-			std::unique_lock<std::mutex> lock(_evt_client_stats_lock);
-			_evt_client_stats.erase(cid);
-			RdbWriteValueDirect("/system/backends/" + SysI64ToHexString(cid) + "/statistics/event/read" , 0);
-			RdbWriteValueDirect("/system/backends/" + SysI64ToHexString(cid) + "/statistics/event/write", 0);
-		}
+		return EvtSubscribe(cid, eid, policy, compiled);
 	}
 
-	static void RegisterServerSideEvents()
+	bool EvtSubscribe(std::uint64_t clientid, std::uint16_t eventid, EvtSubscriptionPolicy policy, std::shared_ptr<const EvtFilter> filter)
 	{
-		// Register server side event for metadata
-		EvtRegister("mxevt::getclientmeta");
-		EvtServerRegisterCallback("mxevt::getclientmeta", OnClientConnectMetadata);
-	}
+		std::unique_lock<std::mutex> lock(_evt_sub_lock);
+		auto subit = _evt_current_subscriptions.find(eventid);
+		if(subit == _evt_current_subscriptions.end())
+		{
+			LogError("[evtserver] Cannot subscribe to event with id <%d>. Not registered.", eventid);
+			return false;
+		}
 
-	EvtServerThread::EvtServerThread()
-	{
-		_evt_thread_running.store(true);
-		_evt_thread_ready.store(false);
+		std::shared_ptr<EvtSubscriberQueue> queue = EvtFindClientQueue(clientid);
+		auto retit = _evt_retention.find(eventid);
+		if(retit != _evt_retention.end())
+		{
+			EvtRelayRetained(queue, *retit->second, policy, filter.get());
+		}
 
-		RegisterServerSideEvents();
-		
-		_evt_accept_thread = std::make_unique<std::thread>(
-			std::bind(&EvtServerThread::serverConnAcceptThread, this)
-		);
+		subit->second.insert_or_assign(clientid, EvtSubscription{ policy, std::move(filter), nullptr, std::move(queue) });
+		EvtPublishSubscribers(eventid);
 
-		_evt_stats_thread = std::make_unique<std::thread>(
-			std::bind(&EvtServerThread::clientStatisticsThread, this)
-		);
+		LogTrace("[evtserver] Subscribed <0x%llx> to event [id=%d, policy=%d].", clientid, eventid, static_cast<int>(policy._policy));
+		return true;
 	}
 
-	EvtServerThread::~EvtServerThread()
+	bool EvtSubscribeGroup(mulex::string32 name, mulex::EvtConsumerGroup group, mulex::EvtSubscriptionPolicy policy)
 	{
-		_evt_thread_running.store(false);
-		_evt_accept_thread->join();
-		_evt_stats_thread->join();
-		std::for_each(_evt_emit_stack.begin(), _evt_emit_stack.end(), [](auto& t){ t.second.requestUnblock(); });
-#ifdef WIN32
-		std::for_each(_evt_stream.begin(), _evt_stream.end(), [](auto& t){ t.second->requestUnblock(); });
-#endif
-		std::for_each(_evt_emit_thread.begin(), _evt_emit_thread.end(), [](auto& t){ t.second->join(); });
-		std::for_each(_evt_listen_thread.begin(), _evt_listen_thread.end(), [](auto& t){ t.second->join(); });
-		_evt_thread_ready.store(false);
-	}
+		std::uint16_t eid = EvtGetId(name);
+		std::uint64_t cid = GetCurrentCallerId();
+		if(!EvtValidateSubscription(name, policy, eid, cid))
+		{
+			return false;
+		}
 
-	bool EvtServerThread::ready() const
-	{
-		return _evt_thread_ready.load();
+		if(group._name.c_str()[0] == 0 || group._balance > EvtGroupBalance::KEY_HASH || (group._balance == EvtGroupBalance::KEY_HASH && group._key_size == 0))
+		{
+			LogError("[evtserver] Cannot subscribe to event <%s>. Invalid consumer group.", name.c_str());
+			return false;
+		}
+
+		return EvtSubscribeGroup(cid, eid, group, policy);
 	}
 
-	bool EvtServerThread::emit(const std::string& event, const std::uint8_t* data, std::uint64_t len)
+	bool EvtSubscribeGroup(std::uint64_t clientid, std::uint16_t eventid, const EvtConsumerGroup& group, EvtSubscriptionPolicy policy)
 	{
-		std::uint16_t eid = EvtGetId(event);
-		if(eid == 0)
+		std::unique_lock<std::mutex> lock(_evt_sub_lock);
+		auto subit = _evt_current_subscriptions.find(eventid);
+		if(subit == _evt_current_subscriptions.end())
 		{
-			LogError("[evtserver] Failed to find event. Emit aborted.");
+			LogError("[evtserver] Cannot subscribe to event with id <%d>. Not registered.", eventid);
 			return false;
 		}
 
-		auto cidit = _evt_current_subscriptions.find(eid);
-		if(cidit == _evt_current_subscriptions.end())
+		// Join the group if another member already created it
+		const std::string gname = group._name.c_str();
+		std::shared_ptr<EvtGroupState> state;
+		for(const auto& [cid, sub] : subit->second)
 		{
-			// Not in registry
-			// Silently ignore
-			return false;
+			if(cid != clientid && sub._group && sub._group->_name == gname)
+			{
+				state = sub._group;
+				break;
+			}
 		}
 
-		if(cidit->second.empty())
+		if(!state)
 		{
-			// Dangling event with no subscriptions
-			// Silently ignore
-			LogTrace("Dangling event <%s>.", event.c_str());
+			state = std::make_shared<EvtGroupState>();
+			state->_name = gname;
+			state->_config = group;
+		}
+		else if(
+			state->_config._balance != group._balance ||
+			state->_config._key_offset != group._key_offset ||
+			state->_config._key_size != group._key_size
+		)
+		{
+			LogError("[evtserver] Cannot join group <%s> of event with id <%d>. Balancing differs from the other members.", gname.c_str(), eventid);
 			return false;
 		}
 
-		// Make header
-		EvtHeader header;
-		header.client = SysGetClientId(); // Should be 0x00
-		header.eventid = eid;
-		header.msgid = GetNextEventMessageId();
-		header.payloadsize = static_cast<std::uint32_t>(len);
-
-		std::vector<std::uint8_t> vdata;
-		vdata.resize(sizeof(EvtHeader) + len);
+		// Publishing the new member list rebalances the group
+		subit->second.insert_or_assign(clientid, EvtSubscription{ policy, nullptr, std::move(state), EvtFindClientQueue(clientid) });
+		EvtPublishSubscribers(eventid);
 
-		std::memcpy(vdata.data(), &header, sizeof(EvtHeader));
-		if(len > 0)
-		{
-			std::memcpy(vdata.data() + sizeof(EvtHeader), data, len);
-		}
+		LogTrace("[evtserver] Subscribed <0x%llx> to event [id=%d, policy=%d] in group <%s>.", clientid, eventid, static_cast<int>(policy._policy), gname.c_str());
+		return true;
+	}
 
-		for(const auto& cid : cidit->second)
+	void EvtServerRegisterCallback(
+		mulex::string32 name,
+		std::function<void(const Socket&, std::uint64_t, std::uint16_t, const std::uint8_t*, std::uint64_t)> callback
+	)
+	{
+		std::uint16_t eid = EvtGetId(name);
+		if(eid == 0)
 		{
-			_evt_emit_stack.at(_evt_client_socket_pair_rev.at(cid)).push(vdata);
+			return;
 		}
-		return true;
+		std::unique_lock lock(_evt_server_callback_lock);
+		_evt_server_callbacks.insert_or_assign(eid, callback);
 	}
 
-	void EvtServerThread::relay(const std::uint64_t clientid, const std::uint8_t* data, std::uint64_t len)
+	bool EvtHasServerCallback(std::uint16_t eventid)
 	{
-		std::vector<std::uint8_t> vdata(data, data + len);
-		_evt_emit_stack.at(_evt_client_socket_pair_rev.at(clientid)).push(vdata);
+		std::unique_lock lock(_evt_server_callback_lock);
+		return _evt_server_callbacks.contains(eventid);
 	}
 
-	void EvtServerThread::serverConnAcceptThread()
+	void EvtTryRunServerCallback(std::uint64_t clientid, std::uint16_t eventid, const std::uint8_t* data, std::uint64_t len, const Socket& socket)
 	{
-		_server_socket = SocketInit();
-		SocketBindListen(_server_socket, EVT_PORT);
-		if(!SocketSetNonBlocking(_server_socket))
+		std::unique_lock lock(_evt_server_callback_lock);
+		auto eidit = _evt_server_callbacks.find(eventid);
+		if(eidit != _evt_server_callbacks.end())
 		{
-			LogError("Failed to set listen socket to non blocking mode.");
-			SocketClose(_server_socket);
-			return;
+			eidit->second(socket, clientid, eventid, data, len);
 		}
+	}
 
-		bool would_block;
-		_evt_thread_ready.store(true);
-		while(_evt_thread_running.load())
+	struct EvtStatsQueueSample
+	{
+		std::uint64_t _client;
+		std::uint16_t _eventid;
+		std::uint64_t _depth;
+		std::uint64_t _dropped;
+	};
+
+	struct EvtStatsTotals
+	{
+		std::uint64_t _msgs_in = 0;
+		std::uint64_t _bytes_in = 0;
+		std::uint64_t _msgs_out = 0;
+		std::uint64_t _bytes_out = 0;
+		bool 		  _active = false; // Slot emitted this event since it was attached
+	};
+
+	// Totals of the previous aggregation per event and client slot (stats thread only)
+	static std::unordered_map<std::uint16_t, std::vector<EvtStatsTotals>> _evt_stats_prev;
+
+	static EvtStatsShard* EvtStatsLocalShard()
+	{
+		struct Holder
 		{
-			Socket client = SocketAccept(_server_socket, &would_block);
+			EvtStatsShard* _shard;
 
-			if(would_block)
+			Holder()
 			{
-				// Loop and recheck
-				std::this_thread::sleep_for(std::chrono::milliseconds(10));
-				continue;
+				std::unique_lock<std::mutex> lock(_evt_stats_shards_lock);
+				if(!_evt_stats_free_shards.empty())
+				{
+					_shard = _evt_stats_free_shards.back();
+					_evt_stats_free_shards.pop_back();
+					return;
+				}
+				_evt_stats_shards.push_back(std::make_unique<EvtStatsShard>());
+				_shard = _evt_stats_shards.back().get();
 			}
 
-			if(!client._error)
+			~Holder()
 			{
-				std::lock_guard<std::mutex> lock(_connections_mutex);
-				_evt_emit_thread.emplace(
-					client,
-					std::make_unique<std::thread>(std::bind(&EvtServerThread::serverEmitThread, this, client))
-				);
-				_evt_listen_thread.emplace(
-					client,
-					std::make_unique<std::thread>(std::bind(&EvtServerThread::serverListenThread, this, client))
-				);
+				std::unique_lock<std::mutex> lock(_evt_stats_shards_lock);
+				_evt_stats_free_shards.push_back(_shard);
 			}
+		};
 
-			// Ignore and keep trying
-			// SocketAccept() already handles errors
-		}
-
-		SocketClose(_server_socket);
+		thread_local Holder holder;
+		return holder._shard;
 	}
 
-	void EvtServerThread::serverListenThread(const Socket& socket)
+	// Only called by the thread owning the shard
+	static EvtStatsCounter& EvtStatsCounters(EvtStatsShard* shard, std::uint16_t eventid, std::uint64_t slot)
 	{
-		std::unique_ptr<SysRecvThread> recvthread = SysStartRecvThread(socket, sizeof(EvtHeader), offsetof(EvtHeader, payloadsize));
-		SysByteStream& sbs = recvthread->_stream;
-
-		{
-			std::unique_lock<std::mutex> lock(_connections_mutex);
-			_evt_stream.emplace(socket, &recvthread->_stream);
-			_evt_thread_sig.emplace(socket, true);
-			_evt_emit_stack.emplace(std::piecewise_construct, std::forward_as_tuple(socket), std::forward_as_tuple());
-		}
-		_evt_notifier.notify_one();
-
-		static constexpr std::uint64_t buffersize = SYS_RECV_THREAD_BUFFER_SIZE;
-		std::vector<std::uint8_t> fbuffer(buffersize);
-
-		while(_evt_thread_running.load() && _evt_thread_sig.at(socket).load())
+		std::atomic<std::atomic<EvtStatsEventCounters*>*>& page = shard->_pages[eventid >> 8];
+		std::atomic<EvtStatsEventCounters*>* events = page.load(std::memory_order_relaxed);
+		if(!events)
 		{
-			// Read next event
-			std::uint64_t read = sbs.fetch(fbuffer.data(), buffersize);
-
-			// if(read <= 0 && (!_evt_thread_running.load() || !_evt_thread_sig.at(socket).load()))
-			if(read <= 0)
-			{
-				break;
-			}
-			
-			// TODO: (Cesar): Place the new event on the event stack
-			//  			  For now we just run the event callback from this thread
-			//				  and see how it goes
-			EvtHeader header;
-			std::memcpy(&header, fbuffer.data(), sizeof(EvtHeader));
-			LogTrace("[evtserver] Got Event <%d> from <0x%llx>.", header.eventid, header.client);
+			events = new std::atomic<EvtStatsEventCounters*>[256]();
+			page.store(events, std::memory_order_release);
+		}
 
-			std::uint64_t datasz = sizeof(EvtHeader) + header.payloadsize;
+		std::atomic<EvtStatsEventCounters*>& entry = events[eventid & 0xFF];
+		EvtStatsEventCounters* counters = entry.load(std::memory_order_relaxed);
+		if(!counters)
+		{
+			counters = new EvtStatsEventCounters();
+			entry.store(counters, std::memory_order_release);
+		}
 
-			// Relay event to clients that are subscribed
-			{
-				std::unique_lock<std::mutex> lock(_evt_sub_lock);
-				for(const std::uint64_t cid : _evt_current_subscriptions.at(header.eventid))
-				{
-					LogTrace("[evtserver] Relaying event <%d> from <0x%llx> to <0x%llx>.", header.eventid, header.client, cid);
-					relay(cid, fbuffer.data(), read);
-				}
-			}
+		std::atomic<EvtStatsCounter*>& block = counters->_blocks[slot / EVT_STATS_SLOT_BLOCK];
+		EvtStatsCounter* slots = block.load(std::memory_order_relaxed);
+		if(!slots)
+		{
+			slots = new EvtStatsCounter[EVT_STATS_SLOT_BLOCK]();
+			block.store(slots, std::memory_order_release);
+		}
+		return slots[slot % EVT_STATS_SLOT_BLOCK];
+	}
 
-			// Perform server side tasks (if any)
-			EvtTryRunServerCallback(header.client, header.eventid, fbuffer.data() + sizeof(EvtHeader), header.payloadsize, socket);
+	static std::int64_t EvtStatsSlot(std::uint64_t clientid)
+	{
+		if(clientid == 0)
+		{
+			return -1;
+		}
 
-			std::uint64_t upload = datasz & 0xFFFFFFFF; // Lo DWORD
+		// Cached per thread, the slot is checked since it could have been handed to another client since
+		thread_local std::unordered_map<std::uint64_t, std::uint64_t> cache;
+		auto it = cache.find(clientid);
+		if(it != cache.end() && _evt_stats_slots[it->second].load(std::memory_order_relaxed) == clientid)
+		{
+			return static_cast<std::int64_t>(it->second);
+		}
 
-			if(!ClientIsGhost(header.client))
+		const std::uint64_t nslots = _evt_stats_slots.size();
+		for(std::uint64_t i = 0; i < nslots; i++)
+		{
+			if(_evt_stats_slots[i].load(std::memory_order_relaxed) == clientid)
 			{
-				// Write event client statistics
-				EvtAccumulateClientStatistics(header.client, upload);
+				cache[clientid] = i;
+				return static_cast<std::int64_t>(i);
 			}
-
-			// Write event statistics
-			EvtAccumulateEventStatistics(header.eventid, header.client, upload, true);
 		}
+		return -1;
+	}
 
-		// On client disconnect unsubscribe from events
-		// We can run into issues if there is a crash on the client side, which we don't control
-		OnClientDisconnect(_evt_client_socket_pair.at(socket._handle));
+	static inline void EvtStatsAdd(std::atomic<std::uint64_t>& counter, std::uint64_t value)
+	{
+		// Single writer, the stats thread only reads
+		counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	}
 
+	void EvtAccumulateUpload(std::uint16_t eventid, std::uint64_t clientid, std::uint64_t framebytes)
+	{
+		const std::int64_t slot = EvtStatsSlot(clientid);
+		if(slot < 0)
 		{
-			std::unique_lock<std::mutex> lock(_connections_mutex);
-			_evt_emit_stack.at(socket).requestUnblock();
-			_evt_stream.erase(socket);
+			return;
 		}
-		recvthread->_handle.join();
+
+		EvtStatsCounter& counter = EvtStatsCounters(EvtStatsLocalShard(), eventid, slot);
+		EvtStatsAdd(counter._msgs_in, 1);
+		EvtStatsAdd(counter._bytes_in, framebytes);
 	}
 
-	void EvtServerThread::serverEmitThread(const Socket& socket)
+	void EvtAccumulateDownload(std::uint16_t eventid, std::uint64_t clientid, std::uint64_t framebytes)
 	{
+		const std::int64_t slot = EvtStatsSlot(clientid);
+		if(slot < 0)
 		{
-			// Wait for _evt_thread_sig to be populated by serverListenThread
-			std::unique_lock<std::mutex> lock(_connections_mutex);
-			_evt_notifier.wait(lock);
+			return;
 		}
 
-		while(_evt_thread_running.load() && _evt_thread_sig.at(socket).load())
-		{
-			// Read next event to emit from stack
-			std::vector<std::uint8_t> data = _evt_emit_stack.at(socket).pop();
+		EvtStatsCounter& counter = EvtStatsCounters(EvtStatsLocalShard(), eventid, slot);
+		EvtStatsAdd(counter._msgs_out, 1);
+		EvtStatsAdd(counter._bytes_out, framebytes);
+	}
+
+	bool EvtStatsAttachClient(std::uint64_t clientid, bool publish)
+	{
+		std::unique_lock<std::mutex> lock(_evt_stats_clients_lock);
 
-			// if(data.size() == 0 && (!_evt_thread_running.load() || ! _evt_thread_sig.at(socket).load()))
-			if(data.size() == 0)
+		// Reconnecting clients get their old slot back if it was not freed yet
+		std::int64_t slot = -1;
+		const std::uint64_t nslots = _evt_stats_slots.size();
+		for(std::uint64_t i = 0; i < nslots; i++)
+		{
+			const std::uint64_t cid = _evt_stats_slots[i].load();
+			if(cid == clientid)
 			{
+				slot = static_cast<std::int64_t>(i);
 				break;
 			}
-			
-			// TODO: (Cesar): Place the new event on the event stack
-			//  			  For now we just run the event callback from this thread
-			//				  and see how it goes
-			EvtHeader header;
-			std::memcpy(&header, data.data(), sizeof(EvtHeader));
-			std::uint64_t cid = _evt_client_socket_pair.at(socket._handle);
-			LogTrace("[evtserver] Emitting Event <%d> to <0x%llx>.", header.eventid, cid);
-			
-			SocketSendBytes(socket, data.data(), data.size());
 
-			std::uint64_t download = sizeof(EvtHeader) + header.payloadsize;
-			// Hi DWORD
-			download &= 0xFFFFFFFF;
-			download <<= 32;
+			if(cid == 0 && slot < 0)
+			{
+				slot = static_cast<std::int64_t>(i);
+			}
+		}
 
-			if(!ClientIsGhost(cid))
+		if(slot < 0)
+		{
+			// Every slot is taken, add a block
+			if(!_evt_stats_slots.grow())
 			{
-				// Write client statistics
-				EvtAccumulateClientStatistics(cid, download);
+				LogError("[evtserver] No statistics slot left for client <0x%llx> (%llu clients attached).", clientid, nslots);
+				return false;
 			}
+			_evt_stats_clients.resize(_evt_stats_slots.size());
+			slot = static_cast<std::int64_t>(nslots);
+			LogDebug("[evtserver] Statistics slots grown to %llu.", _evt_stats_slots.size());
+		}
 
-			// Write event statistics
-			EvtAccumulateEventStatistics(header.eventid, cid, download);
+		EvtStatsClient& client = _evt_stats_clients[slot];
+		client._publish = publish;
+		client._retired = false;
+		if(publish)
+		{
+			// Built once here instead of every second
+			const std::string root = "/system/backends/" + SysI64ToHexString(clientid) + "/statistics/event";
+			client._read_key = root + "/read";
+			client._write_key = root + "/write";
 		}
+		_evt_stats_slots[slot].store(clientid);
+		return true;
 	}
 
-	bool EvtRegister(string32 name)
+	void EvtStatsDetachClient(std::uint64_t clientid)
 	{
-		std::unique_lock lock(_evt_reg_lock);
-		auto evtrit = _evt_server_reg.find(name.c_str());
-		if(evtrit != _evt_server_reg.end())
+		// The slot is only freed by the stats thread after its last counts were aggregated
+		std::unique_lock<std::mutex> lock(_evt_stats_clients_lock);
+		const std::uint64_t nslots = _evt_stats_slots.size();
+		for(std::uint64_t i = 0; i < nslots; i++)
 		{
-			LogTrace("[evtserver] Cannot register event <%s>. Already exists.", name.c_str());
-			return false;
+			if(_evt_stats_slots[i].load() == clientid)
+			{
+				_evt_stats_clients[i]._retired = true;
+				_evt_stats_clients[i]._publish = false;
+			}
 		}
+	}
 
-		const std::uint16_t event_id = ++_evt_server_reg_next;
-		_evt_current_subscriptions.emplace(event_id, std::set<std::uint64_t>());
-		_evt_server_reg.emplace(name.c_str(), event_id);
+	std::shared_ptr<const EvtStatistics> EvtGetStatistics()
+	{
+		return _evt_stats_snapshot.load();
+	}
 
-		EvtMakeStats(name, event_id);
+	static std::vector<std::uint8_t> EvtBuildMetadata(const EvtStatistics& stats)
+	{
+		// [id i16][name string32][io u64] followed by the per client columns
+		// [clients][frames][depth][dropped][messages] as [size u64][u64 x nclients]
+		// io, frames and messages pack the write side on the lo and the read side on the hi dword
+		std::vector<std::uint8_t> buffer;
+		auto append = [&buffer](const void* data, std::uint64_t size) {
+			const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+			buffer.insert(buffer.end(), bytes, bytes + size);
+		};
+
+		auto pack = [](std::uint64_t lo, std::uint64_t hi) -> std::uint64_t {
+			return (std::min<std::uint64_t>(hi, 0xFFFFFFFF) << 32) | std::min<std::uint64_t>(lo, 0xFFFFFFFF);
+		};
+
+		for(const auto& event : stats._events)
+		{
+			const std::int16_t id = static_cast<std::int16_t>(event._id);
+			const std::uint64_t io = pack(event._bytes_in, event._bytes_out);
+			append(&id, sizeof(std::int16_t));
+			append(&event._name, sizeof(string32));
+			append(&io, sizeof(std::uint64_t));
+
+			const std::uint64_t nbytes = event._edges.size() * sizeof(std::uint64_t);
+			auto column = [&](auto field) {
+				append(&nbytes, sizeof(std::uint64_t));
+				for(const auto& edge : event._edges)
+				{
+					const std::uint64_t value = field(edge);
+					append(&value, sizeof(std::uint64_t));
+				}
+			};
 
-		LogTrace("[evtserver] Registered event <%s> [id=%d].", name.c_str(), event_id);
-		return true;
+			column([](const EvtEdgeStatistics& e) { return e._client; });
+			column([&](const EvtEdgeStatistics& e) { return pack(e._bytes_in, e._bytes_out); });
+			column([](const EvtEdgeStatistics& e) { return e._depth; });
+			column([](const EvtEdgeStatistics& e) { return e._dropped; });
+			column([&](const EvtEdgeStatistics& e) { return pack(e._msgs_in, e._msgs_out); });
+		}
+		return buffer;
 	}
 
-	std::uint16_t EvtGetId(mulex::string32 name)
+	static void EvtAggregateStatistics(const std::vector<EvtStatsQueueSample>& samples)
 	{
-		std::shared_lock lock(_evt_reg_lock);
-		auto evtrit = _evt_server_reg.find(name.c_str());
-		if(evtrit != _evt_server_reg.end())
+		// Slots attached after this point are picked up on the next aggregation
+		const std::uint64_t nslots = _evt_stats_slots.size();
+
+		// Sum the counters of every shard
+		std::map<std::uint16_t, std::vector<EvtStatsTotals>> totals;
 		{
-			return evtrit->second;
+			std::unique_lock<std::mutex> lock(_evt_stats_shards_lock);
+			for(const auto& shard : _evt_stats_shards)
+			{
+				for(std::uint64_t hi = 0; hi < shard->_pages.size(); hi++)
+				{
+					const std::atomic<EvtStatsEventCounters*>* events = shard->_pages[hi].load(std::memory_order_acquire);
+					if(!events)
+					{
+						continue;
+					}
+
+					for(std::uint64_t lo = 0; lo < 256; lo++)
+					{
+						const EvtStatsEventCounters* counters = events[lo].load(std::memory_order_acquire);
+						if(!counters)
+						{
+							continue;
+						}
+
+						std::vector<EvtStatsTotals>& sum = totals[static_cast<std::uint16_t>((hi << 8) | lo)];
+						sum.resize(nslots);
+						for(std::uint64_t slot = 0; slot < nslots; slot++)
+						{
+							const EvtStatsCounter* block = counters->_blocks[slot / EVT_STATS_SLOT_BLOCK].load(std::memory_order_acquire);
+							if(!block)
+							{
+								slot += EVT_STATS_SLOT_BLOCK - 1;
+								continue;
+							}
+
+							const EvtStatsCounter& counter = block[slot % EVT_STATS_SLOT_BLOCK];
+							sum[slot]._msgs_in += counter._msgs_in.load(std::memory_order_relaxed);
+							sum[slot]._bytes_in += counter._bytes_in.load(std::memory_order_relaxed);
+							sum[slot]._msgs_out += counter._msgs_out.load(std::memory_order_relaxed);
+							sum[slot]._bytes_out += counter._bytes_out.load(std::memory_order_relaxed);
+						}
+					}
+				}
+			}
 		}
 
-		LogError("[evtserver] Cannot get event id. Event <%s> is not registered.", name.c_str());
-		return 0;
-	}
+		std::vector<std::uint64_t> clients(nslots);
+		for(std::uint64_t slot = 0; slot < nslots; slot++)
+		{
+			clients[slot] = _evt_stats_slots[slot].load();
+		}
 
-	bool EvtSubscribe(mulex::string32 name)
-	{
-		std::uint16_t eid = EvtGetId(name);
-		std::uint64_t cid = GetCurrentCallerId();
-		if(eid == 0)
+		std::map<std::uint16_t, std::string> names;
 		{
-			LogError("[evtserver] Cannot subscribe to event <%s>.", name.c_str());
-			return false;
+			std::shared_lock lock(_evt_reg_lock);
+			for(const auto& reg : _evt_server_reg) names.emplace(reg.second, reg.first);
 		}
 
-		if(cid == 0)
+		// Rates are the difference to the previous totals
+		std::shared_ptr<EvtStatistics> stats = std::make_shared<EvtStatistics>();
+		std::vector<EvtStatsTotals> perclient(nslots);
+		stats->_events.reserve(names.size());
+		for(const auto& [eventid, name] : names)
 		{
-			LogError("[evtserver] Mxserver cannot manually subscribe to events.");
-			return false;
+			EvtEventStatistics event;
+			event._id = eventid;
+			event._name = name;
+
+			std::vector<EvtStatsTotals>& prev = _evt_stats_prev[eventid];
+			prev.resize(nslots);
+			auto current = totals.find(eventid);
+			const EvtSubscriptionTable::Subscribers* subscribers = EvtGetSubscribers(eventid);
+
+			for(std::uint64_t slot = 0; slot < nslots; slot++)
+			{
+				EvtEdgeStatistics edge;
+				if(current != totals.end())
+				{
+					const EvtStatsTotals& now = current->second[slot];
+					edge._msgs_in = now._msgs_in - prev[slot]._msgs_in;
+					edge._bytes_in = now._bytes_in - prev[slot]._bytes_in;
+					edge._msgs_out = now._msgs_out - prev[slot]._msgs_out;
+					edge._bytes_out = now._bytes_out - prev[slot]._bytes_out;
+					prev[slot] = { now._msgs_in, now._bytes_in, now._msgs_out, now._bytes_out, prev[slot]._active };
+				}
+
+				edge._client = clients[slot];
+				if(edge._client == 0)
+				{
+					continue;
+				}
+
+				prev[slot]._active |= (edge._msgs_in > 0);
+				const bool subscribed = subscribers && subscribers->contains(edge._client);
+				if(!subscribed && !prev[slot]._active)
+				{
+					continue;
+				}
+
+				event._msgs_in += edge._msgs_in;
+				event._bytes_in += edge._bytes_in;
+				event._msgs_out += edge._msgs_out;
+				event._bytes_out += edge._bytes_out;
+				perclient[slot]._bytes_in += edge._bytes_in;
+				perclient[slot]._bytes_out += edge._bytes_out;
+				event._edges.push_back(edge);
+			}
+			stats->_events.push_back(std::move(event));
 		}
 
-		std::unique_lock<std::mutex> lock(_evt_sub_lock);
-		std::unique_lock<std::mutex> lock_stats(_evt_event_stats_lock);
-		_evt_current_subscriptions.at(eid).insert(cid);
+		for(const auto& sample : samples)
+		{
+			auto event = std::find_if(stats->_events.begin(), stats->_events.end(), [&sample](const auto& e) { return e._id == sample._eventid; });
+			if(event == stats->_events.end())
+			{
+				continue;
+			}
 
-		EvtMakeStatsEntry(eid, cid);
+			auto edge = std::find_if(event->_edges.begin(), event->_edges.end(), [&sample](const auto& e) { return e._client == sample._client; });
+			if(edge != event->_edges.end())
+			{
+				edge->_depth = sample._depth;
+				edge->_dropped = sample._dropped;
+			}
+		}
 
-		LogTrace("[evtserver] Subscribed <0x%llx> to event <%s> [id=%d].", cid, name.c_str(), eid);
-		return true;
-	}
+		stats->_metadata = EvtBuildMetadata(*stats);
+		_evt_stats_snapshot.store(std::move(stats));
 
-	void EvtServerRegisterCallback(
-		mulex::string32 name,
-		std::function<void(const Socket&, std::uint64_t, std::uint16_t, const std::uint8_t*, std::uint64_t)> callback
-	)
-	{
-		std::uint16_t eid = EvtGetId(name);
-		if(eid == 0)
+		// Client totals go to the rdb with the keys cached on attach
+		std::unique_lock<std::mutex> lock(_evt_stats_clients_lock);
+		for(std::uint64_t slot = 0; slot < nslots; slot++)
 		{
-			return;
+			EvtStatsClient& client = _evt_stats_clients[slot];
+			if(client._publish && clients[slot] != 0 && _evt_stats_slots[slot].load() == clients[slot])
+			{
+				RdbWriteValueDirect(client._read_key, static_cast<std::uint32_t>(std::min<std::uint64_t>(perclient[slot]._bytes_out, 0xFFFFFFFF)));
+				RdbWriteValueDirect(client._write_key, static_cast<std::uint32_t>(std::min<std::uint64_t>(perclient[slot]._bytes_in, 0xFFFFFFFF)));
+			}
+
+			if(client._retired)
+			{
+				// All of the counts of the client were aggregated, the slot can be reused
+				client._retired = false;
+				_evt_stats_slots[slot].store(0);
+				for(auto& [eventid, prev] : _evt_stats_prev)
+				{
+					if(slot < prev.size()) prev[slot]._active = false;
+				}
+			}
 		}
-		std::unique_lock lock(_evt_server_callback_lock);
-		_evt_server_callbacks.insert_or_assign(eid, callback);
 	}
 
-	void EvtTryRunServerCallback(std::uint64_t clientid, std::uint16_t eventid, const std::uint8_t* data, std::uint64_t len, const Socket& socket)
+	void EvtServerThread::decimationThread()
 	{
-		std::unique_lock lock(_evt_server_callback_lock);
-		auto eidit = _evt_server_callbacks.find(eventid);
-		if(eidit != _evt_server_callbacks.end())
+		while(_evt_thread_running.load())
 		{
-			eidit->second(socket, clientid, eventid, data, len);
+			std::this_thread::sleep_for(std::chrono::milliseconds(EVT_DECIMATION_TICK));
+			if(_evt_held_windows.load(std::memory_order_relaxed) == 0)
+			{
+				continue;
+			}
+
+			std::vector<std::shared_ptr<EvtSubscriberQueue>> queues;
+			{
+				std::unique_lock<std::mutex> lock(_evt_emit_queue_mutex);
+				for(const auto& queue : _evt_emit_queue)
+				{
+					queues.push_back(queue.second);
+				}
+			}
+
+			const std::uint64_t now = SysGetMonotonicNs();
+			for(const auto& queue : queues)
+			{
+				if(queue->flushWindows(now) && _evt_reactor)
+				{
+					pumpReactorQueue(queue);
+				}
+			}
 		}
 	}
 
@@ -846,236 +3701,236 @@ namespace mulex
 		{
 			std::int64_t start = SysGetCurrentTime();
 
+			// Snapshot the subscriber queues to export their depth and drops
+			std::vector<std::pair<std::uint64_t, std::shared_ptr<EvtSubscriberQueue>>> queues;
 			{
-				std::unique_lock<std::mutex> lock(_evt_client_stats_lock);
-				for(auto it = _evt_client_stats.begin(); it != _evt_client_stats.end(); it++)
+				std::unique_lock<std::mutex> lock(_evt_emit_queue_mutex);
+				for(const auto& queue : _evt_emit_queue)
 				{
-					std::uint64_t stats = it->second.exchange(0);
-					std::uint32_t upload = static_cast<std::uint32_t>(stats & 0xFFFFFFFF);
-					std::uint32_t download = static_cast<std::uint32_t>(stats >> 32);
-
-					std::string key = "/system/backends/";
-					key += SysI64ToHexString(it->first);
-					key += "/statistics/event";
-
-					// TODO: (Cesar) Entry is always valid here (skip checks)
-					//				 Have some write unsafe kind of function
-					RdbWriteValueDirect(key + "/read", download);
-					RdbWriteValueDirect(key + "/write", upload);
+					auto cidit = _evt_client_socket_pair.find(queue.first._handle);
+					if(cidit != _evt_client_socket_pair.end())
+					{
+						queues.emplace_back(cidit->second, queue.second);
+					}
 				}
 			}
 
+			std::vector<EvtStatsQueueSample> samples;
+			for(const auto& [cid, queue] : queues)
 			{
-				std::unique_lock<std::mutex> lock(_evt_event_stats_lock);
+				queue->statistics([&samples, cid](std::uint16_t eventid, std::uint64_t depth, std::uint64_t dropped) {
+					samples.push_back({ cid, eventid, depth, dropped });
+				});
+			}
 
-				// Copy event stats
-				{
-					std::unique_lock<std::mutex> slock(_evt_event_stats_buffer_lock);
-					_evt_event_stats_buffer = _evt_event_stats;
-				}
+			EvtAggregateStatistics(samples);
 
-				// Clear event stats
-				for(std::uint16_t i = 1; i <= _evt_event_stats._len; i++)
-				{
-					// Reset stats for next frame
-					EvtResetStatistics(i);
-				}
-			}
+			// Mirror the latency percentiles of traced events
+			EvtMirrorLatencyRdb();
 
 			// Every second
 			std::this_thread::sleep_for(std::chrono::milliseconds(1000 - ((SysGetCurrentTime() - start))));
 		}
 	}
 
-	void EvtAccumulateClientStatistics(std::uint64_t clientid, std::uint64_t framebytes)
-	{
-		_evt_client_stats[clientid] += framebytes; // Atomic op
-	}
-
-	void EvtAccumulateEventStatistics(std::uint16_t eventid, std::uint64_t clientid, std::uint64_t framebytes, bool create)
+	mulex::RPCGenericType EvtGetAllRegisteredEvents()
 	{
-		if(eventid > _evt_event_stats._len)
+		std::shared_lock lock(_evt_reg_lock);
+		std::vector<mxstring<512>> output;
+		output.reserve(_evt_server_reg.size());
+		for(const auto& reg : _evt_server_reg)
 		{
-			LogError("[mxevt] EvtAccumulateEventStatistics failed unexpectedly due to an index error.");
-			return;
+			output.push_back(reg.first);
 		}
+		return output;
+	}
 
-		const std::uint16_t event_index = eventid - 1;
-
-		_evt_event_stats._total_frames[event_index] += framebytes;
+	mulex::RPCGenericType EvtGetAllMetadata()
+	{
+		return EvtGetStatistics()->_metadata;
+	}
 
-		// Assuming the ammount of subscriptions is relatively low < 100
-		// One could say that searching an array is faster than using an stl map
-		
-		auto it = std::find(_evt_event_stats._clients[event_index].begin(), _evt_event_stats._clients[event_index].end(), clientid);
-		if(it == _evt_event_stats._clients[event_index].end())
-		{
-			if(create)
+	mulex::RPCGenericType EvtGetLatencyStats()
+	{
+		std::vector<EvtLatencyEntry> output;
+		auto append = [&output](std::uint64_t producer, std::uint64_t consumer, std::uint16_t eventid, const EvtTraceHistograms& hists) {
+			for(std::uint8_t stage = 0; stage < hists.size(); stage++)
 			{
-				EvtMakeStatsEntry(eventid, clientid);
-				it = std::find(_evt_event_stats._clients[event_index].begin(), _evt_event_stats._clients[event_index].end(), clientid);
-				if(it == _evt_event_stats._clients[event_index].end())
+				const SysLatencyHistogram& hist = hists[stage];
+				if(hist.count() > 0)
 				{
-					LogError("[mxevt] Stats entry for [<%d>, <0x%llx>] could not be created.", eventid, clientid);
-					return;
+					output.push_back({ producer, consumer, hist.count(), hist.percentile(50.0), hist.percentile(90.0), hist.percentile(99.0), hist.percentile(99.9), hist.max(), eventid, static_cast<EvtTraceStage>(stage) });
 				}
 			}
+		};
 
-			LogError("[mxevt] Failed to accumulate event statistics for event <%d>. Client <0x%llx> not found.", eventid, clientid);
-			return;
+		std::unique_lock<std::mutex> lock(_evt_trace_lock);
+		for(const auto& [eventid, hists] : _evt_trace_events)
+		{
+			append(0, 0, eventid, hists);
 		}
 
-		auto index = std::distance(_evt_event_stats._clients[event_index].begin(), it);
-		_evt_event_stats._frames[event_index][index] += framebytes;
+		for(const auto& [key, hists] : _evt_trace_pairs)
+		{
+			append(std::get<0>(key), std::get<1>(key), std::get<2>(key), hists);
+		}
+		return output;
 	}
 
-	void EvtResetStatistics(std::uint16_t eventid)
+	bool EvtSetRetention(mulex::string32 name, std::uint32_t count)
 	{
-		if(eventid > _evt_event_stats._len)
+		std::uint16_t eid = EvtGetId(name);
+		if(eid == 0)
 		{
-			LogError("[mxevt] EvtAccumulateEventStatistics failed unexpectedly due to an index error.");
-			return;
+			LogError("[evtserver] Cannot retain event <%s>.", name.c_str());
+			return false;
 		}
 
-		const std::uint16_t event_index = eventid - 1;
-
-		_evt_event_stats._total_frames[event_index] = 0;
-		for(auto& cf : _evt_event_stats._frames[event_index]) cf = 0;
-	}
-
-	void EvtMakeStats(const mulex::string32& name, std::uint16_t eventid)
-	{
-		std::unique_lock lock(_evt_event_stats_lock);
+		if(count > EVT_RETAIN_MAX_COUNT)
+		{
+			LogError("[evtserver] Cannot retain more than %u events of <%s>.", EVT_RETAIN_MAX_COUNT, name.c_str());
+			return false;
+		}
 
-		if(eventid <= _evt_event_stats._len)
+		std::unique_lock<std::mutex> lock(_evt_sub_lock);
+		if(count == 0)
 		{
-			// Event already in stats
-			return;
+			_evt_retention.erase(eid);
 		}
+		else
+		{
+			std::shared_ptr<EvtRetention>& retention = _evt_retention[eid];
+			if(!retention)
+			{
+				retention = std::make_shared<EvtRetention>();
+			}
 
-		_evt_event_stats._len++;
-		_evt_event_stats._name.push_back(name);
-		_evt_event_stats._total_frames.push_back(0);
-		_evt_event_stats._clients.push_back(std::vector<std::uint64_t>());
-		_evt_event_stats._frames.push_back(std::vector<std::uint64_t>());
+			std::unique_lock<std::mutex> rlock(retention->_lock);
+			retention->_count = count;
+			EvtTrimRetention(*retention);
+		}
+		EvtPublishSubscribers(eid);
 
-		LogTrace("[mxevt] Made stats vector for event <%d>.", eventid);
+		LogTrace("[evtserver] Retaining the last %u events of <%s>.", count, name.c_str());
+		return true;
 	}
 
-	void EvtMakeStatsEntry(std::uint16_t eventid, std::uint64_t clientid)
+	mulex::RPCGenericType EvtFetchRetained(mulex::string32 name)
 	{
-		std::uint16_t i = eventid - 1;
-		auto it = std::find(_evt_event_stats._clients[i].begin(), _evt_event_stats._clients[i].end(), clientid);
-		if(it == _evt_event_stats._clients[i].end())
+		std::vector<std::uint8_t> output;
+		std::shared_ptr<EvtRetention> retention;
+		const std::uint16_t eid = EvtGetId(name);
 		{
-			LogTrace("[mxevt] Adding event stats entry for event - client pair [<%d>, <0x%llx>].", eventid, clientid);
-			_evt_event_stats._clients[i].push_back(clientid);
-			_evt_event_stats._frames[i].push_back(0);
+			std::unique_lock<std::mutex> lock(_evt_sub_lock);
+			auto retit = _evt_retention.find(eid);
+			if(retit == _evt_retention.end())
+			{
+				return output;
+			}
+			retention = retit->second;
 		}
-	}
 
-	void EvtDeleteStatsEntry(std::uint16_t eventid, std::uint64_t clientid)
-	{
-		std::uint16_t i = eventid - 1;
-		auto it = std::find(_evt_event_stats._clients[i].begin(), _evt_event_stats._clients[i].end(), clientid);
-		if(it != _evt_event_stats._clients[i].end())
+		std::unique_lock<std::mutex> lock(retention->_lock);
+		for(const std::vector<SysRefBuffer>& event : retention->_events)
 		{
-			LogTrace("[mxevt] Removing event stats entry for event - client pair [<%d>, <%llx>].", eventid, clientid);
-			std::uint64_t dist = std::distance(_evt_event_stats._clients[i].begin(), it);
-			_evt_event_stats._clients[i].erase(it);
-			_evt_event_stats._frames[i].erase(_evt_event_stats._frames[i].begin() + dist);
+			std::uint64_t size = 0;
+			for(const SysRefBuffer& frame : event)
+			{
+				size += frame.size() - sizeof(EvtHeader);
+			}
+
+			std::uint64_t offset = output.size();
+			output.resize(offset + sizeof(std::uint64_t) + size);
+			offset = EvtDataAppend(offset, &output, size);
+			for(const SysRefBuffer& frame : event)
+			{
+				std::memcpy(output.data() + offset, frame.data() + sizeof(EvtHeader), frame.size() - sizeof(EvtHeader));
+				offset += frame.size() - sizeof(EvtHeader);
+			}
 		}
+		return output;
 	}
 
-	void EvtPurgeStatsEntryClient(std::uint64_t clientid)
+	bool EvtRecordStartAt(const std::string& dir, const std::vector<std::string>& events)
 	{
-		for(std::uint64_t i = 0; i < _evt_event_stats._len; i++)
+		if(!JournalWriter::Supported())
 		{
-			EvtDeleteStatsEntry(static_cast<std::uint16_t>(i + 1), clientid);
+			LogError("[evtserver] Event recording is not supported on this system.");
+			return false;
 		}
-	}
-
-	std::uint64_t EvtCalculateStatisticsBufferSize()
-	{
-		// NOTE: (Cesar) Needs to be called in a buffer locked scope
-		std::uint64_t size = 0;
-		size += _evt_event_stats_buffer._len * sizeof(std::int16_t);
-		size += _evt_event_stats_buffer._len * sizeof(string32);
-		size += _evt_event_stats_buffer._len * sizeof(std::uint64_t);
-		size += _evt_event_stats_buffer._len * sizeof(std::uint64_t) * 2;
-		size += std::accumulate(
-			_evt_event_stats_buffer._clients.begin(),
-			_evt_event_stats_buffer._clients.end(),
-			0ULL, [](auto sum, const auto& c){ return sum + c.size(); }
-		) * sizeof(std::uint64_t);
-		size += std::accumulate(
-			_evt_event_stats_buffer._frames.begin(),
-			_evt_event_stats_buffer._frames.end(),
-			0ULL, [](auto sum, const auto& c){ return sum + c.size(); }
-		) * sizeof(std::uint64_t);
-		return size;
-	}
 
-	mulex::RPCGenericType EvtGetAllRegisteredEvents()
-	{
-		std::shared_lock lock(_evt_reg_lock);
-		std::vector<mxstring<512>> output;
-		output.reserve(_evt_server_reg.size());
-		for(const auto& reg : _evt_server_reg)
+		std::unique_lock lock(_evt_recorder_lock);
+		if(_evt_recorder)
 		{
-			output.push_back(reg.first);
+			LogError("[evtserver] Cannot start recording. Already recording to <%s>.", _evt_recorder->_journal->dir().c_str());
+			return false;
 		}
-		return output;
-	}
-
-	static std::uint8_t* EvtPopulateMetadataBuffer(std::uint16_t eventid, std::uint8_t* data)
-	{
-		// NOTE: (Cesar) Needs to be called in a buffer locked scope
-
-		// Copy id
-		std::int16_t i = eventid - 1;
-		std::memcpy(data, &eventid, sizeof(std::int16_t));
-		data += sizeof(std::int16_t);
 
-		// Copy name
-		std::memcpy(data, &_evt_event_stats_buffer._name[i], sizeof(string32));
-		data += sizeof(string32);
+		std::unique_ptr<EvtRecorder> recorder = std::make_unique<EvtRecorder>();
+		recorder->_journal = JournalWriter::Create(dir);
+		if(!recorder->_journal)
+		{
+			LogError("[evtserver] Failed to create journal at <%s>.", dir.c_str());
+			return false;
+		}
+		recorder->_names.insert(events.begin(), events.end());
+		recorder->_events.resize(UINT16_MAX + 1, recorder->_names.empty());
 
-		// Copy total frames
-		std::memcpy(data, &_evt_event_stats_buffer._total_frames[i], sizeof(std::uint64_t));
-		data += sizeof(std::uint64_t);
+		{
+			std::shared_lock lock_reg(_evt_reg_lock);
+			for(const auto& [name, eventid] : _evt_server_reg)
+			{
+				recorder->_journal->name(eventid, name);
+				if(recorder->_names.contains(name))
+				{
+					recorder->_events[eventid] = true;
+				}
+			}
+		}
 
-		// Copy nclientbytes
-		std::uint64_t nclientbytes = _evt_event_stats_buffer._clients[i].size() * sizeof(std::uint64_t);
-		std::memcpy(data, &nclientbytes, sizeof(std::uint64_t));
-		data += sizeof(std::uint64_t);
+		_evt_recorder = std::move(recorder);
+		_evt_recording.store(true);
+		LogMessage("[evtserver] Recording %s to <%s>.", events.empty() ? "all events" : "events", dir.c_str());
+		return true;
+	}
 
-		// Copy clients
-		std::memcpy(data, _evt_event_stats_buffer._clients[i].data(), nclientbytes);
-		data += nclientbytes;
+	bool EvtRecordStart(mulex::string128 name, mulex::RPCGenericType events)
+	{
+		const std::string jname = name.c_str();
+		if(jname.empty() || jname.find('/') != std::string::npos || jname.find('\\') != std::string::npos || jname == "." || jname == "..")
+		{
+			LogError("[evtserver] Invalid journal name <%s>.", jname.c_str());
+			return false;
+		}
 
-		// Copy nframebytes
-		std::memcpy(data, &nclientbytes, sizeof(std::uint64_t));
-		data += sizeof(std::uint64_t);
+		const std::string exphome = SysGetExperimentHome();
+		if(exphome.empty())
+		{
+			return false;
+		}
 
-		// Copy frames
-		std::memcpy(data, _evt_event_stats_buffer._frames[i].data(), nclientbytes);
-		data += nclientbytes;
-		return data;
+		std::vector<std::string> names;
+		for(const string32& event : events.asVectorType<string32>())
+		{
+			names.push_back(event.c_str());
+		}
+		return EvtRecordStartAt(exphome + "/.storage/journal/" + jname, names);
 	}
 
-	mulex::RPCGenericType EvtGetAllMetadata()
+	void EvtRecordStop()
 	{
-		std::unique_lock lock(_evt_event_stats_buffer_lock);
-		std::vector<std::uint8_t> result;
-		result.resize(EvtCalculateStatisticsBufferSize());
-		std::uint8_t* data = result.data();
-		for(std::int16_t i = 1; i <= static_cast<std::int16_t>(_evt_event_stats_buffer._len); i++)
+		_evt_recording.store(false);
+
+		std::unique_ptr<EvtRecorder> recorder;
 		{
-			data = EvtPopulateMetadataBuffer(i, data);
+			std::unique_lock lock(_evt_recorder_lock);
+			recorder = std::move(_evt_recorder);
 		}
 
-		return result;
+		if(recorder)
+		{
+			LogMessage("[evtserver] Recorded %llu events (%llu bytes) to <%s>.", recorder->_journal->records(), recorder->_journal->bytes(), recorder->_journal->dir().c_str());
+		}
 	}
 
 	bool EvtUnsubscribe(mulex::string32 name)
@@ -1108,10 +3963,8 @@ namespace mulex
 			return false;
 		}
 
-		std::unique_lock<std::mutex> lock_stats(_evt_event_stats_lock);
-		EvtDeleteStatsEntry(eventid, clientid);
-		
 		eidit->second.erase(clientid);
+		EvtPublishSubscribers(eventid);
 		LogTrace("[evtserver] Unsubscribing client <0x%llx> from event <%d>.", clientid, eventid);
 		return true;
 	}
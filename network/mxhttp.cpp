@@ -190,7 +190,7 @@ namespace mulex
 	}
 
 	template<std::default_initializable T>
-	static T HttpTryGetEntry(const rapidjson::Document& d, const std::string& key, bool* error)
+	static T HttpTryGetEntry(const rapidjson::Value& d, const std::string& key, bool* error)
 	{
 		ZoneScoped;
 		if(error) *error = false;
@@ -236,6 +236,16 @@ namespace mulex
 				}
 				return d[key.c_str()].GetInt64();
 			}
+			else if constexpr(std::is_same_v<T, double>)
+			{
+				if(d[key.c_str()].GetType() != rapidjson::Type::kNumberType)
+				{
+					LogError("[mxhttp] HttpTryGetEntry: Found key <%s>. But is of incorrect type. Expected Number.", key.c_str());
+					if(error) *error = true;
+					return T();
+				}
+				return d[key.c_str()].GetDouble();
+			}
 			else if constexpr(std::is_same_v<T, bool>)
 			{
 				if(d[key.c_str()].GetType() != rapidjson::Type::kTrueType && d[key.c_str()].GetType() != rapidjson::Type::kFalseType)
@@ -553,26 +563,52 @@ namespace mulex
 	}
 
 	// tuple -> (opcode, eventname)
-	static std::tuple<std::uint8_t, std::string> HttpGetEVTMessage(const rapidjson::Document& d, bool* error)
+	static std::tuple<std::uint8_t, std::string, EvtSubscriptionPolicy> HttpGetEVTMessage(const rapidjson::Document& d, bool* error)
 	{
 		if(error) *error = false;
 
 		std::string eventname = HttpTryGetEntry<std::string>(d, "event", error);
 		if(error && *error)
 		{
-			return std::make_tuple<std::uint8_t, std::string>(0, {});
+			return std::make_tuple<std::uint8_t, std::string, EvtSubscriptionPolicy>(0, {}, {});
 		}
 
 		std::uint8_t opcode = HttpTryGetEntry<std::uint8_t>(d, "opcode", error);
 		if(error && *error)
 		{
-			return std::make_tuple<std::uint8_t, std::string>(0, {});
+			return std::make_tuple<std::uint8_t, std::string, EvtSubscriptionPolicy>(0, {}, {});
 		}
 
-		return std::make_tuple(opcode, eventname);
+		// Optional rate limiting for the subscription (plots rarely need more than a few tens of Hz)
+		// The latest frame is what matters for a tab so the queue conflates if a rate is given
+		EvtSubscriptionPolicy policy;
+		if(d.HasMember("rate"))
+		{
+			policy._policy = EvtDeliveryPolicy::CONFLATE;
+			policy._max_rate = static_cast<float>(HttpTryGetEntry<double>(d, "rate", error));
+			if(d.HasMember("decimation") && !(error && *error))
+			{
+				policy._decimation = static_cast<EvtDecimation>(HttpTryGetEntry<std::uint8_t>(d, "decimation", error));
+			}
+			if(d.HasMember("sample") && !(error && *error))
+			{
+				policy._sample_type = static_cast<EvtSampleType>(HttpTryGetEntry<std::uint8_t>(d, "sample", error));
+			}
+			if(d.HasMember("nth") && !(error && *error))
+			{
+				policy._decimation_param = static_cast<std::uint32_t>(HttpTryGetEntry<std::uint64_t>(d, "nth", error));
+			}
+
+			if(error && *error)
+			{
+				return std::make_tuple<std::uint8_t, std::string, EvtSubscriptionPolicy>(0, {}, {});
+			}
+		}
+
+		return std::make_tuple(opcode, eventname, policy);
 	}
 
-	static std::tuple<std::uint16_t, std::vector<std::uint8_t>, std::uint64_t, bool> HttpGetRPCMessage(const rapidjson::Document& d, bool* error)
+	static std::tuple<std::uint16_t, std::vector<std::uint8_t>, std::uint64_t, bool> HttpGetRPCMessage(const rapidjson::Value& d, bool* error)
 	{
 		ZoneScoped;
 		// If we want to use native types we should get someway of getting the RPC server side types
@@ -656,6 +692,51 @@ namespace mulex
 		return buffer.GetString();
 	}
 
+	struct HttpRPCBatchReply
+	{
+		std::uint64_t 			  _messageid;
+		const char* 			  _status;
+		std::vector<std::uint8_t> _response;
+	};
+
+	// NOTE: (Cesar) One ws message for the whole batch
+	// 				 Every result has the same layout as a single rpc reply
+	static std::string HttpMakeWSRPCBatchMessage(const std::vector<HttpRPCBatchReply>& replies)
+	{
+		ZoneScoped;
+		rapidjson::Document d;
+		rapidjson::StringBuffer buffer;
+		rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+
+		d.SetObject();
+		rapidjson::Document::AllocatorType& allocator = d.GetAllocator();
+		rapidjson::Value results(rapidjson::kArrayType);
+		for(const auto& reply : replies)
+		{
+			rapidjson::Value entry(rapidjson::kObjectType);
+			if(!reply._response.empty())
+			{
+				rapidjson::Value output(rapidjson::kArrayType);
+				for(const auto& byte : reply._response)
+				{
+					output.PushBack(rapidjson::Value().SetInt(byte), allocator);
+				}
+				entry.AddMember("response", output, allocator);
+			}
+			entry.AddMember("status", rapidjson::StringRef(reply._status), allocator);
+			entry.AddMember("type", rapidjson::StringRef("rpc"), allocator);
+			entry.AddMember("messageid", reply._messageid, allocator);
+			results.PushBack(entry, allocator);
+		}
+
+		d.AddMember("type", rapidjson::StringRef("rpc_batch"), allocator);
+		d.AddMember("results", results, allocator);
+
+		d.Accept(writer);
+
+		return buffer.GetString();
+	}
+
 	static std::string HttpMakeWSEVTMessage(const std::vector<std::uint8_t>& ret, const std::string& eventname)
 	{
 		ZoneScoped;
@@ -720,14 +801,13 @@ namespace mulex
 		});
 	}
 
-	static void HttpSubscribeEvent(UWSType* ws, const std::string& event)
+	static void HttpSubscribeEvent(UWSType* ws, const std::string& event, const EvtSubscriptionPolicy& policy)
 	{
 		ZoneScoped;
 		// See if this event exists
 		WsRpcBridge* bridge = ws->getUserData();
 		auto& evtclient = bridge->_local_experiment._evt_client;
-		std::uint16_t eid = evtclient->findEvent(event);
-		if(eid == 0)
+		if(!evtclient->findEvent(event).valid())
 		{
 			LogError("[mxhttp] Failed to subscribe to event. IPC event <%s> does not exist.", event.c_str());
 			return;
@@ -735,7 +815,7 @@ namespace mulex
 
 		evtclient->subscribe(event, [ws, event](auto* data, auto len, auto* userdata) {
 			HttpSendEvent(ws, event, data, len);
-		});
+		}, policy);
 
 		LogTrace("[mxhttp] HttpSubscribeEvent() OK.");
 	}
@@ -941,7 +1021,7 @@ namespace mulex
 				}
 				else if(type == 1) // Evt subscription/unsubscription
 				{
-					const auto [opcode, event] = HttpGetEVTMessage(doc, &parse_error);
+					const auto [opcode, event, policy] = HttpGetEVTMessage(doc, &parse_error);
 					if(parse_error)
 					{
 						// Parse error, ignore this message
@@ -950,7 +1030,7 @@ namespace mulex
 
 					if(opcode == 0) // subscribe
 					{
-						HttpSubscribeEvent(ws, event);
+						HttpSubscribeEvent(ws, event, policy);
 					}
 					else if(opcode == 1) // unsubscribe
 					{
@@ -961,6 +1041,76 @@ namespace mulex
 						LogError("[mxhttp] Urecognized event opcode <%d>.", opcode);
 					}
 				}
+				else if(type == 2) // RPC batch
+				{
+					if(!doc.HasMember("calls") || !doc["calls"].IsArray())
+					{
+						LogError("[mxhttp] RPC batch requires a 'calls' array.");
+						return;
+					}
+
+					// Run every permitted call in a single rpc frame
+					RPCBatch batch;
+					std::vector<HttpRPCBatchReply> replies;
+					std::vector<std::pair<std::uint64_t, bool>> slots; // (batch index, expects result)
+					std::vector<std::uint64_t> queued; // Replies of the calls that went in the batch
+					for(const auto& call : doc["calls"].GetArray())
+					{
+						// NOTE: (Cesar) A malformed entry must not hold back the others coalesced with it
+						// 				 It gets an error reply of its own if its messageid can still be read
+						if(!call.IsObject())
+						{
+							LogError("[mxhttp] RPC batch entries must be objects. Skipping entry.");
+							continue;
+						}
+
+						const auto [procedureid, args, messageidws, exresult] = HttpGetRPCMessage(call, &parse_error);
+						if(parse_error)
+						{
+							if(call.HasMember("messageid") && call["messageid"].IsUint64())
+							{
+								replies.push_back({ call["messageid"].GetUint64(), "PARSE_ERROR", {} });
+								slots.emplace_back(0, false);
+							}
+							continue;
+						}
+
+						if(!PdbCheckMethodPermissions(procedureid, bridge->_user_permissions))
+						{
+							replies.push_back({ messageidws, "NO_PERM", {} });
+							slots.emplace_back(0, false);
+							continue;
+						}
+
+						replies.push_back({ messageidws, "OK", {} });
+						slots.emplace_back(batch.add(procedureid, args), exresult);
+						queued.push_back(replies.size() - 1);
+					}
+
+					if(!batch.empty())
+					{
+						// A rejected or failed batch has no results at all
+						RPCBatchResult result = bridge->_local_experiment._rpc_client->callBatch(batch).get();
+						for(const std::uint64_t i : queued)
+						{
+							if(slots[i].first >= result.size())
+							{
+								replies[i]._status = "FAILED";
+							}
+							else if(slots[i].second)
+							{
+								replies[i]._response = result.raw(slots[i].first);
+							}
+						}
+					}
+
+					if(replies.empty())
+					{
+						return;
+					}
+
+					ws->send(HttpMakeWSRPCBatchMessage(replies));
+				}
 				else
 				{
 					LogError("[mxhttp] Urecognized message type <%d>.", type);
@@ -553,9 +553,11 @@ class RPCGenerator:
                            'trivially copyable. But is of type: '
                            f'{arg.typename.fulltypename}");\n')
             # We require args, nullptr guard
-            self._write_indented(4, 'if(!args) return {};\n')
+            self._write_indented(4, 'if(!args) return;\n')
 
         # Argument offsets
+        # mxstring arguments are length prefixed so SysWireSize reads their size
+        # from the payload (for every other type it is still sizeof)
         if len(method.args) > 1:
             for i, arg in enumerate(method.args[:-1]):
                 if i == 0:
@@ -563,82 +565,61 @@ class RPCGenerator:
                         self._write_indented(
                             4,
                             'const std::uint64_t o1 = '
-                            f'*reinterpret_cast<const std::uint64_t*>(args) + sizeof(std::uint64_t);\n'
+                            f'mulex::SysWireRead<std::uint64_t>(args) + sizeof(std::uint64_t);\n'
                         )
                     else:
                         self._write_indented(
                             4,
-                            'constexpr std::uint64_t o1 = '
-                            f'sizeof({arg.typename.fulltypename});\n'
+                            'const std::uint64_t o1 = '
+                            f'mulex::SysWireSize<{arg.typename.fulltypename}>(args);\n'
                         )
                 else:
                     if arg.typename.is_generic():
                         self._write_indented(
                             4,
                             f'const std::uint64_t o{i + 1} = o{i} + '
-                            f'*reinterpret_cast<const std::uint64_t*>(args + o{i}) + sizeof(std::uint64_t);\n'
+                            f'mulex::SysWireRead<std::uint64_t>(args + o{i}) + sizeof(std::uint64_t);\n'
                         )
                     else:
                         self._write_indented(
                             4,
-                            f'constexpr std::uint64_t o{i + 1} = o{i} + '
-                            f'sizeof({arg.typename.fulltypename});\n'
+                            f'const std::uint64_t o{i + 1} = o{i} + '
+                            f'mulex::SysWireSize<{arg.typename.fulltypename}>(args + o{i});\n'
                         )
 
-        # Return type (except void and generic)
-        if not ret_is_void and not ret_is_gene:
-            self._write_indented(
-                4, 'retbuf.resize(sizeof('
-                   f'{method.rettype.fulltypename}));\n'
-            )
-            self._write_indented(
-                4, f'{method.rettype.fulltypename}* r = '
-                   f'reinterpret_cast<{method.rettype.fulltypename}*>'
-                   '(retbuf.data());\n'
-            )
-
         # Invokes the copy constructor
         if ret_is_void:
             self._write_indented(4, f'{method.fullname}(')
         elif ret_is_gene:
             self._write_indented(4, f'mulex::RPCGenericType r = {method.fullname}(')
         else:
-            self._write_indented(4, f'*r = {method.fullname}(')
+            self._write_indented(4, f'const {method.rettype.fulltypename} r = {method.fullname}(')
         if len(method.args) > 0:
             self._write_indented(0, '\n')
             for i, arg in enumerate(method.args):
-                # Appropriately set the const keyword
-                constkw = ''
-                if 'const' not in arg.typename.fulltypename:
-                    constkw = 'const '
-
                 if i == 0:
                     if arg.typename.is_generic():
                         self._write_indented(
                             5,
                             'mulex::RPCGenericType::FromData(args + sizeof(std::uint64_t), '
-                            '*reinterpret_cast<const std::uint64_t*>(args))'
+                            'mulex::SysWireRead<std::uint64_t>(args))'
                         )
                     else:
                         self._write_indented(
                             5,
-                            '*reinterpret_cast<'
-                            f'{constkw}{arg.typename.fulltypename}'
-                            '*>(args)'
+                            f'mulex::SysWireRead<{arg.typename.fulltypename}>(args)'
                         )
                 else:
                     if arg.typename.is_generic():
                         self._write_indented(
                             5,
                             f'mulex::RPCGenericType::FromData(args + o{i} + sizeof(std::uint64_t), '
-                            f'*reinterpret_cast<const std::uint64_t*>(args + o{i}))'
+                            f'mulex::SysWireRead<std::uint64_t>(args + o{i}))'
                         )
                     else:
                         self._write_indented(
                             5,
-                            '*reinterpret_cast<'
-                            f'{constkw}{arg.typename.fulltypename}'
-                            f'*>(args + o{i})'
+                            f'mulex::SysWireRead<{arg.typename.fulltypename}>(args + o{i})'
                         )
                 if i != len(method.args) - 1:
                     self._write_indented(0, ',\n')
@@ -648,11 +629,22 @@ class RPCGenerator:
         else:
             self._write_indented(0, ');\n')
 
+        # The return value is appended after whatever the caller already wrote to retbuf
+        # (i.e. the reply header) so the reply goes out without any extra copy
         if ret_is_gene:
             self._write_indented(4, 'std::uint64_t data_size = r._data.size();\n')
-            self._write_indented(4, 'retbuf.resize(data_size + sizeof(std::uint64_t));\n')
-            self._write_indented(4, 'std::memcpy(retbuf.data(), &data_size, sizeof(std::uint64_t));\n')
-            self._write_indented(4, 'std::memcpy(retbuf.data() + sizeof(std::uint64_t), r._data.data(), data_size);\n')
+            self._write_indented(4, 'retbuf.resize(base + data_size + sizeof(std::uint64_t));\n')
+            self._write_indented(4, 'std::memcpy(retbuf.data() + base, &data_size, sizeof(std::uint64_t));\n')
+            self._write_indented(4, 'std::memcpy(retbuf.data() + base + sizeof(std::uint64_t), r._data.data(), data_size);\n')
+        elif not ret_is_void:
+            self._write_indented(
+                4, 'retbuf.resize(base + sizeof('
+                   f'{method.rettype.fulltypename}));\n'
+            )
+            self._write_indented(
+                4, 'std::memcpy(retbuf.data() + base, &r, sizeof('
+                   f'{method.rettype.fulltypename}));\n'
+            )
 
         self._write_indented(4, 'break;\n')
         self._write_indented(3, '};\n')
@@ -663,11 +655,11 @@ class RPCGenerator:
         self.buffer.write('{\n')
         self._write_indented(
             1,
-            'std::vector<std::uint8_t> RPCCallLocally(std::uint16_t pid, '
-            'const std::uint8_t* args)\n')
+            'void RPCCallLocally(std::uint16_t pid, '
+            'const std::uint8_t* args, std::vector<std::uint8_t>& retbuf)\n')
         self._write_indented(1, '{\n')
         self._write_indented(2, 'ZoneScoped;\n')
-        self._write_indented(2, 'std::vector<std::uint8_t> retbuf;\n')
+        self._write_indented(2, '[[maybe_unused]] const std::uint64_t base = retbuf.size();\n')
         self._write_indented(2, 'switch(pid)\n')
         self._write_indented(2, '{\n')
 
@@ -675,7 +667,6 @@ class RPCGenerator:
             self._generate_case(id)
 
         self._write_indented(2, '}\n')
-        self._write_indented(2, 'return retbuf;\n')
         self._write_indented(1, '}\n')
         self.buffer.write('}\n')
 
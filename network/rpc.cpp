@@ -6,6 +6,7 @@
 #include <cstdint>
 #include <functional>
 #include <algorithm>
+#include <array>
 
 #include "rpc.h"
 #include <mutex>
@@ -16,15 +17,31 @@
 
 static std::atomic<std::uint64_t> _client_msg_id = 0;
 
-// NOTE: (Cesar) In theory this could be thread unsafe
-// 				 But this practically guards vs using
-// 				 RPC calls on a local context
-// static std::atomic<std::uint64_t> _client_current_caller = 0;
-static std::map<std::thread::id, std::uint64_t> _client_current_caller;
+// NOTE: (Cesar) Client of the call being served by this thread
+// 				 Set for the duration of each request so it works the same
+// 				 for the per connection threads and the worker pool
+// 				 0x00 means a local call (the server itself)
+static thread_local std::uint64_t 				_client_current_caller = 0x00;
 static std::map<std::uint64_t, std::string> 	_client_current_user;
 static std::shared_mutex 						_client_current_user_lock;
 
+// One slot of the rolling profile window of a (client, procedure) pair
+struct RpcProfileSlot
+{
+	std::uint64_t 				_epoch = 0;
+	std::uint64_t 				_count = 0;
+	std::uint64_t 				_bytes_in = 0;
+	std::uint64_t 				_bytes_out = 0;
+	std::uint64_t 				_exec_total = 0;
+	mulex::SysLatencyHistogram 	_exec;
+	mulex::SysLatencyHistogram 	_wait;
+};
+
+using RpcCallProfile = std::array<RpcProfileSlot, mulex::RPC_PROFILE_SLOTS>;
+
 static std::map<mulex::RpcCallerStatDescriptor, std::uint64_t> _rpc_statistics;
+static std::map<mulex::RpcCallerStatDescriptor, RpcCallProfile> _rpc_profile;
+static std::mutex 												_rpc_statistics_lock;
 
 namespace mulex
 {
@@ -45,6 +62,105 @@ namespace mulex
 		return rgt;
 	}
 
+	std::uint64_t RPCBatch::size() const
+	{
+		return _count;
+	}
+
+	bool RPCBatch::empty() const
+	{
+		return _count == 0;
+	}
+
+	void RPCBatch::clear()
+	{
+		_data.clear();
+		_count = 0;
+	}
+
+	const std::vector<std::uint8_t>& RPCBatch::data() const
+	{
+		return _data;
+	}
+
+	RPCBatchResult RPCBatchResult::FromData(const std::vector<std::uint8_t>& payload)
+	{
+		ZoneScoped;
+		RPCBatchResult result;
+		std::uint64_t offset = 0;
+		while(offset + sizeof(RPCBatchEntry) <= payload.size())
+		{
+			RPCBatchEntry entry;
+			std::memcpy(&entry, payload.data() + offset, sizeof(RPCBatchEntry));
+			offset += sizeof(RPCBatchEntry);
+
+			if(offset + entry.payloadsize > payload.size())
+			{
+				LogError("RPCBatchResult::FromData() truncated batch reply.");
+				break;
+			}
+
+			result._results.emplace_back(payload.data() + offset, payload.data() + offset + entry.payloadsize);
+			offset += entry.payloadsize;
+		}
+		return result;
+	}
+
+	const std::vector<std::uint8_t>& RPCBatchResult::raw(std::uint64_t index) const
+	{
+		static const std::vector<std::uint8_t> empty;
+		return index < _results.size() ? _results[index] : empty;
+	}
+
+	std::uint64_t RPCBatchResult::size() const
+	{
+		return _results.size();
+	}
+
+	void RPCCallBatchLocally(std::uint64_t client, const std::uint8_t* data, std::uint64_t size, std::vector<std::uint8_t>& output, std::uint64_t waitns)
+	{
+		ZoneScoped;
+		// Entries also wait on the ones before them
+		const std::uint64_t start = SysGetMonotonicNs();
+		std::uint64_t offset = 0;
+		while(offset + sizeof(RPCBatchEntry) <= size)
+		{
+			RPCBatchEntry entry;
+			std::memcpy(&entry, data + offset, sizeof(RPCBatchEntry));
+			offset += sizeof(RPCBatchEntry);
+
+			if(offset + entry.payloadsize > size)
+			{
+				LogError("[rpcserver] Truncated batch call from <0x%llx>.", client);
+				break;
+			}
+
+			// Results are appended right after their entry header
+			const std::uint64_t pos = output.size();
+			output.resize(pos + sizeof(RPCBatchEntry));
+
+			// A batch cannot nest another batch
+			if(entry.procedureid != RPC_BATCH_PROCEDURE)
+			{
+				const std::uint64_t begin = SysGetMonotonicNs();
+				RPCCallLocally(entry.procedureid, entry.payloadsize > 0 ? data + offset : nullptr, output);
+				const std::uint64_t end = SysGetMonotonicNs();
+				RpcAccumulateCallStatistics(client, entry.procedureid, {
+					entry.payloadsize,
+					output.size() - pos - sizeof(RPCBatchEntry),
+					waitns + (begin - start),
+					end - begin
+				});
+			}
+			offset += entry.payloadsize;
+
+			RPCBatchEntry result;
+			result.procedureid = entry.procedureid;
+			result.payloadsize = static_cast<std::uint32_t>(output.size() - pos - sizeof(RPCBatchEntry));
+			std::memcpy(output.data() + pos, &result, sizeof(RPCBatchEntry));
+		}
+	}
+
 	std::uint64_t GetNextMessageId()
 	{
 		return _client_msg_id++;
@@ -52,14 +168,58 @@ namespace mulex
 
 	std::uint64_t GetCurrentCallerId()
 	{
-		auto cid = _client_current_caller.find(std::this_thread::get_id());
-		if(cid == _client_current_caller.end())
+		return _client_current_caller;
+	}
+
+	static void RpcWriteResponseHeader(std::uint8_t* buffer, RPCResult status, std::uint64_t msgid, std::uint64_t payloadsize)
+	{
+		RPCReturnValue response;
+		response.status = status;
+		response.msgid = msgid;
+		response.payloadsize = static_cast<std::uint32_t>(payloadsize);
+		std::memcpy(buffer, &response, sizeof(RPCReturnValue));
+	}
+
+	// Runs a single request on the calling thread with the caller identity set
+	// The whole response frame is written to response (reused by the caller)
+	static void RpcExecuteRequest(const RPCMessageHeader& header, const std::uint8_t* args, std::vector<std::uint8_t>& response, std::uint64_t waitns)
+	{
+		ZoneScoped;
+		LogTrace("[rpcserver] Got RPC Call <%d> from <0x%llx>.", header.procedureid, header.client);
+
+		const std::uint64_t previous = _client_current_caller;
+		_client_current_caller = header.client;
+
+		response.resize(sizeof(RPCReturnValue));
+		if(header.procedureid == RPC_BATCH_PROCEDURE)
 		{
-			// 0x00 Is Server
-			return 0x00;
+			RPCCallBatchLocally(header.client, args, header.payloadsize, response, waitns);
 		}
+		else
+		{
+			const std::uint64_t begin = SysGetMonotonicNs();
+			RPCCallLocally(header.procedureid, args, response);
+			const std::uint64_t end = SysGetMonotonicNs();
+			RpcAccumulateCallStatistics(header.client, header.procedureid, {
+				header.payloadsize,
+				response.size() - sizeof(RPCReturnValue),
+				waitns,
+				end - begin
+			});
+		}
+
+		_client_current_caller = previous;
+		RpcWriteResponseHeader(response.data(), RPCResult::OK, header.msgid, response.size() - sizeof(RPCReturnValue));
+	}
 
-		return cid->second;
+	static void RpcTrimResponseBuffer(std::vector<std::uint8_t>& response)
+	{
+		// Keep the buffer between calls unless a single call made it large
+		if(response.capacity() > RPC_FRAME_BUFFER_KEEP)
+		{
+			response.clear();
+			response.shrink_to_fit();
+		}
 	}
 
 	std::string GetCurrentCallerUser()
@@ -117,11 +277,13 @@ namespace mulex
 
 		_rpc_socket = SocketInit();
 		SocketConnect(_rpc_socket, hostname, rpcport);
+		SocketSetNoDelay(_rpc_socket);
 
 		// Handshake
 		if(!handshake())
 		{
 			_rpc_init_ok = false;
+			_rpc_pending_closed = true;
 			SocketClose(_rpc_socket);
 			return;
 		}
@@ -161,18 +323,10 @@ namespace mulex
 
 		// Server replies status
 		std::uint8_t status = 0;
-		std::uint64_t recvl = 0;
-
-		while(recvl < 1)
+		if(SocketRecvExact(_rpc_socket, &status, 1, RPC_HANDSHAKE_TIMEOUT) != SocketResult::OK)
 		{
-			SocketResult res = SocketRecvBytes(_rpc_socket, &status, 1 - recvl, &recvl);
-			if(res == SocketResult::ERROR || res == SocketResult::DISCONNECT)
-			{
-				LogError("[rpcclient] Could not process handshake.");
-				return false;
-			}
-
-			std::this_thread::sleep_for(std::chrono::microseconds(50));
+			LogError("[rpcclient] Could not process handshake.");
+			return false;
 		}
 
 		if(status == 0)
@@ -192,45 +346,255 @@ namespace mulex
 		return _rpc_init_ok;
 	}
 
+	struct RPCClientThread::BlockingCall
+	{
+		std::uint64_t _msgid = 0;
+		std::vector<std::uint8_t> _reply;
+		bool _done = false;
+	};
+
 	void RPCClientThread::clientThread(const Socket& socket)
 	{
 		ZoneScoped;
 		std::unique_ptr<SysRecvThread> recvthread = SysStartRecvThread(socket, sizeof(RPCReturnValue), offsetof(RPCReturnValue, payloadsize));
 		SysByteStream& sbs = recvthread->_stream;
 		_rpc_stream = &recvthread->_stream;
-		static constexpr std::uint64_t buffersize = SYS_RECV_THREAD_BUFFER_SIZE;
-		std::vector<std::uint8_t> fbuffer(buffersize);
 		
 		while(_rpc_thread_running.load())
 		{
-			// Read the message
-			std::uint64_t read = sbs.fetch(fbuffer.data(), buffersize);
+			// Read the message (in place)
+			SysByteStream::FrameView frame = sbs.fetchView();
 
-			if(read <= 0 && !_rpc_thread_running.load())
+			if(frame._size == 0)
 			{
 				break;
 			}
 			
 			// Read the header
 			RPCReturnValue header;
-			std::memcpy(&header, fbuffer.data(), sizeof(RPCReturnValue));
+			std::memcpy(&header, frame._data, sizeof(RPCReturnValue));
+
+			if(header.status == RPCResult::REJECTED)
+			{
+				LogWarning("[rpcclient] RPC call was rejected. Server is overloaded.");
+			}
+
+			// Hand the payload to the call waiting on this msgid (if any)
+			// Blocking callers get it copied into their own reused buffer
+			const std::uint8_t* payload = frame._data + sizeof(RPCReturnValue);
+			std::promise<std::vector<std::uint8_t>> promise;
+			bool pending = false;
+			bool blocking = false;
+			{
+				std::lock_guard lock(_rpc_pending_lock);
+				for(std::uint64_t i = 0; i < _rpc_blocking.size(); i++)
+				{
+					BlockingCall* call = _rpc_blocking[i];
+					if(call->_msgid == header.msgid)
+					{
+						call->_reply.assign(payload, payload + header.payloadsize);
+						call->_done = true;
+						_rpc_blocking[i] = _rpc_blocking.back();
+						_rpc_blocking.pop_back();
+						blocking = true;
+						break;
+					}
+				}
+
+				if(!blocking)
+				{
+					auto it = _rpc_pending.find(header.msgid);
+					if(it != _rpc_pending.end())
+					{
+						promise = std::move(it->second);
+						_rpc_pending.erase(it);
+						pending = true;
+					}
+				}
+			}
 
-			// Read the payload (if any)
-			std::vector<std::uint8_t> buffer(header.payloadsize);
-			if(header.payloadsize > 0)
+			if(blocking)
+			{
+				_rpc_blocking_notifier.notify_all();
+			}
+			else if(pending)
 			{
-				std::memcpy(buffer.data(), fbuffer.data() + sizeof(RPCReturnValue), header.payloadsize);
-				_call_return_stack.push(std::move(buffer));
+				promise.set_value(std::vector<std::uint8_t>(payload, payload + header.payloadsize));
 			}
+			sbs.release(frame);
 
 			// LogTrace("[rpcclient] Got RPC Result:");
 			// LogTrace("[rpcclient] \tStatus: %d", static_cast<int>(header.status));
 			// LogTrace("[rpcclient] \tPayloadsz: %lu", header.payloadsize);
 		}
 
+		failPending();
 		recvthread->_handle.join();
 	}
 
+	std::vector<std::uint8_t>& RPCFrameBuffer(std::uint64_t payloadsize)
+	{
+		static thread_local std::vector<std::uint8_t> frame;
+		const std::uint64_t size = RPC_MESSAGE_HEADER_SIZE + payloadsize;
+
+		// Do not hold on to the memory of a single large call
+		if(frame.capacity() > RPC_FRAME_BUFFER_KEEP && size <= RPC_FRAME_BUFFER_KEEP)
+		{
+			frame.clear();
+			frame.shrink_to_fit();
+		}
+
+		frame.resize(size);
+		return frame;
+	}
+
+	std::uint64_t RPCClientThread::writeHeader(std::vector<std::uint8_t>& frame, std::uint16_t procedureid)
+	{
+		RPCMessageHeader header;
+		header.client = _rpc_has_custom_id ? _rpc_custom_id : SysGetClientId();
+		header.procedureid = procedureid;
+		header.msgid = GetNextMessageId();
+		header.payloadsize = static_cast<std::uint32_t>(frame.size() - sizeof(RPCMessageHeader));
+		std::memcpy(frame.data(), &header, sizeof(RPCMessageHeader));
+		return header.msgid;
+	}
+
+	bool RPCClientThread::sendFrame(const std::vector<std::uint8_t>& frame)
+	{
+		SocketResult result;
+		{
+			std::lock_guard lock(_rpc_send_lock);
+			result = SocketSendBytes(_rpc_socket, frame.data(), frame.size());
+		}
+
+		if(result == SocketResult::ERROR)
+		{
+			LogError("CallRemoteFunction failed to send data.");
+			return false;
+		}
+		return true;
+	}
+
+	std::future<std::vector<std::uint8_t>> RPCClientThread::send(std::vector<std::uint8_t>& frame, std::uint16_t procedureid, bool reply)
+	{
+		ZoneScoped;
+		const std::uint64_t msgid = writeHeader(frame, procedureid);
+
+		// Register before sending so the reply can never arrive first
+		std::future<std::vector<std::uint8_t>> future;
+		if(reply)
+		{
+			std::lock_guard lock(_rpc_pending_lock);
+			if(_rpc_pending_closed)
+			{
+				LogError("CallRemoteFunction failed. Connection is closed.");
+				std::promise<std::vector<std::uint8_t>> closed;
+				closed.set_value({});
+				return closed.get_future();
+			}
+			future = _rpc_pending[msgid].get_future();
+		}
+
+		if(!sendFrame(frame) && reply)
+		{
+			std::lock_guard lock(_rpc_pending_lock);
+			auto it = _rpc_pending.find(msgid);
+			if(it != _rpc_pending.end())
+			{
+				it->second.set_value({});
+				_rpc_pending.erase(it);
+			}
+		}
+
+		return future;
+	}
+
+	const std::vector<std::uint8_t>& RPCClientThread::sendAndWait(std::vector<std::uint8_t>& frame, std::uint16_t procedureid)
+	{
+		ZoneScoped;
+		// NOTE: (Cesar) A thread waits on at most one blocking call at a time
+		// 				 so the slot (and its reply capacity) is reused across calls
+		static thread_local BlockingCall call;
+		call._msgid = writeHeader(frame, procedureid);
+		call._done = false;
+		call._reply.clear();
+
+		{
+			std::lock_guard lock(_rpc_pending_lock);
+			if(_rpc_pending_closed)
+			{
+				LogError("CallRemoteFunction failed. Connection is closed.");
+				return call._reply;
+			}
+			_rpc_blocking.push_back(&call);
+		}
+
+		if(!sendFrame(frame))
+		{
+			std::lock_guard lock(_rpc_pending_lock);
+			auto it = std::find(_rpc_blocking.begin(), _rpc_blocking.end(), &call);
+			if(it != _rpc_blocking.end())
+			{
+				_rpc_blocking.erase(it);
+				call._reply.clear();
+				return call._reply;
+			}
+		}
+
+		std::unique_lock lock(_rpc_pending_lock);
+		_rpc_blocking_notifier.wait(lock, []() { return call._done; });
+		return call._reply;
+	}
+
+	std::future<RPCBatchResult> RPCClientThread::callBatch(const RPCBatch& batch)
+	{
+		ZoneScoped;
+		std::future<std::vector<std::uint8_t>> reply = send(RPCPackFrame(batch.data()), RPC_BATCH_PROCEDURE, true);
+		return std::async(std::launch::deferred, [reply = std::move(reply)]() mutable {
+			return RPCBatchResult::FromData(reply.get());
+		});
+	}
+
+	void RPCClientThread::failPending()
+	{
+		ZoneScoped;
+		// Wake every caller still waiting on a reply
+		{
+			std::lock_guard lock(_rpc_pending_lock);
+			_rpc_pending_closed = true;
+			for(auto& pending : _rpc_pending)
+			{
+				pending.second.set_value({});
+			}
+			_rpc_pending.clear();
+
+			for(BlockingCall* call : _rpc_blocking)
+			{
+				call->_reply.clear();
+				call->_done = true;
+			}
+			_rpc_blocking.clear();
+		}
+		_rpc_blocking_notifier.notify_all();
+	}
+
+	struct RPCServerThread::Request
+	{
+		RPCMessageHeader 		  _header;
+		std::vector<std::uint8_t> _args;
+		std::uint64_t 			  _received = 0;
+	};
+
+	struct RPCServerThread::Connection
+	{
+		Socket 				_socket;
+		std::deque<Request> _requests; 		// Guarded by _rpc_work_mutex
+		bool 				_busy = false; 	// Guarded by _rpc_work_mutex
+		bool 				_rejecting = false; // Guarded by _rpc_work_mutex
+		std::mutex 			_send_mutex;
+		bool 				_open = true; 	// Guarded by _send_mutex
+	};
+
 	bool RPCServerThread::ready() const
 	{
 		return _rpc_thread_ready.load();
@@ -242,20 +606,11 @@ namespace mulex
 		SysHandshakeHeader server_header = SysGetHandshakeHeader();
 		SysHandshakeHeader client_header;
 
-		static std::uint8_t buffer[sizeof(SysHandshakeHeader)];
-		std::uint64_t rlen, tsize = 0;
-		while(tsize < sizeof(SysHandshakeHeader))
+		std::uint8_t buffer[sizeof(SysHandshakeHeader)];
+		if(SocketRecvExact(client, buffer, sizeof(SysHandshakeHeader), RPC_HANDSHAKE_TIMEOUT, &_accept_wakeup) != SocketResult::OK)
 		{
-			SocketResult res = SocketRecvBytes(client, &buffer[tsize], sizeof(SysHandshakeHeader) - tsize, &rlen);
-			tsize += rlen;
-
-			if(res == SocketResult::ERROR || res == SocketResult::DISCONNECT)
-			{
-				LogError("[rpcserver] Could not process handshake.");
-				return false;
-			}
-
-			std::this_thread::sleep_for(std::chrono::microseconds(50));
+			LogError("[rpcserver] Could not process handshake.");
+			return false;
 		}
 
 		std::memcpy(&client_header, buffer, sizeof(SysHandshakeHeader));
@@ -298,13 +653,15 @@ namespace mulex
 			
 			if(would_block)
 			{
-				// Loop and recheck
-				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+				// Sleep until there is a connection or we are shutting down
+				SocketWaitReadable(_server_socket, -1, &_accept_wakeup);
 				continue;
 			}
 
 			if(!client._error)
 			{
+				SocketSetNoDelay(client);
+
 				// Handshake
 				if(!handshake(client))
 				{
@@ -312,6 +669,25 @@ namespace mulex
 					continue;
 				}
 
+				if(_rpc_reactor)
+				{
+					// Reactor mode does not need any per connection threads
+					std::shared_ptr<Connection> conn = std::make_shared<Connection>();
+					conn->_socket = client;
+					{
+						std::unique_lock<std::mutex> lock(_rpc_work_mutex);
+						_rpc_connections[client._handle] = conn;
+					}
+
+					if(!_rpc_reactor->attach(client))
+					{
+						std::unique_lock<std::mutex> lock(_rpc_work_mutex);
+						_rpc_connections.erase(client._handle);
+						SocketClose(client);
+					}
+					continue;
+				}
+
 				// Push a new client and start a thread for it
 				std::lock_guard<std::mutex> lock(_connections_mutex);
 				_rpc_thread.emplace(
@@ -335,91 +711,206 @@ namespace mulex
 		// Make sure RPC calls have locked data when accessing
 		std::unique_ptr<SysRecvThread> recvthread = SysStartRecvThread(socket, RPC_MESSAGE_HEADER_SIZE, offsetof(RPCMessageHeader, payloadsize));
 		SysByteStream& sbs = recvthread->_stream;
+		std::vector<std::uint8_t> rbuffer;
 
 		{
 			std::lock_guard<std::mutex> lock(_connections_mutex);
 			_rpc_stream.emplace(socket, &recvthread->_stream);
 			_rpc_thread_sig.emplace(socket, true);
-			_client_current_caller.emplace(std::this_thread::get_id(), 0x00);
 		}
 
-		static constexpr std::uint64_t buffersize = SYS_RECV_THREAD_BUFFER_SIZE;
-		std::vector<std::uint8_t> fbuffer(buffersize);
-
 		while(_rpc_thread_running.load() && _rpc_thread_sig.at(socket).load())
 		{
-			// Read the message
-			std::uint64_t read = sbs.fetch(fbuffer.data(), buffersize);
-			// if(read <= 0 && (!_rpc_thread_running.load() || !_rpc_thread_sig.at(socket).load()))
-			if(read <= 0)
+			// Read the message (in place)
+			SysByteStream::FrameView frame = sbs.fetchView();
+			if(frame._size == 0)
 			{
 				break;
 			}
 
 			// Read the header
 			RPCMessageHeader header;
-			std::memcpy(&header, fbuffer.data(), RPC_MESSAGE_HEADER_SIZE);
-
-			// Read the payload (if any)
-			std::vector<std::uint8_t> buffer(header.payloadsize);
-			if(header.payloadsize > 0)
-			{
-				std::memcpy(buffer.data(), fbuffer.data() + RPC_MESSAGE_HEADER_SIZE, header.payloadsize);
-			}
+			std::memcpy(&header, frame._data, RPC_MESSAGE_HEADER_SIZE);
 
-			LogTrace("[rpcserver] Got RPC Call <%d> from <0x%llx>.", header.procedureid, header.client);
-			RpcAccumulateCallStatistics(header.client, header.procedureid);
-
-			// Set the current global client state
-			// This works if we have multiple threads serving RPC requests
-			_client_current_caller.at(std::this_thread::get_id()) = header.client;
+			// The arguments are read straight from the stream
+			const std::uint8_t* args = (header.payloadsize > 0) ? frame._data + RPC_MESSAGE_HEADER_SIZE : nullptr;
 		
 			// Execute the request locally on the RPC thread
-			std::vector<std::uint8_t> ret = RPCCallLocally(header.procedureid, buffer.data());
+			RpcExecuteRequest(header, args, rbuffer, 0);
+			sbs.release(frame);
+
+			SocketSendBytes(socket, rbuffer.data(), rbuffer.size());
+			RpcTrimResponseBuffer(rbuffer);
+		}
 
-			// Pop the current global client state
-			_client_current_caller.at(std::this_thread::get_id()) = 0x00;
+		recvthread->_handle.join();
+	}
 
-			RPCReturnValue response;
-			response.status = RPCResult::OK;
-			response.payloadsize = static_cast<std::uint32_t>(ret.size());
+	void RPCServerThread::enqueueRequest(const Socket& socket, const std::uint8_t* frame, std::uint64_t size)
+	{
+		ZoneScoped;
+		Request request;
+		std::memcpy(&request._header, frame, RPC_MESSAGE_HEADER_SIZE);
+		request._args.assign(frame + RPC_MESSAGE_HEADER_SIZE, frame + size);
+		request._received = SysGetMonotonicNs();
 
-			// Is there a return type
-			if(response.payloadsize > 0)
+		std::shared_ptr<Connection> conn;
+		bool first_reject;
+		{
+			std::unique_lock<std::mutex> lock(_rpc_work_mutex);
+			auto it = _rpc_connections.find(socket._handle);
+			if(it == _rpc_connections.end())
 			{
-				std::vector<std::uint8_t> rbuffer(ret.size() + sizeof(RPCReturnValue));
-				std::memcpy(rbuffer.data(), &response, sizeof(RPCReturnValue));
-				std::memcpy(rbuffer.data() + sizeof(RPCReturnValue), ret.data(), response.payloadsize);
-				SocketSendBytes(
-					socket,
-					rbuffer.data(),
-					response.payloadsize + sizeof(RPCReturnValue)
-				);
+				return;
 			}
-			else
+			conn = it->second;
+
+			// Admission control, reply right away instead of growing the backlog
+			if(_rpc_queued < RPC_WORKER_MAX_QUEUE_DEPTH && conn->_requests.size() < RPC_WORKER_MAX_CLIENT_DEPTH)
 			{
-				SocketSendBytes(
-					socket,
-					reinterpret_cast<std::uint8_t*>(&response),
-					sizeof(RPCReturnValue)
-				);
+				conn->_requests.push_back(std::move(request));
+				conn->_rejecting = false;
+				_rpc_queued++;
+
+				// A connection is only on the ready list while it has work and no running call
+				if(!conn->_busy && conn->_requests.size() == 1)
+				{
+					_rpc_ready.push_back(conn);
+					_rpc_work_notifier.notify_one();
+				}
+				return;
 			}
+
+			first_reject = !conn->_rejecting;
+			conn->_rejecting = true;
 		}
 
+		// Warn once per burst of rejections
+		if(first_reject)
 		{
-			std::lock_guard<std::mutex> lock(_connections_mutex);
-			_client_current_caller.erase(std::this_thread::get_id());
+			LogWarning("[rpcserver] Rejecting RPC calls from <0x%llx>. Server is overloaded.", request._header.client);
 		}
+		std::uint8_t rejected[sizeof(RPCReturnValue)];
+		RpcWriteResponseHeader(rejected, RPCResult::REJECTED, request._header.msgid, 0);
+		respond(conn, rejected, sizeof(RPCReturnValue));
+	}
 
-		recvthread->_handle.join();
+	void RPCServerThread::closeConnection(const Socket& socket)
+	{
+		ZoneScoped;
+		std::shared_ptr<Connection> conn;
+		{
+			std::unique_lock<std::mutex> lock(_rpc_work_mutex);
+			auto it = _rpc_connections.find(socket._handle);
+			if(it == _rpc_connections.end())
+			{
+				return;
+			}
+			conn = std::move(it->second);
+			_rpc_connections.erase(it);
+
+			// Workers skip a connection that shows up on the ready list without requests
+			_rpc_queued -= conn->_requests.size();
+			conn->_requests.clear();
+		}
+
+		// The socket is closed after we return so a running call cannot reply to a reused handle
+		std::unique_lock<std::mutex> lock(conn->_send_mutex);
+		conn->_open = false;
+	}
+
+	void RPCServerThread::respond(const std::shared_ptr<Connection>& conn, const std::uint8_t* response, std::uint64_t size)
+	{
+		ZoneScoped;
+		// The reactor owns the bytes until they are written
+		SysRefBuffer buffer = SysRefBuffer::Copy(response, size);
+
+		std::unique_lock<std::mutex> lock(conn->_send_mutex);
+		if(conn->_open)
+		{
+			_rpc_reactor->send(conn->_socket, buffer);
+		}
+	}
+
+	void RPCServerThread::workerThread()
+	{
+		ZoneScoped;
+		std::vector<std::uint8_t> response;
+		while(true)
+		{
+			std::shared_ptr<Connection> conn;
+			Request request;
+			{
+				std::unique_lock<std::mutex> lock(_rpc_work_mutex);
+				_rpc_work_notifier.wait(lock, [this](){ return !_rpc_ready.empty() || !_rpc_thread_running.load(); });
+				if(!_rpc_thread_running.load())
+				{
+					break;
+				}
+
+				// Round robin over the connections, one call each
+				conn = std::move(_rpc_ready.front());
+				_rpc_ready.pop_front();
+				if(conn->_requests.empty())
+				{
+					continue;
+				}
+
+				request = std::move(conn->_requests.front());
+				conn->_requests.pop_front();
+				conn->_busy = true;
+				_rpc_queued--;
+			}
+
+			const std::uint64_t waitns = SysGetMonotonicNs() - request._received;
+			RpcExecuteRequest(request._header, request._args.empty() ? nullptr : request._args.data(), response, waitns);
+			respond(conn, response.data(), response.size());
+			RpcTrimResponseBuffer(response);
+
+			{
+				std::unique_lock<std::mutex> lock(_rpc_work_mutex);
+				conn->_busy = false;
+				if(!conn->_requests.empty())
+				{
+					_rpc_ready.push_back(conn);
+					_rpc_work_notifier.notify_one();
+				}
+			}
+		}
 	}
 
-	RPCServerThread::RPCServerThread()
+	RPCServerThread::RPCServerThread(RPCServerMode mode, std::uint32_t nworkers)
 	{
 		ZoneScoped;
 		// Ensure we setup the thread spin flag
+		_rpc_mode = mode;
 		_rpc_thread_running.store(true);
 		_rpc_thread_ready.store(false);
+		_accept_wakeup = SocketNotifierInit();
+
+		if(_rpc_mode == RPCServerMode::REACTOR && !SysIoReactor::Supported())
+		{
+			LogWarning("[rpcserver] Reactor mode is not supported on this platform. Falling back to threaded mode.");
+			_rpc_mode = RPCServerMode::THREADED;
+		}
+
+		if(_rpc_mode == RPCServerMode::REACTOR)
+		{
+			_rpc_reactor = std::make_unique<SysIoReactor>(
+				1,
+				RPC_MESSAGE_HEADER_SIZE,
+				offsetof(RPCMessageHeader, payloadsize),
+				[this](const Socket& socket, const std::uint8_t* frame, std::uint64_t size) { enqueueRequest(socket, frame, size); },
+				[this](const Socket& socket) { closeConnection(socket); }
+			);
+
+			nworkers = std::max(nworkers, 1U);
+			for(std::uint32_t i = 0; i < nworkers; i++)
+			{
+				_rpc_workers.emplace_back(&RPCServerThread::workerThread, this);
+			}
+			LogDebug("[rpcserver] Running in reactor mode with %u workers.", nworkers);
+		}
 
 		// Init the listen thread for this client
 		_rpc_accept_thread = std::make_unique<std::thread>(
@@ -431,7 +922,17 @@ namespace mulex
 	{
 		ZoneScoped;
 		_rpc_thread_running.store(false);
+		SocketNotifierSignal(_accept_wakeup);
 		_rpc_accept_thread->join();
+		SocketNotifierClose(_accept_wakeup);
+
+		// Let the running calls finish before the reactor goes away
+		{
+			std::unique_lock<std::mutex> lock(_rpc_work_mutex);
+			_rpc_work_notifier.notify_all();
+		}
+		std::for_each(_rpc_workers.begin(), _rpc_workers.end(), [](auto& t){ t.join(); });
+		_rpc_reactor.reset();
 #ifdef WIN32
 		std::for_each(_rpc_stream.begin(), _rpc_stream.end(), [](auto& t){ t.second->requestUnblock(); });
 #endif
@@ -444,19 +945,38 @@ namespace mulex
 		return (client < other.client) || (client == other.client && procid < other.procid);
 	}
 
-	void RpcAccumulateCallStatistics(std::uint64_t client, std::uint16_t procid)
+	static std::uint64_t RpcProfileEpoch()
+	{
+		return SysGetMonotonicNs() / (RPC_PROFILE_SLOT_MS * 1000000);
+	}
+
+	void RpcAccumulateCallStatistics(std::uint64_t client, std::uint16_t procid, const RpcCallSample& sample)
 	{
 		RpcCallerStatDescriptor descriptor{ client, procid };
+		const std::uint64_t epoch = RpcProfileEpoch();
+		std::unique_lock lock(_rpc_statistics_lock);
 
-		auto it = _rpc_statistics.find(descriptor);
+		_rpc_statistics[descriptor]++;
 
-		if(it == _rpc_statistics.end())
+		// Reuse the slot of an old epoch (the histograms keep their memory)
+		RpcProfileSlot& slot = _rpc_profile[descriptor][epoch % RPC_PROFILE_SLOTS];
+		if(slot._epoch != epoch)
 		{
-			_rpc_statistics.emplace(descriptor, 1ULL);
-			return;
+			slot._epoch = epoch;
+			slot._count = 0;
+			slot._bytes_in = 0;
+			slot._bytes_out = 0;
+			slot._exec_total = 0;
+			slot._exec.reset();
+			slot._wait.reset();
 		}
 
-		it->second++;
+		slot._count++;
+		slot._bytes_in += sample._bytes_in;
+		slot._bytes_out += sample._bytes_out;
+		slot._exec_total += sample._exec_ns;
+		slot._exec.record(sample._exec_ns);
+		slot._wait.record(sample._wait_ns);
 	}
 
 	mulex::RPCGenericType RpcGetAllCalls()
@@ -478,6 +998,7 @@ namespace mulex
 
 	mulex::RPCGenericType RpcGetCallsDebugData()
 	{
+		std::unique_lock lock(_rpc_statistics_lock);
 		std::vector<std::uint8_t> output;
 		constexpr std::uint64_t size = (2 * sizeof(std::uint64_t) + sizeof(std::uint16_t));
 		output.resize(_rpc_statistics.size() * size);
@@ -491,4 +1012,56 @@ namespace mulex
 		}
 		return output;
 	}
+
+	mulex::RPCGenericType RpcGetCallsProfile()
+	{
+		const std::uint64_t epoch = RpcProfileEpoch();
+		std::vector<RpcCallProfileEntry> output;
+		std::unique_lock lock(_rpc_statistics_lock);
+		for(auto it = _rpc_profile.begin(); it != _rpc_profile.end();)
+		{
+			RpcCallProfileEntry entry = {};
+			SysLatencyHistogram exec;
+			SysLatencyHistogram wait;
+			for(const RpcProfileSlot& slot : it->second)
+			{
+				if(slot._count == 0 || epoch - slot._epoch >= RPC_PROFILE_SLOTS)
+				{
+					continue;
+				}
+				entry._count += slot._count;
+				entry._bytes_in += slot._bytes_in;
+				entry._bytes_out += slot._bytes_out;
+				entry._exec_total += slot._exec_total;
+				exec.merge(slot._exec);
+				wait.merge(slot._wait);
+			}
+
+			// Nothing left in the window (e.g. the client is gone)
+			if(entry._count == 0)
+			{
+				it = _rpc_profile.erase(it);
+				continue;
+			}
+
+			entry._client = it->first.client;
+			entry._procid = it->first.procid;
+			entry._exec_p50 = exec.percentile(50.0);
+			entry._exec_p90 = exec.percentile(90.0);
+			entry._exec_p99 = exec.percentile(99.0);
+			entry._exec_max = exec.max();
+			entry._wait_p50 = wait.percentile(50.0);
+			entry._wait_p99 = wait.percentile(99.0);
+			entry._wait_max = wait.max();
+			output.push_back(entry);
+			it++;
+		}
+		lock.unlock();
+
+		// Procedures that take most of the server time first
+		std::sort(output.begin(), output.end(), [](const RpcCallProfileEntry& a, const RpcCallProfileEntry& b) {
+			return a._exec_total > b._exec_total;
+		});
+		return output;
+	}
 }
@@ -4,7 +4,10 @@
 #include <atomic>
 #include <mutex>
 #include <map>
+#include <deque>
+#include <condition_variable>
 #include <optional>
+#include <future>
 
 #include "socket.h"
 #include "../mxtypes.h"
@@ -26,12 +29,29 @@ namespace mulex
 {
 	static constexpr std::uint16_t RPC_PORT = 5701;
 	static constexpr std::uint16_t RPC_RECV_TIMEOUT = 10000; // 10 sec
+	static constexpr std::int64_t  RPC_HANDSHAKE_TIMEOUT = 5000; // 5 sec
+	static constexpr std::uint64_t RPC_RETURN_QUEUE_SIZE = 64;
+	static constexpr std::uint16_t RPC_BATCH_PROCEDURE = 0xFFFE; // 0xFFFF is the unknown method id
+	static constexpr std::uint32_t RPC_DEFAULT_WORKERS = 4;
+	static constexpr std::uint64_t RPC_WORKER_MAX_QUEUE_DEPTH = 16384; // Waiting calls over all connections
+	static constexpr std::uint64_t RPC_WORKER_MAX_CLIENT_DEPTH = 1024; // Waiting calls of a single connection
 
 	enum class RPCResult
 	{
 		OK,
 		WRONG_ARGS,
-		TIMEOUT
+		TIMEOUT,
+		REJECTED
+	};
+
+	// NOTE: (Cesar) THREADED spawns a receive and a server thread per connection
+	// 				 REACTOR multiplexes every connection on an epoll loop and runs the calls
+	// 				 on a bounded worker pool, one call per connection at a time so the calls
+	// 				 of a connection still run in order
+	enum class RPCServerMode
+	{
+		THREADED,
+		REACTOR
 	};
 	
 	struct RPCMessageHeader
@@ -43,9 +63,12 @@ namespace mulex
 		// std::uint8_t  padding[10];
 	};
 
+	// NOTE: (Cesar) msgid echoes the RPCMessageHeader::msgid of the call
+	// 				 so the client can match replies to pending calls
 	struct RPCReturnValue
 	{
 		RPCResult 	  status;
+		std::uint64_t msgid;
 		std::uint32_t payloadsize;
 	};
 
@@ -189,6 +212,106 @@ namespace mulex
 
 	constexpr std::uint64_t RPC_MESSAGE_HEADER_SIZE = sizeof(RPCMessageHeader);
 
+	// NOTE: (Cesar) Prefixes every call of a batch frame and every result of its reply
+	// 				 The batch payload is a sequence of [RPCBatchEntry][args] and the reply
+	// 				 a sequence of [RPCBatchEntry][return value] in the same order
+	struct RPCBatchEntry
+	{
+		std::uint16_t procedureid;
+		std::uint32_t payloadsize;
+	};
+
+	template<typename T>
+	inline T RPCUnpackReturn(const std::vector<std::uint8_t>& payload)
+	{
+		ZoneScoped;
+		if constexpr(std::is_same_v<T, mulex::RPCGenericType>)
+		{
+			mulex::RPCGenericType rgt;
+			std::uint64_t size;
+
+			if(payload.size() < sizeof(std::uint64_t))
+			{
+				mulex::LogError("CallRemoteFunction got no reply.");
+				return rgt;
+			}
+
+			std::memcpy(&size, payload.data(), sizeof(std::uint64_t));
+			rgt._data.resize(size);
+			std::memcpy(rgt._data.data(), payload.data() + sizeof(std::uint64_t), size);
+
+			return rgt;
+		}
+		else
+		{
+			T out; // NOTE: T needs to be trivially constructible (and copyable)
+			if(payload.size() < sizeof(T))
+			{
+				mulex::LogError("CallRemoteFunction got no reply.");
+				return T();
+			}
+
+			std::memcpy(&out, payload.data(), sizeof(T));
+			return out;
+		}
+	}
+
+	// NOTE: (Cesar) Packs several calls into a single RPC frame
+	// 				 The server runs them in order on the connection thread and replies once
+	// 				 e.g.
+	// 				 RPCBatch batch;
+	// 				 std::uint64_t a = batch.add(RPC_CALL_MULEX_RDBVALUEEXISTS, key);
+	// 				 RPCBatchResult result = client->callBatch(batch).get();
+	// 				 bool exists = result.get<bool>(a);
+	class RPCBatch
+	{
+	public:
+		template<typename... Args>
+		inline std::uint64_t add(std::uint16_t procedureid, Args&&... args);
+
+		std::uint64_t size() const;
+		bool empty() const;
+		void clear();
+		const std::vector<std::uint8_t>& data() const;
+
+	private:
+		std::vector<std::uint8_t> _data;
+		std::uint64_t _count = 0;
+	};
+
+	class RPCBatchResult
+	{
+	public:
+		static RPCBatchResult FromData(const std::vector<std::uint8_t>& payload);
+
+		template<typename T>
+		inline T get(std::uint64_t index) const;
+
+		const std::vector<std::uint8_t>& raw(std::uint64_t index) const;
+		std::uint64_t size() const;
+
+	private:
+		std::vector<std::vector<std::uint8_t>> _results;
+	};
+
+	void RPCCallBatchLocally(std::uint64_t client, const std::uint8_t* data, std::uint64_t size, std::vector<std::uint8_t>& output, std::uint64_t waitns = 0);
+
+	static constexpr std::uint64_t RPC_FRAME_BUFFER_KEEP = 0x10000; // 64KB
+
+	// NOTE: (Cesar) Per thread frame reused by every outgoing call of that thread
+	// 				 Holds RPC_MESSAGE_HEADER_SIZE bytes of room for the header followed by payloadsize bytes
+	// 				 Only shrinks back after a call larger than RPC_FRAME_BUFFER_KEEP
+	std::vector<std::uint8_t>& RPCFrameBuffer(std::uint64_t payloadsize);
+
+	template<typename... Args>
+	inline std::vector<std::uint8_t>& RPCPackFrame(const Args&... args)
+	{
+		ZoneScoped;
+		std::vector<std::uint8_t>& frame = RPCFrameBuffer(SysPackedSize(args...));
+		SysPackArgumentsTo(frame.data() + RPC_MESSAGE_HEADER_SIZE, args...);
+		return frame;
+	}
+
 	std::uint64_t GetNextMessageId();
 	std::uint64_t GetCurrentCallerId();
 	std::string GetCurrentCallerUser();
@@ -208,13 +331,27 @@ namespace mulex
 		template<typename... Args>
 		inline void call(std::uint16_t procedureid, Args&&... args);
 
+		// NOTE: (Cesar) Sends the call and returns without waiting for the reply
+		// 				 Many calls can be in flight on the same connection
+		// 				 The future yields T() if the connection fails before the reply
+		template<typename T, typename... Args>
+		inline std::future<T> callAsync(std::uint16_t procedureid, Args&&... args);
+
 		inline void callRaw(std::uint16_t procedureid, const std::vector<std::uint8_t>& data, std::vector<std::uint8_t>* retdata);
 
+		std::future<RPCBatchResult> callBatch(const RPCBatch& batch);
+
 		bool isValid() const;
 
 	private:
 		void clientThread(const Socket& socket);
 		bool handshake();
+		struct BlockingCall;
+		std::uint64_t writeHeader(std::vector<std::uint8_t>& frame, std::uint16_t procedureid);
+		bool sendFrame(const std::vector<std::uint8_t>& frame);
+		std::future<std::vector<std::uint8_t>> send(std::vector<std::uint8_t>& frame, std::uint16_t procedureid, bool reply);
+		const std::vector<std::uint8_t>& sendAndWait(std::vector<std::uint8_t>& frame, std::uint16_t procedureid);
+		void failPending();
 
 	private:
 		Socket _rpc_socket;
@@ -222,7 +359,12 @@ namespace mulex
 		SysByteStream* _rpc_stream;
 		std::atomic<bool> _rpc_thread_running = false;
 		std::atomic<bool> _rpc_thread_ready = false;
-		SysBufferStack _call_return_stack;
+		std::mutex _rpc_send_lock;
+		std::mutex _rpc_pending_lock;
+		std::map<std::uint64_t, std::promise<std::vector<std::uint8_t>>> _rpc_pending;
+		std::vector<BlockingCall*> _rpc_blocking;
+		std::condition_variable _rpc_blocking_notifier;
+		bool _rpc_pending_closed = false;
 		bool _rpc_has_custom_id = false;
 		std::uint64_t _rpc_custom_id;
 		std::string _rpc_username;
@@ -232,17 +374,25 @@ namespace mulex
 	class RPCServerThread
 	{
 	public:
-		RPCServerThread();
+		RPCServerThread(RPCServerMode mode = RPCServerMode::THREADED, std::uint32_t nworkers = RPC_DEFAULT_WORKERS);
 		~RPCServerThread();
 		bool ready() const;
 
 	private:
+		struct Request;
+		struct Connection;
 		void serverConnAcceptThread();
 		void serverThread(const Socket& socket);
 		bool handshake(const Socket& client);
+		void enqueueRequest(const Socket& socket, const std::uint8_t* frame, std::uint64_t size);
+		void closeConnection(const Socket& socket);
+		void respond(const std::shared_ptr<Connection>& conn, const std::uint8_t* response, std::uint64_t size);
+		void workerThread();
 
 	private:
+		RPCServerMode _rpc_mode;
 		Socket _server_socket;
+		SocketNotifier _accept_wakeup;
 		std::map<Socket, std::unique_ptr<std::thread>> _rpc_thread;
 		std::map<Socket, SysByteStream*> _rpc_stream;
 		std::map<Socket, std::atomic<bool>> _rpc_thread_sig;
@@ -250,168 +400,84 @@ namespace mulex
 		std::atomic<bool> _rpc_thread_running = false;
 		std::atomic<bool> _rpc_thread_ready = false;
 		std::mutex _connections_mutex;
+
+		// Reactor mode
+		std::unique_ptr<SysIoReactor> _rpc_reactor;
+		std::vector<std::thread> _rpc_workers;
+		std::mutex _rpc_work_mutex;
+		std::condition_variable _rpc_work_notifier;
+		std::map<std::int64_t, std::shared_ptr<Connection>> _rpc_connections;
+		std::deque<std::shared_ptr<Connection>> _rpc_ready;
+		std::uint64_t _rpc_queued = 0;
 	};
 
 	template<typename T, typename... Args>
-	inline T RPCClientThread::call(std::uint16_t procedureid, Args&&... args)
+	inline std::future<T> RPCClientThread::callAsync(std::uint16_t procedureid, Args&&... args)
 	{
 		ZoneScoped;
-		const mulex::Socket& conn = _rpc_socket;
-		mulex::RPCMessageHeader header;
-		if(_rpc_has_custom_id)
-		{
-			header.client = _rpc_custom_id;
-		}
-		else
-		{
-			header.client = SysGetClientId();
-		}
-		header.procedureid = procedureid;
-		header.msgid = GetNextMessageId();
-		if constexpr(sizeof...(args) > 0)
-		{
-			header.payloadsize = static_cast<std::uint32_t>(SysVargSize<Args...>(args...));
-		}
-		else
-		{
-			header.payloadsize = 0;
-		}
-
-		if constexpr(sizeof...(args) > 0)
-		{
-			mulex::SocketResult result;
-			std::vector<std::uint8_t> buffer(sizeof(header) + header.payloadsize);
-			std::vector<std::uint8_t> params = SysPackArguments(args...);
-			std::memcpy(buffer.data(), &header, sizeof(header));
-			std::memcpy(buffer.data() + sizeof(header), params.data(), header.payloadsize);
-			result = mulex::SocketSendBytes(conn, buffer.data(), sizeof(header) + header.payloadsize);
-			if(result == mulex::SocketResult::ERROR)
-			{
-				mulex::LogError("CallRemoteFunction failed to send data.");
-				return T();
-			}
-		}
-		else
-		{
-			mulex::SocketResult result;
-			result = mulex::SocketSendBytes(conn, (std::uint8_t*)&header, sizeof(header));
-			if(result == mulex::SocketResult::ERROR)
-			{
-				mulex::LogError("CallRemoteFunction failed to send data.");
-				return T();
-			}
-		}
-
-		std::vector<std::uint8_t> payload = _call_return_stack.pop();
-		if constexpr(std::is_same_v<T, mulex::RPCGenericType>)
-		{
-			mulex::RPCGenericType rgt;
-			std::uint64_t size;
+		std::future<std::vector<std::uint8_t>> reply = send(RPCPackFrame(args...), procedureid, true);
 
-			std::memcpy(&size, payload.data(), sizeof(std::uint64_t));
-			rgt._data.resize(size);
-			std::memcpy(rgt._data.data(), payload.data() + sizeof(std::uint64_t), size);
+		// Unpack on the thread that waits for the result
+		return std::async(std::launch::deferred, [reply = std::move(reply)]() mutable {
+			return RPCUnpackReturn<T>(reply.get());
+		});
+	}
 
-			return rgt;
-		}
-		else
-		{
-			T out; // NOTE: T needs to be trivially constructible (and copyable)
-			std::memcpy(&out, payload.data(), sizeof(T));
-			return out;
-		}
+	template<typename T, typename... Args>
+	inline T RPCClientThread::call(std::uint16_t procedureid, Args&&... args)
+	{
+		ZoneScoped;
+		// The reply is written to a per thread buffer so the blocking path does not allocate
+		return RPCUnpackReturn<T>(sendAndWait(RPCPackFrame(args...), procedureid));
 	}
 
 	template<typename... Args>
 	inline void RPCClientThread::call(std::uint16_t procedureid, Args&&... args)
 	{
 		ZoneScoped;
-		const mulex::Socket& conn = _rpc_socket;
-		mulex::RPCMessageHeader header;
-		if(_rpc_has_custom_id)
-		{
-			header.client = _rpc_custom_id;
-		}
-		else
-		{
-			header.client = SysGetClientId();
-		}
-		header.procedureid = procedureid;
-		header.msgid = GetNextMessageId();
-		header.payloadsize = static_cast<std::uint32_t>(SysVargSize<Args...>(args...));
-
-
-		if constexpr(sizeof...(args) > 0)
-		{
-			mulex::SocketResult result;
-			std::vector<std::uint8_t> buffer(sizeof(header) + header.payloadsize);
-			std::vector<std::uint8_t> params = SysPackArguments(args...);
-			std::memcpy(buffer.data(), &header, sizeof(header));
-			std::memcpy(buffer.data() + sizeof(header), params.data(), header.payloadsize);
-			result = mulex::SocketSendBytes(conn, buffer.data(), sizeof(header) + header.payloadsize);
-			if(result == mulex::SocketResult::ERROR)
-			{
-				mulex::LogError("CallRemoteFunction failed to send data.");
-				return;
-			}
-		}
-		else
-		{
-			mulex::SocketResult result;
-			result = mulex::SocketSendBytes(conn, (std::uint8_t*)&header, sizeof(header));
-			if(result == mulex::SocketResult::ERROR)
-			{
-				mulex::LogError("CallRemoteFunction failed to send data.");
-				return;
-			}
-		}
+		// The server still replies, the client thread drops it
+		send(RPCPackFrame(args...), procedureid, false);
 	}
 
 	inline void RPCClientThread::callRaw(std::uint16_t procedureid, const std::vector<std::uint8_t>& data, std::vector<std::uint8_t>* retdata)
 	{
 		ZoneScoped;
-		const mulex::Socket& conn = _rpc_socket;
-		mulex::RPCMessageHeader header;
-		if(_rpc_has_custom_id)
+		std::vector<std::uint8_t>& frame = RPCPackFrame(data);
+		if(retdata)
 		{
-			header.client = _rpc_custom_id;
+			*retdata = sendAndWait(frame, procedureid);
 		}
 		else
 		{
-			header.client = SysGetClientId();
+			send(frame, procedureid, false);
 		}
-		header.procedureid = procedureid;
-		header.msgid = GetNextMessageId();
-		header.payloadsize = static_cast<std::uint32_t>(data.size());
+	}
 
-		if(header.payloadsize > 0)
-		{
-			mulex::SocketResult result;
-			std::vector<std::uint8_t> buffer(sizeof(header) + header.payloadsize);
-			std::memcpy(buffer.data(), &header, sizeof(header));
-			std::memcpy(buffer.data() + sizeof(header), data.data(), header.payloadsize);
-			result = mulex::SocketSendBytes(conn, buffer.data(), sizeof(header) + header.payloadsize);
-			if(result == mulex::SocketResult::ERROR)
-			{
-				mulex::LogError("CallRemoteFunction failed to send data.");
-				return;
-			}
-		}
-		else
-		{
-			mulex::SocketResult result;
-			result = mulex::SocketSendBytes(conn, (std::uint8_t*)&header, sizeof(header));
-			if(result == mulex::SocketResult::ERROR)
-			{
-				mulex::LogError("CallRemoteFunction failed to send data.");
-				return;
-			}
-		}
+	template<typename... Args>
+	inline std::uint64_t RPCBatch::add(std::uint16_t procedureid, Args&&... args)
+	{
+		ZoneScoped;
+		RPCBatchEntry entry;
+		entry.procedureid = procedureid;
+
+		const std::uint64_t offset = _data.size();
+		entry.payloadsize = static_cast<std::uint32_t>(SysPackedSize(args...));
+		_data.resize(offset + sizeof(RPCBatchEntry) + entry.payloadsize);
+		SysPackArgumentsTo(_data.data() + offset + sizeof(RPCBatchEntry), args...);
+		std::memcpy(_data.data() + offset, &entry, sizeof(RPCBatchEntry));
+		return _count++;
+	}
 
-		if(retdata)
+	template<typename T>
+	inline T RPCBatchResult::get(std::uint64_t index) const
+	{
+		ZoneScoped;
+		if(index >= _results.size())
 		{
-			*retdata = _call_return_stack.pop();
+			LogError("RPCBatchResult::get() no result at index %llu.", index);
+			return T();
 		}
+		return RPCUnpackReturn<T>(_results[index]);
 	}
 
 	struct RpcCallerStatDescriptor
@@ -423,9 +489,43 @@ namespace mulex
 		bool operator<(const RpcCallerStatDescriptor& other) const;
 	};
 
-	void RpcAccumulateCallStatistics(std::uint64_t client, std::uint16_t procid);
+	// NOTE: (Cesar) Calls are profiled over a rolling window of RPC_PROFILE_SLOTS slots
+	// 				 The oldest slot is reset as time moves on, so a profile covers the last
+	// 				 (RPC_PROFILE_SLOTS - 1) * RPC_PROFILE_SLOT_MS to RPC_PROFILE_SLOTS * RPC_PROFILE_SLOT_MS
+	constexpr std::uint64_t RPC_PROFILE_SLOTS = 6;
+	constexpr std::uint64_t RPC_PROFILE_SLOT_MS = 10000;
+
+	// Measurements of a single executed call
+	struct RpcCallSample
+	{
+		std::uint64_t _bytes_in;
+		std::uint64_t _bytes_out;
+		std::uint64_t _wait_ns; // Time queued before a thread picked the call up
+		std::uint64_t _exec_ns;
+	};
+
+	// Entry returned by RpcGetCallsProfile(), sorted by _exec_total (descending)
+	struct RpcCallProfileEntry
+	{
+		std::uint64_t _client;
+		std::uint64_t _count;
+		std::uint64_t _bytes_in;
+		std::uint64_t _bytes_out;
+		std::uint64_t _exec_total;
+		std::uint64_t _exec_p50;
+		std::uint64_t _exec_p90;
+		std::uint64_t _exec_p99;
+		std::uint64_t _exec_max;
+		std::uint64_t _wait_p50;
+		std::uint64_t _wait_p99;
+		std::uint64_t _wait_max;
+		std::uint16_t _procid;
+	};
+
+	void RpcAccumulateCallStatistics(std::uint64_t client, std::uint16_t procid, const RpcCallSample& sample);
 
 	MX_RPC_METHOD mulex::RPCGenericType RpcGetAllCalls();
 	MX_RPC_METHOD mulex::RPCGenericType RpcGetCallsDebugData();
+	MX_RPC_METHOD mulex::RPCGenericType RpcGetCallsProfile();
 
 } // namespace mulex
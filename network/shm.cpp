@@ -0,0 +1,429 @@
+// Date   : 17/10/2026
+// Brief  : Shared memory transport for clients on the same host as the server
+
+#include "shm.h"
+#include "../mxlogger.h"
+
+#include <atomic>
+#include <cstring>
+#include <climits>
+#include <chrono>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+static std::atomic<std::uint32_t> _shm_name_counter = 0;
+
+namespace mulex
+{
+	struct ShmChannel::Ring
+	{
+		alignas(64) std::atomic<std::uint64_t> _head;
+		alignas(64) std::atomic<std::uint64_t> _tail;
+		alignas(64) std::atomic<std::uint32_t> _data_seq;
+		std::atomic<std::uint32_t> 			   _consumer_waiting;
+		alignas(64) std::atomic<std::uint32_t> _space_seq;
+		std::atomic<std::uint32_t> 			   _producer_waiting;
+	};
+
+	// NOTE: (Cesar) Ring 0 is client -> server, ring 1 is server -> client
+	// 				 The ring data follows the segment header in the same order
+	struct ShmChannel::Segment
+	{
+		std::atomic<std::uint32_t> _magic;
+		std::uint32_t 			   _version;
+		std::uint64_t 			   _ring_size;
+		std::atomic<std::uint32_t> _accepted;
+		std::atomic<std::uint32_t> _closed;
+		Ring 					   _rings[2];
+	};
+
+#ifdef __linux__
+	static void ShmFutexWait(std::atomic<std::uint32_t>* word, std::uint32_t expected, std::int64_t timeout)
+	{
+		timespec ts;
+		ts.tv_sec = timeout / 1000;
+		ts.tv_nsec = (timeout % 1000) * 1000000;
+
+		// Not FUTEX_PRIVATE_FLAG, the word is shared between processes
+		::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(word), FUTEX_WAIT, expected, &ts, nullptr, 0);
+	}
+
+	static void ShmFutexWake(std::atomic<std::uint32_t>* word)
+	{
+		::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+	}
+#endif
+
+	ShmChannel::~ShmChannel()
+	{
+#ifdef __linux__
+		if(_segment)
+		{
+			close();
+			::munmap(_segment, _map_size);
+		}
+		unlink();
+#endif
+	}
+
+	bool ShmChannel::Supported()
+	{
+#ifdef __linux__
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	std::unique_ptr<ShmChannel> ShmChannel::Create(std::uint64_t headersize, std::uint64_t headeroffset, std::uint64_t ringsize)
+	{
+#ifdef __linux__
+		std::unique_ptr<ShmChannel> channel(new ShmChannel());
+		channel->_name = "/mxevt-" + std::to_string(::getpid()) + "-" + std::to_string(_shm_name_counter++);
+		channel->_ring_size = ringsize;
+		channel->_map_size = sizeof(Segment) + 2 * ringsize;
+		channel->_header_size = headersize;
+		channel->_header_size_offset = headeroffset;
+		channel->_server = false;
+
+		int fd = ::shm_open(channel->_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+		if(fd < 0)
+		{
+			LogError("[shm] Failed to create shared memory segment <%s>.", channel->_name.c_str());
+			return nullptr;
+		}
+		channel->_linked = true;
+
+		if(::ftruncate(fd, static_cast<off_t>(channel->_map_size)) < 0)
+		{
+			LogError("[shm] Failed to size shared memory segment <%s>.", channel->_name.c_str());
+			::close(fd);
+			return nullptr;
+		}
+
+		void* memory = ::mmap(nullptr, channel->_map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		::close(fd);
+		if(memory == MAP_FAILED)
+		{
+			LogError("[shm] Failed to map shared memory segment <%s>.", channel->_name.c_str());
+			return nullptr;
+		}
+
+		channel->_segment = new(memory) Segment();
+		channel->_segment->_version = SHM_VERSION;
+		channel->_segment->_ring_size = ringsize;
+		channel->_segment->_accepted.store(0);
+		channel->_segment->_closed.store(0);
+		for(Ring& ring : channel->_segment->_rings)
+		{
+			ring._head.store(0);
+			ring._tail.store(0);
+			ring._data_seq.store(0);
+			ring._consumer_waiting.store(0);
+			ring._space_seq.store(0);
+			ring._producer_waiting.store(0);
+		}
+
+		// Publish last
+		channel->_segment->_magic.store(SHM_MAGIC);
+		LogTrace("[shm] Created segment <%s>.", channel->_name.c_str());
+		return channel;
+#else
+		static_cast<void>(headersize);
+		static_cast<void>(headeroffset);
+		static_cast<void>(ringsize);
+		return nullptr;
+#endif
+	}
+
+	std::unique_ptr<ShmChannel> ShmChannel::Open(const std::string& name, std::uint64_t headersize, std::uint64_t headeroffset)
+	{
+#ifdef __linux__
+		int fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+		if(fd < 0)
+		{
+			LogWarning("[shm] Failed to open shared memory segment <%s>.", name.c_str());
+			return nullptr;
+		}
+
+		struct stat st;
+		if(::fstat(fd, &st) < 0 || static_cast<std::uint64_t>(st.st_size) < sizeof(Segment))
+		{
+			LogError("[shm] Shared memory segment <%s> is too small.", name.c_str());
+			::close(fd);
+			return nullptr;
+		}
+
+		void* memory = ::mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		::close(fd);
+		if(memory == MAP_FAILED)
+		{
+			LogError("[shm] Failed to map shared memory segment <%s>.", name.c_str());
+			return nullptr;
+		}
+
+		std::unique_ptr<ShmChannel> channel(new ShmChannel());
+		channel->_name = name;
+		channel->_segment = static_cast<Segment*>(memory);
+		channel->_map_size = st.st_size;
+		channel->_header_size = headersize;
+		channel->_header_size_offset = headeroffset;
+		channel->_server = true;
+
+		if(channel->_segment->_magic.load() != SHM_MAGIC
+		|| channel->_segment->_version != SHM_VERSION
+		|| sizeof(Segment) + 2 * channel->_segment->_ring_size != channel->_map_size)
+		{
+			LogError("[shm] Shared memory segment <%s> has an invalid layout.", name.c_str());
+			return nullptr;
+		}
+
+		channel->_ring_size = channel->_segment->_ring_size;
+		LogTrace("[shm] Opened segment <%s>.", name.c_str());
+		return channel;
+#else
+		static_cast<void>(name);
+		static_cast<void>(headersize);
+		static_cast<void>(headeroffset);
+		return nullptr;
+#endif
+	}
+
+	const std::string& ShmChannel::name() const
+	{
+		return _name;
+	}
+
+	void ShmChannel::accept()
+	{
+#ifdef __linux__
+		_segment->_accepted.store(1);
+		ShmFutexWake(&_segment->_accepted);
+#endif
+	}
+
+	bool ShmChannel::waitAccepted(std::int64_t timeout)
+	{
+#ifdef __linux__
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+		while(_segment->_accepted.load() == 0)
+		{
+			std::int64_t remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+			if(remaining <= 0)
+			{
+				return false;
+			}
+			ShmFutexWait(&_segment->_accepted, 0, remaining);
+		}
+		return true;
+#else
+		static_cast<void>(timeout);
+		return false;
+#endif
+	}
+
+	void ShmChannel::unlink()
+	{
+#ifdef __linux__
+		// Once both sides have it mapped the name is no longer needed
+		// This way nothing is left behind if any of the processes crash
+		if(_linked)
+		{
+			::shm_unlink(_name.c_str());
+			_linked = false;
+		}
+#endif
+	}
+
+	ShmChannel::Ring* ShmChannel::txRing() const
+	{
+		return &_segment->_rings[_server ? 1 : 0];
+	}
+
+	ShmChannel::Ring* ShmChannel::rxRing() const
+	{
+		return &_segment->_rings[_server ? 0 : 1];
+	}
+
+	std::uint8_t* ShmChannel::txData() const
+	{
+		return reinterpret_cast<std::uint8_t*>(_segment + 1) + (_server ? _ring_size : 0);
+	}
+
+	std::uint8_t* ShmChannel::rxData() const
+	{
+		return reinterpret_cast<std::uint8_t*>(_segment + 1) + (_server ? 0 : _ring_size);
+	}
+
+	bool ShmChannel::write(const SocketBuffer* parts, std::uint64_t count)
+	{
+#ifdef __linux__
+		std::uint64_t total = 0;
+		for(std::uint64_t i = 0; i < count; i++) total += parts[i].len;
+
+		if(total > _ring_size)
+		{
+			LogError("[shm] Frame of size %llu does not fit the ring.", total);
+			return false;
+		}
+
+		// NOTE: (Cesar) Multiple local threads may emit, the ring is single producer
+		std::unique_lock<std::mutex> lock(_write_mutex);
+		Ring* ring = txRing();
+		std::uint8_t* data = txData();
+		const std::uint64_t head = ring->_head.load(std::memory_order_relaxed);
+
+		while(_ring_size - (head - ring->_tail.load(std::memory_order_acquire)) < total)
+		{
+			if(_segment->_closed.load())
+			{
+				return false;
+			}
+
+			// Raise the waiter count before re-checking so the consumer wake is never missed
+			const std::uint32_t seq = ring->_space_seq.load();
+			ring->_producer_waiting.fetch_add(1);
+			if(_ring_size - (head - ring->_tail.load()) < total)
+			{
+				ShmFutexWait(&ring->_space_seq, seq, SHM_WAIT_SLICE);
+			}
+			ring->_producer_waiting.fetch_sub(1);
+		}
+
+		std::uint64_t offset = head;
+		for(std::uint64_t i = 0; i < count; i++)
+		{
+			const std::uint64_t pos = offset % _ring_size;
+			const std::uint64_t first = std::min(parts[i].len, _ring_size - pos);
+			std::memcpy(data + pos, parts[i].data, first);
+			if(first < parts[i].len)
+			{
+				std::memcpy(data, parts[i].data + first, parts[i].len - first);
+			}
+			offset += parts[i].len;
+		}
+
+		ring->_head.store(head + total, std::memory_order_release);
+		ring->_data_seq.fetch_add(1);
+		if(ring->_consumer_waiting.load() > 0)
+		{
+			ShmFutexWake(&ring->_data_seq);
+		}
+		return true;
+#else
+		static_cast<void>(parts);
+		static_cast<void>(count);
+		return false;
+#endif
+	}
+
+	bool ShmChannel::read(FrameFunc func)
+	{
+#ifdef __linux__
+		Ring* ring = rxRing();
+		const std::uint8_t* data = rxData();
+		std::uint64_t tail = ring->_tail.load(std::memory_order_relaxed);
+		std::uint64_t head = ring->_head.load(std::memory_order_acquire);
+
+		// Wait for data
+		while(head == tail)
+		{
+			if(_segment->_closed.load())
+			{
+				return false;
+			}
+
+			const std::uint32_t seq = ring->_data_seq.load();
+			ring->_consumer_waiting.fetch_add(1);
+			head = ring->_head.load();
+			if(head == tail)
+			{
+				ShmFutexWait(&ring->_data_seq, seq, SHM_WAIT_SLICE);
+				head = ring->_head.load(std::memory_order_acquire);
+			}
+			ring->_consumer_waiting.fetch_sub(1);
+		}
+
+		// Drain all of the complete frames (the producer only publishes whole frames)
+		while(tail != head)
+		{
+			// NOTE: (Cesar) The ring is written by the peer process so nothing in it is trusted
+			// 				 A frame that does not fit what was published means the peer is broken
+			const std::uint64_t available = head - tail;
+			if(available < _header_size || available > _ring_size)
+			{
+				LogError("[shm] Invalid ring state on <%s> (%llu bytes published). Closing the channel.", _name.c_str(), available);
+				close();
+				return false;
+			}
+
+			std::uint32_t payloadsize;
+			std::uint8_t* psize = reinterpret_cast<std::uint8_t*>(&payloadsize);
+			for(std::uint64_t i = 0; i < sizeof(std::uint32_t); i++)
+			{
+				psize[i] = data[(tail + _header_size_offset + i) % _ring_size];
+			}
+
+			const std::uint64_t framesize = _header_size + payloadsize;
+			if(framesize > available || framesize > _ring_size)
+			{
+				LogError("[shm] Frame of size %llu on <%s> exceeds the %llu bytes published. Closing the channel.", framesize, _name.c_str(), available);
+				close();
+				return false;
+			}
+			const std::uint64_t pos = tail % _ring_size;
+			if(pos + framesize <= _ring_size)
+			{
+				func(data + pos, framesize);
+			}
+			else
+			{
+				// Wrapped frame
+				const std::uint64_t first = _ring_size - pos;
+				_scratch.resize(framesize);
+				std::memcpy(_scratch.data(), data + pos, first);
+				std::memcpy(_scratch.data() + first, data, framesize - first);
+				func(_scratch.data(), framesize);
+			}
+
+			tail += framesize;
+			ring->_tail.store(tail, std::memory_order_release);
+			ring->_space_seq.fetch_add(1);
+			if(ring->_producer_waiting.load() > 0)
+			{
+				ShmFutexWake(&ring->_space_seq);
+			}
+		}
+		return true;
+#else
+		static_cast<void>(func);
+		return false;
+#endif
+	}
+
+	void ShmChannel::close()
+	{
+#ifdef __linux__
+		if(!_segment)
+		{
+			return;
+		}
+
+		_segment->_closed.store(1);
+		for(Ring& ring : _segment->_rings)
+		{
+			ring._data_seq.fetch_add(1);
+			ring._space_seq.fetch_add(1);
+			ShmFutexWake(&ring._data_seq);
+			ShmFutexWake(&ring._space_seq);
+		}
+#endif
+	}
+} // namespace mulex
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "socket.h"
+
+namespace mulex
+{
+	static constexpr std::uint64_t SHM_RING_SIZE = 0x1000000; // 16MB per direction
+	static constexpr std::uint32_t SHM_MAGIC = 0x4853584D; // 'MXSH'
+	static constexpr std::uint32_t SHM_VERSION = 1;
+	static constexpr std::int64_t  SHM_WAIT_SLICE = 100; // ms
+
+	// NOTE: (Cesar) Same host transport
+	// 				 A single shared memory segment holds one SPSC byte ring per direction
+	// 				 Frames keep the same headersize/headeroffset framing as the sockets
+	// 				 and are handed to the reader in place (only wrapped frames are copied)
+	// 				 Waiting is done on process shared futexes (linux only)
+	class ShmChannel
+	{
+	public:
+		using FrameFunc = std::function<void(const std::uint8_t* frame, std::uint64_t size)>;
+
+		~ShmChannel();
+		ShmChannel(const ShmChannel&) = delete;
+		ShmChannel& operator=(const ShmChannel&) = delete;
+
+		// The client creates the segment, the server opens it by name
+		static std::unique_ptr<ShmChannel> Create(std::uint64_t headersize, std::uint64_t headeroffset, std::uint64_t ringsize = SHM_RING_SIZE);
+		static std::unique_ptr<ShmChannel> Open(const std::string& name, std::uint64_t headersize, std::uint64_t headeroffset);
+		static bool Supported();
+
+		const std::string& name() const;
+		void accept();
+		bool waitAccepted(std::int64_t timeout);
+		void unlink();
+
+		bool write(const SocketBuffer* parts, std::uint64_t count);
+		bool read(FrameFunc func);
+		void close();
+
+	private:
+		struct Ring;
+		struct Segment;
+		ShmChannel() = default;
+		Ring* txRing() const;
+		Ring* rxRing() const;
+		std::uint8_t* txData() const;
+		std::uint8_t* rxData() const;
+
+	private:
+		std::string 			  _name;
+		Segment* 				  _segment = nullptr;
+		std::uint64_t 			  _map_size = 0;
+		std::uint64_t 			  _ring_size = 0;
+		std::uint64_t 			  _header_size = 0;
+		std::uint64_t 			  _header_size_offset = 0;
+		bool 					  _server = false;
+		bool 					  _linked = false;
+		std::mutex 				  _write_mutex;
+		std::vector<std::uint8_t> _scratch;
+	};
+} // namespace mulex
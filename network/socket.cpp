@@ -7,11 +7,18 @@
 #include <cerrno>
 #ifdef __unix__
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <netdb.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <limits.h>
+#include <sys/uio.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
 #else
 #define _WINSOCK_DEPRECATED_NO_WARNINGS
 #include <ws2tcpip.h>
@@ -21,7 +28,10 @@
 
 #include "../mxlogger.h"
 
+#include <chrono>
 #include <cstring>
+#include <vector>
+#include <algorithm>
 
 #include <tracy/Tracy.hpp>
 
@@ -147,6 +157,19 @@ namespace mulex
 #endif
 	}
 
+	// NOTE: (Cesar) Disables Nagle's algorithm
+	// 				 Small request frames otherwise wait for the ack of the previous ones (~40ms with delayed ack)
+	bool SocketSetNoDelay(const Socket& socket)
+	{
+		ZoneScoped;
+		if(!SocketCheckStatus(socket))
+		{
+			return false;
+		}
+		int nodelay = 1;
+		return (::setsockopt(socket._handle, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&nodelay), sizeof(nodelay)) == 0);
+	}
+
 	bool SocketAwaitConnection(Socket& socket, std::int64_t timeout)
 	{
 		fd_set wait;
@@ -302,20 +325,154 @@ namespace mulex
 #endif
 	}
 
-	SocketResult SocketSendBytes(const Socket& socket, std::uint8_t* buffer, std::uint64_t len)
+#ifdef __unix__
+	static bool SocketWaitWritable(const Socket& socket)
+	{
+		pollfd pfd;
+		pfd.fd = socket._handle;
+		pfd.events = POLLOUT;
+		pfd.revents = 0;
+		return ::poll(&pfd, 1, -1) > 0 && !(pfd.revents & (POLLERR | POLLHUP | POLLNVAL));
+	}
+#endif
+
+	SocketResult SocketSendBytes(const Socket& socket, const std::uint8_t* buffer, std::uint64_t len)
 	{
 		ZoneScoped;
+		std::uint64_t offset = 0;
+		while(offset < len)
+		{
 #ifdef __unix__
-		int ret = ::send(socket._handle, buffer, len, MSG_NOSIGNAL);
+			ssize_t ret = ::send(socket._handle, buffer + offset, len - offset, MSG_NOSIGNAL);
+			if(ret < 0)
+			{
+				if(errno == EINTR)
+				{
+					continue;
+				}
+
+				if((errno == EAGAIN || errno == EWOULDBLOCK) && SocketWaitWritable(socket))
+				{
+					continue;
+				}
+			}
 #else
-		int ret = ::send(socket._handle, reinterpret_cast<char*>(buffer), len, 0);
+			int ret = ::send(socket._handle, reinterpret_cast<const char*>(buffer + offset), static_cast<int>(len - offset), 0);
 #endif
-		if(ret < 0)
+			if(ret < 0)
+			{
+				LogError("Failed to send data.");
+				return SocketResult::ERROR;
+			}
+
+			// Short writes are not an error, keep sending the remainder
+			offset += static_cast<std::uint64_t>(ret);
+		}
+
+		return SocketResult::OK;
+	}
+
+	SocketResult SocketSendVec(const Socket& socket, const SocketBuffer* buffers, std::uint64_t count, std::uint64_t* nsyscalls)
+	{
+		ZoneScoped;
+		if(nsyscalls) *nsyscalls = 0;
+
+		// NOTE: (Cesar) A short write is not an error, advance the
+		// 				 scatter list past what was sent and try again
+#ifdef __unix__
+		std::vector<iovec> iov(count);
+		for(std::uint64_t i = 0; i < count; i++)
 		{
-			LogError("Failed to send data.");
-			return SocketResult::ERROR;
+			iov[i].iov_base = const_cast<std::uint8_t*>(buffers[i].data);
+			iov[i].iov_len = buffers[i].len;
+		}
+
+		std::uint64_t first = 0;
+		while(first < count)
+		{
+			if(iov[first].iov_len == 0)
+			{
+				first++;
+				continue;
+			}
+
+			msghdr msg;
+			std::memset(&msg, 0, sizeof(msg));
+			msg.msg_iov = iov.data() + first;
+			msg.msg_iovlen = std::min<std::uint64_t>(count - first, IOV_MAX);
+
+			ssize_t ret = ::sendmsg(socket._handle, &msg, MSG_NOSIGNAL);
+			if(nsyscalls) (*nsyscalls)++;
+
+			if(ret < 0)
+			{
+				if(errno == EINTR)
+				{
+					continue;
+				}
+
+				if((errno == EAGAIN || errno == EWOULDBLOCK) && SocketWaitWritable(socket))
+				{
+					continue;
+				}
+
+				LogError("Failed to send data.");
+				return SocketResult::ERROR;
+			}
+
+			std::uint64_t sent = static_cast<std::uint64_t>(ret);
+			while(first < count && sent >= iov[first].iov_len)
+			{
+				sent -= iov[first].iov_len;
+				first++;
+			}
+
+			if(sent > 0)
+			{
+				iov[first].iov_base = static_cast<std::uint8_t*>(iov[first].iov_base) + sent;
+				iov[first].iov_len -= sent;
+			}
+		}
+#else
+		std::vector<WSABUF> wsabuf(count);
+		for(std::uint64_t i = 0; i < count; i++)
+		{
+			wsabuf[i].buf = reinterpret_cast<char*>(const_cast<std::uint8_t*>(buffers[i].data));
+			wsabuf[i].len = static_cast<ULONG>(buffers[i].len);
 		}
 
+		std::uint64_t first = 0;
+		while(first < count)
+		{
+			if(wsabuf[first].len == 0)
+			{
+				first++;
+				continue;
+			}
+
+			DWORD sent = 0;
+			int ret = ::WSASend(socket._handle, wsabuf.data() + first, static_cast<DWORD>(count - first), &sent, 0, nullptr, nullptr);
+			if(nsyscalls) (*nsyscalls)++;
+
+			if(ret == SOCKET_ERROR)
+			{
+				LogError("Failed to send data.");
+				return SocketResult::ERROR;
+			}
+
+			while(first < count && sent >= wsabuf[first].len)
+			{
+				sent -= wsabuf[first].len;
+				first++;
+			}
+
+			if(sent > 0)
+			{
+				wsabuf[first].buf += sent;
+				wsabuf[first].len -= sent;
+			}
+		}
+#endif
 		return SocketResult::OK;
 	}
 
@@ -419,4 +576,156 @@ namespace mulex
 #endif
 	}
 
+	static SocketResult SocketPollReadable(const Socket& socket, std::int64_t timeout, const SocketNotifier* notifier, bool* notified)
+	{
+		*notified = false;
+#ifdef __linux__
+		pollfd pfd[2];
+		pfd[0].fd = socket._handle;
+		pfd[0].events = POLLIN;
+		pfd[0].revents = 0;
+		nfds_t nfds = 1;
+		if(notifier && notifier->_handle >= 0)
+		{
+			pfd[1].fd = notifier->_handle;
+			pfd[1].events = POLLIN;
+			pfd[1].revents = 0;
+			nfds = 2;
+		}
+
+		int res;
+		do
+		{
+			res = ::poll(pfd, nfds, static_cast<int>(timeout));
+		} while(res < 0 && errno == EINTR);
+
+		if(res < 0)
+		{
+			LogError("Socket poll error.");
+			return SocketResult::ERROR;
+		}
+
+		if(nfds == 2 && pfd[1].revents)
+		{
+			*notified = true;
+			return SocketResult::TIMEOUT;
+		}
+		return pfd[0].revents ? SocketResult::OK : SocketResult::TIMEOUT;
+#else
+		static_cast<void>(notifier);
+		const std::int64_t slice = (timeout < 0 || timeout > SOCKET_WAIT_SLICE) ? SOCKET_WAIT_SLICE : timeout;
+#ifdef __unix__
+		pollfd pfd;
+		pfd.fd = socket._handle;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		int res = ::poll(&pfd, 1, static_cast<int>(slice));
+#else
+		WSAPOLLFD pfd;
+		pfd.fd = socket._handle;
+		pfd.events = POLLRDNORM;
+		pfd.revents = 0;
+		int res = ::WSAPoll(&pfd, 1, static_cast<INT>(slice));
+#endif
+		if(res < 0)
+		{
+			LogError("Socket poll error.");
+			return SocketResult::ERROR;
+		}
+		return (res > 0) ? SocketResult::OK : SocketResult::TIMEOUT;
+#endif
+	}
+
+	SocketResult SocketWaitReadable(const Socket& socket, std::int64_t timeout, const SocketNotifier* notifier)
+	{
+		ZoneScoped;
+		// Returns OK if there is something to read (or the peer is gone, recv will tell)
+		// and TIMEOUT if the timeout expired or the notifier was signaled
+		bool notified;
+		return SocketPollReadable(socket, timeout, notifier, &notified);
+	}
+
+	SocketResult SocketRecvExact(const Socket& socket, std::uint8_t* buffer, std::uint64_t len, std::int64_t timeout, const SocketNotifier* notifier)
+	{
+		ZoneScoped;
+		// Blocks until len bytes arrive, timeout is the total time in ms (-1 waits forever)
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+		std::uint64_t offset = 0;
+		while(offset < len)
+		{
+			std::uint64_t rlen;
+			SocketResult res = SocketRecvBytes(socket, buffer + offset, len - offset, &rlen);
+			if(res == SocketResult::ERROR || res == SocketResult::DISCONNECT)
+			{
+				return res;
+			}
+
+			if(res == SocketResult::OK)
+			{
+				offset += rlen;
+				continue;
+			}
+
+			std::int64_t remaining = -1;
+			if(timeout >= 0)
+			{
+				remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+				if(remaining <= 0)
+				{
+					return SocketResult::TIMEOUT;
+				}
+			}
+
+			bool notified;
+			res = SocketPollReadable(socket, remaining, notifier, &notified);
+			if(res == SocketResult::ERROR)
+			{
+				return res;
+			}
+
+			if(notified)
+			{
+				return SocketResult::TIMEOUT;
+			}
+		}
+		return SocketResult::OK;
+	}
+
+	SocketNotifier SocketNotifierInit()
+	{
+		SocketNotifier notifier;
+#ifdef __linux__
+		notifier._handle = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if(notifier._handle < 0)
+		{
+			LogError("Failed to create socket notifier.");
+		}
+#endif
+		return notifier;
+	}
+
+	void SocketNotifierSignal(const SocketNotifier& notifier)
+	{
+#ifdef __linux__
+		if(notifier._handle >= 0)
+		{
+			std::uint64_t one = 1;
+			[[maybe_unused]] auto w = ::write(notifier._handle, &one, sizeof(one));
+		}
+#else
+		static_cast<void>(notifier);
+#endif
+	}
+
+	void SocketNotifierClose(SocketNotifier& notifier)
+	{
+#ifdef __linux__
+		if(notifier._handle >= 0)
+		{
+			::close(notifier._handle);
+		}
+#endif
+		notifier._handle = -1;
+	}
+
 } // namespace mulex
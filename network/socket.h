@@ -37,17 +37,40 @@ namespace mulex
 		TIMEOUT
 	};
 
+	struct SocketBuffer
+	{
+		const std::uint8_t* data;
+		std::uint64_t 		len;
+	};
+
+	// NOTE: (Cesar) Wakes up threads blocked on SocketWaitReadable (eventfd under linux)
+	// 				 Once signaled it stays signaled, it is meant for shutdown
+	// 				 Other platforms have no notifier, waits are done in SOCKET_WAIT_SLICE steps
+	struct SocketNotifier
+	{
+		int _handle = -1;
+	};
+
+	static constexpr std::int64_t SOCKET_WAIT_SLICE = 100; // ms
+
 	bool operator<(const Socket& lhs, const Socket& rhs);
 
 	Socket SocketInit();
 	void SocketBindListen(Socket& socket, std::uint16_t port);
 	bool SocketSetNonBlocking(const Socket& socket);
 	bool SocketSetBlocking(const Socket& socket);
+	bool SocketSetNoDelay(const Socket& socket);
 	bool SocketAwaitConnection(Socket& socket, std::int64_t timeout);
 	Socket SocketAccept(const Socket& socket, bool* would_block);
 	SocketResult SocketRecvBytes(const Socket& socket, std::uint8_t* buffer, std::uint64_t len, std::uint64_t* rlen);
-	SocketResult SocketSendBytes(const Socket& socket, std::uint8_t* buffer, std::uint64_t len);
+	SocketResult SocketSendBytes(const Socket& socket, const std::uint8_t* buffer, std::uint64_t len);
+	SocketResult SocketSendVec(const Socket& socket, const SocketBuffer* buffers, std::uint64_t count, std::uint64_t* nsyscalls = nullptr);
 	void SocketConnect(Socket& socket, const std::string& hostname, std::uint16_t port, std::int64_t timeout = 0);
 	void SocketClose(Socket& socket);
+	SocketResult SocketWaitReadable(const Socket& socket, std::int64_t timeout, const SocketNotifier* notifier = nullptr);
+	SocketResult SocketRecvExact(const Socket& socket, std::uint8_t* buffer, std::uint64_t len, std::int64_t timeout, const SocketNotifier* notifier = nullptr);
+	SocketNotifier SocketNotifierInit();
+	void SocketNotifierSignal(const SocketNotifier& notifier);
+	void SocketNotifierClose(SocketNotifier& notifier);
 
 } // namespace mulex
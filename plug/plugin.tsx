@@ -309,9 +309,8 @@ const MyPlugin : Component<{ cleanup: (cb: () => void) => void }> = (props) => {
 					const [ukey, setUkey] = createSignal<string>('');
 
 					MxWebsocket.instance.subscribe('mxevt::rdbw-6c83cf8ccd1e32e6', (data: Uint8Array) => {
-						const key = MxGenericType.fromData(data).astype('string');
-						const value = MxGenericType.fromData(data.subarray(512), 'generic').astype('uint64');
-						setUvar(value);
+						const [key, value] = MxRdb.decodeWatchEvent(data);
+						setUvar(value.astype('uint64'));
 						setUkey(key);
 					});
 
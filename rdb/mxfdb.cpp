@@ -13,7 +13,9 @@
 #include <iomanip>
 #include <unordered_map>
 
-static std::unordered_map<std::string, std::unique_ptr<mulex::SysBufferStack>> _fdb_chunk_stream;
+// NOTE: (Cesar) Bounded so the preloading thread does not read the whole file into memory
+static constexpr std::uint64_t FDB_CHUNK_QUEUE_SIZE = 16;
+static std::unordered_map<std::string, std::shared_ptr<mulex::SysRingQueue<std::vector<std::uint8_t>>>> _fdb_chunk_stream;
 static std::unordered_map<std::string, std::uint64_t> 		  				   _fdb_chunk_size_cache;
 static std::unordered_map<std::string, std::string> 		  				   _fdb_chunk_filepath_cache;
 static std::shared_mutex 							  		  				   _fdb_chunk_filepath_cache_lock;
@@ -69,7 +71,7 @@ namespace mulex
 		bool valid_insert;
 		std::tie(std::ignore, valid_insert) = _fdb_chunk_filepath_cache.emplace(handle.c_str(), path);
 		_fdb_chunk_size_cache.emplace(handle.c_str(), chunksz);
-		_fdb_chunk_stream.emplace(handle.c_str(), std::make_unique<SysBufferStack>());
+		_fdb_chunk_stream.emplace(handle.c_str(), std::make_shared<SysRingQueue<std::vector<std::uint8_t>>>(FDB_CHUNK_QUEUE_SIZE));
 
 		if(!valid_insert)
 		{
@@ -84,7 +86,14 @@ namespace mulex
 		std::unique_lock lock(_fdb_chunk_filepath_cache_lock);
 		_fdb_chunk_filepath_cache.erase(handle.c_str());
 		_fdb_chunk_size_cache.erase(handle.c_str());
-		_fdb_chunk_stream.erase(handle.c_str());
+
+		// Release the preloading thread if it is still waiting on a full queue
+		auto stream = _fdb_chunk_stream.find(handle.c_str());
+		if(stream != _fdb_chunk_stream.end())
+		{
+			stream->second->requestUnblock();
+			_fdb_chunk_stream.erase(stream);
+		}
 	}
 
 	static std::uint64_t FdbCacheTransferGetChunkSize(const FdbHandle& handle)
@@ -113,7 +122,7 @@ namespace mulex
 		return file_path->second;
 	}
 
-	static SysBufferStack* FdbCacheTransferGetStream(const FdbHandle& handle)
+	static std::shared_ptr<SysRingQueue<std::vector<std::uint8_t>>> FdbCacheTransferGetStream(const FdbHandle& handle)
 	{
 		std::shared_lock lock(_fdb_chunk_filepath_cache_lock);
 		auto stream = _fdb_chunk_stream.find(handle.c_str());
@@ -123,7 +132,7 @@ namespace mulex
 			return nullptr;
 		}
 
-		return stream->second.get();
+		return stream->second;
 	}
 
 	static void FdbInitTables()
@@ -436,7 +445,7 @@ namespace mulex
 
 		// Start preloading chunks in the cache
 		std::thread([handle, chunksize]() {
-			SysBufferStack* stream = FdbCacheTransferGetStream(handle);
+			std::shared_ptr<SysRingQueue<std::vector<std::uint8_t>>> stream = FdbCacheTransferGetStream(handle);
 			std::string path = FdbCacheTransferGetPath(handle);
 			
 			std::ifstream file(path, std::ios::binary);
@@ -462,7 +471,11 @@ namespace mulex
 				for(int i = 0; i < 8; i++) ibuf.push_back(static_cast<std::uint8_t>(size >> (i * 8))); // Bytearray size
 				ibuf.insert(ibuf.end(), buffer.begin(), buffer.end()); // Bytearray
 
-				stream->push(ibuf);
+				if(!stream->push(std::move(ibuf)))
+				{
+					// Transfer was finalized before reading the whole file
+					break;
+				}
 			}
 		}).detach();
 
@@ -472,7 +485,7 @@ namespace mulex
 	mulex::RPCGenericType FdbChunkedDownloadReceive(mulex::PdbString handle)
 	{
 		std::string path = FdbCacheTransferGetPath(handle);
-		SysBufferStack* stream = FdbCacheTransferGetStream(handle);
+		std::shared_ptr<SysRingQueue<std::vector<std::uint8_t>>> stream = FdbCacheTransferGetStream(handle);
 
 		if(path.empty() || stream == nullptr)
 		{
@@ -485,7 +498,7 @@ namespace mulex
 
 	bool FdbChunkedDownloadEnd(mulex::PdbString handle)
 	{
-		SysBufferStack* stream = FdbCacheTransferGetStream(handle);
+		std::shared_ptr<SysRingQueue<std::vector<std::uint8_t>>> stream = FdbCacheTransferGetStream(handle);
 		if(stream != nullptr && stream->size() != 0)
 		{
 			LogError("[fdb] Donwload End was called, but chunks are still pending.");
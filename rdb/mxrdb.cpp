@@ -46,10 +46,11 @@ static RdbStatistics                _rdb_statistics;
 static std::unique_ptr<std::thread> _rdb_statistics_thread;
 static std::atomic<bool> 			_rdb_statistics_flag;
 
+// NOTE: (Cesar) _data holds the key (null terminated, _keysize bytes) followed by _size bytes of value
 struct RdbHistoryData
 {
-	mulex::RdbKeyName   _key;
 	mulex::RdbValueType _type;
+	std::uint16_t 		_keysize;
 	std::uint64_t 		_size;
 	std::int64_t  		_timestamp;
 	std::uint8_t  		_data[];
@@ -423,14 +424,15 @@ namespace mulex
 		while(iterator < _rdb_history_offset)
 		{
 			RdbHistoryData* data = reinterpret_cast<RdbHistoryData*>(_rdb_history_handle + iterator);
+			const std::uint8_t* value = data->_data + data->_keysize;
 			history_writer(
 				std::nullopt,
-				data->_key,
+				PdbString(reinterpret_cast<const char*>(data->_data)),
 				data->_timestamp,
 				static_cast<std::uint8_t>(data->_type),
-				std::vector<std::uint8_t>(data->_data, data->_data + data->_size)
+				std::vector<std::uint8_t>(value, value + data->_size)
 			);
-			iterator += (sizeof(RdbHistoryData) + data->_size);
+			iterator += (sizeof(RdbHistoryData) + data->_keysize + data->_size);
 		}
 		
 		_rdb_history_offset = 0; // Reset the history memory cache
@@ -444,19 +446,26 @@ namespace mulex
 		std::unique_lock lock(_rdb_history_rw_lock);
 		std::uint64_t entry_data_size = RdbCalculateDataSize(entry);
 
-		if(_rdb_history_offset + sizeof(RdbHistoryData) + entry_data_size > _rdb_history_size)
+		// Only the used part of the key is cached
+		const std::uint64_t key_size = std::min<std::uint64_t>(key.size(), sizeof(RdbKeyName) - 1) + 1;
+		const std::uint64_t total_size = sizeof(RdbHistoryData) + key_size + entry_data_size;
+
+		if(_rdb_history_offset + total_size > _rdb_history_size)
 		{
 			RdbHistoryFlushUnlocked();
 		}
 
 		RdbHistoryData data;
 		data._timestamp = entry->_tmodified;
-		data._key = key;
 		data._type = entry->_type;
+		data._keysize = static_cast<std::uint16_t>(key_size);
 		data._size = entry_data_size;
-		std::memcpy(_rdb_history_handle + _rdb_history_offset, &data, sizeof(RdbHistoryData));
-		std::memcpy(_rdb_history_handle + _rdb_history_offset + sizeof(RdbHistoryData), entry->_ptr, entry_data_size);
-		_rdb_history_offset += (sizeof(RdbHistoryData) + entry_data_size);
+		std::uint8_t* ptr = _rdb_history_handle + _rdb_history_offset;
+		std::memcpy(ptr, &data, sizeof(RdbHistoryData));
+		std::memcpy(ptr + sizeof(RdbHistoryData), key.c_str(), key_size - 1);
+		ptr[sizeof(RdbHistoryData) + key_size - 1] = 0;
+		std::memcpy(ptr + sizeof(RdbHistoryData) + key_size, entry->_ptr, entry_data_size);
+		_rdb_history_offset += total_size;
 	}
 
 	static bool RdbGrow()
@@ -517,9 +526,13 @@ namespace mulex
 		std::string event_name = RdbMakeWatchEvent(swatch);
 		std::vector<std::uint8_t> evt_buffer;
 		std::uint64_t entry_data_size = RdbCalculateDataSize(entry);
-		evt_buffer.resize(sizeof(RdbKeyName) + sizeof(std::uint64_t) + entry_data_size);
-		std::uint64_t offset = EvtDataAppend(0, &evt_buffer, key);
-		offset = EvtDataAppend(offset, &evt_buffer, entry_data_size);
+
+		// NOTE: (Cesar) The key goes length prefixed (same as an RPC argument)
+		// 				 Layout: [u16 keysize][key][u64 datasize][data]
+		const std::uint64_t key_size = SysPackedSize(key);
+		evt_buffer.resize(key_size + sizeof(std::uint64_t) + entry_data_size);
+		SysPackArgumentTo(evt_buffer.data(), key);
+		std::uint64_t offset = EvtDataAppend(key_size, &evt_buffer, entry_data_size);
 		offset = EvtDataAppend(offset, &evt_buffer, entry->_ptr, entry_data_size);
 		// LogTrace("Emit watch event <%s> from swatch: <%s>.", event_name.c_str(), swatch.c_str());
 
@@ -1103,11 +1116,23 @@ namespace mulex
 		}
 		_swatch_event = exp.value()->_rpc_client->call<mulex::string32>(RPC_CALL_MULEX_RDBWATCH, RdbKeyName(_key)).c_str();
 		exp.value()->_evt_client->subscribe(_swatch_event, [=](const std::uint8_t* data, std::uint64_t len, const std::uint8_t* userdata) {
-			RdbKeyName key = reinterpret_cast<const char*>(data);
-			RPCGenericType value = RPCGenericType::FromData(
-				data + sizeof(RdbKeyName) + sizeof(std::uint64_t),
-				*reinterpret_cast<const std::uint64_t*>(data + sizeof(RdbKeyName))
-			);
+			// [u16 keysize][key][u64 size][data]
+			if(len < sizeof(std::uint16_t) || SysWireSize<RdbKeyName>(data) + sizeof(std::uint64_t) > len)
+			{
+				LogError("[rdb] Malformed watch event of size %llu.", len);
+				return;
+			}
+
+			const std::uint64_t key_size = SysWireSize<RdbKeyName>(data);
+			const std::uint64_t size = SysWireRead<std::uint64_t>(data + key_size);
+			if(size > len - key_size - sizeof(std::uint64_t))
+			{
+				LogError("[rdb] Malformed watch event of size %llu.", len);
+				return;
+			}
+
+			const RdbKeyName key = SysWireRead<RdbKeyName>(data);
+			RPCGenericType value = RPCGenericType::FromData(data + key_size + sizeof(std::uint64_t), size);
 			callback(key, value);
 		});
 	}
@@ -189,8 +189,8 @@ int main(int argc, char* argv[])
 	});
 
 	RexInlineServiceLoopFunction([]() {
+		// Blocks up to SOCKET_WAIT_SLICE waiting for connections
 		RexServerLoop();
-		std::this_thread::sleep_for(std::chrono::milliseconds(100));
 	});
 
 	RexInlineServiceCleanupFunction([]() {
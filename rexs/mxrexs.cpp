@@ -221,20 +221,11 @@ namespace mulex
 
 	static std::optional<RexCommand> RexServerProcessRequest(const Socket& client)
 	{
-		static std::uint8_t buffer[sizeof(RexCommand)];
-		std::uint64_t rlen, tsize = 0;
-		while(tsize < sizeof(RexCommand))
+		std::uint8_t buffer[sizeof(RexCommand)];
+		if(SocketRecvExact(client, buffer, sizeof(RexCommand), REX_TIMEOUT) != SocketResult::OK)
 		{
-			SocketResult res = SocketRecvBytes(client, &buffer[tsize], sizeof(RexCommand) - tsize, &rlen);
-			tsize += rlen;
-
-			if(res == SocketResult::ERROR || res == SocketResult::DISCONNECT)
-			{
-				LogError("[mxrexs] Could not process request.");
-				return std::nullopt;
-			}
-
-			std::this_thread::sleep_for(std::chrono::microseconds(50));
+			LogError("[mxrexs] Could not process request.");
+			return std::nullopt;
 		}
 
 		RexCommand command;
@@ -253,26 +244,16 @@ namespace mulex
 
 	static RexCommandStatus RexClientWaitResponse(const Socket& client)
 	{
-		static std::uint8_t buffer[sizeof(RexCommandStatus)];
-		std::uint64_t rlen, tsize = 0;
-		const std::int64_t ms = SysGetCurrentTime();
-		while(tsize < sizeof(RexCommandStatus))
+		std::uint8_t buffer[sizeof(RexCommandStatus)];
+		SocketResult res = SocketRecvExact(client, buffer, sizeof(RexCommandStatus), REX_TIMEOUT);
+		if(res == SocketResult::TIMEOUT)
 		{
-			SocketResult res = SocketRecvBytes(client, &buffer[tsize], sizeof(RexCommandStatus) - tsize, &rlen);
-			tsize += rlen;
-
-			if(res == SocketResult::ERROR || res == SocketResult::DISCONNECT)
-			{
-				LogError("[mxrexs] Could not process request.");
-				return RexCommandStatus::COMMAND_TX_ERROR;
-			}
-
-			if((SysGetCurrentTime() - ms >= REX_TIMEOUT))
-			{
-				return RexCommandStatus::COMMAND_TX_TIMEOUT;
-			}
-
-			std::this_thread::sleep_for(std::chrono::microseconds(50));
+			return RexCommandStatus::COMMAND_TX_TIMEOUT;
+		}
+		else if(res != SocketResult::OK)
+		{
+			LogError("[mxrexs] Could not process request.");
+			return RexCommandStatus::COMMAND_TX_ERROR;
 		}
 
 		RexCommandStatus command;
@@ -314,6 +295,12 @@ namespace mulex
 
 	void RexServerLoop()
 	{
+		// Sleep until a connection arrives, but return every slice so the service can stop
+		if(SocketWaitReadable(_server_socket, SOCKET_WAIT_SLICE) != SocketResult::OK)
+		{
+			return;
+		}
+
 		bool would_block;
 		Socket client = SocketAccept(_server_socket, &would_block);
 		if(would_block)
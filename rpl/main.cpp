@@ -0,0 +1,199 @@
+#include "../mxbackend.h"
+#include "../mxlogger.h"
+#include "../mxsystem.h"
+#include "../network/journal.h"
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+using namespace mulex;
+
+struct ReplayOptions
+{
+	std::string 		  _journal;
+	double 				  _speed = 1.0; // 0 = as fast as possible
+	double 				  _from = 0.0;  // Seconds since the start of the journal
+	bool 				  _loop = false;
+	std::set<std::string> _events;      // Empty replays every event
+};
+
+// NOTE: (Cesar) Re-emits the events of a journal recorded by mxmain (--evt-record or EvtRecordStart)
+// 				 Events are registered by name on the target experiment if they do not exist yet
+// 				 Fragmented events are put back together and dispatched whole
+class ReplayBackend : public MxBackend
+{
+public:
+	ReplayBackend(int argc, char* argv[], const ReplayOptions& options) : MxBackend(argc, argv), _options(options)
+	{
+		if(!checkStatus())
+		{
+			return;
+		}
+
+		_reader = JournalReader::Open(_options._journal);
+		if(!_reader)
+		{
+			log.error("Failed to open journal <%s>.", _options._journal.c_str());
+			terminate();
+			return;
+		}
+
+		log.info("Replaying <%s> (%.1fs) at %s.", _options._journal.c_str(), _reader->duration() / 1e9, _options._speed > 0.0 ? (std::to_string(_options._speed) + "x").c_str() : "max speed");
+	}
+
+	~ReplayBackend()
+	{
+		_replay_stop.store(true);
+		if(_replay_thread)
+		{
+			_replay_thread->join();
+		}
+	}
+
+	void start()
+	{
+		if(checkStatus() && _reader)
+		{
+			_replay_thread = std::make_unique<std::thread>(&ReplayBackend::replayThread, this);
+		}
+	}
+
+private:
+	const EvtHandle& handle(std::uint16_t eventid)
+	{
+		auto it = _handles.find(eventid);
+		if(it != _handles.end())
+		{
+			return it->second;
+		}
+
+		EvtHandle evt;
+		auto nameit = _reader->names().find(eventid);
+		if(nameit != _reader->names().end() && (_options._events.empty() || _options._events.contains(nameit->second)))
+		{
+			evt = findEvent(nameit->second);
+			if(!evt.valid())
+			{
+				evt = registerEvent(nameit->second);
+			}
+		}
+		return _handles.emplace(eventid, evt).first->second;
+	}
+
+	void dispatch(const EvtHandle& evt, const std::uint8_t* data, std::uint64_t len)
+	{
+		dispatchEvent(evt, data, len);
+		_replayed++;
+		_replayed_bytes += len;
+	}
+
+	void replayPass()
+	{
+		const std::uint64_t from = static_cast<std::uint64_t>(_options._from * 1e9);
+		_reader->seek(from);
+
+		JournalFrame frame;
+		std::optional<std::uint64_t> first;
+		const auto start = std::chrono::steady_clock::now();
+		while(!_replay_stop.load() && _reader->next(&frame))
+		{
+			if(frame._size < sizeof(EvtHeader))
+			{
+				continue;
+			}
+
+			const EvtHandle& evt = handle(frame._eventid);
+			if(!evt.valid())
+			{
+				continue;
+			}
+
+			if(_options._speed > 0.0)
+			{
+				if(!first.has_value())
+				{
+					first = frame._time;
+				}
+
+				// Keep the original spacing scaled by speed
+				const auto target = start + std::chrono::nanoseconds(static_cast<std::int64_t>((frame._time - first.value()) / _options._speed));
+				std::this_thread::sleep_until(target);
+			}
+
+			EvtHeader header;
+			std::memcpy(&header, frame._data, sizeof(EvtHeader));
+			const std::uint8_t* payload = frame._data + sizeof(EvtHeader);
+			std::uint64_t len = std::min<std::uint64_t>(header.payloadsize, frame._size - sizeof(EvtHeader));
+
+			// The original timestamps mean nothing now
+			// If tracing is on the client stamps the replayed events again
+			if((header.flags & EVT_FLAG_TRACE) && len >= sizeof(EvtTraceStamps))
+			{
+				len -= sizeof(EvtTraceStamps);
+			}
+
+			if(header.flags & EVT_FLAG_FRAGMENT)
+			{
+				header.payloadsize = static_cast<std::uint32_t>(len);
+				_reassembler.feed(header, payload, [this, &evt](const EvtHeader&, const std::uint8_t* data, std::uint64_t size) {
+					dispatch(evt, data, size);
+				});
+			}
+			else
+			{
+				dispatch(evt, payload, len);
+			}
+		}
+	}
+
+	void replayThread()
+	{
+		const auto start = std::chrono::steady_clock::now();
+		do
+		{
+			replayPass();
+		}
+		while(_options._loop && !_replay_stop.load());
+
+		const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		log.info("Replayed %llu events (%.1f MB) in %.2fs [%.0f evt/s].", _replayed, _replayed_bytes / 1e6, elapsed, _replayed / elapsed);
+		terminate();
+	}
+
+private:
+	ReplayOptions 								 _options;
+	std::unique_ptr<JournalReader> 				 _reader;
+	std::unordered_map<std::uint16_t, EvtHandle> _handles;
+	EvtReassembler 								 _reassembler;
+	std::unique_ptr<std::thread> 				 _replay_thread;
+	std::atomic<bool> 							 _replay_stop = false;
+	std::uint64_t 								 _replayed = 0;
+	std::uint64_t 								 _replayed_bytes = 0;
+};
+
+int main(int argc, char* argv[])
+{
+	ReplayOptions options;
+	SysAddArgument("journal", 'j', true, [&](const std::string& dir){ options._journal = dir; }, "Journal directory to replay.");
+	SysAddArgument("speed", 0, true, [&](const std::string& speed){ options._speed = std::stod(speed); }, "Replay speed multiplier (0 replays as fast as possible).");
+	SysAddArgument("from", 0, true, [&](const std::string& from){ options._from = std::stod(from); }, "Start replaying at the given time in seconds.");
+	SysAddArgument("loop", 0, false, [&](const std::string&){ options._loop = true; }, "Replay the journal until stopped.");
+	SysAddArgument("events", 0, true, [&](const std::string& events){
+		std::stringstream ss(events);
+		std::string event;
+		while(std::getline(ss, event, ','))
+		{
+			options._events.insert(event);
+		}
+	}, "Comma separated list of events to replay (defaults to all).");
+
+	ReplayBackend backend(argc, argv, options);
+	backend.init();
+	backend.start();
+	backend.spin();
+	return 0;
+}
@@ -27,5 +27,20 @@ int main()
 	ASSERT_THROW(t.m1 == rt.m1);
 	ASSERT_THROW(t.f() == rt.f());
 
+	// In place packing must match the allocating version byte for byte
+	std::vector<std::uint8_t> inplace(SysPackedSize(a0, a1, t));
+	SysPackArgumentsTo(inplace.data(), a0, a1, t);
+	ASSERT_THROW(inplace == buffer);
+
+	// Strings go length prefixed on the rpc wire
+	mxstring<512> key = "/system/run/status";
+	std::vector<std::uint8_t> wire(SysPackedSize(key, a0));
+	SysPackArgumentsTo(wire.data(), key, a0);
+	ASSERT_THROW(wire.size() == sizeof(std::uint16_t) + std::strlen(key.c_str()) + sizeof(int));
+	ASSERT_THROW(SysWireSize<mxstring<512>>(wire.data()) == wire.size() - sizeof(int));
+	ASSERT_THROW(std::strcmp(SysWireRead<mxstring<512>>(wire.data()).c_str(), key.c_str()) == 0);
+	ASSERT_THROW(SysWireRead<int>(wire.data() + wire.size() - sizeof(int)) == a0);
+	ASSERT_THROW(std::strcmp(SysWireRead<string32>(wire.data()).c_str(), key.c_str()) == 0);
+
 	return 0;
 }
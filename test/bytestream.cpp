@@ -0,0 +1,114 @@
+#include "../mxsystem.h"
+#include "test.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+// NOTE: (Cesar) Checks the SysByteStream ring framing with frames wrapping around the end,
+// 				 pushes split at random sizes and ring growth, then reports the frame throughput
+// 				 Usage: test_bytestream [nframes]
+
+using namespace mulex;
+
+struct StreamHeader
+{
+	std::uint32_t tag;
+	std::uint32_t payloadsize;
+	std::uint64_t sequence;
+};
+
+static void PushFrames(SysByteStream& stream, std::uint64_t nframes, std::uint32_t maxpayload, std::uint32_t maxchunk)
+{
+	std::mt19937 rng(42);
+	std::vector<std::uint8_t> frame;
+	for(std::uint64_t i = 0; i < nframes; i++)
+	{
+		StreamHeader header = { 0xCAFE, static_cast<std::uint32_t>(rng() % maxpayload), i };
+		frame.resize(sizeof(StreamHeader) + header.payloadsize);
+		std::memcpy(frame.data(), &header, sizeof(StreamHeader));
+		for(std::uint32_t k = 0; k < header.payloadsize; k++)
+		{
+			frame[sizeof(StreamHeader) + k] = static_cast<std::uint8_t>(i + k);
+		}
+
+		std::uint64_t offset = 0;
+		while(offset < frame.size())
+		{
+			std::uint64_t count = std::min<std::uint64_t>(frame.size() - offset, 1 + rng() % maxchunk);
+			stream.push(frame.data() + offset, count);
+			offset += count;
+		}
+	}
+}
+
+static void CheckFrames(SysByteStream& stream, std::uint64_t nframes)
+{
+	for(std::uint64_t i = 0; i < nframes; i++)
+	{
+		SysByteStream::FrameView view = stream.fetchView();
+		StreamHeader header;
+		std::memcpy(&header, view._data, sizeof(StreamHeader));
+		ASSERT_THROW(header.tag == 0xCAFE);
+		ASSERT_THROW(header.sequence == i);
+		ASSERT_THROW(view._size == sizeof(StreamHeader) + header.payloadsize);
+		for(std::uint32_t k = 0; k < header.payloadsize; k++)
+		{
+			ASSERT_THROW(view._data[sizeof(StreamHeader) + k] == static_cast<std::uint8_t>(i + k));
+		}
+		stream.release(view);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::uint64_t nframes = 200000;
+	if(argc > 1) nframes = std::stoull(argv[1]);
+
+	// Small ring so most frames wrap at some point
+	{
+		SysByteStream stream(1000, sizeof(StreamHeader), offsetof(StreamHeader, payloadsize));
+		std::thread producer(PushFrames, std::ref(stream), nframes, 300, 128);
+		CheckFrames(stream, nframes);
+		producer.join();
+	}
+
+	// Frames larger than the initial ring make it grow, trim() gives the memory back
+	{
+		SysByteStream stream(1000, sizeof(StreamHeader), offsetof(StreamHeader, payloadsize), 0x10000);
+		std::thread producer(PushFrames, std::ref(stream), nframes / 10, 20000, 4096);
+		CheckFrames(stream, nframes / 10);
+		producer.join();
+		ASSERT_THROW(stream.capacity() > 1024);
+		ASSERT_THROW(stream.trim());
+		ASSERT_THROW(stream.capacity() == 1024);
+	}
+
+	// Unblock wakes up a waiting consumer
+	{
+		SysByteStream stream(1000, sizeof(StreamHeader), offsetof(StreamHeader, payloadsize));
+		std::thread waiter([&](){ ASSERT_THROW(stream.fetchView()._size == 0); });
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		stream.requestUnblock();
+		waiter.join();
+	}
+
+	// Throughput with small frames on the default buffer size
+	{
+		SysByteStream stream(SYS_RECV_THREAD_BUFFER_SIZE, sizeof(StreamHeader), offsetof(StreamHeader, payloadsize));
+		timed_block tb("", false);
+		tb.mstart();
+		std::thread producer(PushFrames, std::ref(stream), nframes, 64, 32768);
+		CheckFrames(stream, nframes);
+		producer.join();
+		float ms = tb.mstop();
+		std::printf("%llu frames in %.1f ms (%.2f Mframes/s)\n", static_cast<unsigned long long>(nframes), ms, nframes / (ms * 1e3));
+	}
+
+	std::printf("OK\n");
+	return 0;
+}
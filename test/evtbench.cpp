@@ -0,0 +1,211 @@
+#include "../mxsystem.h"
+#include "../mxevt.h"
+#include "../mxlogger.h"
+#include "../network/socket.h"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#endif
+
+// NOTE: (Cesar) Compares the per connection threaded event server against the epoll reactor
+// 				 Every connection is a raw ghost client so no rdb / rpc server is required
+// 				 Usage: test_evtbench [nevents] [payload] [nloops]
+
+using namespace mulex;
+
+#ifdef __linux__
+struct BenchResult
+{
+	std::uint64_t threads;
+	std::uint64_t delivered;
+	double 		  cpu_us_per_event;
+	double 		  wall_ms;
+	double 		  frames_per_syscall;
+};
+
+static std::uint64_t GetProcessThreads()
+{
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while(std::getline(status, line))
+	{
+		if(line.rfind("Threads:", 0) == 0)
+		{
+			return std::stoull(line.substr(8));
+		}
+	}
+	return 0;
+}
+
+static double GetProcessCpuUs()
+{
+	rusage usage;
+	::getrusage(RUSAGE_SELF, &usage);
+	return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e6 + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+static void SendFrame(Socket& socket, std::uint64_t cid, std::uint16_t eid, const std::vector<std::uint8_t>& payload)
+{
+	std::vector<std::uint8_t> frame(sizeof(EvtHeader) + payload.size());
+	EvtHeader header{};
+	header.client = cid;
+	header.eventid = eid;
+	header.msgid = GetNextEventMessageId();
+	header.payloadsize = static_cast<std::uint32_t>(payload.size());
+	std::memcpy(frame.data(), &header, sizeof(EvtHeader));
+	if(!payload.empty())
+	{
+		std::memcpy(frame.data() + sizeof(EvtHeader), payload.data(), payload.size());
+	}
+	SocketSendBytes(socket, frame.data(), frame.size());
+}
+
+static BenchResult RunBench(EvtServerMode mode, std::uint32_t nloops, std::uint64_t nclients, std::uint16_t port, std::uint64_t nevents, std::uint64_t payload)
+{
+	BenchResult result = {};
+	EvtServerThread est(mode, nloops, port);
+	while(!est.ready())
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	EvtRegister("evtbench::event");
+	const std::uint16_t eid = EvtGetId("evtbench::event");
+	const std::uint16_t meta = EvtGetId("mxevt::getclientmeta");
+
+	// Ghost subscribers (empty metadata payload)
+	std::vector<Socket> clients(nclients);
+	for(std::uint64_t i = 0; i < nclients; i++)
+	{
+		clients[i] = SocketInit();
+		SocketConnect(clients[i], "localhost", port);
+		SendFrame(clients[i], (static_cast<std::uint64_t>(port) << 32) | (i + 1), meta, {});
+	}
+
+	Socket producer = SocketInit();
+	SocketConnect(producer, "localhost", port);
+	const std::uint64_t producer_id = (static_cast<std::uint64_t>(port) << 32) | 0xFFFFFFFF;
+	SendFrame(producer, producer_id, meta, {});
+
+	// There is no ack for the metadata frame, give the server time to register everyone
+	std::this_thread::sleep_for(std::chrono::milliseconds(500 + nclients));
+
+	for(std::uint64_t i = 0; i < nclients; i++)
+	{
+		EvtSubscribe((static_cast<std::uint64_t>(port) << 32) | (i + 1), eid, { EvtDeliveryPolicy::RELIABLE });
+	}
+
+	const std::uint64_t expected = nclients * nevents * (sizeof(EvtHeader) + payload);
+	std::uint64_t received = 0;
+	result.threads = GetProcessThreads();
+
+	EvtEmitCounters counters_start = EvtGetEmitCounters();
+	double cpu_start = GetProcessCpuUs();
+	std::int64_t start = SysGetCurrentTime();
+
+	std::thread reader([&](){
+		std::vector<pollfd> fds(nclients);
+		for(std::uint64_t i = 0; i < nclients; i++)
+		{
+			fds[i].fd = clients[i]._handle;
+			fds[i].events = POLLIN;
+		}
+
+		std::vector<std::uint8_t> scratch(1024 * 1024);
+		std::int64_t deadline = SysGetCurrentTime() + 60000;
+		while(received < expected && SysGetCurrentTime() < deadline)
+		{
+			if(::poll(fds.data(), fds.size(), 100) <= 0)
+			{
+				continue;
+			}
+
+			for(auto& fd : fds)
+			{
+				if(!(fd.revents & POLLIN))
+				{
+					continue;
+				}
+
+				std::int64_t res;
+				while((res = ::recv(fd.fd, scratch.data(), scratch.size(), MSG_DONTWAIT)) > 0)
+				{
+					received += static_cast<std::uint64_t>(res);
+				}
+			}
+		}
+	});
+
+	std::vector<std::uint8_t> data(payload, 0xAB);
+	for(std::uint64_t i = 0; i < nevents; i++)
+	{
+		SendFrame(producer, producer_id, eid, data);
+	}
+
+	reader.join();
+
+	result.wall_ms = static_cast<double>(SysGetCurrentTime() - start);
+	result.cpu_us_per_event = (GetProcessCpuUs() - cpu_start) / static_cast<double>(nevents * nclients);
+	result.delivered = received / (sizeof(EvtHeader) + payload);
+
+	// Emit thread batches or reactor gathered writes
+	EvtEmitCounters counters_end = EvtGetEmitCounters();
+	const std::uint64_t syscalls = counters_end._syscalls - counters_start._syscalls;
+	result.frames_per_syscall = syscalls > 0 ? static_cast<double>(counters_end._frames - counters_start._frames) / syscalls : 0.0;
+
+	for(auto& client : clients)
+	{
+		SocketClose(client);
+	}
+	SocketClose(producer);
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	return result;
+}
+
+int main(int argc, char* argv[])
+{
+	std::uint64_t nevents = 2000;
+	std::uint64_t payload = 64;
+	std::uint32_t nloops = std::max(std::thread::hardware_concurrency() / 2, 1U);
+
+	if(argc > 1) nevents = std::stoull(argv[1]);
+	if(argc > 2) payload = std::stoull(argv[2]);
+	if(argc > 3) nloops  = static_cast<std::uint32_t>(std::stoul(argv[3]));
+
+	std::uint16_t port = EVT_PORT + 100;
+	std::cout << "mode     clients  threads  delivered   wall[ms]  cpu/evt[us]  frames/syscall" << std::endl;
+	for(std::uint64_t nclients : { 10, 100, 500 })
+	{
+		for(EvtServerMode mode : { EvtServerMode::THREADED, EvtServerMode::REACTOR })
+		{
+			BenchResult r = RunBench(mode, nloops, nclients, port++, nevents, payload);
+			std::printf(
+				"%-8s %7llu  %7llu  %9llu  %9.1f  %11.3f  %14.2f\n",
+				mode == EvtServerMode::THREADED ? "threaded" : "reactor",
+				static_cast<unsigned long long>(nclients),
+				static_cast<unsigned long long>(r.threads),
+				static_cast<unsigned long long>(r.delivered),
+				r.wall_ms,
+				r.cpu_us_per_event,
+				r.frames_per_syscall
+			);
+		}
+	}
+	return 0;
+}
+#else
+int main(void)
+{
+	std::cout << "test_evtbench is only available under linux." << std::endl;
+	return 0;
+}
+#endif
@@ -0,0 +1,91 @@
+#include "../network/evtfilter.h"
+#include "test.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// NOTE: (Cesar) Checks the event filter language and reports the
+// 				 evaluation cost per frame for a few filter shapes
+// 				 Usage: test_evtfilter [nframes]
+
+using namespace mulex;
+
+static std::vector<std::uint8_t> MakePayload(std::uint16_t channel, float amplitude, std::uint8_t flags)
+{
+	std::vector<std::uint8_t> payload(64, 0);
+	std::memcpy(payload.data() + 8, &channel, sizeof(channel));
+	std::memcpy(payload.data() + 12, &amplitude, sizeof(amplitude));
+	payload[0] = flags;
+	return payload;
+}
+
+static bool Match(const std::string& source, const std::vector<std::uint8_t>& payload)
+{
+	std::unique_ptr<EvtFilter> filter = EvtFilter::Compile(source);
+	ASSERT_THROW(filter);
+	return filter->match(payload.data(), payload.size());
+}
+
+static void TestLanguage()
+{
+	const std::vector<std::uint8_t> payload = MakePayload(3, 0.75f, 0x7f);
+
+	ASSERT_THROW(Match("u16@8 == 3 && f32@12 > 0.5", payload));
+	ASSERT_THROW(!Match("u16@8 == 4 || f32@12 > 0.8", payload));
+	ASSERT_THROW(!Match("!(u8@0 == 0x7f)", payload));
+	ASSERT_THROW(Match("u16@8 != 3 || u16@8 <= 3", payload));
+	ASSERT_THROW(Match("u16@8 == 3 && (f32@12 > 0.8 || u8@0 >= 127)", payload));
+	ASSERT_THROW(Match("i8@0 > -1 && i32@20 == 0", payload));
+
+	// Reads past the payload are false
+	ASSERT_THROW(!Match("u64@60 == 0", payload));
+	ASSERT_THROW(Match("!(u64@60 == 0)", payload));
+
+	std::string error;
+	ASSERT_THROW(!EvtFilter::Compile("u8@0 ==", &error) && !error.empty());
+	ASSERT_THROW(!EvtFilter::Compile("(u8@0 == 1", &error));
+	ASSERT_THROW(!EvtFilter::Compile("u8@0 == 1 u8", &error));
+	ASSERT_THROW(!EvtFilter::Compile("u8@0 == -1", &error));
+	ASSERT_THROW(!EvtFilter::Compile("x16@0 == 1", &error));
+	ASSERT_THROW(!EvtFilter::Compile(std::string(EVT_FILTER_MAX_SOURCE, ' '), &error));
+}
+
+static void BenchFilter(const std::string& source, std::uint64_t nframes)
+{
+	std::unique_ptr<EvtFilter> filter = EvtFilter::Compile(source);
+	ASSERT_THROW(filter);
+
+	// Vary the payload so the branches are not trivially predicted
+	std::vector<std::vector<std::uint8_t>> payloads;
+	for(std::uint16_t i = 0; i < 64; i++)
+	{
+		payloads.push_back(MakePayload(i % 8, (i * 37 % 100) / 100.0f, static_cast<std::uint8_t>(i)));
+	}
+
+	std::uint64_t matched = 0;
+	timed_block tb("", false);
+	tb.mstart();
+	for(std::uint64_t i = 0; i < nframes; i++)
+	{
+		const std::vector<std::uint8_t>& payload = payloads[i & 63];
+		matched += filter->match(payload.data(), payload.size());
+	}
+	const float ms = tb.mstop();
+
+	std::printf("%-52s %8.2f ns/frame (%5.1f%% matched)\n", source.c_str(), ms * 1e6 / nframes, 100.0 * matched / nframes);
+}
+
+int main(int argc, char* argv[])
+{
+	const std::uint64_t nframes = argc > 1 ? std::stoull(argv[1]) : 10000000;
+
+	TestLanguage();
+
+	BenchFilter("u16@8 == 3", nframes);
+	BenchFilter("u16@8 == 3 && f32@12 > 0.5", nframes);
+	BenchFilter("(u16@8 == 3 || u16@8 == 5) && f32@12 > 0.5", nframes);
+	BenchFilter("!(u8@0 == 0) && (i32@4 < 10 || f64@16 >= 1.5e3)", nframes);
+	return 0;
+}
@@ -0,0 +1,163 @@
+#include "../mxsystem.h"
+#include "../mxevt.h"
+#include "../mxlogger.h"
+#include "../network/evtfilter.h"
+#include "../network/socket.h"
+#include "test.h"
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/socket.h>
+#endif
+
+// NOTE: (Cesar) Two producers send the fragments of their events interleaved to a filtered subscriber
+// 				 The subscriber must get every fragment of the accepted producer and none of the other
+// 				 Every connection is a raw ghost client so no rdb / rpc server is required
+
+using namespace mulex;
+
+#ifdef __linux__
+static void SendFrame(Socket& socket, const EvtHeader& header, const std::vector<std::uint8_t>& payload)
+{
+	std::vector<std::uint8_t> frame(sizeof(EvtHeader) + payload.size());
+	std::memcpy(frame.data(), &header, sizeof(EvtHeader));
+	if(!payload.empty())
+	{
+		std::memcpy(frame.data() + sizeof(EvtHeader), payload.data(), payload.size());
+	}
+	SocketSendBytes(socket, frame.data(), frame.size());
+}
+
+static void SendFragment(Socket& socket, std::uint64_t cid, std::uint16_t eid, std::uint64_t msgid, std::uint32_t index, std::uint32_t count, std::uint8_t tag)
+{
+	const std::vector<std::uint8_t> payload(64, tag);
+	EvtHeader header{};
+	header.client = cid;
+	header.eventid = eid;
+	header.msgid = msgid;
+	header.flags = EVT_FLAG_FRAGMENT | ((index + 1 == count) ? EVT_FLAG_LAST_FRAGMENT : 0);
+	header.totalsize = static_cast<std::uint32_t>(payload.size() * count);
+	header.payloadsize = static_cast<std::uint32_t>(payload.size());
+	header.fragoffset = static_cast<std::uint32_t>(payload.size() * index);
+	SendFrame(socket, header, payload);
+}
+
+// Reads whole frames until nothing arrives for timeout ms
+static std::vector<EvtHeader> ReceiveFrames(Socket& socket, std::int64_t timeout)
+{
+	std::vector<EvtHeader> frames;
+	std::vector<std::uint8_t> stream;
+	std::vector<std::uint8_t> scratch(64 * 1024);
+	pollfd fd = { socket._handle, POLLIN, 0 };
+	while(::poll(&fd, 1, static_cast<int>(timeout)) > 0)
+	{
+		const std::int64_t res = ::recv(socket._handle, scratch.data(), scratch.size(), MSG_DONTWAIT);
+		if(res <= 0)
+		{
+			break;
+		}
+		stream.insert(stream.end(), scratch.begin(), scratch.begin() + res);
+
+		EvtHeader header;
+		while(stream.size() >= sizeof(EvtHeader))
+		{
+			std::memcpy(&header, stream.data(), sizeof(EvtHeader));
+			if(stream.size() < sizeof(EvtHeader) + header.payloadsize)
+			{
+				break;
+			}
+			frames.push_back(header);
+			stream.erase(stream.begin(), stream.begin() + sizeof(EvtHeader) + header.payloadsize);
+		}
+	}
+	return frames;
+}
+
+int main(void)
+{
+	const std::uint16_t port = EVT_PORT + 90;
+	EvtServerThread est(EvtServerMode::THREADED, 1, port);
+	while(!est.ready())
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	EvtRegister("evtfragments::event");
+	const std::uint16_t eid = EvtGetId("evtfragments::event");
+	const std::uint16_t meta = EvtGetId("mxevt::getclientmeta");
+
+	const std::uint64_t subscriber_id = (static_cast<std::uint64_t>(port) << 32) | 1;
+	const std::uint64_t accepted_id = (static_cast<std::uint64_t>(port) << 32) | 2;
+	const std::uint64_t rejected_id = (static_cast<std::uint64_t>(port) << 32) | 3;
+
+	Socket subscriber = SocketInit();
+	Socket accepted = SocketInit();
+	Socket rejected = SocketInit();
+	SocketConnect(subscriber, "localhost", port);
+	SocketConnect(accepted, "localhost", port);
+	SocketConnect(rejected, "localhost", port);
+
+	EvtHeader metaheader{};
+	metaheader.eventid = meta;
+	metaheader.client = subscriber_id;
+	SendFrame(subscriber, metaheader, {});
+	metaheader.client = accepted_id;
+	SendFrame(accepted, metaheader, {});
+	metaheader.client = rejected_id;
+	SendFrame(rejected, metaheader, {});
+
+	// There is no ack for the metadata frame, give the server time to register everyone
+	std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+	// Only events tagged with 1 pass
+	ASSERT_THROW(EvtSubscribe(subscriber_id, eid, {}, EvtFilter::Compile("u8@0 == 1")));
+
+	// The rejected producer starts its event while the accepted one is midway and the other way around
+	SendFragment(accepted, accepted_id, eid, 1, 0, 3, 1);
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	SendFragment(rejected, rejected_id, eid, 1, 0, 3, 0);
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	SendFragment(accepted, accepted_id, eid, 1, 1, 3, 1);
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	SendFragment(rejected, rejected_id, eid, 1, 1, 3, 0);
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	SendFragment(accepted, accepted_id, eid, 1, 2, 3, 1);
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	SendFragment(rejected, rejected_id, eid, 1, 2, 3, 0);
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+	SendFragment(rejected, rejected_id, eid, 2, 0, 2, 0);
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	SendFragment(accepted, accepted_id, eid, 2, 0, 2, 1);
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	SendFragment(rejected, rejected_id, eid, 2, 1, 2, 0);
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	SendFragment(accepted, accepted_id, eid, 2, 1, 2, 1);
+
+	const std::vector<EvtHeader> frames = ReceiveFrames(subscriber, 500);
+	std::cout << "Received " << frames.size() << " fragments (expected 5)." << std::endl;
+	ASSERT_THROW(frames.size() == 5);
+	for(std::uint64_t i = 0; i < frames.size(); i++)
+	{
+		ASSERT_THROW(frames[i].client == accepted_id);
+		ASSERT_THROW(frames[i].msgid == (i < 3 ? 1 : 2));
+	}
+
+	SocketClose(subscriber);
+	SocketClose(accepted);
+	SocketClose(rejected);
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	return 0;
+}
+#else
+int main(void)
+{
+	std::cout << "test_evtfragments is only available under linux." << std::endl;
+	return 0;
+}
+#endif
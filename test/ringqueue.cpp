@@ -0,0 +1,153 @@
+#include "../mxsystem.h"
+#include "test.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+// NOTE: (Cesar) Microbenchmark for SysRingQueue
+// 				 Checks per producer FIFO ordering, the overflow policies
+// 				 and reports the p50/p99 enqueue and end to end latencies
+// 				 Usage: test_ringqueue [nproducers] [nitems]
+
+using namespace mulex;
+
+struct RingItem
+{
+	std::uint32_t producer = 0;
+	std::uint64_t sequence = 0;
+	std::int64_t  timestamp = 0;
+};
+
+static std::int64_t NowNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static std::int64_t Percentile(std::vector<std::int64_t>& samples, double p)
+{
+	if(samples.empty()) return 0;
+	std::uint64_t idx = static_cast<std::uint64_t>(p * (samples.size() - 1));
+	std::nth_element(samples.begin(), samples.begin() + idx, samples.end());
+	return samples[idx];
+}
+
+static void TestOverflowPolicies()
+{
+	{
+		SysRingQueue<int> queue(4, SysOverflowPolicy::DROP_NEWEST);
+		for(int i = 1; i <= 6; i++) queue.push(i);
+		ASSERT_THROW(queue.size() == 4);
+		ASSERT_THROW(queue.dropped() == 2);
+		for(int i = 1; i <= 4; i++) ASSERT_THROW(queue.pop() == i);
+	}
+
+	{
+		SysRingQueue<int> queue(4, SysOverflowPolicy::DROP_OLDEST);
+		for(int i = 1; i <= 6; i++) queue.push(i);
+		ASSERT_THROW(queue.size() == 4);
+		ASSERT_THROW(queue.dropped() == 2);
+		for(int i = 3; i <= 6; i++) ASSERT_THROW(queue.pop() == i);
+	}
+
+	{
+		SysRingQueue<int> queue(4, SysOverflowPolicy::BLOCK);
+		std::thread consumer([&](){
+			for(int i = 1; i <= 1000; i++) ASSERT_THROW(queue.pop() == i);
+		});
+		for(int i = 1; i <= 1000; i++) ASSERT_THROW(queue.push(i));
+		consumer.join();
+		ASSERT_THROW(queue.dropped() == 0);
+	}
+
+	{
+		SysRingQueue<int> queue(4);
+		std::thread consumer([&](){ ASSERT_THROW(queue.pop() == 0); });
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		queue.requestUnblock();
+		consumer.join();
+	}
+	std::printf("Overflow policies OK.\n");
+}
+
+static void BenchOrderingLatency(std::uint32_t nproducers, std::uint64_t nitems)
+{
+	SysRingQueue<RingItem> queue(1024);
+	std::vector<std::vector<std::int64_t>> enqueue_lat(nproducers);
+	std::vector<std::int64_t> e2e_lat;
+	e2e_lat.reserve(nproducers * nitems);
+
+	std::vector<std::thread> producers;
+	std::int64_t start = NowNs();
+	for(std::uint32_t p = 0; p < nproducers; p++)
+	{
+		enqueue_lat[p].reserve(nitems);
+		producers.emplace_back([&, p](){
+			for(std::uint64_t i = 0; i < nitems; i++)
+			{
+				RingItem item;
+				item.producer = p;
+				item.sequence = i;
+				item.timestamp = NowNs();
+				queue.push(std::move(item));
+				enqueue_lat[p].push_back(NowNs() - item.timestamp);
+			}
+		});
+	}
+
+	// Single consumer, batch pop
+	std::vector<std::uint64_t> next(nproducers, 0);
+	std::vector<RingItem> batch;
+	std::uint64_t total = 0;
+	while(total < nproducers * nitems)
+	{
+		batch.clear();
+		queue.popBatch(batch, 64);
+		std::int64_t now = NowNs();
+		for(const auto& item : batch)
+		{
+			// FIFO per producer
+			ASSERT_THROW(item.sequence == next[item.producer]);
+			next[item.producer]++;
+			e2e_lat.push_back(now - item.timestamp);
+		}
+		total += batch.size();
+	}
+	std::int64_t elapsed = NowNs() - start;
+
+	for(auto& t : producers) t.join();
+
+	std::vector<std::int64_t> enqueue_all;
+	for(auto& v : enqueue_lat) enqueue_all.insert(enqueue_all.end(), v.begin(), v.end());
+
+	std::printf(
+		"producers=%u items=%llu throughput=%.2f Mops/s\n",
+		nproducers,
+		static_cast<unsigned long long>(total),
+		total * 1e3 / elapsed
+	);
+	std::printf(
+		"\tenqueue p50=%lld ns p99=%lld ns | end-to-end p50=%lld ns p99=%lld ns\n",
+		static_cast<long long>(Percentile(enqueue_all, 0.50)),
+		static_cast<long long>(Percentile(enqueue_all, 0.99)),
+		static_cast<long long>(Percentile(e2e_lat, 0.50)),
+		static_cast<long long>(Percentile(e2e_lat, 0.99))
+	);
+}
+
+int main(int argc, char* argv[])
+{
+	std::uint32_t nproducers = 4;
+	std::uint64_t nitems = 250000;
+
+	if(argc > 1) nproducers = static_cast<std::uint32_t>(std::stoul(argv[1]));
+	if(argc > 2) nitems = std::stoull(argv[2]);
+
+	TestOverflowPolicies();
+	for(std::uint32_t p = 1; p <= nproducers; p *= 2)
+	{
+		BenchOrderingLatency(p, nitems);
+	}
+	return 0;
+}
@@ -0,0 +1,119 @@
+#include "../mxrdb.h"
+#include "../network/rpc.h"
+#include "test.h"
+#include <cstdint>
+#include <cstdio>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <rpcspec.inl>
+
+// NOTE: (Cesar) Compares blocking, pipelined and batched small calls over loopback
+// 				 and prints the wire size of the common rdb calls and the server profile
+// 				 Runs its own rpc server so mxmain must not be running on this host
+// 				 Usage: test_rpcbench [ncalls] [batchsize] [workers]
+// 				 With workers > 0 the server runs in reactor mode
+
+using namespace mulex;
+
+static void Report(const char* name, float ms, std::uint64_t ncalls, float baseline)
+{
+	std::printf("%-12s %8.2f us/call %10.0f calls/s (%5.1fx)\n", name, ms * 1e3 / ncalls, ncalls / (ms * 1e-3), baseline / ms);
+}
+
+// Bytes on the wire for the most common rdb calls (fixed size keys vs length prefixed)
+static void ReportWireSize(const char* name, std::uint64_t fixed, std::uint64_t packed)
+{
+	fixed += RPC_MESSAGE_HEADER_SIZE;
+	packed += RPC_MESSAGE_HEADER_SIZE;
+	std::printf("%-24s %5u -> %5u bytes/call (%5.1fx)\n", name, static_cast<unsigned>(fixed), static_cast<unsigned>(packed), static_cast<float>(fixed) / packed);
+}
+
+int main(int argc, char* argv[])
+{
+	const std::uint64_t ncalls = argc > 1 ? std::stoull(argv[1]) : 20000;
+	const std::uint64_t batchsize = argc > 2 ? std::stoull(argv[2]) : 32;
+	const std::uint32_t workers = argc > 3 ? static_cast<std::uint32_t>(std::stoul(argv[3])) : 0;
+
+	RPCServerThread server(workers > 0 ? RPCServerMode::REACTOR : RPCServerMode::THREADED, workers);
+	while(!server.ready())
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	RPCClientThread client("localhost", RPC_PORT, 0x1);
+	ASSERT_THROW(client.isValid());
+	const std::int64_t mark = client.call<std::int64_t>(RPC_CALL_MULEX_SYSGETUPTIMEMARK);
+
+	const RdbKeyName key = "/system/metrics/cpu_usage";
+	const RPCGenericType value = 0.5f;
+	ReportWireSize("RdbWriteValueDirect", sizeof(RdbKeyName) + SysPackedSize(value), SysPackedSize(key, value));
+	ReportWireSize("RdbReadValueDirect", sizeof(RdbKeyName), SysPackedSize(key));
+	ReportWireSize("RdbWatch", sizeof(RdbKeyName), SysPackedSize(key));
+
+	timed_block tb("", false);
+
+	// One round trip per call
+	tb.mstart();
+	for(std::uint64_t i = 0; i < ncalls; i++)
+	{
+		ASSERT_THROW(client.call<std::int64_t>(RPC_CALL_MULEX_SYSGETUPTIMEMARK) == mark);
+	}
+	const float blocking = tb.mstop();
+	Report("blocking", blocking, ncalls, blocking);
+
+	// Up to RPC_WORKER_MAX_CLIENT_DEPTH calls in flight before the first reply is read
+	tb.mstart();
+	std::vector<std::future<std::int64_t>> replies;
+	for(std::uint64_t done = 0; done < ncalls; done += RPC_WORKER_MAX_CLIENT_DEPTH)
+	{
+		replies.clear();
+		for(std::uint64_t i = done; i < std::min(done + RPC_WORKER_MAX_CLIENT_DEPTH, ncalls); i++)
+		{
+			replies.push_back(client.callAsync<std::int64_t>(RPC_CALL_MULEX_SYSGETUPTIMEMARK));
+		}
+		for(auto& reply : replies)
+		{
+			ASSERT_THROW(reply.get() == mark);
+		}
+	}
+	Report("pipelined", tb.mstop(), ncalls, blocking);
+
+	// batchsize calls per frame
+	tb.mstart();
+	for(std::uint64_t done = 0; done < ncalls; done += batchsize)
+	{
+		RPCBatch batch;
+		for(std::uint64_t i = done; i < std::min(done + batchsize, ncalls); i++)
+		{
+			batch.add(RPC_CALL_MULEX_SYSGETUPTIMEMARK);
+		}
+
+		RPCBatchResult result = client.callBatch(batch).get();
+		ASSERT_THROW(result.size() == batch.size());
+		for(std::uint64_t i = 0; i < result.size(); i++)
+		{
+			ASSERT_THROW(result.get<std::int64_t>(i) == mark);
+		}
+	}
+	Report(("batch/" + std::to_string(batchsize)).c_str(), tb.mstop(), ncalls, blocking);
+
+	// Server side view of the same calls
+	const std::vector<RpcCallProfileEntry> profile = client.call<RPCGenericType>(RPC_CALL_MULEX_RPCGETCALLSPROFILE).asVectorType<RpcCallProfileEntry>();
+	ASSERT_THROW(!profile.empty());
+	for(const auto& entry : profile)
+	{
+		std::printf(
+			"proc %-5u calls %-8llu exec p50 %6llu ns p99 %6llu ns total %8.2f ms wait p99 %6llu ns\n",
+			static_cast<unsigned>(entry._procid),
+			static_cast<unsigned long long>(entry._count),
+			static_cast<unsigned long long>(entry._exec_p50),
+			static_cast<unsigned long long>(entry._exec_p99),
+			entry._exec_total * 1e-6,
+			static_cast<unsigned long long>(entry._wait_p99)
+		);
+	}
+	return 0;
+}